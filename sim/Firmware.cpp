@@ -0,0 +1,10 @@
+// Builds the firmware sketch unmodified for the host. FIRMWARE_SOURCE is set by
+// CMake (TREADMILL_SIM_FIRMWARE) so an older revision of the sketch can be
+// measured in the same scenarios.
+#include <Arduino.h>
+
+#ifndef FIRMWARE_SOURCE
+#error "FIRMWARE_SOURCE must name the .ino file to build"
+#endif
+
+#include FIRMWARE_SOURCE
@@ -0,0 +1,46 @@
+#include "FloatController.h"
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+    constexpr float MAX_RPM = 800.0f;
+    constexpr float PWM_MAX = 255.0f;
+    constexpr float RPM_PER_COUNT = 60.0f * 0.6f / (200.0f * FloatController::PERIOD_S);
+    constexpr float RESET_ERROR = 50.0f;
+    constexpr float STARTUP_BOOST = 0.30f;
+}
+
+int16_t FloatController::update(float targetRpm, int32_t counts)
+{
+    targetRpm = std::clamp(targetRpm, -MAX_RPM, MAX_RPM);
+    m_actualRpm = m_actualRpm * 0.7f + counts * RPM_PER_COUNT * 0.3f;
+
+    float error = targetRpm - m_actualRpm;
+    if (std::fabs(error) > RESET_ERROR)
+    {
+        m_integral = 0.0f;
+    }
+
+    float derivative = (error - m_lastError) / PERIOD_S;
+    m_lastError = error;
+
+    float pdff = m_gains.kp * error + m_gains.kd * derivative + m_gains.feedForward * targetRpm;
+    float integral = std::clamp(m_integral + error * PERIOD_S, -MAX_RPM, MAX_RPM);
+    float effort = (pdff + m_gains.ki * integral) / MAX_RPM;
+    if ((effort > 1.0f && error > 0.0f) || (effort < -1.0f && error < 0.0f))
+    {
+        effort = (pdff + m_gains.ki * m_integral) / MAX_RPM;
+    }
+    else
+    {
+        m_integral = integral;
+    }
+
+    if (targetRpm != 0.0f && std::fabs(m_actualRpm) < 1.0f)
+    {
+        effort = targetRpm > 0.0f ? std::max(effort, STARTUP_BOOST) : std::min(effort, -STARTUP_BOOST);
+    }
+
+    return static_cast<int16_t>(std::clamp(effort, -1.0f, 1.0f) * PWM_MAX);
+}
@@ -0,0 +1,36 @@
+#pragma once
+#include <cstdint>
+
+/**
+ * Float reference for the firmware's speed controller
+ * The control law of runControl() written in float, as it stood before the
+ * Q16.16 port: 0.3 low-pass on the per-tick encoder count, PID with reset on
+ * large errors and conditional integration, feed-forward and the startup
+ * boost. Gains are the CalibrationData values (CFG units).
+ */
+class FloatController
+{
+public:
+    struct Gains
+    {
+        float kp = 0.15f;
+        float ki = 0.30f;
+        float kd = 0.0005f;
+        float feedForward = 0.0004f;
+    };
+
+    static constexpr float PERIOD_S = 0.005f;
+
+    explicit FloatController(const Gains &gains) : m_gains(gains) {}
+
+    // One control tick: counts since the last tick, signed towards forward belt motion
+    int16_t update(float targetRpm, int32_t counts);
+
+    float getActualRpm() const { return m_actualRpm; }
+
+private:
+    Gains m_gains;
+    float m_actualRpm = 0.0f;
+    float m_integral = 0.0f;
+    float m_lastError = 0.0f;
+};
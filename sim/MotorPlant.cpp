@@ -0,0 +1,35 @@
+#include "MotorPlant.h"
+#include <cmath>
+
+void MotorPlant::step(double dtS, double duty)
+{
+    double drive = duty / 255.0;
+    double previous = m_rpm;
+
+    if (m_rpm == 0.0 && std::fabs(drive) < m_params.breakawayDuty)
+    {
+        return; // Held by static friction
+    }
+
+    double direction = (m_rpm != 0.0) ? (m_rpm > 0.0 ? 1.0 : -1.0) : (drive > 0.0 ? 1.0 : -1.0);
+    double effective = drive - direction * m_params.coulombDuty;
+    double target = effective * m_params.fullDutyRpm;
+    m_rpm += (target - m_rpm) * (1.0 - std::exp(-dtS / m_params.timeConstantS));
+
+    // Friction brings the belt to rest rather than reversing it
+    if ((previous > 0.0 && m_rpm < 0.0) || (previous < 0.0 && m_rpm > 0.0))
+    {
+        if (std::fabs(drive) < m_params.breakawayDuty)
+        {
+            m_rpm = 0.0;
+        }
+    }
+    m_position += m_params.encoderSign * 0.5 * (previous + m_rpm) * COUNTS_PER_RPM_S * dtS;
+}
+
+void MotorPlant::stepScripted(double nowS, double dtS)
+{
+    double previous = m_rpm;
+    m_rpm = m_script(nowS);
+    m_position += m_params.encoderSign * 0.5 * (previous + m_rpm) * COUNTS_PER_RPM_S * dtS;
+}
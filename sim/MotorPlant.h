@@ -0,0 +1,49 @@
+#pragma once
+#include <functional>
+
+/**
+ * One belt: DC motor, driver and quadrature encoder
+ * First-order speed response to duty with Coulomb friction and breakaway, in
+ * the firmware's belt RPM units (RPM_SCALE applied). The encoder position is
+ * in quadrature counts, ENCODER_CPR per shaft revolution, and may be wired to
+ * count backwards. A script can replace the dynamics with a known speed
+ * profile, e.g. to feed the firmware a synthetic encoder signal.
+ */
+class MotorPlant
+{
+public:
+    static constexpr double ENCODER_CPR = 200.0;
+    static constexpr double RPM_SCALE = 0.6;
+    static constexpr double COUNTS_PER_RPM_S = ENCODER_CPR / (60.0 * RPM_SCALE); // Counts per second at 1 RPM
+
+    struct Params
+    {
+        double fullDutyRpm = 1000.0; // Steady-state speed at 100% duty, friction aside
+        double timeConstantS = 0.12;
+        double coulombDuty = 0.05;   // Duty fraction lost to friction while moving
+        double breakawayDuty = 0.08; // Duty fraction needed to start from standstill
+        int encoderSign = 1;         // -1: counts down for forward belt motion
+    };
+
+    MotorPlant() = default;
+    explicit MotorPlant(const Params &params) : m_params(params) {}
+
+    void setParams(const Params &params) { m_params = params; }
+
+    // duty: -255..255 towards forward belt motion; 0 while the driver sleeps
+    void step(double dtS, double duty);
+    // Speed in RPM as a function of time in seconds; replaces the dynamics when set
+    void setScript(std::function<double(double)> script) { m_script = std::move(script); }
+    bool isScripted() const { return static_cast<bool>(m_script); }
+    // Follows the script to time `nowS`
+    void stepScripted(double nowS, double dtS);
+
+    double rpm() const { return m_rpm; }
+    double position() const { return m_position; } // Encoder counts, fractional
+
+private:
+    Params m_params;
+    std::function<double(double)> m_script;
+    double m_rpm = 0.0;
+    double m_position = 0.0;
+};
@@ -0,0 +1,410 @@
+#include "SimBoard.h"
+#include "arduino/Arduino.h"
+#include "arduino/EEPROM.h"
+#include "arduino/Encoder.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+HardwareSerial Serial;
+EEPROMClass EEPROM;
+
+namespace
+{
+    // The firmware's pin table (MOTOR_PINS, ENCODER_PIN_A, ENCODER_TIMING_PIN)
+    struct MotorWiring
+    {
+        uint8_t pwm;
+        uint8_t dir;
+        uint8_t sleep;
+        uint8_t encoderA;
+        uint8_t timing;
+        uint8_t forwardDir; // DIR level for forward belt motion; motor 2 is mounted mirrored
+    };
+
+    constexpr MotorWiring WIRING[SimBoard::MOTORS] = {
+        {3, 4, 5, 22, 2, HIGH},
+        {6, 7, 8, 26, 19, LOW}};
+
+    // Channel A is high for half of every 4 quadrature counts
+    int64_t floorCount(double position)
+    {
+        return static_cast<int64_t>(std::floor(position));
+    }
+
+    bool risingEdgeAt(int64_t boundary, bool upwards)
+    {
+        int64_t phase = ((boundary % 4) + 4) % 4;
+        return upwards ? phase == 0 : phase == 2;
+    }
+}
+
+SimBoard &SimBoard::instance()
+{
+    static SimBoard board;
+    return board;
+}
+
+SimBoard::SimBoard() = default;
+
+void SimBoard::advance(double us)
+{
+    double end = m_nowUs + us;
+    std::vector<Edge> edges;
+    while (m_nowUs < end)
+    {
+        double to = std::min(end, m_nowUs + STEP_US);
+        edges.clear();
+        stepMotors(m_nowUs, to, edges);
+
+        // Edge-timing interrupts, in time order; the ISR reads micros() at its edge
+        std::sort(edges.begin(), edges.end(), [](const Edge &a, const Edge &b)
+                  { return a.us < b.us; });
+        for (const Edge &edge : edges)
+        {
+            auto isr = m_isrs.find(WIRING[edge.motor].timing);
+            if (m_timingPinsWired && isr != m_isrs.end())
+            {
+                m_nowUs = std::max(m_nowUs, edge.us);
+                isr->second();
+            }
+        }
+
+        moveUart(to);
+        m_nowUs = to;
+    }
+}
+
+void SimBoard::stepMotors(double fromUs, double toUs, std::vector<Edge> &edges)
+{
+    double dtS = (toUs - fromUs) * 1e-6;
+    for (int i = 0; i < MOTORS; ++i)
+    {
+        MotorPlant &motor = m_motors[i];
+        double before = motor.position();
+        if (motor.isScripted())
+        {
+            motor.stepScripted(toUs * 1e-6, dtS);
+        }
+        else
+        {
+            motor.step(dtS, appliedDuty(i));
+        }
+        double after = motor.position();
+
+        // Rising edges of channel A crossed during the step, at interpolated times
+        int64_t from = floorCount(before);
+        int64_t to = floorCount(after);
+        bool upwards = to > from;
+        for (int64_t boundary = upwards ? from + 1 : from; upwards ? boundary <= to : boundary > to;
+             boundary += upwards ? 1 : -1)
+        {
+            if (risingEdgeAt(boundary, upwards))
+            {
+                double fraction = (static_cast<double>(boundary) - before) / (after - before);
+                edges.push_back({fromUs + fraction * (toUs - fromUs), i});
+            }
+        }
+    }
+}
+
+void SimBoard::moveUart(double toUs)
+{
+    while (!m_rxWire.empty() && m_rxWire.front().first <= toUs)
+    {
+        if (m_rxBuffer.size() < UART_BUFFER_BYTES)
+        {
+            m_rxBuffer.push_back(m_rxWire.front().second);
+        }
+        else
+        {
+            m_rxOverruns++;
+        }
+        m_rxWire.pop_front();
+    }
+
+    while (!m_txBuffer.empty() && m_txDoneUs <= toUs)
+    {
+        char c = static_cast<char>(m_txBuffer.front());
+        m_txBuffer.pop_front();
+        if (c == '\n')
+        {
+            if (!m_txLine.empty() && m_txLine.back() == '\r')
+            {
+                m_txLine.pop_back();
+            }
+            m_received.push_back({m_txDoneUs, m_txLine});
+            m_txLine.clear();
+        }
+        else
+        {
+            m_txLine += c;
+        }
+        if (!m_txBuffer.empty())
+        {
+            m_txDoneUs += m_byteUs;
+        }
+    }
+}
+
+bool SimBoard::isDriverEnabled(int index) const
+{
+    return readPin(WIRING[index].sleep) == HIGH;
+}
+
+double SimBoard::appliedDuty(int index) const
+{
+    if (!isDriverEnabled(index))
+    {
+        return 0.0;
+    }
+    auto pwm = m_pins.find(WIRING[index].pwm);
+    double duty = (pwm != m_pins.end()) ? pwm->second : 0.0;
+    return readPin(WIRING[index].dir) == WIRING[index].forwardDir ? duty : -duty;
+}
+
+void SimBoard::hostSend(const std::string &text)
+{
+    double at = std::max(m_rxWireFreeUs, m_nowUs);
+    for (char c : text)
+    {
+        at += m_byteUs;
+        m_rxWire.emplace_back(at, static_cast<uint8_t>(c));
+    }
+    m_rxWireFreeUs = at;
+}
+
+std::vector<SimBoard::ReceivedLine> SimBoard::takeLines()
+{
+    std::vector<ReceivedLine> lines;
+    lines.swap(m_received);
+    return lines;
+}
+
+void SimBoard::setPinMode(uint8_t pin, uint8_t mode)
+{
+    if (mode == INPUT_PULLUP && m_pins.find(pin) == m_pins.end())
+    {
+        m_pins[pin] = HIGH;
+    }
+}
+
+void SimBoard::writePin(uint8_t pin, uint8_t value)
+{
+    m_pins[pin] = value;
+}
+
+int SimBoard::readPin(uint8_t pin) const
+{
+    auto level = m_pins.find(pin);
+    return level != m_pins.end() ? level->second : LOW;
+}
+
+void SimBoard::writeAnalog(uint8_t pin, int value)
+{
+    m_pins[pin] = value;
+    if (pin == WIRING[0].pwm)
+    {
+        m_pwmUpdates.push_back(m_nowUs);
+    }
+}
+
+void SimBoard::attachIsr(uint8_t pin, void (*isr)())
+{
+    m_isrs[pin] = isr;
+}
+
+int SimBoard::motorForEncoder(uint8_t pinA) const
+{
+    return pinA == WIRING[1].encoderA ? 1 : 0;
+}
+
+int32_t SimBoard::encoderCount(uint8_t pinA) const
+{
+    int motor = motorForEncoder(pinA);
+    return static_cast<int32_t>(floorCount(m_motors[motor].position()) - m_encoderOffset[motor]);
+}
+
+void SimBoard::setEncoderCount(uint8_t pinA, int32_t count)
+{
+    int motor = motorForEncoder(pinA);
+    m_encoderOffset[motor] = static_cast<int32_t>(floorCount(m_motors[motor].position()) - count);
+}
+
+void SimBoard::serialBegin(unsigned long baud)
+{
+    m_baud = baud;
+    m_byteUs = 10.0e6 / baud; // 8N1
+    m_rxBuffer.clear();
+}
+
+int SimBoard::serialAvailable()
+{
+    advance(CALL_COST_US);
+    return static_cast<int>(m_rxBuffer.size());
+}
+
+int SimBoard::serialRead()
+{
+    if (m_rxBuffer.empty())
+    {
+        return -1;
+    }
+    int c = m_rxBuffer.front();
+    m_rxBuffer.pop_front();
+    return c;
+}
+
+int SimBoard::serialAvailableForWrite()
+{
+    advance(CALL_COST_US);
+    return static_cast<int>(UART_BUFFER_BYTES - m_txBuffer.size());
+}
+
+void SimBoard::serialWrite(uint8_t byte)
+{
+    // HardwareSerial::write waits for room, exactly what the firmware must avoid in loop()
+    while (m_txBuffer.size() >= UART_BUFFER_BYTES)
+    {
+        advance(std::max(m_txDoneUs - m_nowUs, 0.0) + 0.001);
+    }
+    if (m_txBuffer.empty())
+    {
+        m_txDoneUs = m_nowUs + m_byteUs;
+    }
+    m_txBuffer.push_back(byte);
+}
+
+void SimBoard::serialFlush()
+{
+    while (!m_txBuffer.empty())
+    {
+        advance(std::max(m_txDoneUs - m_nowUs, 0.0) + 0.001);
+    }
+}
+
+// ---- Arduino core ----
+
+unsigned long millis()
+{
+    return static_cast<unsigned long>(SimBoard::instance().nowUs() / 1000.0);
+}
+
+unsigned long micros()
+{
+    return static_cast<unsigned long>(SimBoard::instance().nowUs());
+}
+
+void delay(unsigned long ms)
+{
+    SimBoard::instance().advance(ms * 1000.0);
+}
+
+void pinMode(uint8_t pin, uint8_t mode)
+{
+    SimBoard::instance().setPinMode(pin, mode);
+}
+
+void digitalWrite(uint8_t pin, uint8_t value)
+{
+    SimBoard::instance().writePin(pin, value);
+}
+
+int digitalRead(uint8_t pin)
+{
+    return SimBoard::instance().readPin(pin);
+}
+
+void analogWrite(uint8_t pin, int value)
+{
+    SimBoard::instance().writeAnalog(pin, value);
+}
+
+void attachInterrupt(uint8_t interrupt, void (*isr)(), int)
+{
+    SimBoard::instance().attachIsr(interrupt, isr);
+}
+
+// Interrupts only ever run inside advance(), which the firmware never calls with them masked
+void noInterrupts()
+{
+}
+
+void interrupts()
+{
+}
+
+void HardwareSerial::begin(unsigned long baud)
+{
+    SimBoard::instance().serialBegin(baud);
+}
+
+int HardwareSerial::available()
+{
+    return SimBoard::instance().serialAvailable();
+}
+
+int HardwareSerial::read()
+{
+    return SimBoard::instance().serialRead();
+}
+
+int HardwareSerial::availableForWrite()
+{
+    return SimBoard::instance().serialAvailableForWrite();
+}
+
+void HardwareSerial::flush()
+{
+    SimBoard::instance().serialFlush();
+}
+
+size_t HardwareSerial::write(uint8_t byte)
+{
+    SimBoard::instance().serialWrite(byte);
+    return 1;
+}
+
+size_t HardwareSerial::write(const uint8_t *data, size_t length)
+{
+    for (size_t i = 0; i < length; ++i)
+    {
+        SimBoard::instance().serialWrite(data[i]);
+    }
+    return length;
+}
+
+size_t HardwareSerial::print(long value, int)
+{
+    char text[24];
+    int length = std::snprintf(text, sizeof(text), "%ld", value);
+    return write(text, static_cast<size_t>(length));
+}
+
+size_t HardwareSerial::print(unsigned long value, int)
+{
+    char text[24];
+    int length = std::snprintf(text, sizeof(text), "%lu", value);
+    return write(text, static_cast<size_t>(length));
+}
+
+size_t HardwareSerial::print(double value, int digits)
+{
+    char text[48];
+    int length = std::snprintf(text, sizeof(text), "%.*f", digits, value);
+    return write(text, static_cast<size_t>(length));
+}
+
+Encoder::Encoder(uint8_t pinA, uint8_t) : m_pinA(pinA)
+{
+}
+
+int32_t Encoder::read()
+{
+    return SimBoard::instance().encoderCount(m_pinA);
+}
+
+void Encoder::write(int32_t count)
+{
+    SimBoard::instance().setEncoderCount(m_pinA, count);
+}
@@ -0,0 +1,102 @@
+#pragma once
+#include "MotorPlant.h"
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+ * Arduino Mega running the treadmill firmware, simulated on the host
+ * Backs the Arduino core stand-ins in sim/arduino. Time only moves in
+ * advance(): between loop() iterations (the scenario charges each one a fixed
+ * cost) and whenever the firmware waits on the UART. While it moves, the belts
+ * respond to the firmware's PWM/DIR/SLEEP pins, their encoders count and fire
+ * the edge-timing interrupts, and the UART carries bytes both ways at the baud
+ * rate the firmware set. The firmware's own CPU time is not modelled.
+ */
+class SimBoard
+{
+public:
+    static constexpr int MOTORS = 2;
+    static constexpr double STEP_US = 10.0;          // Integration step
+    static constexpr double CALL_COST_US = 1.0;      // Serial.available()/availableForWrite()
+    static constexpr size_t UART_BUFFER_BYTES = 63;  // Usable bytes of each 64 byte HardwareSerial ring
+
+    struct ReceivedLine
+    {
+        double us; // Last byte off the wire
+        std::string text;
+    };
+
+    static SimBoard &instance();
+
+    double nowUs() const { return m_nowUs; }
+    void advance(double us);
+
+    // ---- Wiring and motors ----
+    MotorPlant &motor(int index) { return m_motors[index]; }
+    // Channel A also on the edge-timing interrupt pins (2 and 19), as ENCODER_EDGE_TIMING expects
+    void setTimingPinsWired(bool wired) { m_timingPinsWired = wired; }
+    bool isDriverEnabled(int index) const;
+    // Signed duty the driver applies, towards forward belt motion
+    double appliedDuty(int index) const;
+    // Times of every PWM update of the left motor: one per control tick
+    const std::vector<double> &getPwmUpdates() const { return m_pwmUpdates; }
+
+    // ---- Host side of the serial link ----
+    void hostSend(const std::string &text);
+    // Complete lines received since the last call, without their line ending
+    std::vector<ReceivedLine> takeLines();
+    uint64_t getRxOverruns() const { return m_rxOverruns; }
+    unsigned long getBaud() const { return m_baud; }
+
+    // ---- Firmware side (Arduino core) ----
+    void setPinMode(uint8_t pin, uint8_t mode);
+    void writePin(uint8_t pin, uint8_t value);
+    int readPin(uint8_t pin) const;
+    void writeAnalog(uint8_t pin, int value);
+    void attachIsr(uint8_t pin, void (*isr)());
+    int32_t encoderCount(uint8_t pinA) const;
+    void setEncoderCount(uint8_t pinA, int32_t count);
+
+    void serialBegin(unsigned long baud);
+    int serialAvailable();
+    int serialRead();
+    int serialAvailableForWrite();
+    void serialWrite(uint8_t byte);
+    void serialFlush();
+
+private:
+    struct Edge
+    {
+        double us;
+        int motor;
+    };
+
+    SimBoard();
+    int motorForEncoder(uint8_t pinA) const;
+    void stepMotors(double fromUs, double toUs, std::vector<Edge> &edges);
+    void moveUart(double toUs);
+
+    double m_nowUs = 0.0;
+    MotorPlant m_motors[MOTORS];
+    bool m_timingPinsWired = false;
+    std::map<uint8_t, int> m_pins;
+    std::map<uint8_t, void (*)()> m_isrs;
+    int32_t m_encoderOffset[MOTORS] = {0, 0};
+    std::vector<double> m_pwmUpdates;
+
+    unsigned long m_baud = 0;
+    double m_byteUs = 20.0;
+    std::deque<std::pair<double, uint8_t>> m_rxWire; // Arrival time, byte
+    double m_rxWireFreeUs = 0.0;
+    std::deque<uint8_t> m_rxBuffer;
+    uint64_t m_rxOverruns = 0;
+    std::deque<uint8_t> m_txBuffer;
+    double m_txDoneUs = 0.0; // When the byte at the front is fully sent
+    std::string m_txLine;
+    std::vector<ReceivedLine> m_received;
+};
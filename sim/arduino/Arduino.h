@@ -0,0 +1,107 @@
+#pragma once
+// Host stand-in for the Arduino core: just what the treadmill firmware uses, backed by SimBoard.
+// int is 32 bits here rather than the AVR's 16; the firmware sizes its arithmetic explicitly.
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <type_traits>
+
+using std::abs;
+
+#define HIGH 1
+#define LOW 0
+#define INPUT 0
+#define OUTPUT 1
+#define INPUT_PULLUP 2
+#define CHANGE 1
+#define FALLING 2
+#define RISING 3
+#define DEC 10
+
+#define SERIAL_TX_BUFFER_SIZE 64
+#define SERIAL_RX_BUFFER_SIZE 64
+
+// Program memory is ordinary memory on the host
+class __FlashStringHelper;
+#define F(string) (reinterpret_cast<const __FlashStringHelper *>(string))
+#define PROGMEM
+#define PGM_P const char *
+#define pgm_read_byte(address) (*reinterpret_cast<const uint8_t *>(address))
+#define strlen_P strlen
+#define memcpy_P memcpy
+
+template <typename T, typename L, typename H>
+T constrain(T value, L low, H high)
+{
+    return value < low ? static_cast<T>(low) : (value > high ? static_cast<T>(high) : value);
+}
+
+// The core's min/max are macros; the usual arithmetic conversions give the same result type
+template <typename A, typename B>
+typename std::common_type<A, B>::type min(A a, B b)
+{
+    return a < b ? a : b;
+}
+
+template <typename A, typename B>
+typename std::common_type<A, B>::type max(A a, B b)
+{
+    return a > b ? a : b;
+}
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t value);
+int digitalRead(uint8_t pin);
+void analogWrite(uint8_t pin, int value);
+
+// Interrupt numbers are the pin numbers themselves
+inline uint8_t digitalPinToInterrupt(uint8_t pin) { return pin; }
+void attachInterrupt(uint8_t interrupt, void (*isr)(), int mode);
+void noInterrupts();
+void interrupts();
+
+class HardwareSerial
+{
+public:
+    void begin(unsigned long baud);
+    int available();
+    int read();
+    int availableForWrite();
+    void flush();
+
+    size_t write(uint8_t byte);
+    size_t write(const uint8_t *data, size_t length);
+    size_t write(const char *data, size_t length) { return write(reinterpret_cast<const uint8_t *>(data), length); }
+
+    size_t print(const __FlashStringHelper *text) { return print(reinterpret_cast<const char *>(text)); }
+    size_t print(const char *text) { return write(text, strlen(text)); }
+    size_t print(char c) { return write(static_cast<uint8_t>(c)); }
+    size_t print(unsigned char value, int base = DEC) { return print(static_cast<unsigned long>(value), base); }
+    size_t print(int value, int base = DEC) { return print(static_cast<long>(value), base); }
+    size_t print(unsigned int value, int base = DEC) { return print(static_cast<unsigned long>(value), base); }
+    size_t print(long value, int base = DEC);
+    size_t print(unsigned long value, int base = DEC);
+    size_t print(double value, int digits = 2);
+
+    template <typename T>
+    size_t println(T value)
+    {
+        size_t n = print(value);
+        return n + println();
+    }
+    template <typename T>
+    size_t println(T value, int format)
+    {
+        size_t n = print(value, format);
+        return n + println();
+    }
+    size_t println() { return write("\r\n", 2); }
+};
+
+extern HardwareSerial Serial;
@@ -0,0 +1,34 @@
+#pragma once
+// Host stand-in for the Arduino EEPROM library; starts erased (0xFF) like a new board
+#include <cstdint>
+#include <cstring>
+
+class EEPROMClass
+{
+public:
+    static constexpr int SIZE = 4096; // ATmega2560
+
+    EEPROMClass() { memset(m_bytes, 0xFF, sizeof(m_bytes)); }
+
+    uint8_t read(int address) const { return m_bytes[address]; }
+    void write(int address, uint8_t value) { m_bytes[address] = value; }
+
+    template <typename T>
+    T &get(int address, T &value) const
+    {
+        memcpy(&value, m_bytes + address, sizeof(T));
+        return value;
+    }
+
+    template <typename T>
+    const T &put(int address, const T &value)
+    {
+        memcpy(m_bytes + address, &value, sizeof(T));
+        return value;
+    }
+
+private:
+    uint8_t m_bytes[SIZE];
+};
+
+extern EEPROMClass EEPROM;
@@ -0,0 +1,15 @@
+#pragma once
+// Host stand-in for the PJRC Encoder library: quadrature counts come from SimBoard's motor model
+#include <cstdint>
+
+class Encoder
+{
+public:
+    Encoder(uint8_t pinA, uint8_t pinB);
+
+    int32_t read();
+    void write(int32_t count);
+
+private:
+    uint8_t m_pinA;
+};
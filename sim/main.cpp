@@ -0,0 +1,722 @@
+// Host simulator for the treadmill firmware: runs the unmodified sketch
+// against simulated belts and a simulated serial link, one scenario per run.
+#include "FloatController.h"
+#include "SimBoard.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+
+// The sketch (Firmware.cpp)
+void setup();
+void loop();
+
+namespace
+{
+    // Fixed cost charged per loop() pass: the firmware's own CPU time is not
+    // modelled, so this stands in for a typical idle pass on the Mega
+    constexpr double LOOP_COST_US = 40.0;
+
+    SimBoard &board()
+    {
+        return SimBoard::instance();
+    }
+
+    // Longest time spent inside a single loop() pass (waiting on the UART), since reset
+    double longestLoopUs = 0.0;
+
+    void loopOnce()
+    {
+        double passStartUs = board().nowUs();
+        loop();
+        longestLoopUs = std::max(longestLoopUs, board().nowUs() - passStartUs);
+        board().advance(LOOP_COST_US);
+    }
+
+    // Runs the firmware until `untilUs`, calling `each` after every loop() pass
+    void runUntil(double untilUs, const std::function<void()> &each = nullptr)
+    {
+        while (board().nowUs() < untilUs)
+        {
+            loopOnce();
+            if (each)
+            {
+                each();
+            }
+        }
+    }
+
+    void boot()
+    {
+        setup();
+        runUntil(board().nowUs() + 50000.0);
+        board().takeLines();
+    }
+
+    void send(const std::string &line)
+    {
+        board().hostSend(line + "\n");
+    }
+
+    std::vector<std::string> splitFields(const std::string &line)
+    {
+        std::vector<std::string> fields;
+        size_t start = 0;
+        while (true)
+        {
+            size_t comma = line.find(',', start);
+            fields.push_back(line.substr(start, comma - start));
+            if (comma == std::string::npos)
+            {
+                return fields;
+            }
+            start = comma + 1;
+        }
+    }
+
+    // ---- step: Q16 firmware against the float reference ----
+
+    struct Step
+    {
+        double atS;
+        float rpm;
+    };
+
+    const Step STEPS[] = {{0.5, 200.0f}, {3.0, 500.0f}, {5.5, 100.0f}, {8.0, -200.0f}, {10.5, 0.0f}};
+    constexpr double STEP_RUN_S = 13.0;
+    constexpr double SETPOINT_PERIOD_S = 0.05; // SPD stream rate, as TreadmillController streams
+    constexpr double SAMPLE_US = 100.0;
+    constexpr double MATCH_MS = 5.0;
+
+    struct Trace
+    {
+        std::vector<double> rpm[SimBoard::MOTORS];
+    };
+
+    // Response of one belt to one step: when it crossed 10%, 50% and 90% of
+    // the way to the new target, in ms after the step command
+    struct StepTiming
+    {
+        double crossing[3] = {NAN, NAN, NAN};
+        double overshoot = 0.0; // Peak RPM past the new target
+    };
+
+    const double CROSSING_FRACTIONS[3] = {0.1, 0.5, 0.9};
+
+    StepTiming measureStep(const std::vector<double> &rpm, size_t from, size_t to, float before, float after)
+    {
+        StepTiming timing;
+        double span = after - before;
+        for (size_t i = from; i < to; ++i)
+        {
+            double progress = (rpm[i] - before) / span;
+            for (int c = 0; c < 3; ++c)
+            {
+                if (std::isnan(timing.crossing[c]) && progress >= CROSSING_FRACTIONS[c])
+                {
+                    timing.crossing[c] = (i - from) * SAMPLE_US / 1000.0;
+                }
+            }
+            timing.overshoot = std::max(timing.overshoot, (rpm[i] - after) * (span > 0 ? 1.0 : -1.0));
+        }
+        return timing;
+    }
+
+    int runStep()
+    {
+        MotorPlant::Params params;
+        MotorPlant::Params mirrored = params;
+        mirrored.encoderSign = -1;
+        board().motor(0).setParams(params);
+        board().motor(1).setParams(mirrored);
+        MotorPlant referencePlant[SimBoard::MOTORS] = {MotorPlant(params), MotorPlant(mirrored)};
+
+        FloatController::Gains gains;
+        gains.kp = 1.5f;
+        gains.ki = 6.0f;
+        gains.kd = 0.001f;
+        gains.feedForward = 0.8f;
+        FloatController reference[SimBoard::MOTORS] = {FloatController(gains), FloatController(gains)};
+
+        boot();
+        char line[48];
+        const char *keys[] = {"KP", "KI", "KD", "FF"};
+        const float values[] = {gains.kp, gains.ki, gains.kd, gains.feedForward};
+        for (int k = 0; k < 4; ++k)
+        {
+            for (int m = 1; m <= 2; ++m)
+            {
+                std::snprintf(line, sizeof(line), "CFG,%s%d,%g", keys[k], m, values[k]);
+                send(line);
+            }
+        }
+        send("CFG,ENC1,1");
+        send("CFG,ENC2,-1");
+        send("STREAM");
+        runUntil(board().nowUs() + 20000.0);
+
+        // The reference belts tick at the firmware's tick instants (its PWM
+        // updates) and see each setpoint once its SPD line has crossed the
+        // link, so the two sides differ only in their arithmetic
+        double startUs = board().nowUs();
+        double nextSetpointUs = startUs;
+        double nextSampleUs = startUs;
+        double referenceUs = startUs;
+        size_t ticksSeen = board().getPwmUpdates().size();
+        int16_t referenceDuty[SimBoard::MOTORS] = {0, 0};
+        int64_t referenceCount[SimBoard::MOTORS] = {0, 0};
+        float target = 0.0f;
+        float referenceTarget = 0.0f;
+        std::vector<std::pair<double, float>> inFlight; // Arrival time, setpoint
+        uint32_t seq = 0;
+        Trace firmwareTrace;
+        Trace referenceTrace;
+
+        auto advanceReference = [&](double toUs)
+        {
+            while (referenceUs < toUs)
+            {
+                double stepUs = std::min(SimBoard::STEP_US, toUs - referenceUs);
+                for (int m = 0; m < SimBoard::MOTORS; ++m)
+                {
+                    referencePlant[m].step(stepUs * 1e-6, referenceDuty[m]);
+                }
+                referenceUs += stepUs;
+            }
+        };
+
+        auto each = [&]()
+        {
+            double now = board().nowUs();
+            double elapsedS = (now - startUs) * 1e-6;
+            for (const Step &step : STEPS)
+            {
+                if (elapsedS >= step.atS)
+                {
+                    target = step.rpm;
+                }
+            }
+
+            const std::vector<double> &ticks = board().getPwmUpdates();
+            for (; ticksSeen < ticks.size(); ++ticksSeen)
+            {
+                advanceReference(ticks[ticksSeen]);
+                while (!inFlight.empty() && inFlight.front().first <= referenceUs)
+                {
+                    referenceTarget = inFlight.front().second;
+                    inFlight.erase(inFlight.begin());
+                }
+                for (int m = 0; m < SimBoard::MOTORS; ++m)
+                {
+                    int64_t count = static_cast<int64_t>(std::floor(referencePlant[m].position()));
+                    int32_t counts = static_cast<int32_t>(count - referenceCount[m]);
+                    referenceCount[m] = count;
+                    referenceDuty[m] = reference[m].update(referenceTarget, m == 1 ? -counts : counts);
+                }
+            }
+            advanceReference(now);
+
+            if (now >= nextSetpointUs)
+            {
+                std::snprintf(line, sizeof(line), "SPD,%.3f,%.3f,%u", target, target, ++seq);
+                send(line);
+                inFlight.emplace_back(now + (std::strlen(line) + 1) * 10.0e6 / board().getBaud(), target);
+                nextSetpointUs += SETPOINT_PERIOD_S * 1e6;
+            }
+
+            while (nextSampleUs <= now)
+            {
+                for (int m = 0; m < SimBoard::MOTORS; ++m)
+                {
+                    firmwareTrace.rpm[m].push_back(board().motor(m).rpm());
+                    referenceTrace.rpm[m].push_back(referencePlant[m].rpm());
+                }
+                nextSampleUs += SAMPLE_US;
+            }
+        };
+        runUntil(startUs + STEP_RUN_S * 1e6, each);
+
+        std::printf("Step response, Q16 firmware vs float reference (plant belt RPM; ms after the step)\n");
+        std::printf("%-11s %4s %15s %15s %15s %15s %9s\n", "step", "belt", "10% fw/ref", "50% fw/ref", "90% fw/ref",
+                    "overshoot", "max diff");
+        double worst = 0.0;
+        double worstRpm = 0.0;
+        float before = 0.0f;
+        size_t steps = sizeof(STEPS) / sizeof(STEPS[0]);
+        for (size_t s = 0; s < steps; ++s)
+        {
+            size_t from = static_cast<size_t>(STEPS[s].atS * 1e6 / SAMPLE_US);
+            size_t to = static_cast<size_t>((s + 1 < steps ? STEPS[s + 1].atS : STEP_RUN_S) * 1e6 / SAMPLE_US);
+            for (int m = 0; m < SimBoard::MOTORS; ++m)
+            {
+                to = std::min(to, firmwareTrace.rpm[m].size());
+                StepTiming fw = measureStep(firmwareTrace.rpm[m], from, to, before, STEPS[s].rpm);
+                StepTiming ref = measureStep(referenceTrace.rpm[m], from, to, before, STEPS[s].rpm);
+                double maxDiff = 0.0;
+                for (size_t i = from; i < to; ++i)
+                {
+                    maxDiff = std::max(maxDiff, std::fabs(firmwareTrace.rpm[m][i] - referenceTrace.rpm[m][i]));
+                }
+                worstRpm = std::max(worstRpm, maxDiff);
+
+                char name[32];
+                std::snprintf(name, sizeof(name), "%g->%g", before, STEPS[s].rpm);
+                std::printf("%-11s %4d", name, m + 1);
+                for (int c = 0; c < 3; ++c)
+                {
+                    std::printf(" %7.1f/%-7.1f", fw.crossing[c], ref.crossing[c]);
+                    double diff = std::fabs(fw.crossing[c] - ref.crossing[c]);
+                    worst = std::max(worst, std::isnan(diff) ? INFINITY : diff);
+                }
+                std::printf(" %7.1f/%-7.1f %9.2f\n", fw.overshoot, ref.overshoot, maxDiff);
+            }
+            before = STEPS[s].rpm;
+        }
+
+        std::printf("Largest crossing time difference: %.1f ms (limit %.0f ms); largest speed difference %.2f RPM\n",
+                    worst, MATCH_MS, worstRpm);
+        return worst <= MATCH_MS ? 0 : 1;
+    }
+    // ---- encoder: speed estimate against a synthetic encoder signal ----
+
+#if defined(ENCODER_EDGE_TIMING) && ENCODER_EDGE_TIMING
+    constexpr bool EDGE_TIMING_BUILD = true;
+#else
+    constexpr bool EDGE_TIMING_BUILD = false;
+#endif
+
+    // Held speeds, belt RPM; each band lasts BAND_S and is measured after BAND_SETTLE_S
+    const double BANDS[] = {3.0, 5.0, 10.0, 20.0, 50.0, 100.0, 200.0, 400.0, 700.0, -5.0, -100.0};
+    constexpr double BAND_S = 2.0;
+    constexpr double BAND_SETTLE_S = 0.5;
+    constexpr double BAND_BIAS_LIMIT = 0.02; // Mean error allowed, fraction of the speed
+    constexpr double BAND_BIAS_FLOOR_RPM = 0.5;
+    constexpr double CONTROL_PERIOD_S = 0.005;
+
+    struct BandStats
+    {
+        int samples = 0;
+        double errorSum = 0.0;
+        double maxError = 0.0;
+        int quality[4] = {0, 0, 0, 0}; // By SpeedQuality
+    };
+
+    int runEncoder()
+    {
+        // The belts follow the script regardless of drive; encoder 2 is mounted mirrored
+        size_t bands = sizeof(BANDS) / sizeof(BANDS[0]);
+        double startS = 0.1;
+        auto script = [startS, bands](double nowS)
+        {
+            double t = nowS - startS;
+            if (t < 0.0)
+            {
+                return 0.0;
+            }
+            size_t band = static_cast<size_t>(t / BAND_S);
+            return band < bands ? BANDS[band] : 0.0;
+        };
+        MotorPlant::Params mirrored;
+        mirrored.encoderSign = -1;
+        board().motor(1).setParams(mirrored);
+        board().motor(0).setScript(script);
+        board().motor(1).setScript(script);
+        board().setTimingPinsWired(EDGE_TIMING_BUILD);
+
+        boot();
+        send("CFG,ENC1,1");
+        send("CFG,ENC2,-1");
+        send("STREAM");
+
+        // A nonzero setpoint stream keeps telemetry flowing; the belts ignore the drive
+        std::vector<BandStats> stats(bands * SimBoard::MOTORS);
+        double nextSetpointUs = board().nowUs();
+        auto each = [&]()
+        {
+            if (board().nowUs() >= nextSetpointUs)
+            {
+                send("SPD,100,100");
+                nextSetpointUs += SETPOINT_PERIOD_S * 1e6;
+            }
+
+            for (const SimBoard::ReceivedLine &line : board().takeLines())
+            {
+                std::vector<std::string> fields = splitFields(line.text);
+                if (fields[0] != "TEL" || fields.size() < 13)
+                {
+                    continue;
+                }
+                double atS = std::stod(fields[1]) / 1000.0;
+                double t = atS - startS;
+                size_t band = static_cast<size_t>(t / BAND_S);
+                if (t < 0.0 || band >= bands || t - band * BAND_S < BAND_SETTLE_S)
+                {
+                    continue;
+                }
+                for (int m = 0; m < SimBoard::MOTORS; ++m)
+                {
+                    BandStats &band_ = stats[band * SimBoard::MOTORS + m];
+                    double error = std::stod(fields[3 + 2 * m]) - script(atS);
+                    band_.samples++;
+                    band_.errorSum += error;
+                    band_.maxError = std::max(band_.maxError, std::fabs(error));
+                    int quality = std::stoi(fields[11 + m]);
+                    if (quality >= 0 && quality < 4)
+                    {
+                        band_.quality[quality]++;
+                    }
+                }
+            }
+        };
+        runUntil((startS + bands * BAND_S) * 1e6, each);
+
+        std::printf("Speed estimate vs synthetic encoder signal, %s build%s\n",
+                    EDGE_TIMING_BUILD ? "ENCODER_EDGE_TIMING=1" : "count-only",
+                    EDGE_TIMING_BUILD ? " (timing pins wired)" : "");
+        std::printf("%8s %4s %8s %10s %10s %7s %7s %7s %7s\n", "RPM", "belt", "samples", "mean err", "max err",
+                    "stale", "period", "blend", "count");
+        bool ok = true;
+        for (size_t b = 0; b < bands; ++b)
+        {
+            for (int m = 0; m < SimBoard::MOTORS; ++m)
+            {
+                const BandStats &band = stats[b * SimBoard::MOTORS + m];
+                double mean = band.samples ? band.errorSum / band.samples : NAN;
+                // Below one count per tick a count-only estimate is quantisation noise, not a measurement
+                bool checked = EDGE_TIMING_BUILD ||
+                               std::fabs(BANDS[b]) * MotorPlant::COUNTS_PER_RPM_S * CONTROL_PERIOD_S >= 1.0;
+                bool biased =
+                    !(std::fabs(mean) <= std::max(BAND_BIAS_LIMIT * std::fabs(BANDS[b]), BAND_BIAS_FLOOR_RPM));
+                ok &= !(checked && biased);
+                std::printf("%8.1f %4d %8d %10.2f %10.2f %7d %7d %7d %7d%s\n", BANDS[b], m + 1, band.samples, mean,
+                            band.maxError, band.quality[0], band.quality[1], band.quality[2], band.quality[3],
+                            !checked ? "  (not checked)" : (biased ? "  BIASED" : ""));
+            }
+        }
+        std::printf("%s: mean error within %.0f%% (or %.1f RPM) in every checked band\n", ok ? "PASS" : "FAIL",
+                    BAND_BIAS_LIMIT * 100.0, BAND_BIAS_FLOOR_RPM);
+        return ok ? 0 : 1;
+    }
+
+    // ---- jitter: control tick timing under reply traffic ----
+
+    struct JitterPhase
+    {
+        const char *name;
+        bool burst; // Keep a BURST running, so the TX ring stays full
+    };
+
+    const JitterPhase JITTER_PHASES[] = {{"replies", false}, {"replies+burst", true}};
+    constexpr double JITTER_PHASE_S = 3.0;
+    constexpr double QUERY_PERIOD_S = 0.01; // PROFILE? rate
+    constexpr double PING_PERIOD_S = 0.1;
+    constexpr double BURST_PERIOD_S = 1.0; // BURST,1000 takes about 1 s at 500000 baud
+
+    int runJitter()
+    {
+        boot();
+        send("STREAM");
+        std::printf("Control tick timing (5000 us nominal) with an SPD stream, PROFILE? every 10 ms and PING every 100 ms\n");
+        std::printf("%-14s %7s %9s %9s %9s %9s %12s %9s %9s\n", "phase", "ticks", "mean us", "stddev", "min us",
+                    "max us", "longest loop", "replies", "B lines");
+
+        double nextSetpointUs = board().nowUs();
+        double nextQueryUs = nextSetpointUs;
+        double nextPingUs = nextSetpointUs;
+        double nextBurstUs = nextSetpointUs;
+        uint32_t seq = 0;
+        for (const JitterPhase &phase : JITTER_PHASES)
+        {
+            size_t firstTick = board().getPwmUpdates().size();
+            longestLoopUs = 0.0;
+            int replies = 0;
+            int burstLines = 0;
+            auto each = [&]()
+            {
+                double now = board().nowUs();
+                if (now >= nextSetpointUs)
+                {
+                    send("SPD,300,300," + std::to_string(++seq));
+                    nextSetpointUs += SETPOINT_PERIOD_S * 1e6;
+                }
+                if (now >= nextQueryUs)
+                {
+                    send("PROFILE?");
+                    nextQueryUs += QUERY_PERIOD_S * 1e6;
+                }
+                if (now >= nextPingUs)
+                {
+                    send("PING," + std::to_string(seq));
+                    nextPingUs += PING_PERIOD_S * 1e6;
+                }
+                if (phase.burst && now >= nextBurstUs)
+                {
+                    send("BURST,1000");
+                    nextBurstUs = now + BURST_PERIOD_S * 1e6;
+                }
+                for (const SimBoard::ReceivedLine &line : board().takeLines())
+                {
+                    replies += line.text.compare(0, 8, "PROFILE,") == 0 || line.text.compare(0, 5, "PONG,") == 0;
+                    burstLines += line.text.compare(0, 2, "B,") == 0;
+                }
+            };
+            runUntil(board().nowUs() + JITTER_PHASE_S * 1e6, each);
+            nextBurstUs = board().nowUs();
+
+            const std::vector<double> &ticks = board().getPwmUpdates();
+            double sum = 0.0, sumSq = 0.0, shortest = INFINITY, longest = 0.0;
+            size_t count = 0;
+            for (size_t i = firstTick + 1; i < ticks.size(); ++i)
+            {
+                double interval = ticks[i] - ticks[i - 1];
+                sum += interval;
+                sumSq += interval * interval;
+                shortest = std::min(shortest, interval);
+                longest = std::max(longest, interval);
+                count++;
+            }
+            double mean = sum / count;
+            std::printf("%-14s %7zu %9.1f %9.1f %9.1f %9.1f %12.1f %9d %9d\n", phase.name, count, mean,
+                        std::sqrt(std::max(sumSq / count - mean * mean, 0.0)), shortest, longest, longestLoopUs,
+                        replies, burstLines);
+        }
+        return 0;
+    }
+
+    // ---- stats: STATS reports delivered whole while the link is busy ----
+
+    constexpr double STATS_RUN_S = 5.0;
+    constexpr double STATS_PERIOD_S = 0.5; // Heartbeat rate, as TreadmillController polls it
+    const char *const STATS_TASKS[] = {"TICK", "CTL", "RX", "TEL"};
+
+    int runStats()
+    {
+        boot();
+        send("STREAM");
+        double nextSetpointUs = board().nowUs();
+        double nextStatsUs = nextSetpointUs;
+        double nextBurstUs = nextSetpointUs;
+        int requested = 0;
+        int complete = 0;
+        int incomplete = 0;
+        int taskLines = 0;
+        unsigned seen = 0;
+        auto each = [&]()
+        {
+            double now = board().nowUs();
+            if (now >= nextSetpointUs)
+            {
+                send("SPD,300,300");
+                nextSetpointUs += SETPOINT_PERIOD_S * 1e6;
+            }
+            if (now >= nextBurstUs)
+            {
+                send("BURST,1000");
+                nextBurstUs = now + BURST_PERIOD_S * 1e6;
+            }
+            if (now >= nextStatsUs)
+            {
+                send("STATS");
+                requested++;
+                nextStatsUs += STATS_PERIOD_S * 1e6;
+            }
+            for (const SimBoard::ReceivedLine &line : board().takeLines())
+            {
+                std::vector<std::string> fields = splitFields(line.text);
+                if (fields[0] != "STATS" || fields.size() < 2)
+                {
+                    continue;
+                }
+                if (fields[1] == "LOOP")
+                {
+                    (seen == 0x0F ? complete : incomplete)++;
+                    seen = 0;
+                    continue;
+                }
+                for (unsigned t = 0; t < 4; ++t)
+                {
+                    if (fields[1] == STATS_TASKS[t])
+                    {
+                        seen |= 1u << t;
+                        taskLines++;
+                    }
+                }
+            }
+        };
+        runUntil(board().nowUs() + STATS_RUN_S * 1e6, each);
+        runUntil(board().nowUs() + 100000.0, each); // Let the last report finish
+
+        std::printf("STATS every %.0f ms for %.0f s with an SPD stream and a continuous BURST\n",
+                    STATS_PERIOD_S * 1000.0, STATS_RUN_S);
+        std::printf("requested %d, complete reports %d, incomplete %d, task lines %d\n", requested, complete,
+                    incomplete, taskLines);
+        return complete == requested ? 0 : 1;
+    }
+
+    // ---- upload: text profile upload round trips ----
+
+    constexpr int UPLOAD_STEPS = 60;
+    constexpr double REPLY_TIMEOUT_US = 100000.0;
+
+    // Sends `line` and runs the firmware until a line starting with `reply` arrives; time taken in us, or NAN
+    double roundTrip(const std::string &line, const std::string &reply)
+    {
+        double sentUs = board().nowUs();
+        send(line);
+        while (board().nowUs() < sentUs + REPLY_TIMEOUT_US)
+        {
+            loopOnce();
+            for (const SimBoard::ReceivedLine &received : board().takeLines())
+            {
+                if (received.text.compare(0, reply.size(), reply) == 0)
+                {
+                    return received.us - sentUs;
+                }
+            }
+        }
+        return NAN;
+    }
+
+    int runUpload()
+    {
+        boot();
+        std::vector<double> steps;
+        double startUs = board().nowUs();
+        bool ok = !std::isnan(roundTrip("START_READ", "READY"));
+        char line[48];
+        for (int i = 0; i < UPLOAD_STEPS && ok; ++i)
+        {
+            std::snprintf(line, sizeof(line), "L:%d.%03d R:%d.%03d T:%d.5", 100 + i, i * 7 % 1000, 90 + i,
+                          i * 13 % 1000, 1 + i % 9);
+            steps.push_back(roundTrip(line, "READY"));
+            ok = !std::isnan(steps.back());
+        }
+        ok = ok && !std::isnan(roundTrip("END_READ", "ACK"));
+        double totalUs = board().nowUs() - startUs;
+        if (!ok)
+        {
+            std::printf("Upload failed: no reply within %.0f ms\n", REPLY_TIMEOUT_US / 1000.0);
+            return 1;
+        }
+
+        std::sort(steps.begin(), steps.end());
+        double sum = 0.0;
+        for (double us : steps)
+        {
+            sum += us;
+        }
+        std::printf("Text profile upload at %lu baud, %d steps (L: line -> READY, host sends on receipt)\n",
+                    board().getBaud(), UPLOAD_STEPS);
+        std::printf("per step us: mean %.1f, median %.1f, max %.1f; whole upload %.1f ms\n", sum / steps.size(),
+                    steps[steps.size() / 2], steps.back(), totalUs / 1000.0);
+        return 0;
+    }
+
+    // ---- safety: SPD after STOP_TM must not wake the drivers ----
+
+    constexpr double SAFETY_PHASE_S = 1.0;
+
+    int runSafety()
+    {
+        boot();
+        std::printf("SPD,300,300 every %.0f ms through each phase; drivers enabled and replies per phase\n",
+                    SETPOINT_PERIOD_S * 1000.0);
+        std::printf("%-22s %14s %9s %9s\n", "phase", "enabled loops", "loops", "latched");
+
+        struct Phase
+        {
+            const char *name;
+            const char *command; // Sent at the start of the phase
+            const char *setpoint;
+            bool expectEnabled;
+        };
+        const Phase phases[] = {
+            {"stream", "STREAM", "SPD,300,300", true},
+            {"after STOP_TM", "STOP_TM", "SPD,300,300", false},
+            {"zero after STOP_TM", nullptr, "SPD,0,0", false},
+            {"new STREAM", "STREAM", "SPD,300,300", true},
+        };
+
+        bool ok = true;
+        for (const Phase &phase : phases)
+        {
+            if (phase.command)
+            {
+                send(phase.command);
+            }
+            // Skip the first setpoint period while the phase's command takes effect
+            double settleUs = board().nowUs() + SETPOINT_PERIOD_S * 1e6;
+            double nextSetpointUs = board().nowUs();
+            int loops = 0;
+            int enabled = 0;
+            int latched = 0;
+            auto each = [&]()
+            {
+                double now = board().nowUs();
+                if (now >= nextSetpointUs)
+                {
+                    send(phase.setpoint);
+                    nextSetpointUs += SETPOINT_PERIOD_S * 1e6;
+                }
+                for (const SimBoard::ReceivedLine &line : board().takeLines())
+                {
+                    if (line.text.compare(0, 16, "ERR,STOP_LATCHED") == 0)
+                    {
+                        latched++;
+                    }
+                }
+                if (now >= settleUs)
+                {
+                    loops++;
+                    enabled += (board().isDriverEnabled(0) && board().isDriverEnabled(1)) ? 1 : 0;
+                }
+            };
+            runUntil(board().nowUs() + SAFETY_PHASE_S * 1e6, each);
+            bool phaseOk = enabled == (phase.expectEnabled ? loops : 0);
+            ok = ok && phaseOk;
+            std::printf("%-22s %14d %9d %9d%s\n", phase.name, enabled, loops, latched, phaseOk ? "" : "  FAIL");
+        }
+        return ok ? 0 : 1;
+    }
+
+    struct Scenario
+    {
+        const char *name;
+        const char *description;
+        int (*run)();
+    };
+
+    const Scenario SCENARIOS[] = {
+        {"step", "Q16 speed controller against the float reference on identical belts", runStep},
+        {"encoder", "Speed estimate and quality flags against a scripted encoder signal", runEncoder},
+        {"jitter", "Control tick timing while the host keeps the firmware replying", runJitter},
+        {"stats", "Complete STATS reports while telemetry and a burst fill the link", runStats},
+        {"upload", "Per-step round trip of a text profile upload", runUpload},
+        {"safety", "Drivers stay off for SPD after STOP_TM until a new STREAM", runSafety},
+    };
+}
+
+int main(int argc, char **argv)
+{
+    if (argc == 2)
+    {
+        for (const Scenario &scenario : SCENARIOS)
+        {
+            if (std::strcmp(argv[1], scenario.name) == 0)
+            {
+                return scenario.run();
+            }
+        }
+    }
+
+    std::fprintf(stderr, "Usage: %s <scenario>\n", argc > 0 ? argv[0] : "firmware_sim");
+    for (const Scenario &scenario : SCENARIOS)
+    {
+        std::fprintf(stderr, "  %-10s %s\n", scenario.name, scenario.description);
+    }
+    return 2;
+}
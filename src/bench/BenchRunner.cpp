@@ -0,0 +1,186 @@
+#include "BenchRunner.h"
+#include <algorithm>
+#include <chrono>
+#include <ctime>
+#include <iomanip>
+#include <iostream>
+#include <thread>
+
+void BenchRunner::add(Benchmark benchmark)
+{
+    m_benchmarks.push_back(std::move(benchmark));
+}
+
+const std::vector<BenchRunner::Result> &BenchRunner::runAll()
+{
+    m_results.clear();
+    for (const auto &benchmark : m_benchmarks)
+    {
+        if (!m_filter.empty() && benchmark.name.find(m_filter) == std::string::npos)
+        {
+            continue;
+        }
+
+        std::cerr << "Running " << benchmark.name << "..." << std::endl;
+        m_results.push_back(runOne(benchmark));
+
+        const Result &result = m_results.back();
+        if (result.skipped)
+        {
+            std::cerr << "  skipped" << std::endl;
+        }
+        else
+        {
+            std::cerr << "  " << result.items << " " << result.unit << " in "
+                      << std::fixed << std::setprecision(3) << result.medianMs << " ms (median)" << std::endl;
+            for (const auto &metric : result.metrics)
+            {
+                std::cerr << "  " << metric.first << " " << metric.second << std::endl;
+            }
+        }
+    }
+    return m_results;
+}
+
+BenchRunner::Result BenchRunner::runOne(const Benchmark &benchmark) const
+{
+    Result result;
+    result.name = benchmark.name;
+    result.unit = benchmark.unit;
+
+    std::vector<double> timesMs;
+    std::vector<Metrics> metrics;
+
+    // Repeat 0 is the warm-up and is not recorded
+    for (int repeat = 0; repeat <= m_repeats; ++repeat)
+    {
+        if (benchmark.setup && !benchmark.setup())
+        {
+            result.skipped = true;
+            return result;
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        size_t items = benchmark.run();
+        auto end = std::chrono::steady_clock::now();
+
+        Metrics repeatMetrics;
+        if (benchmark.metrics)
+        {
+            benchmark.metrics(repeatMetrics);
+        }
+
+        if (benchmark.teardown)
+        {
+            benchmark.teardown();
+        }
+
+        if (repeat > 0)
+        {
+            timesMs.push_back(std::chrono::duration<double, std::milli>(end - start).count());
+            metrics.push_back(std::move(repeatMetrics));
+            result.items = items;
+        }
+    }
+
+    // Sort repeat indices rather than times so the median repeat's metrics can be found
+    std::vector<size_t> order(timesMs.size());
+    for (size_t i = 0; i < order.size(); ++i)
+    {
+        order[i] = i;
+    }
+    std::sort(order.begin(), order.end(), [&timesMs](size_t a, size_t b)
+              { return timesMs[a] < timesMs[b]; });
+
+    size_t median = order[order.size() / 2];
+    result.repeats = static_cast<int>(timesMs.size());
+    result.minMs = timesMs[order.front()];
+    result.maxMs = timesMs[order.back()];
+    result.medianMs = timesMs[median];
+    result.metrics = std::move(metrics[median]);
+    return result;
+}
+
+void BenchRunner::writeJson(std::ostream &out) const
+{
+    std::time_t now = std::time(nullptr);
+    char timestamp[32];
+    std::strftime(timestamp, sizeof(timestamp), "%Y-%m-%dT%H:%M:%SZ", std::gmtime(&now));
+
+#if defined(__clang__)
+    const std::string compiler = "clang " __clang_version__;
+#elif defined(__GNUC__)
+    const std::string compiler = "gcc " __VERSION__;
+#elif defined(_MSC_VER)
+    const std::string compiler = "msvc " + std::to_string(_MSC_VER);
+#else
+    const std::string compiler = "unknown";
+#endif
+
+#ifdef NDEBUG
+    const char *buildType = "release";
+#else
+    const char *buildType = "debug";
+#endif
+
+    out << "{\n"
+        << "  \"schema\": 1,\n"
+        << "  \"suite\": \"treadmill_bench\",\n"
+        << "  \"timestamp\": \"" << timestamp << "\",\n"
+        << "  \"compiler\": \"" << escapeJson(compiler) << "\",\n"
+        << "  \"build\": \"" << buildType << "\",\n"
+        << "  \"hardware_threads\": " << std::thread::hardware_concurrency() << ",\n"
+        << "  \"results\": [";
+
+    out << std::fixed << std::setprecision(3);
+    for (size_t i = 0; i < m_results.size(); ++i)
+    {
+        const Result &r = m_results[i];
+        double seconds = r.medianMs / 1000.0;
+
+        out << (i ? ",\n" : "\n")
+            << "    {\"name\": \"" << escapeJson(r.name) << "\", \"unit\": \"" << escapeJson(r.unit) << "\"";
+        if (r.skipped)
+        {
+            out << ", \"skipped\": true}";
+            continue;
+        }
+
+        out << ", \"items\": " << r.items
+            << ", \"repeats\": " << r.repeats
+            << ", \"median_ms\": " << r.medianMs
+            << ", \"min_ms\": " << r.minMs
+            << ", \"max_ms\": " << r.maxMs
+            << ", \"ns_per_item\": " << (r.items ? r.medianMs * 1e6 / r.items : 0.0)
+            << ", \"items_per_sec\": " << (seconds > 0.0 ? r.items / seconds : 0.0);
+        if (!r.metrics.empty())
+        {
+            out << ", \"metrics\": {";
+            for (size_t m = 0; m < r.metrics.size(); ++m)
+            {
+                out << (m ? ", " : "") << "\"" << escapeJson(r.metrics[m].first) << "\": " << r.metrics[m].second;
+            }
+            out << "}";
+        }
+        out << "}";
+    }
+    out << "\n  ]\n}\n";
+}
+
+std::string BenchRunner::escapeJson(const std::string &text)
+{
+    std::string escaped;
+    for (char c : text)
+    {
+        if (c == '"' || c == '\\')
+        {
+            escaped += '\\';
+            escaped += c;
+        }
+        else if (static_cast<unsigned char>(c) >= 0x20)
+        {
+            escaped += c;
+        }
+    }
+    return escaped;
+}
@@ -0,0 +1,58 @@
+#pragma once
+#include <cstddef>
+#include <functional>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+ * Minimal benchmark harness
+ * Runs each registered benchmark once to warm up and then a fixed number of
+ * timed repeats, and reports the median as machine-readable JSON
+ */
+class BenchRunner
+{
+public:
+    // Extra named figures a benchmark reports besides its timing, e.g. CPU use
+    using Metrics = std::vector<std::pair<std::string, double>>;
+
+    struct Benchmark
+    {
+        std::string name{};
+        std::string unit{};               // What one item is ("lines", "samples", ...)
+        std::function<bool()> setup{};    // Untimed, before every repeat; false skips the benchmark
+        std::function<size_t()> run{};    // Timed; returns the number of items processed
+        std::function<void()> teardown{}; // Untimed, after every repeat
+        std::function<void(Metrics &)> metrics{}; // Untimed, after each timed run; the median repeat's are kept
+    };
+
+    struct Result
+    {
+        std::string name;
+        std::string unit;
+        size_t items = 0;
+        int repeats = 0;
+        double medianMs = 0.0;
+        double minMs = 0.0;
+        double maxMs = 0.0;
+        bool skipped = false;
+        Metrics metrics;
+    };
+
+    void add(Benchmark benchmark);
+    void setRepeats(int repeats) { m_repeats = repeats; }
+    void setFilter(const std::string &filter) { m_filter = filter; }
+
+    const std::vector<Result> &runAll();
+    void writeJson(std::ostream &out) const;
+
+private:
+    Result runOne(const Benchmark &benchmark) const;
+    static std::string escapeJson(const std::string &text);
+
+    std::vector<Benchmark> m_benchmarks;
+    std::vector<Result> m_results;
+    std::string m_filter;
+    int m_repeats = 5;
+};
@@ -0,0 +1,486 @@
+#include "FakeTreadmill.h"
+#include "utils/Crc16.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <fcntl.h>
+#include <iostream>
+#include <poll.h>
+#include <termios.h>
+#include <unistd.h>
+
+FakeTreadmill::FakeTreadmill() = default;
+
+FakeTreadmill::~FakeTreadmill()
+{
+    close();
+}
+
+bool FakeTreadmill::open()
+{
+    close();
+
+    m_masterFd = ::posix_openpt(O_RDWR | O_NOCTTY);
+    if (m_masterFd < 0 || ::grantpt(m_masterFd) != 0 || ::unlockpt(m_masterFd) != 0)
+    {
+        std::cerr << "Failed to create pseudo-terminal" << std::endl;
+        close();
+        return false;
+    }
+
+    const char *name = ::ptsname(m_masterFd);
+    if (!name)
+    {
+        close();
+        return false;
+    }
+    m_portName = name;
+    ::fcntl(m_masterFd, F_SETFL, ::fcntl(m_masterFd, F_GETFL) | O_NONBLOCK);
+
+    // Hold the slave side open so the master never sees EIO between host
+    // connections, and make it raw so nothing is echoed or translated
+    m_slaveFd = ::open(name, O_RDWR | O_NOCTTY);
+    if (m_slaveFd < 0)
+    {
+        std::cerr << "Failed to open " << m_portName << std::endl;
+        close();
+        return false;
+    }
+
+    termios tio{};
+    ::tcgetattr(m_slaveFd, &tio);
+    ::cfmakeraw(&tio);
+    ::tcsetattr(m_slaveFd, TCSANOW, &tio);
+
+    // A fresh port is a freshly reset board: nothing stored, default rate
+    m_state = State::Idle;
+    m_rxLine.clear();
+    m_steps.clear();
+    m_profileStored = false;
+    m_profileSteps = 0;
+    m_binaryRemaining = 0;
+    m_baudRate = 500000;
+    m_setpointStreaming = false;
+    m_setpointSeq = 0;
+    m_targetL = m_targetR = 0.0f;
+    m_bootTime = Clock::now();
+    m_running = true;
+    m_thread = std::thread(&FakeTreadmill::deviceLoop, this);
+    return true;
+}
+
+void FakeTreadmill::close()
+{
+    m_running = false;
+    if (m_thread.joinable())
+    {
+        m_thread.join();
+    }
+
+    if (m_slaveFd >= 0)
+    {
+        ::close(m_slaveFd);
+        m_slaveFd = -1;
+    }
+    if (m_masterFd >= 0)
+    {
+        ::close(m_masterFd);
+        m_masterFd = -1;
+    }
+    m_portName.clear();
+}
+
+void FakeTreadmill::streamTelemetry(size_t count)
+{
+    m_burstRemaining += count;
+}
+
+void FakeTreadmill::deviceLoop()
+{
+    char buffer[512];
+
+    while (m_running)
+    {
+        // Bursts take priority over the normal telemetry cadence
+        if (m_burstRemaining > 0)
+        {
+            size_t chunk = std::min<size_t>(m_burstRemaining, 64);
+            for (size_t i = 0; i < chunk; ++i)
+            {
+                publishTelemetry(true);
+            }
+            m_burstRemaining -= chunk;
+        }
+
+        int waitMs = (m_burstRemaining > 0) ? 0 : 1;
+        pollfd pfd{m_masterFd, POLLIN, 0};
+        int ready = ::poll(&pfd, 1, waitMs);
+
+        if (ready > 0 && (pfd.revents & POLLIN))
+        {
+            ssize_t n = ::read(m_masterFd, buffer, sizeof(buffer));
+            for (ssize_t i = 0; i < n; ++i)
+            {
+                char c = buffer[i];
+                if (m_binaryRemaining > 0)
+                {
+                    m_binary.push_back(static_cast<uint8_t>(c));
+                    if (--m_binaryRemaining == 0)
+                    {
+                        finishBinaryProfile();
+                    }
+                }
+                else if (c == '\n')
+                {
+                    if (!m_rxLine.empty() && m_rxLine.back() == '\r')
+                    {
+                        m_rxLine.pop_back();
+                    }
+                    m_linesReceived++;
+                    handleLine(m_rxLine);
+                    m_rxLine.clear();
+                }
+                else
+                {
+                    m_rxLine += c;
+                }
+            }
+        }
+
+        if (m_setpointStreaming &&
+            Clock::now() - m_lastSetpoint > std::chrono::milliseconds(SETPOINT_TIMEOUT_MS))
+        {
+            m_setpointStreaming = false;
+            m_stopLatched = true;
+            m_targetL = m_targetR = 0.0f;
+            writeLine("ERR,SETPOINT_TIMEOUT");
+        }
+
+        // Like the firmware, a streamed setpoint keeps telemetry flowing outside a run
+        if (m_setpointStreaming && m_state == State::Idle && Clock::now() >= m_nextTelemetry)
+        {
+            publishTelemetry(false);
+            m_nextTelemetry = Clock::now() + std::chrono::milliseconds(m_telemetryIntervalMs.load());
+        }
+
+        if (m_state == State::Running)
+        {
+            auto now = Clock::now();
+            if (now >= m_nextTelemetry)
+            {
+                bool finished = std::chrono::duration<double>(now - m_runStart).count() >= m_runSeconds;
+                publishTelemetry(!finished);
+                m_nextTelemetry += std::chrono::milliseconds(m_telemetryIntervalMs.load());
+                if (finished)
+                {
+                    m_state = State::Idle;
+                }
+            }
+        }
+    }
+}
+
+void FakeTreadmill::handleLine(const std::string &line)
+{
+    if (line == "STOP_TM")
+    {
+        int64_t faultUs = m_faultFrameUs;
+        if (faultUs != 0 && m_faultToStopUs < 0)
+        {
+            m_faultToStopUs = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - m_bootTime).count() - faultUs;
+        }
+        m_state = State::Idle;
+        m_setpointStreaming = false;
+        m_stopLatched = true;
+        m_targetL = m_targetR = 0.0f;
+        writeLine("STOPPED");
+    }
+    else if (line.rfind("START_READ", 0) == 0)
+    {
+        if (m_state == State::Running)
+        {
+            writeLine("ERR,BUSY_RUNNING");
+            return;
+        }
+        m_state = State::Uploading;
+        m_profileSteps = 0;
+        m_runSeconds = 0.0;
+        m_steps.clear();
+        m_profileStored = false;
+        writeLine("READY");
+    }
+    else if (m_state == State::Uploading && line.rfind("END_READ", 0) == 0)
+    {
+        m_state = State::Idle;
+        m_profileStored = true;
+        writeLine("ACK");
+    }
+    else if (m_state == State::Uploading && line.rfind("L", 0) == 0)
+    {
+        // L: <left> R: <right> T: <seconds>
+        float left = 0.0f, right = 0.0f, seconds = 0.0f;
+        if (std::sscanf(line.c_str(), "L: %f R: %f T: %f", &left, &right, &seconds) == 3)
+        {
+            if (m_profileSteps == 0)
+            {
+                m_targetL = left;
+                m_targetR = right;
+            }
+            m_runSeconds += seconds;
+            m_profileSteps++;
+        }
+
+        CompiledStep step;
+        if (ProfileParser::compileStep(line, step))
+        {
+            m_steps.push_back(step);
+        }
+        writeLine("READY");
+    }
+    else if (m_state == State::Idle && line.rfind("RUN_TM", 0) == 0)
+    {
+        if (m_profileSteps == 0)
+        {
+            writeLine("ERR,NO_PROFILE");
+            return;
+        }
+        m_state = State::Running;
+        m_setpointStreaming = false;
+        m_stopLatched = false;
+        m_runStart = Clock::now();
+        m_nextTelemetry = m_runStart;
+        writeLine("RUNNING");
+    }
+    else if (line.rfind("PING,", 0) == 0)
+    {
+        writeLine("PONG," + line.substr(5) + "," + std::to_string(millis()));
+    }
+    else if (m_state == State::Idle && line == "PROFILE?")
+    {
+        size_t steps = m_profileStored ? m_steps.size() : 0;
+        char crc[4] = {'0', '0', '0', '0'};
+        if (steps > 0)
+        {
+            Crc16::toHex(ProfileParser::checksum(m_steps), crc);
+        }
+        writeLine("PROFILE," + std::to_string(steps) + "," + std::string(crc, 4) + "," +
+                  std::to_string(PROFILE_CAPACITY));
+    }
+    else if (m_state == State::Idle && line.rfind("PROFILE_BIN,", 0) == 0)
+    {
+        unsigned long steps = 0;
+        unsigned int crc = 0;
+        if (std::sscanf(line.c_str(), "PROFILE_BIN,%lu,%4x", &steps, &crc) != 2 || steps == 0)
+        {
+            writeLine("ERR,PARSE_FMT");
+            return;
+        }
+        m_state = State::Uploading;
+        m_profileStored = false;
+        m_binary.clear();
+        m_binaryCrc = static_cast<uint16_t>(crc);
+        m_binaryRemaining = steps * 12;
+    }
+    else if (m_state == State::Idle && line.rfind("SPD,", 0) == 0)
+    {
+        // SPD,<left>,<right>[,<seq>]
+        float left = 0.0f, right = 0.0f;
+        unsigned int seq = 0;
+        int fields = std::sscanf(line.c_str(), "SPD,%f,%f,%u", &left, &right, &seq);
+        if (fields < 2)
+        {
+            return;
+        }
+        if (fields == 3)
+        {
+            m_setpointSeq = static_cast<uint16_t>(seq);
+        }
+        m_lastSetpoint = Clock::now();
+        m_setpointsReceived++;
+        bool moving = (left != 0.0f || right != 0.0f);
+        if (m_stopLatched)
+        {
+            m_setpointStreaming = false;
+            m_targetL = m_targetR = 0.0f;
+            if (moving)
+            {
+                writeLine("ERR,STOP_LATCHED");
+            }
+            return;
+        }
+        m_targetL = left;
+        m_targetR = right;
+        m_setpointStreaming = moving;
+    }
+    else if (m_state == State::Idle && line == "STREAM")
+    {
+        m_setpointStreaming = false;
+        m_stopLatched = false;
+        m_lastSetpoint = Clock::now();
+        writeLine("STREAMING");
+    }
+    else if (line == "STATS")
+    {
+        for (const char *task : {"TICK", "CTL", "RX", "TEL"})
+        {
+            writeLine(std::string("STATS,") + task + ",0,0,0,0,0,0,0,0,0,0");
+        }
+        writeLine("STATS,LOOP,0,0,0");
+    }
+    else if (m_state == State::Idle && line.rfind("BAUD,", 0) == 0)
+    {
+        m_baudRate = std::strtoul(line.c_str() + 5, nullptr, 10);
+        writeLine("BAUD_OK," + std::to_string(m_baudRate));
+    }
+    else if (m_state == State::Idle && line == "BAUD_COMMIT")
+    {
+        writeLine("BAUD_COMMITTED," + std::to_string(m_baudRate));
+    }
+    else if (m_state == State::Idle && line.rfind("BURST,", 0) == 0)
+    {
+        writeBurst(std::strtoul(line.c_str() + 6, nullptr, 10));
+    }
+    // HEARTBEAT, STATS,RESET and unknown commands need no reply
+}
+
+void FakeTreadmill::publishTelemetry(bool profileActive)
+{
+    uint16_t seq = m_telemetrySeq++;
+    int lossEvery = m_frameLossEvery;
+    if (lossEvery > 0 && seq % lossEvery == lossEvery - 1)
+    {
+        return;
+    }
+
+    bool fault = m_driverFault;
+    char frame[112];
+    int length = std::snprintf(frame, sizeof(frame), "TEL,%u,%.2f,%.2f,%.2f,%.2f,%d,1,0,%d,0,3,3,%u,%u\r\n",
+                               millis(), m_targetL, m_targetL, m_targetR, m_targetR, fault ? 0 : 1,
+                               profileActive ? 1 : 0, static_cast<unsigned>(seq), static_cast<unsigned>(m_setpointSeq));
+    std::lock_guard<std::mutex> lock(m_writeMutex);
+    writeAll(frame, static_cast<size_t>(length));
+
+    int64_t none = 0;
+    if (fault)
+    {
+        int64_t nowUs = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - m_bootTime).count();
+        m_faultFrameUs.compare_exchange_strong(none, nowUs);
+    }
+}
+
+void FakeTreadmill::setDriverFault(bool fault)
+{
+    m_faultFrameUs = 0;
+    m_faultToStopUs = -1;
+    m_driverFault = fault;
+}
+
+void FakeTreadmill::finishBinaryProfile()
+{
+    m_state = State::Idle;
+    if (Crc16::compute(m_binary.data(), m_binary.size()) != m_binaryCrc)
+    {
+        writeLine("ERR,PROFILE_CRC");
+        return;
+    }
+
+    auto readLittleEndian = [this](size_t offset)
+    {
+        uint32_t value = 0;
+        for (int i = 3; i >= 0; --i)
+        {
+            value = (value << 8) | m_binary[offset + i];
+        }
+        return value;
+    };
+
+    m_steps.clear();
+    m_runSeconds = 0.0;
+    for (size_t offset = 0; offset + 12 <= m_binary.size(); offset += 12)
+    {
+        CompiledStep step;
+        step.leftMilli = static_cast<int32_t>(readLittleEndian(offset));
+        step.rightMilli = static_cast<int32_t>(readLittleEndian(offset + 4));
+        step.durationMs = readLittleEndian(offset + 8);
+        m_steps.push_back(step);
+        m_runSeconds += step.durationMs / 1000.0;
+    }
+
+    m_targetL = m_steps.front().leftMilli / 1000.0f;
+    m_targetR = m_steps.front().rightMilli / 1000.0f;
+    m_profileSteps = m_steps.size();
+    m_profileStored = true;
+    writeLine("ACK");
+}
+
+void FakeTreadmill::writeBurst(unsigned long lines)
+{
+    unsigned int maxClean = m_maxCleanBaud;
+    bool marginal = maxClean > 0 && m_baudRate > maxClean;
+
+    std::string burst;
+    uint32_t state = 0xACE1u;
+    for (unsigned long seq = 0; seq < lines; ++seq)
+    {
+        char body[48];
+        int length = std::snprintf(body, sizeof(body), "%lu,", seq);
+        for (int i = 0; i < 4; ++i)
+        {
+            state = state * 1664525u + 1013904223u;
+            length += std::snprintf(body + length, sizeof(body) - length, "%08X", static_cast<unsigned>(state));
+        }
+
+        char crc[4];
+        Crc16::toHex(Crc16::compute(body, static_cast<size_t>(length)), crc);
+        if (marginal && seq % 10 == 9)
+        {
+            body[length - 1] ^= 0x01; // Flipped bit after the CRC was taken
+        }
+
+        burst += "B,";
+        burst.append(body, static_cast<size_t>(length));
+        burst += ',';
+        burst.append(crc, 4);
+        burst += "\r\n";
+    }
+    burst += "BURST_END," + std::to_string(lines) + "\r\n";
+
+    std::lock_guard<std::mutex> lock(m_writeMutex);
+    writeAll(burst.data(), burst.size());
+}
+
+void FakeTreadmill::writeLine(const std::string &line)
+{
+    std::string framed = line + "\r\n";
+    std::lock_guard<std::mutex> lock(m_writeMutex);
+    writeAll(framed.data(), framed.size());
+}
+
+void FakeTreadmill::writeAll(const char *data, size_t length)
+{
+    while (length > 0 && m_running)
+    {
+        ssize_t written = ::write(m_masterFd, data, length);
+        if (written < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            if (errno != EAGAIN)
+                return;
+
+            // Host is not draining: wait for room, but never past close()
+            pollfd pfd{m_masterFd, POLLOUT, 0};
+            ::poll(&pfd, 1, 10);
+            continue;
+        }
+        data += written;
+        length -= static_cast<size_t>(written);
+    }
+}
+
+uint32_t FakeTreadmill::millis() const
+{
+    return static_cast<uint32_t>(
+        std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - m_bootTime).count());
+}
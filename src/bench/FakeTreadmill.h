@@ -0,0 +1,109 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "utils/ProfileParser.h"
+
+/**
+ * Simulated treadmill controller on a POSIX pseudo-terminal
+ * Speaks the host side of the firmware protocol (sync, upload, run, heartbeat,
+ * telemetry) so SerialManager and TreadmillController can be exercised without
+ * hardware. The host opens getPortName() like any other serial port.
+ */
+class FakeTreadmill
+{
+public:
+    static constexpr int DEFAULT_TELEMETRY_INTERVAL_MS = 100;
+    static constexpr size_t PROFILE_CAPACITY = 255; // The firmware's ring holds 63 steps; the simulator is not limited
+    static constexpr int SETPOINT_TIMEOUT_MS = 250;   // Matches the firmware's SPD stream watchdog
+
+    FakeTreadmill();
+    ~FakeTreadmill();
+
+    FakeTreadmill(const FakeTreadmill &) = delete;
+    FakeTreadmill &operator=(const FakeTreadmill &) = delete;
+
+    bool open();
+    void close();
+    bool isOpen() const { return m_masterFd >= 0; }
+
+    // Write `count` TEL frames back to back, as fast as the host drains them
+    void streamTelemetry(size_t count);
+
+    void setTelemetryIntervalMs(int intervalMs) { m_telemetryIntervalMs = intervalMs; }
+    // Silently skip every Nth TEL frame (0 = never), as a lossy link would
+    void setFrameLossEvery(int frames) { m_frameLossEvery = frames; }
+    // Corrupt every 10th BURST line once BAUD goes above this rate (0 = never), like a marginal cable
+    void setMaxCleanBaud(unsigned int baudRate) { m_maxCleanBaud = baudRate; }
+    // Report the left driver unhealthy in every TEL frame (restarts the fault-to-stop measurement)
+    void setDriverFault(bool fault);
+    // First faulted TEL frame written -> STOP_TM received, in us; -1 until the host has stopped
+    int64_t getFaultToStopUs() const { return m_faultToStopUs; }
+
+    const std::string &getPortName() const { return m_portName; }
+    size_t getLinesReceived() const { return m_linesReceived; }
+    size_t getProfileSteps() const { return m_profileSteps; }
+    size_t getSetpointsReceived() const { return m_setpointsReceived; }
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    enum class State
+    {
+        Idle,
+        Uploading,
+        Running
+    };
+
+    void deviceLoop();
+    void handleLine(const std::string &line);
+    void publishTelemetry(bool profileActive);
+    void writeBurst(unsigned long lines);
+    void finishBinaryProfile();
+    void writeLine(const std::string &line);
+    void writeAll(const char *data, size_t length);
+    uint32_t millis() const;
+
+    int m_masterFd = -1;
+    int m_slaveFd = -1;
+    std::string m_portName;
+    std::thread m_thread;
+    std::atomic<bool> m_running{false};
+    std::mutex m_writeMutex;
+
+    // Device state, owned by the device thread
+    State m_state = State::Idle;
+    std::string m_rxLine;
+    float m_targetL = 0.0f;
+    float m_targetR = 0.0f;
+    double m_runSeconds = 0.0;
+    std::vector<CompiledStep> m_steps; // Reported by PROFILE? once END_READ completes the upload
+    bool m_profileStored = false;
+    size_t m_binaryRemaining = 0; // PROFILE_BIN payload bytes still to come
+    uint16_t m_binaryCrc = 0;
+    std::vector<uint8_t> m_binary;
+    Clock::time_point m_bootTime;
+    Clock::time_point m_runStart;
+    Clock::time_point m_nextTelemetry;
+
+    std::atomic<size_t> m_profileSteps{0};
+    std::atomic<size_t> m_linesReceived{0};
+    std::atomic<size_t> m_burstRemaining{0};
+    std::atomic<int> m_telemetryIntervalMs{DEFAULT_TELEMETRY_INTERVAL_MS};
+    std::atomic<int> m_frameLossEvery{0};
+    std::atomic<unsigned int> m_maxCleanBaud{0};
+    unsigned long m_baudRate = 500000; // Acknowledged only; a PTY has no line rate
+    uint16_t m_telemetrySeq = 0;
+    bool m_setpointStreaming = false; // Nonzero SPD targets, held alive by further SPD lines
+    uint16_t m_setpointSeq = 0;
+    bool m_stopLatched = true; // Set by STOP_TM and the setpoint timeout; cleared by RUN_TM or STREAM
+    Clock::time_point m_lastSetpoint;
+    std::atomic<size_t> m_setpointsReceived{0};
+    std::atomic<bool> m_driverFault{false};
+    std::atomic<int64_t> m_faultFrameUs{0}; // Since boot; 0 = no faulted frame sent yet
+    std::atomic<int64_t> m_faultToStopUs{-1};
+};
@@ -0,0 +1,857 @@
+#include "BenchRunner.h"
+#include "FakeTreadmill.h"
+#include "utils/DerivedChannels.h"
+#include "utils/DeviceManager.h"
+#include "utils/ExportJob.h"
+#include "utils/ProfileParser.h"
+#include "utils/SerialManager.h"
+#include "utils/SessionJournal.h"
+#include "utils/TelemetryCsv.h"
+#include "utils/TelemetryHistory.h"
+#include "utils/TreadmillController.h"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <condition_variable>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <sstream>
+#include <streambuf>
+#include <thread>
+
+namespace
+{
+    // Fixed seed so every run benchmarks the same inputs
+    constexpr unsigned BENCH_SEED = 20240611;
+
+    struct BenchSizes
+    {
+        size_t telemetryLines = 200000;
+        size_t framedLines = 100000;
+        size_t profileLines = 50000;
+        size_t csvSamples = 1000000;
+        size_t busSamples = 200000;
+        size_t safetySamples = 1000000;
+        size_t derivedSamples = 1000000;
+        size_t historySamples = 2000000;
+        size_t exportRows = 10000000;
+        size_t uploadSteps = 64; // Firmware profile queue size
+        int multiDeviceWindowMs = 1000;
+        int journalWindowMs = 3000;
+    };
+
+    // Swallows the controller's console chatter so it cannot skew timings or the JSON
+    class NullBuffer : public std::streambuf
+    {
+    protected:
+        int overflow(int c) override { return c; }
+        std::streamsize xsputn(const char *, std::streamsize n) override { return n; }
+    };
+
+    std::vector<std::string> makeTelemetryLines(size_t count)
+    {
+        std::mt19937 rng(BENCH_SEED);
+        std::uniform_real_distribution<float> rpm(0.0f, 600.0f);
+
+        std::vector<std::string> lines;
+        lines.reserve(count);
+        char frame[96];
+        for (size_t i = 0; i < count; ++i)
+        {
+            float t1 = rpm(rng), t2 = rpm(rng);
+            std::snprintf(frame, sizeof(frame), "TEL,%zu,%.2f,%.2f,%.2f,%.2f,1,1,0,1,0,3,3",
+                          i * 100, t1, t1 + rpm(rng) * 0.01f, t2, t2 - rpm(rng) * 0.01f);
+            lines.emplace_back(frame);
+        }
+        return lines;
+    }
+
+    std::string makeProfileText(size_t steps)
+    {
+        std::mt19937 rng(BENCH_SEED);
+        std::uniform_real_distribution<float> speed(0.2f, 3.0f);
+        std::uniform_int_distribution<int> seconds(1, 120);
+
+        std::ostringstream text;
+        text.precision(3);
+        for (size_t i = 0; i < steps; ++i)
+        {
+            text << "L: " << speed(rng) << " R: " << speed(rng) << " T: " << seconds(rng) << "\n";
+        }
+        return text.str();
+    }
+
+    std::vector<TelemetryData> makeSamples(size_t count)
+    {
+        std::vector<TelemetryData> samples;
+        samples.reserve(count);
+        for (const auto &line : makeTelemetryLines(std::min<size_t>(count, 10000)))
+        {
+            TelemetryData data{};
+            TreadmillController::parseTelemetryLine(line, data);
+            samples.push_back(data);
+        }
+        while (samples.size() < count)
+        {
+            TelemetryData data = samples[samples.size() % 10000];
+            data.timestamp = static_cast<uint32_t>(samples.size() * 100);
+            samples.push_back(data);
+        }
+        return samples;
+    }
+
+    void addParseBenchmarks(BenchRunner &runner, const BenchSizes &sizes)
+    {
+        auto lines = std::make_shared<std::vector<std::string>>(makeTelemetryLines(sizes.telemetryLines));
+        runner.add({"telemetry_parse", "lines", nullptr, [lines]()
+                    {
+                        size_t parsed = 0;
+                        TelemetryData data{};
+                        for (const auto &line : *lines)
+                        {
+                            parsed += TreadmillController::parseTelemetryLine(line, data) ? 1 : 0;
+                        }
+                        return parsed;
+                    },
+                    nullptr});
+
+        auto profile = std::make_shared<std::string>(makeProfileText(sizes.profileLines));
+        runner.add({"profile_parse", "steps", nullptr, [profile]()
+                    { return ProfileParser::parseSpeedCommands(*profile).size(); },
+                    nullptr});
+    }
+
+    // Publish to four subscribers at once: UI-style drop-oldest, a lossless recorder and two
+    // analytics consumers, one of them slow. The slow one only loses its own frames.
+    void addBusBenchmark(BenchRunner &runner, const BenchSizes &sizes)
+    {
+        struct BusState
+        {
+            TelemetryBus bus;
+            std::vector<TelemetryBus::Subscription> subscriptions;
+            std::array<std::atomic<size_t>, 4> received{};
+            std::vector<TelemetrySample> samples;
+        };
+        auto state = std::make_shared<BusState>();
+        for (const TelemetryData &data : makeSamples(sizes.busSamples))
+        {
+            state->samples.push_back(TelemetrySample{1, data});
+        }
+
+        runner.add({"telemetry_bus_fanout", "samples", [state]()
+                    {
+                        for (auto &count : state->received)
+                        {
+                            count = 0;
+                        }
+                        auto counter = [state](size_t index)
+                        {
+                            return [state, index](const TelemetryBus::Ptr &)
+                            { state->received[index]++; };
+                        };
+                        state->subscriptions.push_back(state->bus.subscribe("ui", {64, OverflowPolicy::DropOldest, {}, {}}, counter(0)));
+                        state->subscriptions.push_back(state->bus.subscribe("recorder", {8192, OverflowPolicy::Block, std::chrono::milliseconds(1000), {}}, counter(1)));
+                        state->subscriptions.push_back(state->bus.subscribe("analytics", {1024, OverflowPolicy::DropNewest, {}, {}}, counter(2)));
+                        state->subscriptions.push_back(state->bus.subscribe("slow", {256, OverflowPolicy::DropOldest, {}, {}},
+                                                                            [state](const TelemetryBus::Ptr &)
+                                                                            {
+                                                                                state->received[3]++;
+                                                                                std::this_thread::sleep_for(std::chrono::microseconds(50));
+                                                                            }));
+                        return true;
+                    },
+                    [state]()
+                    {
+                        for (const TelemetrySample &sample : state->samples)
+                        {
+                            state->bus.publish(sample);
+                        }
+                        // Done once the lossless recorder has seen everything
+                        while (state->received[1] < state->samples.size())
+                        {
+                            std::this_thread::yield();
+                        }
+                        return state->samples.size();
+                    },
+                    [state]()
+                    { state->subscriptions.clear(); },
+                    [state](BenchRunner::Metrics &metrics)
+                    {
+                        for (const SubscriberStats &stats : state->bus.getStats())
+                        {
+                            metrics.emplace_back(stats.name + "_dropped", static_cast<double>(stats.dropped));
+                        }
+                    }});
+    }
+
+    void addExportBenchmark(BenchRunner &runner, const BenchSizes &sizes)
+    {
+        auto samples = std::make_shared<std::vector<TelemetryData>>(makeSamples(sizes.csvSamples));
+        auto path = std::make_shared<std::string>(
+            (std::filesystem::temp_directory_path() / "treadmill_bench_export.csv").string());
+
+        runner.add({"csv_export", "samples", nullptr, [samples, path]()
+                    {
+                        std::ofstream file(*path);
+                        TelemetryCsv::writeHeader(file);
+                        for (const auto &sample : *samples)
+                        {
+                            TelemetryCsv::writeRow(file, sample);
+                        }
+                        file.close();
+                        return samples->size();
+                    },
+                    [path]()
+                    { std::remove(path->c_str()); }});
+    }
+
+    void addSerialBenchmarks(BenchRunner &runner, const BenchSizes &sizes)
+    {
+        // Line framing: the fake device bursts TEL frames at the listener
+        struct FramingState
+        {
+            FakeTreadmill device;
+            SerialManager serial;
+            std::mutex mutex;
+            std::condition_variable cv;
+            size_t received = 0;
+        };
+        auto framing = std::make_shared<FramingState>();
+        size_t framedLines = sizes.framedLines;
+
+        runner.add({"serial_line_framing", "lines", [framing]()
+                    {
+                        if (!framing->device.open() || !framing->serial.initialize(framing->device.getPortName(), 500000))
+                            return false;
+                        framing->received = 0;
+                        framing->serial.setTelemetryCallback([framing](const std::string &)
+                                                             {
+                            std::lock_guard<std::mutex> lock(framing->mutex);
+                            framing->received++;
+                            framing->cv.notify_one(); });
+                        framing->serial.startListening();
+                        return true;
+                    },
+                    [framing, framedLines]()
+                    {
+                        framing->device.streamTelemetry(framedLines);
+                        std::unique_lock<std::mutex> lock(framing->mutex);
+                        framing->cv.wait_for(lock, std::chrono::seconds(30), [&]()
+                                             { return framing->received >= framedLines; });
+                        return framing->received;
+                    },
+                    [framing]()
+                    {
+                        framing->serial.stopListening();
+                        framing->serial.disconnect();
+                        framing->device.close();
+                    }});
+
+        // Upload round-trip: sync, PROFILE?, one PROFILE_BIN transfer and RUN_TM
+        struct UploadState
+        {
+            FakeTreadmill device;
+            std::unique_ptr<TreadmillController> controller;
+            std::vector<std::string> commands;
+        };
+        auto upload = std::make_shared<UploadState>();
+        upload->commands = ProfileParser::parseSpeedCommands(makeProfileText(sizes.uploadSteps));
+
+        runner.add({"upload_roundtrip", "steps", [upload]()
+                    {
+                        upload->controller = std::make_unique<TreadmillController>();
+                        return upload->device.open() && upload->controller->initialize(upload->device.getPortName());
+                    },
+                    [upload]()
+                    { return upload->controller->runTreadmill(upload->commands) ? upload->commands.size() : 0; },
+                    [upload]()
+                    {
+                        upload->controller->stopTreadmill();
+                        upload->controller.reset();
+                        upload->device.close();
+                    }});
+
+        // The same upload as text: START_READ, one READY per step, END_READ and a PROFILE? check
+        auto text = std::make_shared<UploadState>();
+        text->commands = upload->commands;
+
+        runner.add({"upload_text", "steps", [text]()
+                    {
+                        text->controller = std::make_unique<TreadmillController>();
+                        text->controller->setBinaryUpload(false);
+                        return text->device.open() && text->controller->initialize(text->device.getPortName());
+                    },
+                    [text]()
+                    { return text->controller->runTreadmill(text->commands) ? text->commands.size() : 0; },
+                    [text]()
+                    {
+                        text->controller->stopTreadmill();
+                        text->controller.reset();
+                        text->device.close();
+                    }});
+
+        // Repeat start: the device still holds the profile, so only PROFILE? and RUN_TM remain
+        auto cached = std::make_shared<UploadState>();
+        cached->commands = upload->commands;
+
+        runner.add({"upload_cached", "steps", [cached]()
+                    {
+                        cached->controller = std::make_unique<TreadmillController>();
+                        if (!cached->device.open() || !cached->controller->initialize(cached->device.getPortName()))
+                            return false;
+                        bool primed = cached->controller->runTreadmill(cached->commands);
+                        cached->controller->stopTreadmill();
+                        return primed;
+                    },
+                    [cached]()
+                    { return cached->controller->runTreadmill(cached->commands) ? cached->commands.size() : 0; },
+                    [cached]()
+                    {
+                        cached->controller->stopTreadmill();
+                        cached->controller.reset();
+                        cached->device.close();
+                    }});
+    }
+
+    // N simulated treadmills at 100 Hz telemetry on one DeviceManager with a fixed
+    // two-thread pool: pool CPU per device and latency should not grow with N
+    void addMultiDeviceBenchmarks(BenchRunner &runner, const BenchSizes &sizes)
+    {
+        static constexpr size_t POOL_THREADS = 2;
+        static constexpr int TELEMETRY_INTERVAL_MS = 10;
+
+        struct MultiDeviceState
+        {
+            size_t deviceCount = 0;
+            std::vector<std::unique_ptr<FakeTreadmill>> devices;
+            std::unique_ptr<DeviceManager> manager;
+            std::vector<std::string> commands;
+            TelemetryBus::Subscription counter;
+            std::atomic<size_t> frames{0};
+            size_t framesAtStart = 0;
+            int64_t cpuStartUs = 0;
+            int64_t cpuEndUs = 0;
+            std::chrono::steady_clock::time_point windowStart;
+            std::chrono::steady_clock::time_point windowEnd;
+        };
+
+        for (size_t deviceCount : {1, 2, 4, 8})
+        {
+            auto state = std::make_shared<MultiDeviceState>();
+            state->deviceCount = deviceCount;
+            state->commands = ProfileParser::parseSpeedCommands("L: 1.0 R: 1.0 T: 600\n");
+            int windowMs = sizes.multiDeviceWindowMs;
+
+            runner.add({"multi_device_" + std::to_string(deviceCount), "frames", [state]()
+                        {
+                            state->manager = std::make_unique<DeviceManager>(POOL_THREADS);
+                            state->manager->setRecording(false);
+                            state->counter = state->manager->getTelemetryBus().subscribe(
+                                "bench", {4096, OverflowPolicy::DropOldest, {}, {}},
+                                [state](const TelemetryBus::Ptr &)
+                                { state->frames++; });
+                            for (size_t i = 0; i < state->deviceCount; ++i)
+                            {
+                                auto device = std::make_unique<FakeTreadmill>();
+                                device->setTelemetryIntervalMs(TELEMETRY_INTERVAL_MS);
+                                if (!device->open())
+                                    return false;
+                                size_t id = state->manager->addDevice();
+                                if (!state->manager->getController(id)->initialize(device->getPortName()))
+                                    return false;
+                                state->devices.push_back(std::move(device));
+                            }
+                            return state->manager->runAll(state->commands) == state->deviceCount;
+                        },
+                        [state, windowMs]()
+                        {
+                            state->framesAtStart = state->frames;
+                            state->cpuStartUs = state->manager->getIoPool().getCpuTimeUs();
+                            state->windowStart = std::chrono::steady_clock::now();
+                            std::this_thread::sleep_for(std::chrono::milliseconds(windowMs));
+                            state->windowEnd = std::chrono::steady_clock::now();
+                            state->cpuEndUs = state->manager->getIoPool().getCpuTimeUs();
+                            return state->frames - state->framesAtStart;
+                        },
+                        [state]()
+                        {
+                            state->manager->stopAll();
+                            state->counter.reset();
+                            state->manager.reset();
+                            state->devices.clear();
+                        },
+                        [state](BenchRunner::Metrics &metrics)
+                        {
+                            double windowUs = std::chrono::duration<double, std::micro>(state->windowEnd - state->windowStart).count();
+                            size_t frames = state->frames - state->framesAtStart;
+                            if (state->cpuStartUs >= 0 && windowUs > 0.0)
+                            {
+                                double cpuUs = static_cast<double>(state->cpuEndUs - state->cpuStartUs);
+                                metrics.emplace_back("pool_cpu_pct", 100.0 * cpuUs / windowUs);
+                                metrics.emplace_back("pool_cpu_pct_per_device", 100.0 * cpuUs / windowUs / state->deviceCount);
+                                metrics.emplace_back("cpu_us_per_frame", frames ? cpuUs / frames : 0.0);
+                            }
+
+                            // Worst device, so one starved device cannot hide behind the others
+                            uint32_t p50Us = 0, p99Us = 0, maxUs = 0;
+                            for (const DeviceStatus &device : state->manager->getDeviceStatus())
+                            {
+                                p50Us = std::max(p50Us, device.deviceToHost.p50Us);
+                                p99Us = std::max(p99Us, device.deviceToHost.p99Us);
+                                maxUs = std::max(maxUs, device.deviceToHost.maxUs);
+                            }
+                            metrics.emplace_back("latency_p50_us", p50Us);
+                            metrics.emplace_back("latency_p99_us", p99Us);
+                            metrics.emplace_back("latency_max_us", maxUs);
+                        }});
+        }
+    }
+
+    // Rule cost per sample, and the full loop on a device: faulted TEL frame out -> STOP_TM back in
+    void addSafetyBenchmarks(BenchRunner &runner, const BenchSizes &sizes)
+    {
+        static constexpr int TELEMETRY_INTERVAL_MS = 10;
+
+        struct RulesState
+        {
+            std::vector<TelemetryData> samples;
+            std::unique_ptr<SafetyMonitor> monitor;
+        };
+        auto rules = std::make_shared<RulesState>();
+        rules->samples = makeSamples(sizes.safetySamples);
+
+        runner.add({"safety_rules", "samples", [rules]()
+                    {
+                        rules->monitor = std::make_unique<SafetyMonitor>();
+                        return true;
+                    },
+                    [rules]()
+                    {
+                        TelemetrySample sample;
+                        for (const TelemetryData &data : rules->samples)
+                        {
+                            sample.data = data;
+                            rules->monitor->evaluate(sample);
+                        }
+                        return rules->samples.size();
+                    },
+                    [rules]()
+                    { rules->monitor.reset(); },
+                    [rules](BenchRunner::Metrics &metrics)
+                    {
+                        SafetyStats stats = rules->monitor->getStats();
+                        metrics.emplace_back("eval_p99_us", stats.evaluation.p99Us);
+                        metrics.emplace_back("eval_max_us", stats.evaluation.maxUs);
+                    }});
+
+        struct StopState
+        {
+            FakeTreadmill device;
+            std::unique_ptr<TreadmillController> controller;
+            std::vector<std::string> commands;
+            int64_t faultToStopUs = -1;
+        };
+        auto stop = std::make_shared<StopState>();
+        stop->commands = ProfileParser::parseSpeedCommands("L: 1.0 R: 1.0 T: 600\n");
+
+        runner.add({"safety_stop", "stops", [stop]()
+                    {
+                        stop->device.setTelemetryIntervalMs(TELEMETRY_INTERVAL_MS);
+                        stop->device.setDriverFault(false);
+                        stop->controller = std::make_unique<TreadmillController>();
+                        if (!stop->device.open() || !stop->controller->initialize(stop->device.getPortName()) ||
+                            !stop->controller->runTreadmill(stop->commands))
+                            return false;
+                        std::this_thread::sleep_for(std::chrono::milliseconds(100)); // Telemetry flowing
+                        return true;
+                    },
+                    [stop]()
+                    {
+                        stop->device.setDriverFault(true);
+                        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(2);
+                        while (stop->device.getFaultToStopUs() < 0 && std::chrono::steady_clock::now() < deadline)
+                        {
+                            std::this_thread::sleep_for(std::chrono::microseconds(100));
+                        }
+                        stop->faultToStopUs = stop->device.getFaultToStopUs();
+                        return static_cast<size_t>(stop->faultToStopUs >= 0 ? 1 : 0);
+                    },
+                    [stop]()
+                    {
+                        stop->controller->stopTreadmill();
+                        stop->controller.reset();
+                        stop->device.close();
+                    },
+                    [stop](BenchRunner::Metrics &metrics)
+                    {
+                        SafetyStats stats = stop->controller->getSafetyMonitor()->getStats();
+                        metrics.emplace_back("fault_to_stop_us", static_cast<double>(stop->faultToStopUs));
+                        metrics.emplace_back("sample_to_action_us", stats.sampleToAction.maxUs);
+                        metrics.emplace_back("over_budget", static_cast<double>(stats.overBudget));
+                    }});
+    }
+
+    // The same four channels per sample (live path) and block-wise over a recording (export path)
+    void addDerivedChannelBenchmarks(BenchRunner &runner, const BenchSizes &sizes)
+    {
+        struct ChannelState
+        {
+            DerivedChannels channels;
+            std::vector<TelemetryData> samples;
+            std::vector<double> live;               // Last sample's values, per channel
+            std::vector<std::vector<double>> batch; // out[channel][sample]
+        };
+        auto state = std::make_shared<ChannelState>();
+        state->samples = makeSamples(sizes.derivedSamples);
+        std::string error;
+        state->channels.parse("SpeedL = ActualL * 0.00524\n"
+                              "AccelL = d(SpeedL)\n"
+                              "Asymmetry = abs(ActualL - ActualR) - abs(TargetL - TargetR)\n"
+                              "TrackPct = 100 * (ActualL - TargetL) / max(abs(TargetL), 1)\n",
+                              error);
+
+        runner.add({"derived_channels_live", "samples", nullptr, [state]()
+                    {
+                        DerivedChannels::State channelState = state->channels.makeState();
+                        state->live.assign(state->channels.size(), 0.0);
+                        for (const TelemetryData &data : state->samples)
+                        {
+                            state->channels.evaluate(data, channelState, state->live.data());
+                        }
+                        return state->samples.size();
+                    },
+                    nullptr});
+
+        runner.add({"derived_channels_batch", "samples", nullptr, [state]()
+                    {
+                        DerivedChannels::State channelState = state->channels.makeState();
+                        state->channels.evaluateBatch(state->samples.data(), state->samples.size(), channelState, state->batch);
+                        return state->samples.size();
+                    },
+                    nullptr,
+                    [state](BenchRunner::Metrics &metrics)
+                    {
+                        // Both paths must agree exactly; compare the batch against a fresh per-sample pass
+                        DerivedChannels::State channelState = state->channels.makeState();
+                        std::vector<double> values(state->channels.size());
+                        double maxDiff = 0.0;
+                        for (size_t i = 0; i < state->samples.size(); ++i)
+                        {
+                            state->channels.evaluate(state->samples[i], channelState, values.data());
+                            for (size_t channel = 0; channel < values.size(); ++channel)
+                            {
+                                maxDiff = std::max(maxDiff, std::fabs(values[channel] - state->batch[channel][i]));
+                            }
+                        }
+                        metrics.emplace_back("channels", static_cast<double>(state->channels.size()));
+                        metrics.emplace_back("max_diff_vs_live", maxDiff);
+                    }});
+    }
+
+    // Recording under a small RAM budget so most chunks spill, then reading it all back
+    void addHistoryBenchmarks(BenchRunner &runner, const BenchSizes &sizes)
+    {
+        static constexpr size_t BUDGET_BYTES = 8u * 1024 * 1024;
+
+        struct HistoryState
+        {
+            std::vector<TelemetrySample> samples;
+            std::unique_ptr<TelemetryHistory> history;
+            size_t mismatches = 0;
+        };
+        auto state = std::make_shared<HistoryState>();
+        for (const TelemetryData &data : makeSamples(sizes.historySamples))
+        {
+            // Two devices interleaved, arriving every 10 ms with some jitter
+            TelemetrySample sample;
+            sample.deviceId = 1 + state->samples.size() % 2;
+            sample.data = data;
+            sample.data.hostArrivalUs = static_cast<int64_t>(state->samples.size()) * 5000 + data.timestamp % 97;
+            sample.data.sequence = static_cast<int32_t>((state->samples.size() / 2) % 65536);
+            state->samples.push_back(sample);
+        }
+
+        runner.add({"history_record", "samples", [state]()
+                    {
+                        state->history = std::make_unique<TelemetryHistory>(BUDGET_BYTES);
+                        return true;
+                    },
+                    [state]()
+                    {
+                        for (const TelemetrySample &sample : state->samples)
+                        {
+                            state->history->append(sample);
+                        }
+                        state->history->flush(); // Spilling runs behind append(); count it in full
+                        return state->samples.size();
+                    },
+                    nullptr,
+                    [state](BenchRunner::Metrics &metrics)
+                    {
+                        TelemetryHistoryStats stats = state->history->getStats();
+                        double rawBytes = static_cast<double>(stats.spilledSamples * sizeof(TelemetrySample));
+                        metrics.emplace_back("ram_mb", stats.memoryBytes / 1048576.0);
+                        metrics.emplace_back("disk_mb", stats.spilledBytes / 1048576.0);
+                        metrics.emplace_back("spilled_fraction", static_cast<double>(stats.spilledSamples) / stats.samples);
+                        metrics.emplace_back("bytes_per_spilled_sample",
+                                             stats.spilledSamples > 0 ? static_cast<double>(stats.spilledBytes) / stats.spilledSamples : 0.0);
+                        metrics.emplace_back("compression_ratio", stats.spilledBytes > 0 ? rawBytes / stats.spilledBytes : 0.0);
+                    }});
+
+        // Reads what history_record left behind, or records it first when run on its own
+        runner.add({"history_readback", "samples", [state]()
+                    {
+                        if (!state->history)
+                        {
+                            state->history = std::make_unique<TelemetryHistory>(BUDGET_BYTES);
+                            for (const TelemetrySample &sample : state->samples)
+                            {
+                                state->history->append(sample);
+                            }
+                        }
+                        return true;
+                    },
+                    [state]()
+                    {
+                        size_t index = 0;
+                        state->mismatches = 0;
+                        bool complete = state->history->snapshot().forEachChunk([&](const TelemetrySample *samples, size_t count)
+                                                                                {
+                            for (size_t i = 0; i < count; ++i, ++index)
+                            {
+                                const TelemetrySample &a = samples[i];
+                                const TelemetrySample &b = state->samples[index];
+                                bool same = a.deviceId == b.deviceId && a.data.timestamp == b.data.timestamp &&
+                                            a.data.targetRpm1 == b.data.targetRpm1 && a.data.actualRpm1 == b.data.actualRpm1 &&
+                                            a.data.targetRpm2 == b.data.targetRpm2 && a.data.actualRpm2 == b.data.actualRpm2 &&
+                                            a.data.driver1Healthy == b.data.driver1Healthy && a.data.driver2Healthy == b.data.driver2Healthy &&
+                                            a.data.emergencyStop == b.data.emergencyStop && a.data.profileActive == b.data.profileActive &&
+                                            a.data.droppedFrames == b.data.droppedFrames && a.data.speedQuality1 == b.data.speedQuality1 &&
+                                            a.data.speedQuality2 == b.data.speedQuality2 && a.data.hostArrivalUs == b.data.hostArrivalUs &&
+                                            a.data.sequence == b.data.sequence && a.data.gapBefore == b.data.gapBefore &&
+                                            a.data.setpointSeq == b.data.setpointSeq;
+                                state->mismatches += same ? 0 : 1;
+                            }
+                            return true; });
+                        return complete ? index : 0;
+                    },
+                    nullptr,
+                    [state](BenchRunner::Metrics &metrics)
+                    { metrics.emplace_back("mismatches", static_cast<double>(state->mismatches)); }});
+    }
+
+    // Four treadmills at 100 Hz journaled for a few seconds: what append() costs the recording
+    // thread, and what each fsync costs on this disk
+    void addJournalBenchmark(BenchRunner &runner, const BenchSizes &sizes)
+    {
+        static constexpr size_t DEVICES = 4;
+        static constexpr int INTERVAL_MS = 10;
+
+        struct JournalState
+        {
+            std::string path;
+            std::unique_ptr<SessionJournal> journal;
+            LatencyHistogram append; // ns
+            JournalStats stats;
+        };
+        auto state = std::make_shared<JournalState>();
+        state->path = (std::filesystem::temp_directory_path() / "treadmill_bench_journal.tmj").string();
+        int windowMs = sizes.journalWindowMs;
+
+        runner.add({"journal_record", "samples", [state]()
+                    {
+                        state->journal = std::make_unique<SessionJournal>();
+                        state->append.reset();
+                        return state->journal->open(state->path);
+                    },
+                    [state, windowMs]()
+                    {
+                        auto samples = makeSamples(DEVICES * static_cast<size_t>(windowMs / INTERVAL_MS));
+                        auto next = std::chrono::steady_clock::now();
+                        for (size_t i = 0; i < samples.size(); i += DEVICES)
+                        {
+                            std::this_thread::sleep_until(next);
+                            next += std::chrono::milliseconds(INTERVAL_MS);
+                            for (size_t device = 0; device < DEVICES && i + device < samples.size(); ++device)
+                            {
+                                TelemetrySample sample{device + 1, samples[i + device]};
+                                sample.data.hostArrivalUs = ClockSync::hostNowUs();
+                                auto start = std::chrono::steady_clock::now();
+                                state->journal->append(sample);
+                                state->append.record(static_cast<uint32_t>(
+                                    std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count()));
+                            }
+                        }
+                        state->journal->close(true); // Synced to the last sample
+                        state->stats = state->journal->getStats();
+                        return static_cast<size_t>(state->stats.samples);
+                    },
+                    [state]()
+                    {
+                        state->journal.reset();
+                        std::remove(state->path.c_str());
+                    },
+                    [state](BenchRunner::Metrics &metrics)
+                    {
+                        const JournalStats &stats = state->stats;
+                        LatencySummary append = state->append.summarize();
+                        metrics.emplace_back("append_p99_ns", append.p99Us);
+                        metrics.emplace_back("append_max_ns", append.maxUs);
+                        metrics.emplace_back("fsync_p50_us", stats.sync.p50Us);
+                        metrics.emplace_back("fsync_p99_us", stats.sync.p99Us);
+                        metrics.emplace_back("durable_p99_ms", stats.durable.p99Us / 1000.0);
+                        metrics.emplace_back("bytes_per_sample", stats.samples > 0 ? static_cast<double>(stats.fileBytes) / stats.samples : 0.0);
+                        metrics.emplace_back("write_amplification", stats.writeAmplification());
+                        metrics.emplace_back("dropped", static_cast<double>(stats.dropped));
+                    }});
+    }
+
+    // A long two-device recording, mostly spilled, exported the way the GUI does it: an
+    // ExportJob over a snapshot, reading chunks back and formatting them into a file
+    void addRecordingExportBenchmark(BenchRunner &runner, const BenchSizes &sizes)
+    {
+        static constexpr size_t BUDGET_BYTES = 64u * 1024 * 1024;
+
+        struct RecordingExportState
+        {
+            std::string path;
+            std::unique_ptr<TelemetryHistory> history;
+            ExportProgress progress;
+            uint64_t fileBytes = 0;
+        };
+        auto state = std::make_shared<RecordingExportState>();
+        state->path = (std::filesystem::temp_directory_path() / "treadmill_bench_recording.csv").string();
+        size_t rows = sizes.exportRows;
+
+        runner.add({"recording_export", "rows", [state, rows]()
+                    {
+                        if (!state->history)
+                        {
+                            std::vector<TelemetryData> pattern = makeSamples(10000);
+                            state->history = std::make_unique<TelemetryHistory>(BUDGET_BYTES);
+                            for (size_t i = 0; i < rows; ++i)
+                            {
+                                TelemetrySample sample;
+                                sample.deviceId = 1 + i % 2;
+                                sample.data = pattern[i % pattern.size()];
+                                sample.data.timestamp = static_cast<uint32_t>(i / 2 * 10);
+                                sample.data.sequence = static_cast<int32_t>((i / 2) % 65536);
+                                state->history->append(sample);
+                            }
+                        }
+                        return true;
+                    },
+                    [state]()
+                    {
+                        ExportJob job(state->history->snapshot(), nullptr, state->path);
+                        job.start();
+                        job.wait();
+                        state->progress = job.getProgress();
+                        std::error_code error;
+                        state->fileBytes = std::filesystem::file_size(state->path, error);
+                        return state->progress.state == ExportState::Completed ? static_cast<size_t>(state->progress.rows) : 0;
+                    },
+                    [state]()
+                    { std::remove(state->path.c_str()); },
+                    [state](BenchRunner::Metrics &metrics)
+                    {
+                        TelemetryHistoryStats stats = state->history->getStats();
+                        metrics.emplace_back("spilled_fraction", static_cast<double>(stats.spilledSamples) / stats.samples);
+                        metrics.emplace_back("rows_per_sec", state->progress.rowsPerSecond());
+                        metrics.emplace_back("file_mb", state->fileBytes / 1048576.0);
+                        metrics.emplace_back("mb_per_sec", state->progress.elapsedSec > 0.0
+                                                               ? state->fileBytes / 1048576.0 / state->progress.elapsedSec
+                                                               : 0.0);
+                    }});
+    }
+
+    void printUsage(const char *programName)
+    {
+        std::cerr << "Usage: " << programName << " [--json <file>] [--filter <name>] [--repeat <n>] [--quick] [--verbose]\n"
+                  << "Results are written as JSON to stdout unless --json is given." << std::endl;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    BenchSizes sizes;
+    BenchRunner runner;
+    std::string jsonPath;
+    bool verbose = false;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        bool hasValue = (i + 1 < argc);
+
+        if (arg == "--json" && hasValue)
+            jsonPath = argv[++i];
+        else if (arg == "--filter" && hasValue)
+            runner.setFilter(argv[++i]);
+        else if (arg == "--repeat" && hasValue)
+            runner.setRepeats(std::max(1, std::atoi(argv[++i])));
+        else if (arg == "--quick")
+        {
+            sizes.telemetryLines /= 10;
+            sizes.framedLines /= 10;
+            sizes.profileLines /= 10;
+            sizes.csvSamples /= 10;
+            sizes.busSamples /= 10;
+            sizes.safetySamples /= 10;
+            sizes.derivedSamples /= 10;
+            sizes.historySamples /= 10;
+            sizes.exportRows /= 10;
+            sizes.multiDeviceWindowMs /= 4;
+            sizes.journalWindowMs /= 3;
+        }
+        else if (arg == "--verbose")
+            verbose = true;
+        else
+        {
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+
+    addParseBenchmarks(runner, sizes);
+    addBusBenchmark(runner, sizes);
+    addExportBenchmark(runner, sizes);
+    addSerialBenchmarks(runner, sizes);
+    addMultiDeviceBenchmarks(runner, sizes);
+    addSafetyBenchmarks(runner, sizes);
+    addDerivedChannelBenchmarks(runner, sizes);
+    addHistoryBenchmarks(runner, sizes);
+    addJournalBenchmark(runner, sizes);
+    addRecordingExportBenchmark(runner, sizes);
+
+    NullBuffer nullBuffer;
+    std::streambuf *consoleBuffer = std::cout.rdbuf();
+    if (!verbose)
+    {
+        std::cout.rdbuf(&nullBuffer);
+    }
+
+    runner.runAll();
+    std::cout.rdbuf(consoleBuffer);
+
+    if (jsonPath.empty())
+    {
+        runner.writeJson(std::cout);
+        return 0;
+    }
+
+    std::ofstream file(jsonPath);
+    if (!file.is_open())
+    {
+        std::cerr << "Could not create file: " << jsonPath << std::endl;
+        return 1;
+    }
+    runner.writeJson(file);
+    return 0;
+}
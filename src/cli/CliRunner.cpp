@@ -0,0 +1,795 @@
+#include "CliRunner.h"
+#include "utils/FileManager.h"
+#include "utils/ProfileParser.h"
+#include "utils/SessionJournal.h"
+#include "utils/TelemetryCsv.h"
+#include "utils/Trace.h"
+#include <cmath>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <initializer_list>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+std::atomic<bool> CliRunner::s_abortRequested{false};
+
+CliRunner::CliRunner(Options options)
+    : m_options(std::move(options))
+{
+}
+
+bool CliRunner::parseArguments(int argc, char *argv[], Options &options)
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        bool hasValue = (i + 1 < argc);
+
+        try
+        {
+            if ((arg == "--port" || arg == "-p") && hasValue)
+                options.portName = argv[++i];
+            else if ((arg == "--profile" || arg == "-f") && hasValue)
+                options.profilePath = argv[++i];
+            else if ((arg == "--output" || arg == "-o") && hasValue)
+                options.outputPath = argv[++i];
+            else if (arg == "--low-latency")
+                options.lowLatency = true;
+            else if (arg == "--negotiate")
+                options.negotiate = true;
+            else if (arg == "--stream" && hasValue)
+                options.streamRateHz = std::stod(argv[++i]);
+            else if (arg == "--rules" && hasValue)
+                options.rulesPath = argv[++i];
+            else if (arg == "--replay" && hasValue)
+                options.replayPath = argv[++i];
+            else if (arg == "--recover" && hasValue)
+                options.recoverPath = argv[++i];
+            else if (arg == "--channels" && hasValue)
+                options.channelsPath = argv[++i];
+            else if (arg == "--probe" && hasValue)
+                options.probeSamples = std::stoi(argv[++i]);
+            else if (arg == "--trace" && hasValue)
+                options.tracePath = argv[++i];
+            else if (arg == "--baud" && hasValue)
+                options.baudRate = static_cast<unsigned int>(std::stoul(argv[++i]));
+            else if (arg == "--timeout" && hasValue)
+                options.runTimeoutSec = std::stoi(argv[++i]);
+            else if (arg == "--telemetry-timeout" && hasValue)
+                options.telemetryTimeoutSec = std::stoi(argv[++i]);
+            else
+            {
+                std::cerr << "Unknown or incomplete argument: " << arg << std::endl;
+                return false;
+            }
+        }
+        catch (const std::exception &)
+        {
+            std::cerr << "Invalid value for " << arg << std::endl;
+            return false;
+        }
+    }
+
+    if (!options.replayPath.empty() || !options.recoverPath.empty())
+    {
+        return true; // No device involved
+    }
+    // Below the minimum the firmware's setpoint watchdog stops the belts between setpoints
+    if (options.streamRateHz != 0.0 && (options.streamRateHz < TreadmillController::MIN_STREAM_RATE_HZ ||
+                                        options.streamRateHz > TreadmillController::MAX_STREAM_RATE_HZ))
+    {
+        std::cerr << "--stream rate must be between " << TreadmillController::MIN_STREAM_RATE_HZ << " and "
+                  << TreadmillController::MAX_STREAM_RATE_HZ << " Hz" << std::endl;
+        return false;
+    }
+    bool needsProfile = (options.probeSamples <= 0 && !options.negotiate && options.streamRateHz <= 0.0);
+    return !options.portName.empty() && (!needsProfile || !options.profilePath.empty());
+}
+
+void CliRunner::printUsage(const char *programName)
+{
+    std::cerr << "Usage: " << programName << " --port <name> --profile <file> [options]\n"
+              << "       " << programName << " --port <name> --probe <samples>\n"
+              << "       " << programName << " --port <name> --negotiate\n"
+              << "       " << programName << " --port <name> --stream <hz> < setpoints\n"
+              << "       " << programName << " --replay <recording.csv> [--rules <file>] [-o <file> --channels <file>]\n"
+              << "       " << programName << " --recover <session.tmj> [-o <file>]\n"
+              << "  -o, --output <file|->        Record telemetry as CSV (- for stdout)\n"
+              << "      --baud <rate>            Serial baud rate (default 500000)\n"
+              << "      --low-latency            Linux: low-latency serial tuning (USB adapters)\n"
+              << "      --probe <n>              Compare n PING round trips with and without --low-latency\n"
+              << "      --negotiate              Test the link and run at the fastest clean baud rate\n"
+              << "      --stream <hz>            Send \"left right\" lines from stdin as SPD setpoints at this rate\n"
+              << "                               (10-500); the last one is held until the next, EOF ends the stream\n"
+              << "      --rules <file>           Safety rules, one \"name, condition, action[, rpm[, hold ms]]\" per line\n"
+              << "                               (conditions driver_fault/estop/tracking/asymmetry, actions stop/alarm/marker)\n"
+              << "      --replay <file>          Run a recorded CSV through the safety rules; exit 7 if one would stop\n"
+              << "      --recover <file>         Write the samples in an interrupted session journal as CSV\n"
+              << "                               (default: the journal's name with .csv)\n"
+              << "      --channels <file>        Add derived columns to the recording, one \"Name = expression\" per line\n"
+              << "                               (e.g. \"SpeedL = ActualL * 0.00524\", \"AccelL = d(SpeedL)\")\n"
+              << "      --trace <file>           Save a Chrome/Perfetto trace of the run\n"
+              << "      --timeout <s>            Abort the run after this many seconds\n"
+              << "      --telemetry-timeout <s>  Abort if telemetry stops (default 5)\n"
+              << "Exit codes: 0 completed, 1 usage, 2 connect failed, 3 bad profile,\n"
+              << "            4 start failed, 5 aborted, 6 timed out, 7 device fault" << std::endl;
+}
+
+void CliRunner::requestAbort()
+{
+    s_abortRequested.store(true);
+}
+
+int CliRunner::run()
+{
+    if (!m_options.replayPath.empty())
+    {
+        return runReplay();
+    }
+    if (!m_options.recoverPath.empty())
+    {
+        return runRecover();
+    }
+    if (m_options.probeSamples > 0)
+    {
+        return runProbe();
+    }
+    bool streaming = (m_options.streamRateHz > 0.0);
+    if (m_options.negotiate && m_options.profilePath.empty() && !streaming)
+    {
+        return runNegotiation();
+    }
+
+    // 1. Profile, unless setpoints come from stdin
+    std::vector<std::string> commands;
+    if (!streaming)
+    {
+        try
+        {
+            commands = ProfileParser::parseSpeedCommands(FileManager::readFile(m_options.profilePath));
+        }
+        catch (const std::exception &e)
+        {
+            std::cerr << e.what() << std::endl;
+            return ProfileError;
+        }
+
+        if (commands.empty())
+        {
+            std::cerr << "No valid speed commands in " << m_options.profilePath << std::endl;
+            return ProfileError;
+        }
+    }
+
+    // 2. Recording target
+    if (!loadDerivedChannels())
+    {
+        return UsageError;
+    }
+    std::ofstream file;
+    if (m_options.outputPath == "-")
+    {
+        m_output = &std::cout;
+    }
+    else if (!m_options.outputPath.empty())
+    {
+        std::string path = FileManager::ensureExtension(m_options.outputPath, ".csv");
+        file.open(path);
+        if (!file.is_open())
+        {
+            std::cerr << "Could not create file: " << path << std::endl;
+            return UsageError;
+        }
+        m_output = &file;
+    }
+
+    if (m_output)
+    {
+        TelemetryCsv::writeHeader(*m_output, false, m_channels.getNames());
+    }
+
+    if (!m_options.tracePath.empty())
+    {
+        Trace::setThreadName("CLI");
+        Trace::setEnabled(true);
+    }
+
+    // 3. Connect and run through the same controller path as the GUI
+    TreadmillController controller;
+    controller.setStatusCallback([this](const std::string &message)
+                                 { handleStatus(message); });
+    if (!loadSafetyRules(*controller.getSafetyMonitor()))
+    {
+        return UsageError;
+    }
+    controller.getSafetyMonitor()->setEventCallback([this](const SafetyEvent &event)
+                                                    { handleSafetyEvent(event); });
+    // The I/O thread never waits for the writer; rows it cannot queue are counted and reported
+    TelemetryBus::Subscription telemetry = controller.getTelemetryBus()->subscribe(
+        "cli", {WRITER_QUEUE_CAPACITY, OverflowPolicy::DropNewest, {}, {}},
+        [this](const TelemetryBus::Ptr &sample)
+        { handleTelemetry(sample->data); });
+
+    if (!controller.initialize(m_options.portName, m_options.baudRate, m_options.lowLatency))
+    {
+        return ConnectFailed;
+    }
+
+    // The board resets to its default rate when the port is reopened, so this only lasts for the run
+    if (m_options.negotiate && controller.negotiateBaudRate().baudRate == 0)
+    {
+        controller.disconnect();
+        return ConnectFailed;
+    }
+
+    ExitCode outcome;
+    SetpointStreamStats stream;
+    if (streaming)
+    {
+        outcome = runStream(controller);
+        controller.stopSetpointStream(); // Joins the stream thread and leaves the device in IDLE
+        stream = controller.getSetpointStreamStats();
+    }
+    else
+    {
+        m_runStart = Clock::now();
+        if (!controller.runTreadmill(commands))
+        {
+            controller.disconnect();
+            return StartFailed;
+        }
+        m_startupMs = std::chrono::duration<double, std::milli>(Clock::now() - m_runStart).count();
+
+        outcome = waitForCompletion();
+
+        // Always leave the device in IDLE; this also joins the listening thread
+        controller.stopTreadmill();
+    }
+    LinkStatsSnapshot link = controller.getLinkStats();
+    TelemetryLatencySnapshot latency = controller.getTelemetryLatency();
+    SafetyStats safety = controller.getSafetyMonitor()->getStats();
+    RunAnalyticsSnapshot analytics = controller.getRunAnalytics();
+    m_frames = controller.getSequenceStats();
+    controller.disconnect();
+    m_writerDropped = telemetry.getStats().dropped; // Nothing is published after disconnect
+    telemetry.reset();                              // Writes out whatever is still queued
+
+    if (m_output)
+    {
+        m_output->flush();
+    }
+
+    // Step analytics next to a recording file
+    if (file.is_open())
+    {
+        std::string stepsPath = RunAnalytics::stepsPathFor(FileManager::ensureExtension(m_options.outputPath, ".csv"));
+        std::ofstream steps(stepsPath);
+        if (steps.is_open())
+        {
+            RunAnalytics::writeCsvHeader(steps);
+            RunAnalytics::writeCsvRows(steps, analytics);
+            std::cerr << "Step analytics saved to " << stepsPath << std::endl;
+        }
+        else
+        {
+            std::cerr << "Could not create file: " << stepsPath << std::endl;
+        }
+    }
+
+    if (!m_options.tracePath.empty() && Trace::dumpToFile(m_options.tracePath))
+    {
+        std::cerr << "Trace saved to " << m_options.tracePath << std::endl;
+    }
+
+    printSummary(outcome, commands.size(), link, latency);
+    if (streaming)
+    {
+        printStreamSummary(stream);
+    }
+    printAnalyticsSummary(analytics);
+    printSafetySummary(safety);
+    return outcome;
+}
+
+int CliRunner::runReplay()
+{
+    std::string text;
+    try
+    {
+        text = FileManager::readFile(m_options.replayPath);
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << e.what() << std::endl;
+        return UsageError;
+    }
+
+    SafetyMonitor monitor;
+    if (!loadSafetyRules(monitor) || !loadDerivedChannels())
+    {
+        return UsageError;
+    }
+    monitor.setEventCallback([this](const SafetyEvent &event)
+                             { handleSafetyEvent(event); });
+
+    // Samples go through the rules exactly as the I/O thread would hand them over, with no device to stop
+    std::istringstream stream(text);
+    std::string line;
+    bool deviceColumn = false;
+    if (!std::getline(stream, line) || !TelemetryCsv::parseHeader(line, deviceColumn))
+    {
+        std::cerr << m_options.replayPath << " is not a telemetry recording" << std::endl;
+        return UsageError;
+    }
+
+    size_t skipped = 0;
+    TelemetryHistory recording;
+    while (std::getline(stream, line))
+    {
+        TelemetrySample sample;
+        if (!TelemetryCsv::parseRow(line, deviceColumn, sample))
+        {
+            skipped++;
+            continue;
+        }
+        sample.data.hostArrivalUs = ClockSync::hostNowUs();
+        for (SafetyEvent &event : monitor.evaluate(sample))
+        {
+            monitor.complete(event);
+        }
+        recording.append(sample);
+    }
+    size_t rows = recording.size();
+
+    // Written back with the derived columns
+    if (!m_options.outputPath.empty())
+    {
+        std::ofstream file;
+        std::ostream *out = &std::cout;
+        if (m_options.outputPath != "-")
+        {
+            std::string path = FileManager::ensureExtension(m_options.outputPath, ".csv");
+            file.open(path);
+            if (!file.is_open())
+            {
+                std::cerr << "Could not create file: " << path << std::endl;
+                return UsageError;
+            }
+            out = &file;
+        }
+        if (!TelemetryCsv::writeRecording(*out, recording.snapshot(), &m_channels))
+        {
+            return UsageError;
+        }
+        out->flush();
+    }
+
+    SafetyStats stats = monitor.getStats();
+    std::cerr << "---- treadmill-cli replay ----\n"
+              << "Recording:      " << rows << " samples";
+    if (skipped > 0)
+    {
+        std::cerr << ", " << skipped << " malformed rows skipped";
+    }
+    std::cerr << "\n";
+    printSafetySummary(stats);
+    return stats.stops > 0 ? DeviceFault : Completed;
+}
+
+int CliRunner::runRecover()
+{
+    std::string csvPath = m_options.outputPath.empty()
+                              ? std::filesystem::path(m_options.recoverPath).replace_extension(".csv").string()
+                              : FileManager::ensureExtension(m_options.outputPath, ".csv");
+
+    JournalRecovery recovery;
+    if (!SessionJournal::recoverToCsv(m_options.recoverPath, csvPath, recovery))
+    {
+        return UsageError;
+    }
+
+    std::cerr << "---- treadmill-cli recover ----\n"
+              << "Journal:        " << recovery.blocks << " blocks, " << recovery.validBytes << " bytes intact"
+              << (recovery.cleanEnd ? ", closed normally" : ", interrupted") << "\n";
+    if (recovery.discardedBytes > 0)
+    {
+        std::cerr << "Torn tail:      " << recovery.discardedBytes << " bytes dropped\n";
+    }
+    std::cerr << "Recovered:      " << recovery.samples << " samples to " << csvPath << std::endl;
+    return Completed;
+}
+
+int CliRunner::runProbe()
+{
+    std::cerr << "Round trip over " << m_options.probeSamples << " PINGs (us):" << std::endl;
+
+    for (bool lowLatency : {false, true})
+    {
+        TreadmillController controller;
+        if (!controller.initialize(m_options.portName, m_options.baudRate, lowLatency))
+        {
+            return ConnectFailed;
+        }
+
+        LatencySummary rtt = controller.probeRoundTrip(m_options.probeSamples);
+        controller.disconnect();
+
+        std::cerr << (lowLatency ? "  low latency " : "  default     ");
+        if (rtt.count == 0)
+        {
+            std::cerr << "no replies" << std::endl;
+            return StartFailed;
+        }
+        std::cerr << "n " << rtt.count << ", p50 " << rtt.p50Us << ", p90 " << rtt.p90Us
+                  << ", p99 " << rtt.p99Us << ", max " << rtt.maxUs << std::endl;
+    }
+    return Completed;
+}
+
+int CliRunner::runNegotiation()
+{
+    // Results are reported through the status callback as each rate is tried
+    TreadmillController controller;
+    controller.setStatusCallback([this](const std::string &message)
+                                 { handleStatus(message); });
+    if (!controller.initialize(m_options.portName, m_options.baudRate, m_options.lowLatency))
+    {
+        return ConnectFailed;
+    }
+
+    BaudNegotiationResult result = controller.negotiateBaudRate();
+    controller.disconnect();
+    return result.baudRate != 0 ? Completed : ConnectFailed;
+}
+
+CliRunner::ExitCode CliRunner::runStream(TreadmillController &controller)
+{
+    // Setpoints read from stdin, each used for one tick; the newest is held while
+    // the queue is empty so a slow or interactive producer keeps the belts steady
+    struct SetpointQueue
+    {
+        std::mutex mutex;
+        std::deque<std::pair<float, float>> pending;
+        std::pair<float, float> current{0.0f, 0.0f};
+        bool inputClosed = false;
+    };
+    auto queue = std::make_shared<SetpointQueue>();
+
+    // Detached: a blocking getline cannot be interrupted when the run is aborted
+    std::thread([queue]
+                {
+        std::string line;
+        while (std::getline(std::cin, line))
+        {
+            std::istringstream fields(line);
+            float left = 0.0f, right = 0.0f;
+            if (fields >> left >> right)
+            {
+                std::lock_guard<std::mutex> lock(queue->mutex);
+                queue->pending.emplace_back(left, right);
+            }
+        }
+        std::lock_guard<std::mutex> lock(queue->mutex);
+        queue->inputClosed = true; })
+        .detach();
+
+    auto source = [queue](double, float &left, float &right)
+    {
+        std::lock_guard<std::mutex> lock(queue->mutex);
+        if (!queue->pending.empty())
+        {
+            queue->current = queue->pending.front();
+            queue->pending.pop_front();
+        }
+        else if (queue->inputClosed)
+        {
+            return false;
+        }
+        left = queue->current.first;
+        right = queue->current.second;
+        return true;
+    };
+
+    m_runStart = Clock::now();
+    if (!controller.startSetpointStream(m_options.streamRateHz, source))
+    {
+        return StartFailed;
+    }
+    m_startupMs = std::chrono::duration<double, std::milli>(Clock::now() - m_runStart).count();
+
+    // Telemetry only flows while the belts move, so there is no telemetry timeout here
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (controller.isStreaming())
+    {
+        if (m_deviceFault)
+            return DeviceFault;
+        if (s_abortRequested)
+            return Aborted;
+        if (m_options.runTimeoutSec > 0 && Clock::now() - m_runStart > std::chrono::seconds(m_options.runTimeoutSec))
+        {
+            std::cerr << "Run timeout reached" << std::endl;
+            return TimedOut;
+        }
+        m_cv.wait_for(lock, std::chrono::milliseconds(100));
+    }
+    // A safety stop, or the firmware stopping the belts on its own, also ends the stream
+    if (!controller.getSetpointStreamStats().error.empty())
+    {
+        return DeviceFault;
+    }
+    return m_deviceFault ? DeviceFault : Completed;
+}
+
+CliRunner::ExitCode CliRunner::waitForCompletion()
+{
+    const auto pollInterval = std::chrono::milliseconds(100);
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    while (true)
+    {
+        if (m_finished)
+            return Completed;
+        if (m_deviceFault)
+            return DeviceFault;
+        if (s_abortRequested)
+            return Aborted;
+
+        auto now = Clock::now();
+        if (m_options.runTimeoutSec > 0 && now - m_runStart > std::chrono::seconds(m_options.runTimeoutSec))
+        {
+            std::cerr << "Run timeout reached" << std::endl;
+            return TimedOut;
+        }
+
+        auto lastActivity = (m_sampleCount > 0) ? m_lastSample : m_runStart;
+        if (now - lastActivity > std::chrono::seconds(m_options.telemetryTimeoutSec))
+        {
+            std::cerr << "No telemetry for " << m_options.telemetryTimeoutSec << "s" << std::endl;
+            return TimedOut;
+        }
+
+        m_cv.wait_for(lock, pollInterval);
+    }
+}
+
+// Called on the subscription's delivery thread
+void CliRunner::handleTelemetry(const TelemetryData &data)
+{
+    if (m_output)
+    {
+        if (!m_channels.empty())
+        {
+            m_channels.evaluate(data, m_channelState, m_channelValues.data());
+        }
+        TelemetryCsv::writeRow(*m_output, data, m_channelValues.data(), m_channelValues.size());
+    }
+
+    auto now = Clock::now();
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    if (m_sampleCount == 0)
+    {
+        m_firstSample = now;
+    }
+    else
+    {
+        double gapMs = std::chrono::duration<double, std::milli>(now - m_lastSample).count();
+        m_gapSumMs += gapMs;
+        if (gapMs > m_gapMaxMs)
+            m_gapMaxMs = gapMs;
+    }
+    m_lastSample = now;
+    m_sampleCount++;
+    m_firmwareDrops = data.droppedFrames;
+}
+
+bool CliRunner::loadDerivedChannels()
+{
+    if (m_options.channelsPath.empty())
+    {
+        return true;
+    }
+
+    std::string error;
+    try
+    {
+        if (m_channels.parse(FileManager::readFile(m_options.channelsPath), error))
+        {
+            std::cerr << "Derived channels: " << m_channels.size() << " from " << m_options.channelsPath << std::endl;
+            m_channelState = m_channels.makeState();
+            m_channelValues.assign(m_channels.size(), 0.0);
+            return true;
+        }
+    }
+    catch (const std::exception &e)
+    {
+        error = e.what();
+    }
+    std::cerr << m_options.channelsPath << ": " << error << std::endl;
+    return false;
+}
+
+bool CliRunner::loadSafetyRules(SafetyMonitor &monitor) const
+{
+    if (m_options.rulesPath.empty())
+    {
+        return true;
+    }
+
+    try
+    {
+        std::vector<SafetyRule> rules = SafetyMonitor::parseRules(FileManager::readFile(m_options.rulesPath));
+        std::cerr << "Safety rules: " << rules.size() << " from " << m_options.rulesPath << std::endl;
+        monitor.setRules(std::move(rules));
+        return true;
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << e.what() << std::endl;
+        return false;
+    }
+}
+
+// Called on the I/O thread, after the action has been carried out
+void CliRunner::handleSafetyEvent(const SafetyEvent &event)
+{
+    std::cerr << "SAFETY " << safetyActionName(event.action) << " [" << event.rule << "] " << event.detail
+              << " at " << event.timestamp << " ms (" << (event.actionUs - event.sampleArrivalUs) << " us)" << std::endl;
+
+    if (event.action == SafetyAction::Stop)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_deviceFault = true;
+        m_cv.notify_all();
+    }
+}
+
+void CliRunner::handleStatus(const std::string &message)
+{
+    if (message == "FINISHED")
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_finished = true;
+        m_cv.notify_all();
+        return;
+    }
+
+    std::cerr << message << std::endl;
+}
+
+const char *CliRunner::describe(ExitCode code)
+{
+    switch (code)
+    {
+    case Completed:
+        return "completed";
+    case UsageError:
+        return "usage error";
+    case ConnectFailed:
+        return "connect failed";
+    case ProfileError:
+        return "invalid profile";
+    case StartFailed:
+        return "start failed";
+    case Aborted:
+        return "aborted";
+    case TimedOut:
+        return "timed out";
+    case DeviceFault:
+        return "device fault";
+    }
+    return "unknown";
+}
+
+void CliRunner::printSummary(ExitCode outcome, size_t profileSteps, const LinkStatsSnapshot &link,
+                             const TelemetryLatencySnapshot &latency) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    double runSeconds = std::chrono::duration<double>(Clock::now() - m_runStart).count();
+    double streamSeconds = (m_sampleCount > 1)
+                               ? std::chrono::duration<double>(m_lastSample - m_firstSample).count()
+                               : 0.0;
+    double rate = (streamSeconds > 0.0) ? (m_sampleCount - 1) / streamSeconds : 0.0;
+    double meanGapMs = (m_sampleCount > 1) ? m_gapSumMs / (m_sampleCount - 1) : 0.0;
+
+    std::cerr << std::fixed << std::setprecision(1)
+              << "---- treadmill-cli summary ----\n"
+              << "Outcome:        " << describe(outcome) << " (exit " << static_cast<int>(outcome) << ")\n"
+              << "Profile steps:  " << profileSteps << "\n"
+              << "Start-up:       " << m_startupMs << " ms (sync, upload, RUN)\n"
+              << "Run time:       " << runSeconds << " s\n"
+              << "Telemetry:      " << m_sampleCount << " samples, " << rate << " samples/s\n"
+              << "Inter-arrival:  mean " << meanGapMs << " ms, max " << m_gapMaxMs << " ms\n"
+              << "Firmware drops: " << m_firmwareDrops << "\n"
+              << "Writer drops:   " << m_writerDropped << " (output queue full)\n"
+              << "Frame loss:     " << m_frames.lost << " lost in " << m_frames.gaps << " gaps, "
+              << m_frames.duplicates << " duplicates, " << m_frames.reordered << " late, "
+              << m_frames.corrupted << " corrupted\n"
+              << "Link:           RX " << link.bytesRx << " B, TX " << link.bytesTx << " B, "
+              << link.timeouts << " timeouts, " << link.parseErrors << " parse errors\n";
+
+    for (size_t i = 0; i < LINK_COMMAND_COUNT; ++i)
+    {
+        const LatencySummary &rtt = link.roundTrip[i];
+        if (rtt.count > 0)
+        {
+            std::cerr << "  " << std::left << std::setw(12) << linkCommandName(static_cast<LinkCommand>(i)) << std::right
+                      << "n " << rtt.count << ", p50 " << rtt.p50Us << " us, p99 " << rtt.p99Us
+                      << " us, max " << rtt.maxUs << " us\n";
+        }
+    }
+
+    if (latency.deviceToHost.count > 0)
+    {
+        std::cerr << "Device->host:   p50 " << latency.deviceToHost.p50Us / 1000.0
+                  << " ms, p99 " << latency.deviceToHost.p99Us / 1000.0
+                  << " ms, max " << latency.deviceToHost.maxUs / 1000.0 << " ms"
+                  << " (clock drift " << latency.clock.driftPpm << " ppm)\n";
+    }
+    std::cerr << std::flush;
+}
+
+void CliRunner::printStreamSummary(const SetpointStreamStats &stats)
+{
+    std::cerr << std::fixed << std::setprecision(1)
+              << "Setpoints:      " << stats.sent << " sent, " << stats.achievedRateHz << " Hz of "
+              << stats.rateHz << " Hz, " << stats.missedDeadlines << " missed deadlines\n"
+              << "Tick lateness:  p50 " << stats.lateness.p50Us << " us, p99 " << stats.lateness.p99Us
+              << " us, max " << stats.lateness.maxUs << " us\n";
+    if (!stats.error.empty())
+    {
+        std::cerr << "Stream error:   " << stats.error << "\n";
+    }
+    if (stats.setpointToTelemetry.count > 0)
+    {
+        std::cerr << "Setpoint->TEL:  p50 " << stats.setpointToTelemetry.p50Us / 1000.0
+                  << " ms, p99 " << stats.setpointToTelemetry.p99Us / 1000.0
+                  << " ms (n " << stats.setpointToTelemetry.count << ")\n";
+    }
+    std::cerr << std::flush;
+}
+
+void CliRunner::printSafetySummary(const SafetyStats &stats)
+{
+    std::cerr << "Safety:         " << stats.stops << " stops, " << stats.alarms << " alarms, "
+              << stats.markers << " markers over " << stats.samples << " samples\n"
+              << "Rule eval:      p50 " << stats.evaluation.p50Us << " us, p99 " << stats.evaluation.p99Us
+              << " us, max " << stats.evaluation.maxUs << " us\n";
+    if (stats.sampleToAction.count > 0)
+    {
+        std::cerr << "Sample->action: p50 " << stats.sampleToAction.p50Us << " us, p99 " << stats.sampleToAction.p99Us
+                  << " us, max " << stats.sampleToAction.maxUs << " us (" << stats.overBudget << " over the "
+                  << SafetyMonitor::ACTION_BUDGET_US << " us budget)\n";
+    }
+    std::cerr << std::flush;
+}
+
+void CliRunner::printAnalyticsSummary(const RunAnalyticsSnapshot &analytics)
+{
+    if (analytics.samples == 0)
+    {
+        return;
+    }
+
+    std::cerr << std::fixed << std::setprecision(1)
+              << "Tracking error: RMS L " << analytics.errorLeft.rms() << " / R " << analytics.errorRight.rms()
+              << " RPM, worst L " << std::max(std::fabs(analytics.errorLeft.min()), std::fabs(analytics.errorLeft.max()))
+              << " / R " << std::max(std::fabs(analytics.errorRight.min()), std::fabs(analytics.errorRight.max())) << " RPM\n"
+              << "Asymmetry:      mean " << analytics.asymmetry.mean() << " RPM, RMS " << analytics.asymmetry.rms() << " RPM\n";
+    if (analytics.planned)
+    {
+        size_t settled = 0;
+        for (const StepAnalytics &step : analytics.steps)
+        {
+            settled += (step.left.settleMs >= 0.0 && step.right.settleMs >= 0.0) ? 1 : 0;
+        }
+        std::cerr << "Steps:          " << analytics.steps.size() << " reached, " << settled << " settled\n";
+    }
+    std::cerr << std::flush;
+}
@@ -0,0 +1,111 @@
+#pragma once
+#include "utils/DerivedChannels.h"
+#include "utils/TreadmillController.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+/**
+ * Headless treadmill runner
+ * Connects, uploads a profile, runs it with heartbeat and records telemetry
+ * through the same TreadmillController path as the GUI, without any window
+ */
+class CliRunner
+{
+public:
+    // Process exit codes, one per run outcome
+    enum ExitCode : int
+    {
+        Completed = 0,
+        UsageError = 1,
+        ConnectFailed = 2,
+        ProfileError = 3,
+        StartFailed = 4,
+        Aborted = 5,     // SIGINT/SIGTERM
+        TimedOut = 6,    // Run limit reached or telemetry went quiet
+        DeviceFault = 7  // Driver unhealthy or emergency stop reported
+    };
+
+    struct Options
+    {
+        std::string portName;
+        std::string profilePath;
+        std::string outputPath; // "-" for stdout, empty for no recording
+        std::string tracePath;  // Chrome trace-event JSON of the run, empty for none
+        unsigned int baudRate = 500000;
+        int runTimeoutSec = 0;       // 0 = no limit
+        int telemetryTimeoutSec = 5; // Give up if no telemetry arrives for this long
+        bool lowLatency = false;     // Linux low-latency serial tuning
+        int probeSamples = 0;        // > 0: measure round trips (normal vs low latency) instead of running
+        bool negotiate = false;      // Move the link to the fastest baud rate that passes a burst test
+        double streamRateHz = 0.0;   // > 0: stream "left right" setpoints from stdin instead of a profile
+        std::string rulesPath;       // Safety rules (SafetyMonitor::parseRules), empty for the defaults
+        std::string replayPath;      // Recorded CSV to run through the safety rules instead of a device
+        std::string channelsPath;    // Derived channel definitions (DerivedChannels::parse), empty for none
+        std::string recoverPath;     // Session journal (SessionJournal) to turn into a CSV recording
+    };
+
+    explicit CliRunner(Options options);
+
+    static bool parseArguments(int argc, char *argv[], Options &options);
+    static void printUsage(const char *programName);
+
+    // Async-signal-safe: only sets a lock-free flag
+    static void requestAbort();
+
+    int run();
+
+private:
+    using Clock = std::chrono::steady_clock;
+    static constexpr size_t WRITER_QUEUE_CAPACITY = 65536; // Over a minute of 1 kHz telemetry
+
+    int runProbe();
+    int runNegotiation();
+    int runReplay();
+    int runRecover();
+    bool loadSafetyRules(SafetyMonitor &monitor) const;
+    bool loadDerivedChannels();
+    void handleSafetyEvent(const SafetyEvent &event);
+    ExitCode runStream(TreadmillController &controller);
+    void handleTelemetry(const TelemetryData &data);
+    void handleStatus(const std::string &message);
+    ExitCode waitForCompletion();
+    void printSummary(ExitCode outcome, size_t profileSteps, const LinkStatsSnapshot &link,
+                      const TelemetryLatencySnapshot &latency) const;
+    static void printStreamSummary(const SetpointStreamStats &stats);
+    static void printSafetySummary(const SafetyStats &stats);
+    static void printAnalyticsSummary(const RunAnalyticsSnapshot &analytics);
+    static const char *describe(ExitCode code);
+
+    Options m_options;
+    std::ostream *m_output = nullptr;
+
+    // Derived columns of the recording, evaluated per sample on the delivery thread
+    DerivedChannels m_channels;
+    DerivedChannels::State m_channelState;
+    std::vector<double> m_channelValues;
+
+    static std::atomic<bool> s_abortRequested;
+
+    // Run state, shared with the I/O thread
+    mutable std::mutex m_mutex;
+    std::condition_variable m_cv;
+    bool m_finished = false;
+    bool m_deviceFault = false; // Set by a safety Stop rule
+
+    // Throughput / latency figures for the summary
+    Clock::time_point m_runStart;
+    Clock::time_point m_firstSample;
+    Clock::time_point m_lastSample;
+    double m_startupMs = 0.0;
+    size_t m_sampleCount = 0;
+    double m_gapSumMs = 0.0;
+    double m_gapMaxMs = 0.0;
+    uint16_t m_firmwareDrops = 0;
+    uint64_t m_writerDropped = 0; // Samples the output writer's queue had no room for
+    SequenceStats m_frames;
+};
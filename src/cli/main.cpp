@@ -0,0 +1,35 @@
+#include "cli/CliRunner.h"
+#include <csignal>
+#include <iostream>
+
+namespace
+{
+    void handleSignal(int)
+    {
+        CliRunner::requestAbort();
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    CliRunner::Options options;
+    if (!CliRunner::parseArguments(argc, argv, options))
+    {
+        CliRunner::printUsage(argv[0]);
+        return CliRunner::UsageError;
+    }
+
+    std::signal(SIGINT, handleSignal);
+    std::signal(SIGTERM, handleSignal);
+
+    try
+    {
+        CliRunner runner(options);
+        return runner.run();
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return CliRunner::StartFailed;
+    }
+}
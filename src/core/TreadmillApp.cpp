@@ -2,8 +2,13 @@
 #include "ui/panels/SpeedControlPanel.h"
 #include "ui/panels/TestingPanel.h"
 #include "ui/panels/DataPanel.h"
+#include "ui/panels/DevicesPanel.h"
 #include "ui/ThemeManager.h"
+#include "utils/ExportJob.h"
 #include "utils/FileManager.h"
+#include "utils/Trace.h"
+#include <filesystem>
+#include <iomanip>
 #include <iostream>
 #include <sstream>
 
@@ -11,6 +16,16 @@
 using Colors = ThemeManager::Colors;
 using TextSizes = ThemeManager::TextSizes;
 
+namespace
+{
+    // Optional derived channel definitions (see DerivedChannels), read from the working directory
+    constexpr const char *CHANNELS_FILE = "channels.txt";
+    // RAM kept for the telemetry recording; older samples are compressed to a session file
+    constexpr size_t HISTORY_BUDGET_BYTES = 256u * 1024 * 1024;
+    // Session journals, under the downloads folder so they survive a reboot
+    constexpr const char *JOURNAL_DIRECTORY = "treadmill_journal";
+}
+
 TreadmillApp::TreadmillApp()
     : m_window(sf::VideoMode(sf::Vector2u(1200, 800)), "Treadmill Control System"), m_gui(m_window), m_running(false)
 {
@@ -29,7 +44,15 @@ bool TreadmillApp::initialize()
         m_themeManager->loadTheme();
 
         // Initialize core systems
-        m_treadmillController = std::make_shared<TreadmillController>();
+        m_deviceManager = std::make_shared<DeviceManager>();
+        // Status from the other devices; the primary one reports through the speed panel below
+        m_deviceManager->setStatusCallback([this](size_t deviceId, const std::string &message)
+                                           { queueUiUpdate([this, deviceId, message]()
+                                                           { m_dataPanel->addStatusMessage("[Device " + std::to_string(deviceId) + "] " +
+                                                                                           (message == "FINISHED" ? "Run finished" : message)); }); });
+        m_deviceManager->setHistoryBudget(HISTORY_BUDGET_BYTES);
+        m_primaryDeviceId = m_deviceManager->addDevice();
+        m_treadmillController = m_deviceManager->getController(m_primaryDeviceId);
 
         // Create background panel
         m_backgroundPanel = tgui::Panel::create();
@@ -55,8 +78,12 @@ bool TreadmillApp::initialize()
         m_testingPanel = std::make_unique<TestingPanel>();
         m_testingPanel->initialize(m_gui, m_treadmillController);
 
+        m_devicesPanel = std::make_unique<DevicesPanel>();
+        m_devicesPanel->initialize(m_gui, m_deviceManager, m_primaryDeviceId);
+
         // Initial status message
         m_dataPanel->addStatusMessage("System initialized. Please select COM port and connect.");
+        recoverSessions((std::filesystem::path(FileManager::getDownloadsPath()) / JOURNAL_DIRECTORY).string());
 
         // Set up event callbacks
         // Use queueUiUpdate to ensure thread safety for callbacks coming from background threads
@@ -83,29 +110,71 @@ bool TreadmillApp::initialize()
                                                 m_speedPanel->getSpeedInput()->setText(content);
                                                 m_dataPanel->addStatusMessage("File content loaded into speed input"); });
 
-        // Also need to handle telemetry updates which come from background thread
-        // We need to intercept the telemetry callback set in SpeedControlPanel
-        // But SpeedControlPanel sets it directly on the controller.
-        // We should modify SpeedControlPanel to use a thread-safe wrapper or handle it here.
-        // Ideally, SpeedControlPanel should not set the callback directly on the controller if it's not thread safe.
-        // Let's override it here to be safe, or better, modify SpeedControlPanel to use a dispatcher.
-        // Since SpeedControlPanel::initialize sets the callback, we can wrap the controller's callback mechanism.
-
-        // Re-register the telemetry callback with thread safety
-        m_treadmillController->setTelemetryCallback([this](const TelemetryData &data)
-                                                    { 
-                                                        // Store data (Thread Safe)
-                                                        {
-                                                            std::lock_guard<std::mutex> lock(m_dataMutex);
-                                                            m_telemetryHistory.push_back(data);
-                                                        }
-
-                                                        queueUiUpdate([this, data]()
-                                                                    { m_speedPanel->updateTelemetryUI(data); }); });
+        // Telemetry for the speed panel: the UI thread drains this queue every frame.
+        // Only the newest frames matter on screen, so a stalled frame drops the oldest.
+        // Recording is a separate, lossless subscription inside the device manager.
+        TelemetryBus::Options uiOptions;
+        uiOptions.capacity = 64;
+        uiOptions.policy = OverflowPolicy::DropOldest;
+        uiOptions.filter = [primary = m_primaryDeviceId](const TelemetrySample &sample)
+        { return sample.deviceId == primary; };
+        m_uiTelemetry = m_deviceManager->getTelemetryBus().subscribe("ui", uiOptions);
+
+        // Trace dump results from the testing panel (UI thread)
+        m_testingPanel->setStatusCallback([this](const std::string &message)
+                                          { m_dataPanel->addStatusMessage(message); });
+
+        // Device list actions (UI thread); RUN ALL runs the profile in the speed input
+        m_devicesPanel->setStatusCallback([this](const std::string &message)
+                                          { m_dataPanel->addStatusMessage(message); });
+        m_devicesPanel->setCommandsProvider([this]()
+                                            {
+                                                m_speedPanel->parseSpeedCommands();
+                                                return m_speedPanel->getMotorCommands(); });
+
+        // Safety alarms and markers (stops also arrive as status messages from the controller)
+        m_deviceManager->getSafetyMonitor().setEventCallback([this](const SafetyEvent &event)
+                                                             {
+                                                                 if (event.action == SafetyAction::Stop)
+                                                                 {
+                                                                     return;
+                                                                 }
+                                                                 std::string message = std::string(event.action == SafetyAction::Alarm ? "ALARM" : "Marker") +
+                                                                                       " [Device " + std::to_string(event.deviceId) + "] " + event.rule +
+                                                                                       ": " + event.detail + " at " + std::to_string(event.timestamp) + " ms";
+                                                                 queueUiUpdate([this, message]()
+                                                                               { m_dataPanel->addStatusMessage(message); }); });
+
+        // Derived channels, if defined: shown live in the speed panel and added as columns to CSV exports
+        if (FileManager::fileExists(CHANNELS_FILE))
+        {
+            auto channels = std::make_shared<DerivedChannels>();
+            std::string error;
+            if (channels->parse(FileManager::readFile(CHANNELS_FILE), error))
+            {
+                m_deviceManager->setDerivedChannels(channels);
+                m_speedPanel->setDerivedChannels(channels);
+                m_dataPanel->addStatusMessage("Derived channels: " + std::to_string(channels->size()) + " from " + CHANNELS_FILE);
+            }
+            else
+            {
+                m_dataPanel->addStatusMessage(std::string(CHANNELS_FILE) + ": " + error);
+            }
+        }
+
+        // Firmware loop timing arrives on the I/O thread alongside telemetry
+        m_treadmillController->setControlStatsCallback([this](const ControlLoopStats &stats)
+                                                       { queueUiUpdate([this, stats]()
+                                                                       { m_testingPanel->updateControlStats(stats); }); });
 
         // Connect Download Button
         m_dataPanel->setDownloadDataButtonCallback([this](const std::string &filename)
                                                    { saveTelemetryToCSV(filename); });
+        m_dataPanel->setCancelExportCallback([this]()
+                                             {
+            if (m_exportJob) {
+                m_exportJob->cancel();
+            } });
 
         std::cout << "All components initialized." << std::endl;
         m_running = true;
@@ -122,12 +191,24 @@ bool TreadmillApp::initialize()
 void TreadmillApp::run()
 {
     std::cout << "Starting main loop..." << std::endl;
+    Trace::setThreadName("UI");
 
     while (m_window.isOpen() && m_running)
     {
         handleEvents();
         processUiUpdates(); // Process any pending UI updates from background threads
+        processTelemetry();
+        m_testingPanel->refreshLinkStats();
+        m_devicesPanel->refresh();
+        pollExport();
         render();
+
+        // Samples applied this frame are now on screen
+        for (int64_t arrivalUs : m_presentedArrivals)
+        {
+            m_treadmillController->recordPresentation(arrivalUs);
+        }
+        m_presentedArrivals.clear();
     }
 
     std::cout << "Application closing normally" << std::endl;
@@ -139,8 +220,18 @@ void TreadmillApp::queueUiUpdate(std::function<void()> updateFunc)
     m_uiQueue.push(updateFunc);
 }
 
+void TreadmillApp::processTelemetry()
+{
+    TRACE_SCOPE("processTelemetry");
+    m_uiTelemetry.drain([this](const TelemetryBus::Ptr &sample)
+                        {
+                            m_speedPanel->updateTelemetryUI(sample->data);
+                            m_presentedArrivals.push_back(sample->data.hostArrivalUs); });
+}
+
 void TreadmillApp::processUiUpdates()
 {
+    TRACE_SCOPE("processUiUpdates");
     std::lock_guard<std::mutex> lock(m_uiQueueMutex);
     while (!m_uiQueue.empty())
     {
@@ -184,38 +275,110 @@ void TreadmillApp::handleWindowResize(const sf::Event::Resized &resizeEvent)
 
 void TreadmillApp::render()
 {
+    TRACE_SCOPE("render");
     m_window.clear(Colors::WindowBackground);
     m_gui.draw();
     m_window.display();
 }
 
+void TreadmillApp::recoverSessions(const std::string &journalDirectory)
+{
+    for (const std::string &journal : SessionJournal::findIncomplete(journalDirectory))
+    {
+        std::filesystem::path csvPath = std::filesystem::path(FileManager::getDownloadsPath()) /
+                                        ("recovered_" + std::filesystem::path(journal).stem().string() + ".csv");
+        JournalRecovery recovery;
+        if (!SessionJournal::recoverToCsv(journal, csvPath.string(), recovery))
+        {
+            m_dataPanel->addStatusMessage("Could not recover interrupted session " + journal);
+            continue;
+        }
+
+        std::string message = "Recovered " + std::to_string(recovery.samples) + " samples of an interrupted session to " + csvPath.string();
+        if (recovery.discardedBytes > 0)
+        {
+            message += " (" + std::to_string(recovery.discardedBytes) + " bytes of torn writes dropped)";
+        }
+        m_dataPanel->addStatusMessage(message);
+        std::error_code ignored;
+        std::filesystem::remove(journal, ignored);
+    }
+
+    if (!m_deviceManager->startJournal(journalDirectory))
+    {
+        m_dataPanel->addStatusMessage("WARNING: Could not create a session journal in " + journalDirectory +
+                                      "; a crash will lose unsaved telemetry");
+    }
+}
+
 void TreadmillApp::saveTelemetryToCSV(const std::string &filename)
 {
-    std::lock_guard<std::mutex> lock(m_dataMutex);
+    if (m_exportJob && !m_exportJob->isFinished())
+    {
+        m_dataPanel->addStatusMessage("An export is already running");
+        return;
+    }
 
-    std::stringstream ss;
-    // Header
-    ss << "Timestamp,TargetL,ActualL,TargetR,ActualR,Driver1Health,Driver2Health,EStop\n";
+    // Ensure extension is .csv
+    std::string finalPath = FileManager::ensureExtension(filename, ".csv");
 
-    // Data
-    for (const auto &data : m_telemetryHistory)
+    // Written off the UI thread from a snapshot, so recording and the UI carry on meanwhile
+    m_exportJob = std::make_unique<ExportJob>(m_deviceManager->snapshotRecording(),
+                                              m_deviceManager->getDerivedChannels(), finalPath);
+    std::stringstream steps;
+    m_deviceManager->writeAnalyticsCsv(steps);
+    m_exportSteps = steps.str();
+
+    m_exportJob->start();
+    m_dataPanel->showExportProgress(0, m_exportJob->getProgress().totalRows);
+    m_dataPanel->addStatusMessage("Saving data to: " + finalPath);
+}
+
+void TreadmillApp::pollExport()
+{
+    if (!m_exportJob)
     {
-        ss << data.timestamp << ", "
-           << data.targetRpm1 << ", " << data.actualRpm1 << ", "
-           << data.targetRpm2 << ", " << data.actualRpm2 << ", "
-           << data.driver1Healthy << ", " << data.driver2Healthy << ", "
-           << data.emergencyStop << "\n";
+        return;
     }
 
-    try
+    ExportProgress progress = m_exportJob->getProgress();
+    if (progress.state == ExportState::Running)
     {
-        // Ensure extension is .csv
-        std::string finalPath = FileManager::ensureExtension(filename, ".csv");
-        FileManager::writeFile(finalPath, ss.str());
-        m_dataPanel->addStatusMessage("Data saved to: " + finalPath);
+        m_dataPanel->showExportProgress(progress.rows, progress.totalRows);
+        return;
     }
-    catch (const std::exception &e)
+
+    m_dataPanel->hideExportProgress();
+    const std::string &path = m_exportJob->getPath();
+    if (progress.state == ExportState::Completed)
     {
-        m_dataPanel->addStatusMessage("Error saving data: " + std::string(e.what()));
+        std::ostringstream message;
+        message << "Data saved to: " << path << " (" << progress.rows << " rows in " << std::fixed
+                << std::setprecision(1) << progress.elapsedSec << " s, " << std::setprecision(0)
+                << progress.rowsPerSecond() << " rows/s)";
+        m_dataPanel->addStatusMessage(message.str());
+
+        // Step analytics next to the recording
+        std::string stepsPath = RunAnalytics::stepsPathFor(path);
+        try
+        {
+            FileManager::writeFile(stepsPath, m_exportSteps);
+            m_dataPanel->addStatusMessage("Step analytics saved to: " + stepsPath);
+        }
+        catch (const std::exception &e)
+        {
+            m_dataPanel->addStatusMessage("Error saving data: " + std::string(e.what()));
+        }
     }
+    else if (progress.state == ExportState::Cancelled)
+    {
+        m_dataPanel->addStatusMessage("Export cancelled; " + path + " was not saved");
+    }
+    else
+    {
+        m_dataPanel->addStatusMessage("Error saving data: " + m_exportJob->getError());
+    }
+
+    m_exportJob.reset();
+    m_exportSteps.clear();
 }
\ No newline at end of file
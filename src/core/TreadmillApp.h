@@ -7,12 +7,15 @@
 #include <queue>
 #include <mutex>
 #include <functional>
+#include "utils/DeviceManager.h"
 #include "utils/TreadmillController.h"
 
 class SpeedControlPanel;
 class DataPanel;
 class TestingPanel;
+class DevicesPanel;
 class ThemeManager;
+class ExportJob;
 
 class TreadmillApp
 {
@@ -32,12 +35,12 @@ private:
     void queueUiUpdate(std::function<void()> updateFunc);
     void processUiUpdates();
 
-    // Telemetry History
-    std::vector<TelemetryData> m_telemetryHistory;
-    std::mutex m_dataMutex;
-
-    // Helper to save data
+    // Helper to save data (every device's telemetry, recorded by the device manager): starts an
+    // export in the background; pollExport() follows it from the main loop
     void saveTelemetryToCSV(const std::string &filename);
+    void pollExport();
+    // Turns journals left by a crashed or killed session into CSV recordings, then journals this one
+    void recoverSessions(const std::string &journalDirectory);
 
     sf::RenderWindow m_window;
     tgui::Gui m_gui;
@@ -46,14 +49,29 @@ private:
     std::queue<std::function<void()>> m_uiQueue;
     std::mutex m_uiQueueMutex;
 
+    // Arrival times of samples drawn this frame (UI thread only), for host->screen latency
+    std::vector<int64_t> m_presentedArrivals;
+
+    // Drains the UI's telemetry subscription once per frame
+    void processTelemetry();
+
     // UI Components
     std::unique_ptr<SpeedControlPanel> m_speedPanel;
     std::unique_ptr<TestingPanel> m_testingPanel;
     std::unique_ptr<DataPanel> m_dataPanel;
+    std::unique_ptr<DevicesPanel> m_devicesPanel;
     std::unique_ptr<ThemeManager> m_themeManager;
 
     // Core Systems
+    // All treadmills share the manager's I/O pool; the speed and testing panels drive the primary one
+    std::shared_ptr<DeviceManager> m_deviceManager;
+    size_t m_primaryDeviceId = 0;
     std::shared_ptr<TreadmillController> m_treadmillController;
+    // Poll-mode subscription for the primary device, drained by the UI loop
+    TelemetryBus::Subscription m_uiTelemetry;
+    // Export in progress (or just finished), and the step analytics taken when it started
+    std::unique_ptr<ExportJob> m_exportJob;
+    std::string m_exportSteps;
 
     // Main UI elements
     tgui::Panel::Ptr m_backgroundPanel;
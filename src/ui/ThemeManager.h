@@ -63,10 +63,15 @@ public:
         static constexpr const char *SPEED_PANEL_Y = "10%";
         static constexpr const char *SPEED_BUTTON_HEIGHT = "8.33%";
 
-        static constexpr const char *DATA_PANEL_HEIGHT = "85%";
+        static constexpr const char *DATA_PANEL_HEIGHT = "47%";
         static constexpr const char *DATA_PANEL_X = "52.5%";
         static constexpr const char *DATA_PANEL_Y = "10%";
-        static constexpr const char *DATA_BUTTON_HEIGHT = "5.88%";
+        static constexpr const char *DATA_BUTTON_HEIGHT = "10.6%";
+
+        static constexpr const char *DEVICES_PANEL_HEIGHT = "35%";
+        static constexpr const char *DEVICES_PANEL_X = "52.5%";
+        static constexpr const char *DEVICES_PANEL_Y = "60%";
+        static constexpr const char *DEVICES_BUTTON_HEIGHT = "14.3%";
 
         static constexpr const char *TESTING_PANEL_HEIGHT = "20%";
         static constexpr const char *TESTING_PANEL_X = "4%";
@@ -35,12 +35,22 @@ void DataPanel::initialize(tgui::Gui &gui)
     m_downloadDataButton->setSize("30%", Layout::DATA_BUTTON_HEIGHT);
     m_downloadDataButton->setPosition("65%", Layout::MARGIN_SMALL);
 
+    // Export progress, shown only while an export runs
+    m_exportProgress = tgui::ProgressBar::create();
+    m_exportProgress->setSize("30%", Layout::DATA_BUTTON_HEIGHT);
+    m_exportProgress->setPosition("33%", Layout::MARGIN_SMALL);
+    m_exportProgress->setMinimum(0);
+    m_exportProgress->setMaximum(1000);
+    m_exportProgress->setTextSize(TextSizes::LABEL_SMALL);
+    m_exportProgress->setVisible(false);
+
     setupStyling();
 
     // Add widgets to panel
     m_panel->add(m_statusTitle);
     m_panel->add(m_statusText);
     m_panel->add(m_downloadDataButton);
+    m_panel->add(m_exportProgress);
 
     // Add panel to GUI
     gui.add(m_panel);
@@ -68,13 +78,64 @@ void DataPanel::setupStyling()
     ThemeManager::styleButton(m_downloadDataButton, Colors::ButtonDefault,
                               Colors::DefaultButtonHover, Colors::DefaultButtonDown,
                               Colors::DefaultButtonBorder);
+
+    // Progress bar styling
+    m_exportProgress->getRenderer()->setBackgroundColor(Colors::TextAreaBackground);
+    m_exportProgress->getRenderer()->setFillColor(Colors::ButtonStart);
+    m_exportProgress->getRenderer()->setTextColor(Colors::TextPrimary);
+    m_exportProgress->getRenderer()->setTextColorFilled(Colors::TextPrimary);
+    m_exportProgress->getRenderer()->setBorderColor(Colors::TextAreaBorder);
+    m_exportProgress->getRenderer()->setBorders({Borders::ELEMENT_WIDTH});
 }
 
 void DataPanel::setDownloadDataButtonCallback(std::function<void(const std::string &)> callback)
 {
     m_downloadDataButtonCallback = std::move(callback);
     m_downloadDataButton->onPress([this]()
-                                  { openSaveDialog(); });
+                                  {
+        if (m_exporting) {
+            if (m_cancelExportCallback) {
+                m_cancelExportCallback();
+            }
+        } else {
+            openSaveDialog();
+        } });
+}
+
+void DataPanel::setCancelExportCallback(std::function<void()> callback)
+{
+    m_cancelExportCallback = std::move(callback);
+}
+
+void DataPanel::showExportProgress(uint64_t rows, uint64_t totalRows)
+{
+    if (!m_exporting)
+    {
+        m_exporting = true;
+        m_exportProgress->setVisible(true);
+        m_downloadDataButton->setText("CANCEL EXPORT");
+        ThemeManager::styleButton(m_downloadDataButton, Colors::ButtonStop,
+                                  Colors::StopButtonHover, Colors::StopButtonDown,
+                                  Colors::StopButtonBorder);
+    }
+
+    unsigned int permille = totalRows > 0 ? static_cast<unsigned int>(rows * 1000 / totalRows) : 0;
+    m_exportProgress->setValue(permille);
+    m_exportProgress->setText(std::to_string(permille / 10) + "%");
+}
+
+void DataPanel::hideExportProgress()
+{
+    if (!m_exporting)
+    {
+        return;
+    }
+    m_exporting = false;
+    m_exportProgress->setVisible(false);
+    m_downloadDataButton->setText("DOWNLOAD DATA");
+    ThemeManager::styleButton(m_downloadDataButton, Colors::ButtonDefault,
+                              Colors::DefaultButtonHover, Colors::DefaultButtonDown,
+                              Colors::DefaultButtonBorder);
 }
 
 void DataPanel::cleanupFileDialog()
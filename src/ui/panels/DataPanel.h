@@ -2,6 +2,7 @@
 
 #include <TGUI/TGUI.hpp>
 #include <TGUI/Backend/SFML-Graphics.hpp>
+#include <cstdint>
 
 class DataPanel
 {
@@ -14,6 +15,10 @@ public:
     void addStatusMessage(const std::string &message);
     void clearData();
     void setDownloadDataButtonCallback(std::function<void(const std::string &)> callback);
+    // While an export runs the download button cancels it instead
+    void setCancelExportCallback(std::function<void()> callback);
+    void showExportProgress(uint64_t rows, uint64_t totalRows);
+    void hideExportProgress();
 
     // Getters for data operations
     tgui::TextArea::Ptr getStatusText() const { return m_statusText; }
@@ -27,6 +32,9 @@ private:
     tgui::Label::Ptr m_statusTitle;
     tgui::TextArea::Ptr m_statusText;
     tgui::Button::Ptr m_downloadDataButton;
+    tgui::ProgressBar::Ptr m_exportProgress;
     tgui::FileDialog::Ptr m_fileDialog;
     std::function<void(const std::string &)> m_downloadDataButtonCallback;
+    std::function<void()> m_cancelExportCallback;
+    bool m_exporting = false;
 };
\ No newline at end of file
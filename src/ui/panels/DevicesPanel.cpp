@@ -0,0 +1,356 @@
+#include "DevicesPanel.h"
+#include "ui/ThemeManager.h"
+#include "utils/Trace.h"
+#include <iomanip>
+#include <sstream>
+#include <thread>
+
+// Shorter aliases for ThemeManager members
+using Layout = ThemeManager::Layout;
+using Colors = ThemeManager::Colors;
+using TextSizes = ThemeManager::TextSizes;
+using Borders = ThemeManager::Borders;
+
+DevicesPanel::DevicesPanel() = default;
+DevicesPanel::~DevicesPanel() = default;
+
+void DevicesPanel::initialize(tgui::Gui &gui, std::shared_ptr<DeviceManager> deviceManager, size_t primaryDeviceId)
+{
+    m_deviceManager = deviceManager;
+    m_primaryDeviceId = primaryDeviceId;
+
+    // Main panel
+    m_panel = tgui::Panel::create();
+    m_panel->setSize(Layout::HALF_PANEL_WIDTH, Layout::DEVICES_PANEL_HEIGHT);
+    m_panel->setPosition(Layout::DEVICES_PANEL_X, Layout::DEVICES_PANEL_Y);
+
+    m_titleLabel = tgui::Label::create("DEVICES");
+    m_titleLabel->setTextSize(TextSizes::LABEL_STANDARD);
+    m_titleLabel->setPosition(Layout::MARGIN_SMALL, Layout::MARGIN_SMALL);
+
+    // Shared I/O pool size and load
+    m_poolLabel = tgui::Label::create("I/O pool: -");
+    m_poolLabel->setTextSize(TextSizes::LABEL_SMALL);
+    m_poolLabel->setPosition("40%", "6%");
+
+    // One row per device
+    m_deviceList = tgui::ListView::create();
+    m_deviceList->setSize(Layout::PANEL_WIDTH, "52%");
+    m_deviceList->setPosition(Layout::MARGIN_SMALL, "18%");
+    m_deviceList->setTextSize(TextSizes::LABEL_SMALL);
+    m_deviceList->addColumn("#", 40);
+    m_deviceList->addColumn("Port", 110);
+    m_deviceList->addColumn("State", 80);
+    m_deviceList->addColumn("L / R RPM", 110);
+    m_deviceList->addColumn("TEL/s", 60);
+    m_deviceList->addColumn("p99 ms", 60);
+
+    // Adding a device connects it straight away
+    m_portInput = tgui::EditBox::create();
+    m_portInput->setSize("20%", Layout::DEVICES_BUTTON_HEIGHT);
+    m_portInput->setPosition(Layout::MARGIN_SMALL, "76%");
+    m_portInput->setDefaultText("COM4");
+
+    m_addButton = tgui::Button::create("ADD");
+    m_addButton->setSize("16%", Layout::DEVICES_BUTTON_HEIGHT);
+    m_addButton->setPosition("26%", "76%");
+
+    m_removeButton = tgui::Button::create("REMOVE");
+    m_removeButton->setSize("16%", Layout::DEVICES_BUTTON_HEIGHT);
+    m_removeButton->setPosition("44%", "76%");
+
+    m_runAllButton = tgui::Button::create("RUN ALL");
+    m_runAllButton->setSize("16%", Layout::DEVICES_BUTTON_HEIGHT);
+    m_runAllButton->setPosition("62%", "76%");
+
+    m_stopAllButton = tgui::Button::create("STOP ALL");
+    m_stopAllButton->setSize("16%", Layout::DEVICES_BUTTON_HEIGHT);
+    m_stopAllButton->setPosition("80%", "76%");
+
+    // Safety stops stay latched until acknowledged here
+    m_clearStopButton = tgui::Button::create("CLEAR STOP");
+    m_clearStopButton->setSize("20%", Layout::DEVICES_BUTTON_HEIGHT);
+    m_clearStopButton->setPosition("18%", "4%");
+
+    setupStyling();
+    connectEvents();
+
+    m_panel->add(m_titleLabel);
+    m_panel->add(m_poolLabel);
+    m_panel->add(m_deviceList);
+    m_panel->add(m_portInput);
+    m_panel->add(m_addButton);
+    m_panel->add(m_removeButton);
+    m_panel->add(m_runAllButton);
+    m_panel->add(m_stopAllButton);
+    m_panel->add(m_clearStopButton);
+
+    gui.add(m_panel);
+}
+
+void DevicesPanel::setupStyling()
+{
+    // Panel styling
+    m_panel->getRenderer()->setBackgroundColor(Colors::PanelBackground);
+    m_panel->getRenderer()->setBorderColor(Colors::BorderSecondary);
+    m_panel->getRenderer()->setBorders({Borders::PANEL_WIDTH});
+    m_panel->getRenderer()->setRoundedBorderRadius(Borders::PANEL_RADIUS);
+
+    m_titleLabel->getRenderer()->setTextColor(Colors::TextPrimary);
+    m_poolLabel->getRenderer()->setTextColor(Colors::TextPrimary);
+
+    m_deviceList->getRenderer()->setBackgroundColor(Colors::TextAreaBackground);
+    m_deviceList->getRenderer()->setTextColor(Colors::TextPrimary);
+    m_deviceList->getRenderer()->setBorderColor(Colors::TextAreaBorder);
+    m_deviceList->getRenderer()->setBorders({Borders::ELEMENT_WIDTH});
+    m_deviceList->getRenderer()->setScrollbarWidth(Borders::SCROLLBAR_WIDTH);
+
+    m_portInput->getRenderer()->setBackgroundColor(Colors::TextAreaBackground);
+    m_portInput->getRenderer()->setTextColor(Colors::TextPrimary);
+    m_portInput->getRenderer()->setBorderColor(Colors::TextAreaBorder);
+    m_portInput->getRenderer()->setBorders({Borders::ELEMENT_WIDTH});
+    m_portInput->getRenderer()->setRoundedBorderRadius(Borders::INPUT_RADIUS);
+
+    ThemeManager::styleButton(m_addButton, Colors::ButtonDefault,
+                              Colors::DefaultButtonHover, Colors::DefaultButtonDown,
+                              Colors::DefaultButtonBorder);
+
+    ThemeManager::styleButton(m_removeButton, Colors::ButtonDefault,
+                              Colors::DefaultButtonHover, Colors::DefaultButtonDown,
+                              Colors::DefaultButtonBorder);
+
+    ThemeManager::styleButton(m_runAllButton, Colors::ButtonStart,
+                              Colors::StartButtonHover, Colors::StartButtonDown,
+                              Colors::StartButtonBorder);
+
+    ThemeManager::styleButton(m_stopAllButton, Colors::ButtonStop,
+                              Colors::StopButtonHover, Colors::StopButtonDown,
+                              Colors::StopButtonBorder);
+
+    ThemeManager::styleButton(m_clearStopButton, Colors::ButtonDefault,
+                              Colors::DefaultButtonHover, Colors::DefaultButtonDown,
+                              Colors::DefaultButtonBorder);
+}
+
+void DevicesPanel::connectEvents()
+{
+    m_addButton->onPress([this]()
+                         { addDevice(); });
+
+    m_removeButton->onPress([this]()
+                            { removeSelectedDevice(); });
+
+    m_runAllButton->onPress([this]()
+                            {
+        std::vector<std::string> commands = m_commandsProvider ? m_commandsProvider() : std::vector<std::string>{};
+        if (commands.empty())
+        {
+            reportStatus("ERROR: No valid commands to send");
+            return;
+        }
+
+        // Uploads block on replies; each device reports its own progress through its status messages
+        auto manager = m_deviceManager;
+        std::thread([manager, commands]()
+                    {
+            Trace::setThreadName("Worker");
+            manager->runAll(commands); })
+            .detach(); });
+
+    m_stopAllButton->onPress([this]()
+                             {
+        auto manager = m_deviceManager;
+        std::thread([manager]()
+                    {
+            Trace::setThreadName("Worker");
+            manager->stopAll(); })
+            .detach(); });
+
+    m_clearStopButton->onPress([this]()
+                               {
+        size_t cleared = m_deviceManager->clearSafetyStops();
+        reportStatus(cleared > 0 ? "Safety stop cleared on " + std::to_string(cleared) + " device(s)"
+                                 : "No safety stop to clear");
+        m_lastRefresh = {}; });
+}
+
+void DevicesPanel::addDevice()
+{
+    std::string port = m_portInput->getText().toStdString();
+    if (port.empty())
+    {
+        reportStatus("Error: Port name cannot be empty");
+        return;
+    }
+
+    for (const DeviceStatus &device : m_deviceManager->getDeviceStatus())
+    {
+        if (device.connected && device.portName == port)
+        {
+            reportStatus(port + " is already connected as device " + std::to_string(device.id));
+            return;
+        }
+    }
+
+    size_t id = m_deviceManager->addDevice();
+    if (!m_deviceManager->getController(id)->initialize(port, 500000))
+    {
+        m_deviceManager->removeDevice(id);
+        reportStatus("Failed to connect to " + port);
+        return;
+    }
+
+    m_portInput->setText("");
+    reportStatus("Device " + std::to_string(id) + " connected on " + port);
+    m_lastRefresh = {}; // Show it now rather than at the next refresh tick
+}
+
+void DevicesPanel::removeSelectedDevice()
+{
+    int row = m_deviceList->getSelectedItemIndex();
+    if (row < 0 || static_cast<size_t>(row) >= m_rowIds.size())
+    {
+        reportStatus("Select a device to remove");
+        return;
+    }
+
+    size_t id = m_rowIds[row];
+    if (id == m_primaryDeviceId)
+    {
+        reportStatus("The main device is connected from the speed control panel");
+        return;
+    }
+
+    m_deviceManager->removeDevice(id);
+    m_lastSamples.erase(id);
+    reportStatus("Device " + std::to_string(id) + " removed");
+    m_lastRefresh = {};
+}
+
+void DevicesPanel::refresh()
+{
+    constexpr auto refreshInterval = std::chrono::milliseconds(500);
+
+    auto now = std::chrono::steady_clock::now();
+    if (!m_deviceManager || now - m_lastRefresh < refreshInterval)
+    {
+        return;
+    }
+    double elapsedSec = std::chrono::duration<double>(now - m_lastRefresh).count();
+    bool haveRate = (m_lastRefresh != std::chrono::steady_clock::time_point{}) && elapsedSec < 5.0;
+    m_lastRefresh = now;
+
+    std::vector<DeviceStatus> devices = m_deviceManager->getDeviceStatus();
+
+    // Rebuild only when devices come or go, so the selection survives refreshes
+    bool rebuild = devices.size() != m_rowIds.size();
+    for (size_t i = 0; !rebuild && i < devices.size(); ++i)
+    {
+        rebuild = devices[i].id != m_rowIds[i];
+    }
+    if (rebuild)
+    {
+        m_deviceList->removeAllItems();
+        m_rowIds.clear();
+    }
+
+    for (size_t i = 0; i < devices.size(); ++i)
+    {
+        const DeviceStatus &device = devices[i];
+
+        std::stringstream speeds;
+        std::stringstream rate;
+        std::stringstream latency;
+        speeds << std::fixed << std::setprecision(1);
+        if (device.samples > 0)
+        {
+            speeds << device.last.actualRpm1 << " / " << device.last.actualRpm2;
+        }
+
+        uint64_t previous = m_lastSamples.count(device.id) ? m_lastSamples[device.id] : device.samples;
+        if (haveRate && device.running)
+        {
+            rate << std::fixed << std::setprecision(1) << (device.samples - previous) / elapsedSec;
+        }
+        m_lastSamples[device.id] = device.samples;
+
+        if (device.deviceToHost.count > 0)
+        {
+            latency << std::fixed << std::setprecision(1) << device.deviceToHost.p99Us / 1000.0;
+        }
+
+        std::vector<tgui::String> row = {
+            std::to_string(device.id) + (device.id == m_primaryDeviceId ? "*" : ""),
+            device.connected ? device.portName : "-",
+            !device.connected ? "offline" : (device.safetyStopped ? "SAFETY STOP" : (device.running ? "running" : "idle")),
+            speeds.str(),
+            rate.str(),
+            latency.str()};
+
+        if (rebuild)
+        {
+            m_deviceList->addItem(row);
+            m_rowIds.push_back(device.id);
+        }
+        else
+        {
+            m_deviceList->changeItem(i, row);
+        }
+    }
+
+    // Pool load over the last interval
+    const IoThreadPool &pool = m_deviceManager->getIoPool();
+    int64_t cpuUs = pool.getCpuTimeUs();
+    std::stringstream ss;
+    ss << "I/O pool: " << pool.getThreadCount() << " threads";
+    if (cpuUs >= 0 && m_lastPoolCpuUs >= 0 && haveRate)
+    {
+        ss << ", " << std::fixed << std::setprecision(1) << (cpuUs - m_lastPoolCpuUs) / (elapsedSec * 1e4) << "% CPU";
+    }
+    m_lastPoolCpuUs = cpuUs;
+
+    // Recording: the RAM window and what has been spilled to the session file
+    TelemetryHistoryStats history = m_deviceManager->getHistoryStats();
+    ss << "  |  Recorded: " << history.samples << " samples, "
+       << std::fixed << std::setprecision(1) << history.memoryBytes / 1048576.0 << " MB in RAM";
+    if (uint64_t lost = m_deviceManager->getRecordingDropped())
+    {
+        ss << ", " << lost << " LOST";
+    }
+    if (history.chunksSpilled > 0)
+    {
+        ss << ", " << history.spilledBytes / 1048576.0 << " MB on disk";
+    }
+
+    // Crash-safe journal: what each fsync costs and how much the device really writes
+    JournalStats journal = m_deviceManager->getJournalStats();
+    if (journal.blocks > 0)
+    {
+        ss << "\nJournal: " << journal.fileBytes / 1048576.0 << " MB, fsync p99 "
+           << journal.sync.p99Us / 1000.0 << " ms, durable p99 " << journal.durable.p99Us / 1000.0
+           << " ms, write amp " << journal.writeAmplification() << "x";
+        if (journal.dropped > 0)
+        {
+            ss << ", " << journal.dropped << " dropped";
+        }
+    }
+    m_poolLabel->setText(ss.str());
+}
+
+void DevicesPanel::setStatusCallback(std::function<void(const std::string &)> callback)
+{
+    m_statusCallback = std::move(callback);
+}
+
+void DevicesPanel::setCommandsProvider(std::function<std::vector<std::string>()> provider)
+{
+    m_commandsProvider = std::move(provider);
+}
+
+void DevicesPanel::reportStatus(const std::string &message)
+{
+    if (m_statusCallback)
+    {
+        m_statusCallback(message);
+    }
+}
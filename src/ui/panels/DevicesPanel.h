@@ -0,0 +1,60 @@
+#pragma once
+
+#include <TGUI/TGUI.hpp>
+#include <TGUI/Backend/SFML-Graphics.hpp>
+#include <chrono>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+#include "utils/DeviceManager.h"
+
+class DevicesPanel
+{
+public:
+    DevicesPanel();
+    ~DevicesPanel();
+
+    // primaryDeviceId is the device driven by the speed panel; it cannot be removed here
+    void initialize(tgui::Gui &gui, std::shared_ptr<DeviceManager> deviceManager, size_t primaryDeviceId);
+
+    // Called on the UI thread
+    void setStatusCallback(std::function<void(const std::string &)> callback);
+    // Supplies the profile for RUN ALL (normally the speed panel's commands)
+    void setCommandsProvider(std::function<std::vector<std::string>()> provider);
+
+    // Pulls per-device state from the manager; throttled, so it can be called every frame
+    void refresh();
+
+private:
+    void setupStyling();
+    void connectEvents();
+    void addDevice();
+    void removeSelectedDevice();
+    void reportStatus(const std::string &message);
+
+    tgui::Panel::Ptr m_panel;
+    tgui::Label::Ptr m_titleLabel;
+    tgui::Label::Ptr m_poolLabel;
+    tgui::ListView::Ptr m_deviceList;
+    tgui::EditBox::Ptr m_portInput;
+    tgui::Button::Ptr m_addButton;
+    tgui::Button::Ptr m_removeButton;
+    tgui::Button::Ptr m_runAllButton;
+    tgui::Button::Ptr m_stopAllButton;
+    tgui::Button::Ptr m_clearStopButton;
+
+    std::shared_ptr<DeviceManager> m_deviceManager;
+    size_t m_primaryDeviceId = 0;
+
+    // Row i of the list shows device m_rowIds[i]
+    std::vector<size_t> m_rowIds;
+    // Sample counts at the previous refresh, for the per-device telemetry rate
+    std::map<size_t, uint64_t> m_lastSamples;
+    std::chrono::steady_clock::time_point m_lastRefresh;
+    int64_t m_lastPoolCpuUs = -1;
+
+    std::function<void(const std::string &)> m_statusCallback;
+    std::function<std::vector<std::string>()> m_commandsProvider;
+};
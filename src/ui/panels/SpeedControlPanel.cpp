@@ -1,6 +1,8 @@
 #include "SpeedControlPanel.h"
 #include "ui/ThemeManager.h"
 #include "utils/FileManager.h"
+#include "utils/ProfileParser.h"
+#include "utils/Trace.h"
 #include <iostream>
 #include <algorithm>
 #include <sstream>
@@ -101,9 +103,7 @@ void SpeedControlPanel::initialize(tgui::Gui &gui, std::shared_ptr<TreadmillCont
     // Add panel to GUI
     gui.add(m_panel);
 
-    // Register telemetry callback
-    m_treadmillController->setTelemetryCallback([this](const TelemetryData &data)
-                                                { updateTelemetryUI(data); });
+    // Telemetry reaches updateTelemetryUI through the app's UI subscription on the telemetry bus
 
     // File dialog will be created and added when needed
 }
@@ -196,6 +196,7 @@ void SpeedControlPanel::connectEvents()
             auto controller = m_treadmillController; // Keep controller alive
             
             std::thread([controller, commands]() {
+                Trace::setThreadName("Worker");
                 controller->runTreadmill(commands);
             }).detach();
             
@@ -243,9 +244,30 @@ void SpeedControlPanel::updateTelemetryUI(const TelemetryData &data)
        << "Time: " << (data.timestamp / 1000.0) << "s  |  "
        << "Drivers: " << (data.driver1Healthy ? "OK" : "ERR") << "/" << (data.driver2Healthy ? "OK" : "ERR");
 
+    if (m_derivedChannels && !m_derivedChannels->empty())
+    {
+        m_derivedChannels->evaluate(data, m_derivedState, m_derivedValues.data());
+        const std::vector<std::string> &names = m_derivedChannels->getNames();
+        ss << "\n" << std::setprecision(3);
+        for (size_t i = 0; i < names.size(); ++i)
+        {
+            ss << (i > 0 ? "  |  " : "") << names[i] << ": " << m_derivedValues[i];
+        }
+    }
+
     m_telemetryLabel->setText(ss.str());
 }
 
+void SpeedControlPanel::setDerivedChannels(std::shared_ptr<const DerivedChannels> channels)
+{
+    m_derivedChannels = std::move(channels);
+    if (m_derivedChannels)
+    {
+        m_derivedState = m_derivedChannels->makeState();
+        m_derivedValues.assign(m_derivedChannels->size(), 0.0);
+    }
+}
+
 void SpeedControlPanel::setUploadFileCallback(std::function<void(const std::string &, const std::string &)> callback)
 {
     m_uploadFileCallback = callback;
@@ -343,60 +365,17 @@ void SpeedControlPanel::openFileDialog(bool isLoadDialog)
 
 bool SpeedControlPanel::parseSpeedCommands()
 {
-    m_motorCommands.clear();
-
     // Get text from text area
     std::string commands = m_speedInput->getText().toStdString();
-    std::istringstream stream(commands);
-    std::string line;
-
-    // Regex to validate the speed commands format
-    std::regex commandRegex(R"(L:\s*(-?\d+(?:\.\d+)?)\s+R:\s*(-?\d+(?:\.\d+)?)\s+T:\s*(-?\d+(?:\.\d+)?))");
-    std::smatch matches;
-
-    int lineNumber = 0;
-    bool hasValidCommands = false;
+    m_motorCommands = ProfileParser::parseSpeedCommands(commands);
 
-    while (std::getline(stream, line))
+    for (size_t i = 0; i < m_motorCommands.size(); ++i)
     {
-        lineNumber++;
-
-        // Skip empty lines and lines with only whitespace
-        if (line.empty() || std::all_of(line.begin(), line.end(), ::isspace))
-        {
-            continue;
-        }
-
-        if (std::regex_search(line, matches, commandRegex))
-        {
-            try
-            {
-                // Validate the time value
-                double time = std::stod(matches[3].str());
-                if (time <= 0)
-                {
-                    std::cerr << "Warning: Line " << lineNumber << " has invalid time value (must be > 0): " << time << std::endl;
-                    continue;
-                }
-
-                m_motorCommands.push_back(line);
-                hasValidCommands = true;
-
-                std::cout << "Parsed command " << m_motorCommands.size() << ": " << line << std::endl;
-            }
-            catch (const std::exception &e)
-            {
-                std::cerr << "Error parsing line " << lineNumber << ": " << e.what() << std::endl;
-            }
-        }
-        else
-        {
-            std::cerr << "Warning: Line " << lineNumber << " doesn't match expected format, skipping: " << line << std::endl;
-        }
+        std::cout << "Parsed command " << (i + 1) << ": " << m_motorCommands[i] << std::endl;
     }
 
     std::cout << "Successfully parsed " << m_motorCommands.size() << " motor commands." << std::endl;
-    return hasValidCommands;
+    return !m_motorCommands.empty();
 }
 
 const std::vector<std::string> &SpeedControlPanel::getMotorCommands() const
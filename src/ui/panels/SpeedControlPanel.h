@@ -3,12 +3,12 @@
 #include <TGUI/TGUI.hpp>
 #include <TGUI/Backend/SFML-Graphics.hpp>
 #include <TGUI/Widgets/FileDialog.hpp>
+#include "utils/DerivedChannels.h"
 #include "utils/TreadmillController.h"
 #include <functional>
 #include <memory>
 #include <vector>
 #include <string>
-#include <regex>
 
 class SpeedControlPanel
 {
@@ -31,6 +31,8 @@ public:
     TreadmillController *getTreadmillController() const { return m_treadmillController.get(); }
 
     void updateTelemetryUI(const TelemetryData &data);
+    // Derived channels shown under the live telemetry (null for none)
+    void setDerivedChannels(std::shared_ptr<const DerivedChannels> channels);
 
 private:
     void setupStyling();
@@ -55,6 +57,9 @@ private:
 
     // Telemetry display
     tgui::Label::Ptr m_telemetryLabel;
+    std::shared_ptr<const DerivedChannels> m_derivedChannels;
+    DerivedChannels::State m_derivedState;
+    std::vector<double> m_derivedValues;
 
     tgui::FileDialog::Ptr m_fileDialog;
 
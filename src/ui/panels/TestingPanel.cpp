@@ -1,6 +1,12 @@
 #include "TestingPanel.h"
 #include "ui/ThemeManager.h"
+#include "utils/FileManager.h"
+#include "utils/Trace.h"
+#include <ctime>
+#include <filesystem>
+#include <iomanip>
 #include <iostream>
+#include <sstream>
 #include <thread>
 #include <vector>
 
@@ -27,18 +33,33 @@ void TestingPanel::initialize(tgui::Gui &gui, std::shared_ptr<TreadmillControlle
     m_debugLabel->setTextSize(TextSizes::LABEL_STANDARD);
     m_debugLabel->setPosition(Layout::MARGIN_SMALL, "8%");
 
+    // Diagnostics (firmware loop timing, link statistics)
+    m_statsText = tgui::TextArea::create();
+    m_statsText->setSize("92%", "40%");
+    m_statsText->setPosition(Layout::MARGIN_SMALL, "24%");
+    m_statsText->setTextSize(TextSizes::LABEL_SMALL);
+    m_statsText->setReadOnly(true);
+    m_controlStatsText = "Loop: no data";
+    m_statsText->setText(m_controlStatsText);
+
     // Debugging buttons
     m_debug1Button = tgui::Button::create("DEBUG 1");
-    m_debug1Button->setSize("28%", Layout::TESTING_BUTTON_HEIGHT);
-    m_debug1Button->setPosition(Layout::MARGIN_SMALL, "50%");
+    m_debug1Button->setSize("21%", Layout::TESTING_BUTTON_HEIGHT);
+    m_debug1Button->setPosition(Layout::MARGIN_SMALL, "68%");
+
+    // Tracing: toggle span recording, then dump it as Chrome/Perfetto JSON
+    m_traceButton = tgui::Button::create("TRACE: OFF");
+    m_traceButton->setSize("21%", Layout::TESTING_BUTTON_HEIGHT);
+    m_traceButton->setPosition("28%", "68%");
 
-    m_debug2Button = tgui::Button::create("DEBUG 2");
-    m_debug2Button->setSize("28%", Layout::TESTING_BUTTON_HEIGHT);
-    m_debug2Button->setPosition("36%", "50%");
+    m_saveTraceButton = tgui::Button::create("SAVE TRACE");
+    m_saveTraceButton->setSize("21%", Layout::TESTING_BUTTON_HEIGHT);
+    m_saveTraceButton->setPosition("52%", "68%");
 
-    m_debug3Button = tgui::Button::create("DEBUG 3");
-    m_debug3Button->setSize("28%", Layout::TESTING_BUTTON_HEIGHT);
-    m_debug3Button->setPosition("67%", "50%");
+    // Baud negotiation; per-rate goodput and error rate go to the status log
+    m_linkTestButton = tgui::Button::create("LINK TEST");
+    m_linkTestButton->setSize("21%", Layout::TESTING_BUTTON_HEIGHT);
+    m_linkTestButton->setPosition("76%", "68%");
 
     // Set up styling
     setupStyling();
@@ -46,9 +67,11 @@ void TestingPanel::initialize(tgui::Gui &gui, std::shared_ptr<TreadmillControlle
 
     // Add widgets to panel
     m_panel->add(m_debugLabel);
+    m_panel->add(m_statsText);
     m_panel->add(m_debug1Button);
-    m_panel->add(m_debug2Button);
-    m_panel->add(m_debug3Button);
+    m_panel->add(m_traceButton);
+    m_panel->add(m_saveTraceButton);
+    m_panel->add(m_linkTestButton);
 
     // Add panel to GUI
     gui.add(m_panel);
@@ -65,16 +88,28 @@ void TestingPanel::setupStyling()
     // Label styling
     m_debugLabel->getRenderer()->setTextColor(Colors::TextPrimary);
 
+    // Diagnostics styling
+    m_statsText->getRenderer()->setBackgroundColor(Colors::TextAreaBackground);
+    m_statsText->getRenderer()->setTextColor(Colors::TextPrimary);
+    m_statsText->getRenderer()->setBorderColor(Colors::TextAreaBorder);
+    m_statsText->getRenderer()->setBorders({Borders::ELEMENT_WIDTH});
+    m_statsText->getRenderer()->setRoundedBorderRadius(Borders::INPUT_RADIUS);
+    m_statsText->getRenderer()->setScrollbarWidth(Borders::SCROLLBAR_WIDTH);
+
     // Button styling
     ThemeManager::styleButton(m_debug1Button, Colors::ButtonDefault,
                               Colors::DefaultButtonHover, Colors::DefaultButtonDown,
                               Colors::DefaultButtonBorder);
 
-    ThemeManager::styleButton(m_debug2Button, Colors::ButtonDefault,
+    ThemeManager::styleButton(m_traceButton, Colors::ButtonDefault,
+                              Colors::DefaultButtonHover, Colors::DefaultButtonDown,
+                              Colors::DefaultButtonBorder);
+
+    ThemeManager::styleButton(m_saveTraceButton, Colors::ButtonDefault,
                               Colors::DefaultButtonHover, Colors::DefaultButtonDown,
                               Colors::DefaultButtonBorder);
 
-    ThemeManager::styleButton(m_debug3Button, Colors::ButtonDefault,
+    ThemeManager::styleButton(m_linkTestButton, Colors::ButtonDefault,
                               Colors::DefaultButtonHover, Colors::DefaultButtonDown,
                               Colors::DefaultButtonBorder);
 }
@@ -88,6 +123,7 @@ void TestingPanel::connectEvents()
         auto controller = m_treadmillController;
         
         std::thread([controller, commands]() {
+            Trace::setThreadName("Worker");
             controller->runTreadmill(commands);
         }).detach();
 
@@ -95,17 +131,37 @@ void TestingPanel::connectEvents()
             m_debug1ButtonCallback();
         } });
 
-    m_debug2Button->onPress([this]()
-                            {
-        if (m_debug2ButtonCallback) {
-            m_debug2ButtonCallback();
+    m_traceButton->onPress([this]()
+                           {
+        toggleTracing();
+
+        if (m_traceButtonCallback) {
+            m_traceButtonCallback();
         } });
 
-    m_debug3Button->onPress([this]()
-                            {
-        if (m_debug3ButtonCallback) {
-            m_debug3ButtonCallback();
+    m_saveTraceButton->onPress([this]()
+                               {
+        saveTrace();
+
+        if (m_saveTraceButtonCallback) {
+            m_saveTraceButtonCallback();
         } });
+
+    m_linkTestButton->onPress([this]()
+                              {
+        // Blocks for up to a few seconds per rate, so keep it off the UI thread
+        auto controller = m_treadmillController;
+        if (!controller || !controller->isConnected()) {
+            if (m_statusCallback) {
+                m_statusCallback("ERROR: Connect before running the link test");
+            }
+            return;
+        }
+
+        std::thread([controller]() {
+            Trace::setThreadName("Worker");
+            controller->negotiateBaudRate();
+        }).detach(); });
 }
 
 void TestingPanel::setDebug1Callback(std::function<void()> callback)
@@ -113,12 +169,213 @@ void TestingPanel::setDebug1Callback(std::function<void()> callback)
     m_debug1ButtonCallback = callback;
 }
 
-void TestingPanel::setDebug2Callback(std::function<void()> callback)
+void TestingPanel::setTraceCallback(std::function<void()> callback)
+{
+    m_traceButtonCallback = callback;
+}
+
+void TestingPanel::setSaveTraceCallback(std::function<void()> callback)
+{
+    m_saveTraceButtonCallback = callback;
+}
+
+void TestingPanel::setStatusCallback(std::function<void(const std::string &)> callback)
+{
+    m_statusCallback = callback;
+}
+
+void TestingPanel::toggleTracing()
 {
-    m_debug2ButtonCallback = callback;
+    bool enable = !Trace::isEnabled();
+    if (enable)
+    {
+        Trace::clear(); // Each capture starts empty
+    }
+    Trace::setEnabled(enable);
+    m_traceButton->setText(enable ? "TRACE: ON" : "TRACE: OFF");
+}
+
+void TestingPanel::saveTrace()
+{
+    std::time_t now = std::time(nullptr);
+    char stamp[32];
+    std::strftime(stamp, sizeof(stamp), "%Y%m%d_%H%M%S", std::localtime(&now));
+
+    std::string path = (std::filesystem::path(FileManager::getDownloadsPath()) /
+                        ("treadmill_trace_" + std::string(stamp) + ".json"))
+                           .string();
+
+    std::string message = Trace::dumpToFile(path)
+                              ? "Trace saved to " + path + " (open in ui.perfetto.dev or chrome://tracing)"
+                              : "ERROR: Could not save trace to " + path;
+    std::cout << message << std::endl;
+    if (m_statusCallback)
+    {
+        m_statusCallback(message);
+    }
+}
+
+void TestingPanel::updateControlStats(const ControlLoopStats &stats)
+{
+    if (!stats.valid)
+    {
+        return;
+    }
+
+    std::stringstream ss;
+    ss << "Loop: " << stats.ticks << " ticks, " << stats.overruns << " overruns, "
+       << stats.skippedTicks << " skipped\n"
+       << "us last/max  TICK " << stats.tick.lastUs << "/" << stats.tick.maxUs
+       << "  CTL " << stats.control.lastUs << "/" << stats.control.maxUs
+       << "  RX " << stats.serial.lastUs << "/" << stats.serial.maxUs
+       << "  TEL " << stats.telemetry.lastUs << "/" << stats.telemetry.maxUs << "\n"
+       << "TICK hist (<64us..>=4ms):";
+    for (uint16_t count : stats.tick.histogram)
+    {
+        ss << " " << count;
+    }
+
+    m_controlStatsText = ss.str();
+    refreshStatsText();
+}
+
+void TestingPanel::refreshLinkStats()
+{
+    constexpr auto refreshInterval = std::chrono::milliseconds(500);
+
+    auto now = std::chrono::steady_clock::now();
+    if (!m_treadmillController || now - m_lastLinkRefresh < refreshInterval)
+    {
+        return;
+    }
+    m_lastLinkRefresh = now;
+
+    LinkStatsSnapshot stats = m_treadmillController->getLinkStats();
+
+    std::stringstream ss;
+    ss << "Link: RX " << stats.bytesRx << " B / " << stats.linesRx << " lines"
+       << "  TX " << stats.bytesTx << " B / " << stats.linesTx << " lines\n"
+       << "timeouts " << stats.timeouts << "  parse errors " << stats.parseErrors
+       << "  purged " << stats.purgedLines;
+
+    bool header = false;
+    for (size_t i = 0; i < LINK_COMMAND_COUNT; ++i)
+    {
+        const LatencySummary &rtt = stats.roundTrip[i];
+        if (rtt.count == 0)
+        {
+            continue;
+        }
+        if (!header)
+        {
+            ss << "\nRound trip (us)  n / p50 / p90 / p99 / max";
+            header = true;
+        }
+        ss << "\n" << std::left << std::setw(11) << linkCommandName(static_cast<LinkCommand>(i)) << std::right
+           << rtt.count << " / " << rtt.p50Us << " / " << rtt.p90Us << " / " << rtt.p99Us << " / " << rtt.maxUs;
+    }
+
+    SequenceStats frames = m_treadmillController->getSequenceStats();
+    double expected = static_cast<double>(frames.received + frames.lost);
+    ss << "\nFrames: " << frames.received << " received, " << frames.lost << " lost";
+    if (expected > 0)
+    {
+        ss << " (" << std::fixed << std::setprecision(2) << 100.0 * frames.lost / expected << "%)";
+    }
+    ss << " in " << frames.gaps << " gaps, " << frames.duplicates << " dup, "
+       << frames.reordered << " late, " << frames.corrupted << " corrupt";
+
+    TelemetryLatencySnapshot latency = m_treadmillController->getTelemetryLatency();
+    ss << std::fixed << std::setprecision(1);
+
+    RunAnalyticsSnapshot run = m_treadmillController->getRunAnalytics();
+    if (run.samples > 0)
+    {
+        ss << "\nRun: RMS error L " << run.errorLeft.rms() << " / R " << run.errorRight.rms()
+           << " RPM, asymmetry RMS " << run.asymmetry.rms() << " RPM";
+        auto formatMs = [](double ms)
+        { return ms >= 0.0 ? std::to_string(static_cast<int>(ms + 0.5)) + " ms" : std::string("-"); };
+        for (size_t i = run.steps.size() > 3 ? run.steps.size() - 3 : 0; i < run.steps.size(); ++i)
+        {
+            const StepAnalytics &step = run.steps[i];
+            ss << "\n  step " << step.index + 1 << ": RMS " << step.left.error.rms() << " / " << step.right.error.rms()
+               << ", rise " << formatMs(step.left.riseMs) << " / " << formatMs(step.right.riseMs)
+               << ", settle " << formatMs(step.left.settleMs) << " / " << formatMs(step.right.settleMs);
+        }
+    }
+    if (latency.clock.synchronized)
+    {
+        ss << "\nClock: drift " << latency.clock.driftPpm << " ppm, fit +-" << latency.clock.residualUs / 1000.0
+           << " ms, min RTT " << latency.clock.minRttUs << " us";
+        if (latency.clock.resets > 0)
+        {
+            ss << ", " << latency.clock.resets << " device resets";
+        }
+    }
+    else
+    {
+        ss << "\nClock: not synchronized";
+    }
+
+    auto formatLatency = [&ss](const char *label, const LatencySummary &summary)
+    {
+        ss << "\n" << label;
+        if (summary.count == 0)
+        {
+            ss << "no data";
+            return;
+        }
+        ss << summary.p50Us / 1000.0 << " / " << summary.p90Us / 1000.0 << " / "
+           << summary.p99Us / 1000.0 << " / " << summary.maxUs / 1000.0;
+    };
+    ss << "\nLatency (ms)   p50 / p90 / p99 / max";
+    formatLatency("device->host  ", latency.deviceToHost);
+    formatLatency("host->screen  ", latency.hostToScreen);
+
+    SetpointStreamStats stream = m_treadmillController->getSetpointStreamStats();
+    if (stream.sent > 0)
+    {
+        formatLatency("setpoint->TEL ", stream.setpointToTelemetry);
+        ss << "\nSetpoints: " << stream.sent << " at " << stream.achievedRateHz << " / " << stream.rateHz
+           << " Hz, " << stream.missedDeadlines << " missed, tick late p99 " << stream.lateness.p99Us << " us";
+    }
+
+    if (const auto &monitor = m_treadmillController->getSafetyMonitor())
+    {
+        SafetyStats safety = monitor->getStats();
+        ss << "\nSafety: " << safety.stops << " stops, " << safety.alarms << " alarms, " << safety.markers
+           << " markers; eval p99 " << safety.evaluation.p99Us << " us";
+        if (safety.sampleToAction.count > 0)
+        {
+            ss << ", sample->action p99 " << safety.sampleToAction.p99Us << " us (" << safety.overBudget
+               << " over " << SafetyMonitor::ACTION_BUDGET_US << " us)";
+        }
+    }
+
+    for (const SubscriberStats &bus : m_treadmillController->getTelemetryBus()->getStats())
+    {
+        ss << "\nBus " << bus.name << ": " << bus.delivered << " delivered, " << bus.dropped << " dropped ("
+           << overflowPolicyName(bus.policy) << "), high water " << bus.highWater << " / " << bus.capacity;
+    }
+
+    std::string text = ss.str();
+    if (text != m_linkStatsText)
+    {
+        m_linkStatsText = text;
+        refreshStatsText();
+    }
 }
 
-void TestingPanel::setDebug3Callback(std::function<void()> callback)
+void TestingPanel::refreshStatsText()
 {
-    m_debug3ButtonCallback = callback;
+    std::string text = m_controlStatsText;
+    if (!m_linkStatsText.empty())
+    {
+        if (!text.empty())
+        {
+            text += "\n\n";
+        }
+        text += m_linkStatsText;
+    }
+    m_statsText->setText(text);
 }
@@ -2,8 +2,10 @@
 
 #include <TGUI/TGUI.hpp>
 #include <TGUI/Backend/SFML-Graphics.hpp>
+#include <chrono>
 #include <functional>
 #include <memory>
+#include <string>
 #include "utils/TreadmillController.h"
 
 class TestingPanel
@@ -15,25 +17,42 @@ public:
     void initialize(tgui::Gui &gui, std::shared_ptr<TreadmillController> treadmillController);
 
     void setDebug1Callback(std::function<void()> callback);
-    void setDebug2Callback(std::function<void()> callback);
-    void setDebug3Callback(std::function<void()> callback);
+    void setTraceCallback(std::function<void()> callback);
+    void setSaveTraceCallback(std::function<void()> callback);
+    void setStatusCallback(std::function<void(const std::string &)> callback);
 
     tgui::Label::Ptr getdebugLabel() const { return m_debugLabel; }
 
+    // Live diagnostics (call from the UI thread)
+    void updateControlStats(const ControlLoopStats &stats);
+    // Pulls link counters from the controller; throttled, so it can be called every frame
+    void refreshLinkStats();
+
 private:
     void setupStyling();
     void connectEvents();
+    void refreshStatsText();
+    void toggleTracing();
+    void saveTrace();
 
     tgui::Panel::Ptr m_panel;
     tgui::Label::Ptr m_debugLabel;
+    tgui::TextArea::Ptr m_statsText;
     tgui::Button::Ptr m_debug1Button;
-    tgui::Button::Ptr m_debug2Button;
-    tgui::Button::Ptr m_debug3Button;
+    tgui::Button::Ptr m_traceButton;
+    tgui::Button::Ptr m_saveTraceButton;
+    tgui::Button::Ptr m_linkTestButton;
 
     std::shared_ptr<TreadmillController> m_treadmillController;
 
+    // Diagnostics text sections
+    std::string m_controlStatsText;
+    std::string m_linkStatsText;
+    std::chrono::steady_clock::time_point m_lastLinkRefresh;
+
     // Callbacks
     std::function<void()> m_debug1ButtonCallback;
-    std::function<void()> m_debug2ButtonCallback;
-    std::function<void()> m_debug3ButtonCallback;
+    std::function<void()> m_traceButtonCallback;
+    std::function<void()> m_saveTraceButtonCallback;
+    std::function<void(const std::string &)> m_statusCallback;
 };
\ No newline at end of file
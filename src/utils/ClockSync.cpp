@@ -0,0 +1,193 @@
+#include "ClockSync.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+namespace
+{
+    constexpr int64_t WRAP_US = (int64_t{1} << 32) * 1000; // millis() wraps after ~49.7 days
+    constexpr int64_t RESET_THRESHOLD_US = 1000000;        // Prediction this far off means the device restarted
+    constexpr int64_t MIN_DRIFT_SPAN_US = 5000000;         // Fit drift only over at least 5 s of device time
+    constexpr double MAX_DRIFT = 500e-6;                   // Ceramic resonators are well inside +-0.5%
+}
+
+int64_t ClockSync::hostNowUs()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+void ClockSync::addExchange(int64_t hostSendUs, int64_t hostReceiveUs, uint32_t deviceMs)
+{
+    if (hostReceiveUs < hostSendUs)
+    {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    Exchange exchange;
+    exchange.deviceUs = unwrapLocked(deviceMs);
+    exchange.hostUs = hostSendUs + (hostReceiveUs - hostSendUs) / 2;
+    exchange.rttUs = hostReceiveUs - hostSendUs;
+
+    if (m_synchronized && std::llabs(predictLocked(exchange.deviceUs) - exchange.hostUs) > RESET_THRESHOLD_US)
+    {
+        clearLocked();
+        m_resets++;
+        exchange.deviceUs = deviceMs * int64_t{1000};
+    }
+
+    m_lastDeviceUs = exchange.deviceUs;
+    m_exchanges.push_back(exchange);
+    if (m_exchanges.size() > WINDOW_SIZE)
+    {
+        m_exchanges.pop_front();
+    }
+
+    refitLocked();
+}
+
+bool ClockSync::isSynchronized() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_synchronized;
+}
+
+int64_t ClockSync::toHostUs(uint32_t deviceMs) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return predictLocked(unwrapLocked(deviceMs));
+}
+
+ClockSyncState ClockSync::getState() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    ClockSyncState state;
+    state.synchronized = m_synchronized;
+    state.driftPpm = (m_slope - 1.0) * 1e6;
+    state.residualUs = m_residualUs;
+    state.minRttUs = m_minRttUs;
+    state.exchanges = m_exchanges.size();
+    state.resets = m_resets;
+    return state;
+}
+
+void ClockSync::reset()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    clearLocked();
+    m_resets = 0;
+}
+
+int64_t ClockSync::unwrapLocked(uint32_t deviceMs) const
+{
+    int64_t deviceUs = deviceMs * int64_t{1000};
+    if (m_lastDeviceUs < 0)
+    {
+        return deviceUs;
+    }
+
+    // Pick the wrap epoch that lands closest to the last exchange
+    int64_t epochBase = m_lastDeviceUs - (m_lastDeviceUs % WRAP_US);
+    int64_t candidate = epochBase + deviceUs;
+    if (candidate - m_lastDeviceUs > WRAP_US / 2)
+    {
+        candidate -= WRAP_US;
+    }
+    else if (m_lastDeviceUs - candidate > WRAP_US / 2)
+    {
+        candidate += WRAP_US;
+    }
+    return candidate;
+}
+
+int64_t ClockSync::predictLocked(int64_t deviceUs) const
+{
+    return static_cast<int64_t>(std::llround(m_hostRef + m_slope * static_cast<double>(deviceUs - m_deviceRef)));
+}
+
+void ClockSync::refitLocked()
+{
+    if (m_exchanges.empty())
+    {
+        m_synchronized = false;
+        return;
+    }
+
+    m_minRttUs = m_exchanges.front().rttUs;
+    for (const auto &exchange : m_exchanges)
+    {
+        m_minRttUs = std::min(m_minRttUs, exchange.rttUs);
+    }
+
+    // Queueing only ever adds delay, so the fastest round trips bound the offset best
+    int64_t trustedRttUs = m_minRttUs + m_minRttUs / 2 + 1000;
+
+    double sumDevice = 0.0, sumHost = 0.0;
+    size_t n = 0;
+    int64_t deviceRef = m_exchanges.back().deviceUs;
+    int64_t hostRef = m_exchanges.back().hostUs;
+    int64_t minDevice = deviceRef, maxDevice = deviceRef;
+
+    for (const auto &exchange : m_exchanges)
+    {
+        if (exchange.rttUs > trustedRttUs)
+            continue;
+        sumDevice += static_cast<double>(exchange.deviceUs - deviceRef);
+        sumHost += static_cast<double>(exchange.hostUs - hostRef);
+        minDevice = std::min(minDevice, exchange.deviceUs);
+        maxDevice = std::max(maxDevice, exchange.deviceUs);
+        n++;
+    }
+
+    double meanDevice = sumDevice / n;
+    double meanHost = sumHost / n;
+    double slope = 1.0;
+
+    if (n >= 3 && maxDevice - minDevice >= MIN_DRIFT_SPAN_US)
+    {
+        double sxx = 0.0, sxy = 0.0;
+        for (const auto &exchange : m_exchanges)
+        {
+            if (exchange.rttUs > trustedRttUs)
+                continue;
+            double dx = static_cast<double>(exchange.deviceUs - deviceRef) - meanDevice;
+            double dy = static_cast<double>(exchange.hostUs - hostRef) - meanHost;
+            sxx += dx * dx;
+            sxy += dx * dy;
+        }
+        if (sxx > 0.0)
+        {
+            slope = std::clamp(sxy / sxx, 1.0 - MAX_DRIFT, 1.0 + MAX_DRIFT);
+        }
+    }
+
+    // Anchor the fit at the centroid of the trusted exchanges
+    m_slope = slope;
+    m_deviceRef = deviceRef + static_cast<int64_t>(std::llround(meanDevice));
+    m_hostRef = static_cast<double>(hostRef) + meanHost;
+
+    double sumSquares = 0.0;
+    for (const auto &exchange : m_exchanges)
+    {
+        if (exchange.rttUs > trustedRttUs)
+            continue;
+        double error = static_cast<double>(exchange.hostUs - predictLocked(exchange.deviceUs));
+        sumSquares += error * error;
+    }
+    m_residualUs = std::sqrt(sumSquares / n);
+    m_synchronized = true;
+}
+
+void ClockSync::clearLocked()
+{
+    m_exchanges.clear();
+    m_lastDeviceUs = -1;
+    m_synchronized = false;
+    m_slope = 1.0;
+    m_residualUs = 0.0;
+    m_minRttUs = 0;
+}
@@ -0,0 +1,65 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+
+struct ClockSyncState
+{
+    bool synchronized = false;
+    double driftPpm = 0.0;    // Device clock rate error relative to the host
+    double residualUs = 0.0;  // RMS fit error of the trusted exchanges
+    int64_t minRttUs = 0;     // Best PING/PONG round trip in the window
+    size_t exchanges = 0;     // Exchanges currently in the window
+    uint32_t resets = 0;      // Device restarts detected
+};
+
+/**
+ * Maps firmware millis() timestamps onto the host steady_clock
+ * Fed with NTP-style PING/PONG exchanges: each reply is assumed to have been
+ * stamped halfway through its round trip. Only exchanges with a near-minimal
+ * round trip are trusted, and offset and drift are fitted to them by least squares.
+ */
+class ClockSync
+{
+public:
+    static constexpr size_t WINDOW_SIZE = 64;
+
+    // Host time base for everything that is compared against device time
+    static int64_t hostNowUs();
+
+    void addExchange(int64_t hostSendUs, int64_t hostReceiveUs, uint32_t deviceMs);
+    bool isSynchronized() const;
+
+    // Host steady_clock time (us) for a device millis() value; needs isSynchronized()
+    int64_t toHostUs(uint32_t deviceMs) const;
+
+    ClockSyncState getState() const;
+    void reset();
+
+private:
+    struct Exchange
+    {
+        int64_t deviceUs;
+        int64_t hostUs; // Midpoint of the round trip
+        int64_t rttUs;
+    };
+
+    int64_t unwrapLocked(uint32_t deviceMs) const;
+    int64_t predictLocked(int64_t deviceUs) const;
+    void refitLocked();
+    void clearLocked();
+
+    mutable std::mutex m_mutex;
+    std::deque<Exchange> m_exchanges;
+    int64_t m_lastDeviceUs = -1;
+
+    // hostUs = m_hostRef + m_slope * (deviceUs - m_deviceRef)
+    bool m_synchronized = false;
+    int64_t m_deviceRef = 0;
+    double m_hostRef = 0.0;
+    double m_slope = 1.0;
+    double m_residualUs = 0.0;
+    int64_t m_minRttUs = 0;
+    uint32_t m_resets = 0;
+};
@@ -0,0 +1,67 @@
+#include "Crc16.h"
+#include <array>
+
+namespace
+{
+    // Byte-at-a-time table; the firmware does the same thing bit by bit
+    constexpr std::array<uint16_t, 256> makeTable()
+    {
+        std::array<uint16_t, 256> table{};
+        for (uint32_t i = 0; i < 256; ++i)
+        {
+            uint16_t crc = static_cast<uint16_t>(i << 8);
+            for (int bit = 0; bit < 8; ++bit)
+            {
+                crc = (crc & 0x8000) ? static_cast<uint16_t>((crc << 1) ^ 0x1021) : static_cast<uint16_t>(crc << 1);
+            }
+            table[i] = crc;
+        }
+        return table;
+    }
+
+    constexpr std::array<uint16_t, 256> CRC_TABLE = makeTable();
+}
+
+uint16_t Crc16::compute(const void *data, size_t length, uint16_t crc)
+{
+    const auto *bytes = static_cast<const uint8_t *>(data);
+    for (size_t i = 0; i < length; ++i)
+    {
+        crc = static_cast<uint16_t>((crc << 8) ^ CRC_TABLE[((crc >> 8) ^ bytes[i]) & 0xFF]);
+    }
+    return crc;
+}
+
+void Crc16::toHex(uint16_t crc, char out[4])
+{
+    static const char HEX_DIGITS[] = "0123456789ABCDEF";
+    for (int i = 0; i < 4; ++i)
+    {
+        out[i] = HEX_DIGITS[(crc >> (12 - 4 * i)) & 0xF];
+    }
+}
+
+bool Crc16::fromHex(std::string_view text, uint16_t &crc)
+{
+    if (text.size() != 4)
+    {
+        return false;
+    }
+
+    uint16_t value = 0;
+    for (char c : text)
+    {
+        int digit;
+        if (c >= '0' && c <= '9')
+            digit = c - '0';
+        else if (c >= 'A' && c <= 'F')
+            digit = c - 'A' + 10;
+        else if (c >= 'a' && c <= 'f')
+            digit = c - 'a' + 10;
+        else
+            return false;
+        value = static_cast<uint16_t>((value << 4) | digit);
+    }
+    crc = value;
+    return true;
+}
@@ -0,0 +1,27 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+/**
+ * CRC-16/CCITT-FALSE (poly 0x1021, init 0xFFFF), as computed by the firmware
+ * Used to verify link test bursts and, later, profile transfers
+ */
+class Crc16
+{
+public:
+    static constexpr uint16_t INITIAL = 0xFFFF;
+
+    // Delete constructor to prevent instantiation
+    Crc16() = delete;
+
+    static uint16_t compute(const void *data, size_t length, uint16_t crc = INITIAL);
+    static uint16_t compute(std::string_view text, uint16_t crc = INITIAL)
+    {
+        return compute(text.data(), text.size(), crc);
+    }
+
+    // Four upper-case hex digits, the form used on the wire
+    static void toHex(uint16_t crc, char out[4]);
+    static bool fromHex(std::string_view text, uint16_t &crc);
+};
@@ -0,0 +1,786 @@
+#include "DerivedChannels.h"
+#include "TreadmillController.h"
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <sstream>
+
+namespace
+{
+    // Operand names match the TelemetryCsv columns
+    enum FieldId : uint16_t
+    {
+        Timestamp,
+        TargetL,
+        ActualL,
+        TargetR,
+        ActualR,
+        Driver1Health,
+        Driver2Health,
+        EStop,
+        Seq,
+        Gap,
+        FIELD_COUNT
+    };
+
+    const char *const FIELD_NAMES[FIELD_COUNT] = {"Timestamp", "TargetL", "ActualL", "TargetR", "ActualR",
+                                                  "Driver1Health", "Driver2Health", "EStop", "Seq", "Gap"};
+
+    double fieldValue(const TelemetryData &data, uint16_t field)
+    {
+        switch (field)
+        {
+        case Timestamp:
+            return data.timestamp;
+        case TargetL:
+            return data.targetRpm1;
+        case ActualL:
+            return data.actualRpm1;
+        case TargetR:
+            return data.targetRpm2;
+        case ActualR:
+            return data.actualRpm2;
+        case Driver1Health:
+            return data.driver1Healthy ? 1.0 : 0.0;
+        case Driver2Health:
+            return data.driver2Healthy ? 1.0 : 0.0;
+        case EStop:
+            return data.emergencyStop ? 1.0 : 0.0;
+        case Seq:
+            return data.sequence;
+        case Gap:
+            return data.gapBefore;
+        }
+        return 0.0;
+    }
+
+    // Column gather for a block; the switch is outside the loop so each loop is a plain strided copy
+    void loadField(const TelemetryData *block, size_t n, uint16_t field, double *out)
+    {
+        switch (field)
+        {
+        case TargetL:
+            for (size_t i = 0; i < n; ++i)
+                out[i] = block[i].targetRpm1;
+            break;
+        case ActualL:
+            for (size_t i = 0; i < n; ++i)
+                out[i] = block[i].actualRpm1;
+            break;
+        case TargetR:
+            for (size_t i = 0; i < n; ++i)
+                out[i] = block[i].targetRpm2;
+            break;
+        case ActualR:
+            for (size_t i = 0; i < n; ++i)
+                out[i] = block[i].actualRpm2;
+            break;
+        default:
+            for (size_t i = 0; i < n; ++i)
+                out[i] = fieldValue(block[i], field);
+            break;
+        }
+    }
+
+    // Seconds of device time since the previous sample; 0 marks "no rate" (first sample or clock reset)
+    double secondsSince(uint32_t timestamp, uint32_t previous, bool started)
+    {
+        return started ? static_cast<int32_t>(timestamp - previous) / 1000.0 : 0.0;
+    }
+
+    double rate(double value, double previous, double seconds)
+    {
+        return seconds > 0.0 ? (value - previous) / seconds : 0.0;
+    }
+
+    bool isIdentifierStart(char c)
+    {
+        return std::isalpha(static_cast<unsigned char>(c)) || c == '_';
+    }
+
+    bool isIdentifierChar(char c)
+    {
+        return std::isalnum(static_cast<unsigned char>(c)) || c == '_';
+    }
+}
+
+// Recursive descent straight to bytecode, folding operations on constants as it goes
+class DerivedChannels::Compiler
+{
+public:
+    Compiler(DerivedChannels &owner, const std::string &text)
+        : m_owner(owner), m_text(text), m_constants(owner.m_constants), m_stateSlots(owner.m_stateSlots)
+    {
+    }
+
+    bool compile(Program &program, std::string &error)
+    {
+        bool ok = parseExpression() && expectEnd();
+        if (!ok)
+        {
+            error = m_error;
+            return false;
+        }
+
+        // Deepest the stack gets
+        size_t depth = 0;
+        for (const Instruction &instruction : m_code)
+        {
+            switch (instruction.op)
+            {
+            case Op::Const:
+            case Op::Field:
+            case Op::Channel:
+                depth++;
+                break;
+            case Op::Add:
+            case Op::Sub:
+            case Op::Mul:
+            case Op::Div:
+            case Op::Min:
+            case Op::Max:
+                depth--;
+                break;
+            default:
+                break;
+            }
+            program.maxStack = std::max(program.maxStack, depth);
+        }
+        if (program.maxStack > MAX_STACK)
+        {
+            error = "expression nests too deeply";
+            return false;
+        }
+
+        program.code = std::move(m_code);
+        m_owner.m_constants = std::move(m_constants);
+        m_owner.m_stateSlots = m_stateSlots;
+        return true;
+    }
+
+private:
+    bool fail(const std::string &message)
+    {
+        if (m_error.empty())
+        {
+            m_error = message + " at column " + std::to_string(m_pos + 1);
+        }
+        return false;
+    }
+
+    void skipSpaces()
+    {
+        while (m_pos < m_text.size() && std::isspace(static_cast<unsigned char>(m_text[m_pos])))
+        {
+            m_pos++;
+        }
+    }
+
+    bool accept(char c)
+    {
+        skipSpaces();
+        if (m_pos < m_text.size() && m_text[m_pos] == c)
+        {
+            m_pos++;
+            return true;
+        }
+        return false;
+    }
+
+    bool expectEnd()
+    {
+        skipSpaces();
+        return m_pos == m_text.size() || fail("unexpected '" + std::string(1, m_text[m_pos]) + "'");
+    }
+
+    bool parseExpression()
+    {
+        if (!parseTerm())
+            return false;
+        while (true)
+        {
+            if (accept('+'))
+            {
+                if (!parseTerm())
+                    return false;
+                emitBinary(Op::Add);
+            }
+            else if (accept('-'))
+            {
+                if (!parseTerm())
+                    return false;
+                emitBinary(Op::Sub);
+            }
+            else
+            {
+                return true;
+            }
+        }
+    }
+
+    bool parseTerm()
+    {
+        if (!parseUnary())
+            return false;
+        while (true)
+        {
+            if (accept('*'))
+            {
+                if (!parseUnary())
+                    return false;
+                emitBinary(Op::Mul);
+            }
+            else if (accept('/'))
+            {
+                if (!parseUnary())
+                    return false;
+                emitBinary(Op::Div);
+            }
+            else
+            {
+                return true;
+            }
+        }
+    }
+
+    // Every nested parenthesis, sign or call argument comes back through here
+    bool parseUnary()
+    {
+        if (m_depth >= MAX_NESTING)
+        {
+            return fail("expression nests too deeply");
+        }
+        m_depth++;
+        bool ok = parseSigned();
+        m_depth--;
+        return ok;
+    }
+
+    bool parseSigned()
+    {
+        if (accept('-'))
+        {
+            if (!parseUnary())
+                return false;
+            emitUnary(Op::Neg);
+            return true;
+        }
+        accept('+');
+        return parsePrimary();
+    }
+
+    bool parsePrimary()
+    {
+        skipSpaces();
+        if (m_pos >= m_text.size())
+        {
+            return fail("expression ends early");
+        }
+
+        if (accept('('))
+        {
+            return parseExpression() && (accept(')') || fail("missing ')'"));
+        }
+
+        char c = m_text[m_pos];
+        if (std::isdigit(static_cast<unsigned char>(c)) || c == '.')
+        {
+            const char *start = m_text.c_str() + m_pos;
+            char *end = nullptr;
+            double value = std::strtod(start, &end);
+            if (end == start)
+            {
+                return fail("bad number");
+            }
+            m_pos += static_cast<size_t>(end - start);
+            emitConst(value);
+            return true;
+        }
+
+        if (!isIdentifierStart(c))
+        {
+            return fail("unexpected '" + std::string(1, c) + "'");
+        }
+        size_t start = m_pos;
+        while (m_pos < m_text.size() && isIdentifierChar(m_text[m_pos]))
+        {
+            m_pos++;
+        }
+        std::string name = m_text.substr(start, m_pos - start);
+
+        if (accept('('))
+        {
+            return parseCall(name);
+        }
+        if (name == "pi")
+        {
+            emitConst(3.14159265358979323846);
+            return true;
+        }
+        for (uint16_t field = 0; field < FIELD_COUNT; ++field)
+        {
+            if (name == FIELD_NAMES[field])
+            {
+                m_code.push_back({Op::Field, field});
+                return true;
+            }
+        }
+        const std::vector<std::string> &channels = m_owner.m_names;
+        auto it = std::find(channels.begin(), channels.end(), name);
+        if (it != channels.end())
+        {
+            m_code.push_back({Op::Channel, static_cast<uint16_t>(it - channels.begin())});
+            return true;
+        }
+        m_pos = start;
+        return fail("unknown name '" + name + "'");
+    }
+
+    bool parseCall(const std::string &name)
+    {
+        size_t arguments = 0;
+        if (!accept(')'))
+        {
+            do
+            {
+                if (!parseExpression())
+                    return false;
+                arguments++;
+            } while (accept(','));
+            if (!accept(')'))
+            {
+                return fail("missing ')'");
+            }
+        }
+
+        size_t expected = (name == "min" || name == "max") ? 2 : 1;
+        if (name != "abs" && name != "sqrt" && name != "min" && name != "max" && name != "d" && name != "prev")
+        {
+            return fail("unknown function '" + name + "'");
+        }
+        if (arguments != expected)
+        {
+            return fail(name + "() takes " + std::to_string(expected) + " argument" + (expected > 1 ? "s" : ""));
+        }
+
+        if (name == "abs")
+            emitUnary(Op::Abs);
+        else if (name == "sqrt")
+            emitUnary(Op::Sqrt);
+        else if (name == "min")
+            emitBinary(Op::Min);
+        else if (name == "max")
+            emitBinary(Op::Max);
+        else // d() and prev() depend on the previous sample, so they never fold
+            m_code.push_back({name == "d" ? Op::Deriv : Op::Prev, static_cast<uint16_t>(m_stateSlots++)});
+        return true;
+    }
+
+    void emitConst(double value)
+    {
+        m_code.push_back({Op::Const, static_cast<uint16_t>(m_constants.size())});
+        m_constants.push_back(value);
+    }
+
+    bool lastIsConst(size_t fromEnd) const
+    {
+        return m_code.size() >= fromEnd && m_code[m_code.size() - fromEnd].op == Op::Const;
+    }
+
+    void emitUnary(Op op)
+    {
+        if (lastIsConst(1))
+        {
+            double &value = m_constants[m_code.back().arg];
+            value = (op == Op::Neg) ? -value : (op == Op::Abs) ? std::fabs(value) : std::sqrt(value);
+            return;
+        }
+        m_code.push_back({op, 0});
+    }
+
+    void emitBinary(Op op)
+    {
+        if (lastIsConst(1) && lastIsConst(2))
+        {
+            double b = m_constants[m_code.back().arg];
+            m_code.pop_back();
+            double &a = m_constants[m_code.back().arg];
+            a = applyBinary(op, a, b);
+            m_constants.pop_back(); // b was the newest constant
+            return;
+        }
+        m_code.push_back({op, 0});
+    }
+
+public:
+    static double applyBinary(Op op, double a, double b)
+    {
+        switch (op)
+        {
+        case Op::Add:
+            return a + b;
+        case Op::Sub:
+            return a - b;
+        case Op::Mul:
+            return a * b;
+        case Op::Div:
+            return a / b;
+        case Op::Min:
+            return std::min(a, b);
+        case Op::Max:
+            return std::max(a, b);
+        default:
+            return 0.0;
+        }
+    }
+
+private:
+    DerivedChannels &m_owner;
+    const std::string &m_text;
+    size_t m_pos = 0;
+    size_t m_depth = 0;
+    std::string m_error;
+    std::vector<Instruction> m_code;
+    std::vector<double> m_constants; // Working copy; committed only if the channel compiles
+    size_t m_stateSlots;
+};
+
+bool DerivedChannels::parse(const std::string &definitions, std::string &error)
+{
+    DerivedChannels parsed;
+    std::istringstream stream(definitions);
+    std::string line;
+    int lineNumber = 0;
+
+    while (std::getline(stream, line))
+    {
+        lineNumber++;
+        line = line.substr(0, line.find('#'));
+        if (std::all_of(line.begin(), line.end(), [](char c)
+                        { return std::isspace(static_cast<unsigned char>(c)); }))
+        {
+            continue;
+        }
+
+        size_t equals = line.find('=');
+        std::string name = (equals == std::string::npos) ? "" : line.substr(0, equals);
+        name.erase(0, name.find_first_not_of(" \t"));
+        name.erase(name.find_last_not_of(" \t\r") + 1);
+
+        std::string reason;
+        if (equals == std::string::npos)
+        {
+            reason = "expected \"Name = expression\"";
+        }
+        else if (!parsed.add(name, line.substr(equals + 1), reason))
+        {
+            // add() filled in the reason
+        }
+        else
+        {
+            continue;
+        }
+        error = "line " + std::to_string(lineNumber) + ": " + reason;
+        return false;
+    }
+
+    *this = std::move(parsed);
+    return true;
+}
+
+bool DerivedChannels::add(const std::string &name, const std::string &expression, std::string &error)
+{
+    bool validName = !name.empty() && isIdentifierStart(name[0]) &&
+                     std::all_of(name.begin(), name.end(), isIdentifierChar);
+    if (!validName)
+    {
+        error = "'" + name + "' is not a valid channel name";
+        return false;
+    }
+    bool taken = (name == "pi" || name == "abs" || name == "sqrt" || name == "min" || name == "max" ||
+                  name == "d" || name == "prev" ||
+                  std::find(m_names.begin(), m_names.end(), name) != m_names.end() ||
+                  std::find(std::begin(FIELD_NAMES), std::end(FIELD_NAMES), name) != std::end(FIELD_NAMES));
+    if (taken)
+    {
+        error = "'" + name + "' is already defined";
+        return false;
+    }
+
+    Program program;
+    std::string reason;
+    Compiler compiler(*this, expression);
+    if (!compiler.compile(program, reason))
+    {
+        error = name + ": " + reason;
+        return false;
+    }
+
+    m_names.push_back(name);
+    m_channels.push_back(std::move(program));
+    return true;
+}
+
+void DerivedChannels::clear()
+{
+    m_names.clear();
+    m_channels.clear();
+    m_constants.clear();
+    m_stateSlots = 0;
+}
+
+const char *DerivedChannels::opName(Op op)
+{
+    switch (op)
+    {
+    case Op::Const:
+        return "const";
+    case Op::Field:
+        return "field";
+    case Op::Channel:
+        return "channel";
+    case Op::Add:
+        return "add";
+    case Op::Sub:
+        return "sub";
+    case Op::Mul:
+        return "mul";
+    case Op::Div:
+        return "div";
+    case Op::Neg:
+        return "neg";
+    case Op::Abs:
+        return "abs";
+    case Op::Sqrt:
+        return "sqrt";
+    case Op::Min:
+        return "min";
+    case Op::Max:
+        return "max";
+    case Op::Deriv:
+        return "d";
+    case Op::Prev:
+        return "prev";
+    }
+    return "?";
+}
+
+std::string DerivedChannels::disassemble(size_t channel) const
+{
+    std::ostringstream out;
+    for (const Instruction &instruction : m_channels.at(channel).code)
+    {
+        out << opName(instruction.op);
+        switch (instruction.op)
+        {
+        case Op::Const:
+            out << " " << m_constants[instruction.arg];
+            break;
+        case Op::Field:
+            out << " " << FIELD_NAMES[instruction.arg];
+            break;
+        case Op::Channel:
+            out << " " << m_names[instruction.arg];
+            break;
+        case Op::Deriv:
+        case Op::Prev:
+            out << " #" << instruction.arg;
+            break;
+        default:
+            break;
+        }
+        out << "; ";
+    }
+    return out.str();
+}
+
+DerivedChannels::State DerivedChannels::makeState() const
+{
+    State state;
+    state.previous.assign(m_stateSlots, 0.0);
+    return state;
+}
+
+void DerivedChannels::evaluate(const TelemetryData &data, State &state, double *out) const
+{
+    state.previous.resize(m_stateSlots, 0.0);
+    double seconds = secondsSince(data.timestamp, state.previousTimestamp, state.started);
+
+    for (size_t channel = 0; channel < m_channels.size(); ++channel)
+    {
+        double stack[MAX_STACK];
+        size_t top = 0;
+        for (const Instruction &instruction : m_channels[channel].code)
+        {
+            switch (instruction.op)
+            {
+            case Op::Const:
+                stack[top++] = m_constants[instruction.arg];
+                break;
+            case Op::Field:
+                stack[top++] = fieldValue(data, instruction.arg);
+                break;
+            case Op::Channel:
+                stack[top++] = out[instruction.arg];
+                break;
+            case Op::Add:
+            case Op::Sub:
+            case Op::Mul:
+            case Op::Div:
+            case Op::Min:
+            case Op::Max:
+                top--;
+                stack[top - 1] = Compiler::applyBinary(instruction.op, stack[top - 1], stack[top]);
+                break;
+            case Op::Neg:
+                stack[top - 1] = -stack[top - 1];
+                break;
+            case Op::Abs:
+                stack[top - 1] = std::fabs(stack[top - 1]);
+                break;
+            case Op::Sqrt:
+                stack[top - 1] = std::sqrt(stack[top - 1]);
+                break;
+            case Op::Deriv:
+            case Op::Prev:
+            {
+                double value = stack[top - 1];
+                double previous = state.started ? state.previous[instruction.arg] : value;
+                stack[top - 1] = (instruction.op == Op::Deriv) ? rate(value, previous, seconds) : previous;
+                state.previous[instruction.arg] = value;
+                break;
+            }
+            }
+        }
+        out[channel] = stack[0];
+    }
+
+    state.previousTimestamp = data.timestamp;
+    state.started = true;
+}
+
+void DerivedChannels::evaluateBatch(const TelemetryData *data, size_t count, State &state,
+                                    std::vector<std::vector<double>> &out) const
+{
+    out.resize(m_channels.size());
+    for (auto &column : out)
+    {
+        column.resize(count);
+    }
+    state.previous.resize(m_stateSlots, 0.0);
+
+    // Registers: one block-wide column per stack level
+    std::vector<double> stack(MAX_STACK * BATCH_BLOCK);
+    double seconds[BATCH_BLOCK];
+    bool started[BATCH_BLOCK];
+
+    for (size_t begin = 0; begin < count; begin += BATCH_BLOCK)
+    {
+        const size_t n = std::min(BATCH_BLOCK, count - begin);
+        const TelemetryData *block = data + begin;
+
+        for (size_t i = 0; i < n; ++i)
+        {
+            uint32_t previous = (i == 0) ? state.previousTimestamp : block[i - 1].timestamp;
+            started[i] = (i > 0) || state.started;
+            seconds[i] = secondsSince(block[i].timestamp, previous, started[i]);
+        }
+
+        for (size_t channel = 0; channel < m_channels.size(); ++channel)
+        {
+            size_t top = 0;
+            for (const Instruction &instruction : m_channels[channel].code)
+            {
+                double *a = &stack[(top > 0 ? top - 1 : 0) * BATCH_BLOCK];
+                double *b = &stack[top * BATCH_BLOCK];
+                switch (instruction.op)
+                {
+                case Op::Const:
+                    std::fill(b, b + n, m_constants[instruction.arg]);
+                    top++;
+                    break;
+                case Op::Field:
+                    loadField(block, n, instruction.arg, b);
+                    top++;
+                    break;
+                case Op::Channel:
+                    std::copy(&out[instruction.arg][begin], &out[instruction.arg][begin] + n, b);
+                    top++;
+                    break;
+
+                // Binary ops: b points one past the top, so the operands are a[-BLOCK..] and a
+                case Op::Add:
+                case Op::Sub:
+                case Op::Mul:
+                case Op::Div:
+                case Op::Min:
+                case Op::Max:
+                {
+                    double *lhs = a - BATCH_BLOCK;
+                    const double *rhs = a;
+                    switch (instruction.op)
+                    {
+                    case Op::Add:
+                        for (size_t i = 0; i < n; ++i)
+                            lhs[i] = lhs[i] + rhs[i];
+                        break;
+                    case Op::Sub:
+                        for (size_t i = 0; i < n; ++i)
+                            lhs[i] = lhs[i] - rhs[i];
+                        break;
+                    case Op::Mul:
+                        for (size_t i = 0; i < n; ++i)
+                            lhs[i] = lhs[i] * rhs[i];
+                        break;
+                    case Op::Div:
+                        for (size_t i = 0; i < n; ++i)
+                            lhs[i] = lhs[i] / rhs[i];
+                        break;
+                    case Op::Min:
+                        for (size_t i = 0; i < n; ++i)
+                            lhs[i] = std::min(lhs[i], rhs[i]);
+                        break;
+                    default:
+                        for (size_t i = 0; i < n; ++i)
+                            lhs[i] = std::max(lhs[i], rhs[i]);
+                        break;
+                    }
+                    top--;
+                    break;
+                }
+                case Op::Neg:
+                    for (size_t i = 0; i < n; ++i)
+                        a[i] = -a[i];
+                    break;
+                case Op::Abs:
+                    for (size_t i = 0; i < n; ++i)
+                        a[i] = std::fabs(a[i]);
+                    break;
+                case Op::Sqrt:
+                    for (size_t i = 0; i < n; ++i)
+                        a[i] = std::sqrt(a[i]);
+                    break;
+                case Op::Deriv:
+                case Op::Prev:
+                {
+                    // Each sample's "previous" is its neighbour in the block, or the carried state for the first
+                    double carried = state.previous[instruction.arg];
+                    double last = a[n - 1];
+                    for (size_t i = n; i-- > 0;)
+                    {
+                        double previous = (i > 0) ? a[i - 1] : (started[0] ? carried : a[0]);
+                        a[i] = (instruction.op == Op::Deriv) ? rate(a[i], previous, seconds[i]) : previous;
+                    }
+                    state.previous[instruction.arg] = last;
+                    break;
+                }
+                }
+            }
+            std::copy(stack.begin(), stack.begin() + static_cast<std::ptrdiff_t>(n), out[channel].begin() + static_cast<std::ptrdiff_t>(begin));
+        }
+
+        state.previousTimestamp = block[n - 1].timestamp;
+        state.started = true;
+    }
+}
@@ -0,0 +1,100 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+struct TelemetryData;
+
+/**
+ * Derived telemetry channels from small arithmetic expressions
+ * One "Name = expression" definition per line, e.g.
+ *     SpeedL = ActualL * 0.00524        # m/s for a 5 cm roller
+ *     AccelL = d(SpeedL)                # m/s^2
+ *     TrackErrPct = 100 * (ActualL - TargetL) / max(abs(TargetL), 1)
+ * Operands are the recorded columns (Timestamp, TargetL, ActualL, TargetR,
+ * ActualR, Driver1Health, Driver2Health, EStop, Seq, Gap), numbers, pi and
+ * channels defined above. Operators + - * / and parentheses; functions
+ * abs, sqrt, min, max, d (rate of change per second of device time) and
+ * prev (value at the previous sample).
+ *
+ * Each channel compiles once to stack bytecode with constants folded.
+ * evaluate() runs it per sample in the live path; evaluateBatch() runs each
+ * instruction over a block of samples at a time for recorded sessions and
+ * gives bit-identical results.
+ */
+class DerivedChannels
+{
+public:
+    static constexpr size_t MAX_STACK = 16;
+    static constexpr size_t MAX_NESTING = 64; // Parentheses, unary signs and call arguments; bounds the parser's recursion
+    static constexpr size_t BATCH_BLOCK = 256;
+
+    // Carried from sample to sample by d() and prev(); one per stream of samples (e.g. per device)
+    struct State
+    {
+        std::vector<double> previous; // Per d()/prev() call site
+        uint32_t previousTimestamp = 0;
+        bool started = false;
+    };
+
+    // Replaces every channel; false (with the line and reason in `error`) leaves them unchanged
+    bool parse(const std::string &definitions, std::string &error);
+    // Appends one channel; false if the expression does not compile
+    bool add(const std::string &name, const std::string &expression, std::string &error);
+    void clear();
+
+    bool empty() const { return m_channels.empty(); }
+    size_t size() const { return m_channels.size(); }
+    const std::vector<std::string> &getNames() const { return m_names; }
+    // Bytecode listing, for checking what an expression compiled to
+    std::string disassemble(size_t channel) const;
+
+    State makeState() const;
+    // Live path: every channel for one sample into out[0..size())
+    void evaluate(const TelemetryData &data, State &state, double *out) const;
+    // Recorded sessions: out[channel][sample]; samples must be in time order for one device
+    void evaluateBatch(const TelemetryData *data, size_t count, State &state,
+                       std::vector<std::vector<double>> &out) const;
+
+private:
+    enum class Op : uint8_t
+    {
+        Const,   // arg: constant index
+        Field,   // arg: FieldId
+        Channel, // arg: earlier channel
+        Add,
+        Sub,
+        Mul,
+        Div,
+        Neg,
+        Abs,
+        Sqrt,
+        Min,
+        Max,
+        Deriv,   // arg: state slot
+        Prev     // arg: state slot
+    };
+
+    struct Instruction
+    {
+        Op op;
+        uint16_t arg = 0;
+    };
+
+    struct Program
+    {
+        std::vector<Instruction> code;
+        size_t maxStack = 0;
+    };
+
+    class Compiler;
+    friend class Compiler;
+
+    static const char *opName(Op op);
+
+    std::vector<std::string> m_names;
+    std::vector<Program> m_channels;
+    std::vector<double> m_constants;
+    size_t m_stateSlots = 0;
+};
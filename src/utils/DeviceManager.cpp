@@ -0,0 +1,336 @@
+#include "DeviceManager.h"
+#include "TelemetryCsv.h"
+#include "Trace.h"
+#include <thread>
+
+DeviceManager::DeviceManager(size_t ioThreads)
+    : m_ioPool(std::make_shared<IoThreadPool>(ioThreads)), m_telemetryBus(std::make_shared<TelemetryBus>()),
+      m_safetyMonitor(std::make_shared<SafetyMonitor>())
+{
+    // Per-device counters only need the latest frames
+    m_trackerSubscription = m_telemetryBus->subscribe("devices", {1024, OverflowPolicy::DropOldest, {}, {}},
+                                                      [this](const TelemetryBus::Ptr &sample)
+                                                      { trackSample(*sample); });
+
+    // Publishers are the shared I/O threads, which must never wait on the recorder. The queue
+    // holds over a minute of 1 kHz telemetry; anything beyond that is counted as lost.
+    m_recorderSubscription = m_telemetryBus->subscribe("recorder", {RECORDER_QUEUE_CAPACITY, OverflowPolicy::DropNewest, {}, {}},
+                                                       [this](const TelemetryBus::Ptr &sample)
+                                                       { recordSample(sample); });
+}
+
+DeviceManager::~DeviceManager()
+{
+    std::map<size_t, Device> devices;
+    {
+        std::lock_guard<std::mutex> lock(m_devicesMutex);
+        devices.swap(m_devices);
+    }
+
+    // Controllers must be done with the pool before it stops
+    for (auto &entry : devices)
+    {
+        entry.second.controller->disconnect();
+    }
+
+    m_recorderSubscription.reset();
+    m_trackerSubscription.reset();
+    stopJournal(); // Everything recorded has been journaled by now
+}
+
+size_t DeviceManager::addDevice()
+{
+    auto controller = std::make_shared<TreadmillController>(m_ioPool);
+
+    size_t id;
+    {
+        std::lock_guard<std::mutex> lock(m_devicesMutex);
+        id = m_nextId++;
+        m_devices[id].controller = controller;
+    }
+
+    controller->setTelemetryBus(m_telemetryBus, id);
+    controller->setSafetyMonitor(m_safetyMonitor);
+    if (m_statusCallback)
+    {
+        StatusCallback callback = m_statusCallback;
+        controller->setStatusCallback([callback, id](const std::string &message)
+                                      { callback(id, message); });
+    }
+    return id;
+}
+
+void DeviceManager::removeDevice(size_t id)
+{
+    std::shared_ptr<TreadmillController> controller;
+    {
+        std::lock_guard<std::mutex> lock(m_devicesMutex);
+        auto it = m_devices.find(id);
+        if (it == m_devices.end())
+        {
+            return;
+        }
+        controller = it->second.controller;
+        m_devices.erase(it);
+    }
+
+    if (controller->isConnected() && (controller->isRunActive() || controller->isStreaming()))
+    {
+        controller->stopSetpointStream();
+        controller->stopTreadmill();
+    }
+    controller->disconnect();
+}
+
+std::shared_ptr<TreadmillController> DeviceManager::getController(size_t id) const
+{
+    std::lock_guard<std::mutex> lock(m_devicesMutex);
+    auto it = m_devices.find(id);
+    return it != m_devices.end() ? it->second.controller : nullptr;
+}
+
+std::vector<size_t> DeviceManager::getDeviceIds() const
+{
+    std::lock_guard<std::mutex> lock(m_devicesMutex);
+    std::vector<size_t> ids;
+    ids.reserve(m_devices.size());
+    for (const auto &entry : m_devices)
+    {
+        ids.push_back(entry.first);
+    }
+    return ids;
+}
+
+size_t DeviceManager::getDeviceCount() const
+{
+    std::lock_guard<std::mutex> lock(m_devicesMutex);
+    return m_devices.size();
+}
+
+std::vector<DeviceStatus> DeviceManager::getDeviceStatus() const
+{
+    std::vector<DeviceStatus> rows;
+    std::vector<std::shared_ptr<TreadmillController>> controllers;
+    {
+        std::lock_guard<std::mutex> lock(m_devicesMutex);
+        for (const auto &entry : m_devices)
+        {
+            DeviceStatus row;
+            row.id = entry.first;
+            row.samples = entry.second.samples;
+            row.last = entry.second.last;
+            rows.push_back(row);
+            controllers.push_back(entry.second.controller);
+        }
+    }
+
+    // Controller queries take their own locks; keep them outside the devices lock
+    for (size_t i = 0; i < rows.size(); ++i)
+    {
+        const auto &controller = controllers[i];
+        rows[i].connected = controller->isConnected();
+        rows[i].running = controller->isRunActive() || controller->isStreaming();
+        rows[i].safetyStopped = controller->isSafetyStopped();
+        if (rows[i].connected)
+        {
+            rows[i].portName = controller->getSerialComm()->getPortName();
+        }
+        rows[i].deviceToHost = controller->getTelemetryLatency().deviceToHost;
+    }
+    return rows;
+}
+
+size_t DeviceManager::runAll(const std::vector<std::string> &speedCommands)
+{
+    std::vector<std::shared_ptr<TreadmillController>> idle;
+    {
+        std::lock_guard<std::mutex> lock(m_devicesMutex);
+        for (const auto &entry : m_devices)
+        {
+            const auto &controller = entry.second.controller;
+            if (controller->isConnected() && !controller->isRunActive() && !controller->isStreaming())
+            {
+                idle.push_back(controller);
+            }
+        }
+    }
+
+    // Uploads are request/reply bound, so the devices are started side by side
+    std::vector<char> started(idle.size(), 0);
+    std::vector<std::thread> workers;
+    workers.reserve(idle.size());
+    for (size_t i = 0; i < idle.size(); ++i)
+    {
+        workers.emplace_back([&, i]()
+                             {
+            Trace::setThreadName("Worker");
+            started[i] = idle[i]->runTreadmill(speedCommands) ? 1 : 0; });
+    }
+
+    size_t count = 0;
+    for (size_t i = 0; i < workers.size(); ++i)
+    {
+        workers[i].join();
+        count += started[i];
+    }
+    return count;
+}
+
+void DeviceManager::stopAll()
+{
+    for (size_t id : getDeviceIds())
+    {
+        auto controller = getController(id);
+        if (controller && controller->isConnected())
+        {
+            controller->stopSetpointStream();
+            controller->stopTreadmill();
+        }
+    }
+}
+
+size_t DeviceManager::clearSafetyStops()
+{
+    size_t count = 0;
+    for (size_t id : getDeviceIds())
+    {
+        auto controller = getController(id);
+        if (controller && controller->clearSafetyStop())
+        {
+            count++;
+        }
+    }
+    return count;
+}
+
+void DeviceManager::clearRecording()
+{
+    std::lock_guard<std::mutex> lock(m_recordMutex);
+    m_history.clear();
+    if (m_journal.isOpen())
+    {
+        m_journal.open(SessionJournal::makePath(m_journalDirectory));
+    }
+}
+
+size_t DeviceManager::getRecordedCount() const
+{
+    std::lock_guard<std::mutex> lock(m_recordMutex);
+    return m_history.size();
+}
+
+void DeviceManager::setHistoryBudget(size_t bytes)
+{
+    std::lock_guard<std::mutex> lock(m_recordMutex);
+    m_history.setBudget(bytes);
+}
+
+TelemetryHistoryStats DeviceManager::getHistoryStats() const
+{
+    std::lock_guard<std::mutex> lock(m_recordMutex);
+    return m_history.getStats();
+}
+
+uint64_t DeviceManager::getRecordingDropped() const
+{
+    return m_recorderSubscription.getStats().dropped;
+}
+
+bool DeviceManager::startJournal(const std::string &directory)
+{
+    std::lock_guard<std::mutex> lock(m_recordMutex);
+    m_journalDirectory = directory;
+    return m_journal.open(SessionJournal::makePath(directory));
+}
+
+void DeviceManager::stopJournal()
+{
+    std::lock_guard<std::mutex> lock(m_recordMutex);
+    m_journal.close();
+}
+
+JournalStats DeviceManager::getJournalStats() const
+{
+    return m_journal.getStats();
+}
+
+TelemetryHistorySnapshot DeviceManager::snapshotRecording() const
+{
+    std::lock_guard<std::mutex> lock(m_recordMutex);
+    return m_history.snapshot();
+}
+
+bool DeviceManager::writeCsv(std::ostream &out) const
+{
+    // Recording is not held up while the file is written
+    std::shared_ptr<const DerivedChannels> channels = getDerivedChannels();
+    return TelemetryCsv::writeRecording(out, snapshotRecording(), channels.get());
+}
+
+void DeviceManager::setDerivedChannels(std::shared_ptr<const DerivedChannels> channels)
+{
+    std::lock_guard<std::mutex> lock(m_channelsMutex);
+    m_derivedChannels = std::move(channels);
+}
+
+std::shared_ptr<const DerivedChannels> DeviceManager::getDerivedChannels() const
+{
+    std::lock_guard<std::mutex> lock(m_channelsMutex);
+    return m_derivedChannels;
+}
+
+void DeviceManager::writeAnalyticsCsv(std::ostream &out) const
+{
+    std::vector<std::pair<size_t, RunAnalyticsSnapshot>> runs;
+    {
+        std::lock_guard<std::mutex> lock(m_devicesMutex);
+        for (const auto &entry : m_devices)
+        {
+            RunAnalyticsSnapshot snapshot = entry.second.controller->getRunAnalytics();
+            if (snapshot.samples > 0)
+            {
+                runs.emplace_back(entry.first, std::move(snapshot));
+            }
+        }
+    }
+
+    bool multiDevice = runs.size() > 1;
+    RunAnalytics::writeCsvHeader(out, multiDevice);
+    for (const auto &run : runs)
+    {
+        if (multiDevice)
+        {
+            RunAnalytics::writeCsvRows(out, run.first, run.second);
+        }
+        else
+        {
+            RunAnalytics::writeCsvRows(out, run.second);
+        }
+    }
+}
+
+// Bus delivery thread
+void DeviceManager::trackSample(const TelemetrySample &sample)
+{
+    std::lock_guard<std::mutex> lock(m_devicesMutex);
+    auto it = m_devices.find(sample.deviceId);
+    if (it != m_devices.end())
+    {
+        it->second.samples++;
+        it->second.last = sample.data;
+    }
+}
+
+// Bus delivery thread
+void DeviceManager::recordSample(const TelemetryBus::Ptr &sample)
+{
+    if (m_recording)
+    {
+        std::lock_guard<std::mutex> lock(m_recordMutex);
+        m_history.append(*sample);
+        if (m_journal.isOpen())
+        {
+            m_journal.append(*sample);
+        }
+    }
+}
@@ -0,0 +1,137 @@
+#pragma once
+#include "DerivedChannels.h"
+#include "IoThreadPool.h"
+#include "SessionJournal.h"
+#include "TelemetryHistory.h"
+#include "TreadmillController.h"
+#include <cstddef>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// One row of the devices overview
+struct DeviceStatus
+{
+    size_t id = 0;
+    std::string portName;
+    bool connected = false;
+    bool running = false;            // Profile run or setpoint stream in progress
+    bool safetyStopped = false;      // Latched until clearSafetyStops()
+    uint64_t samples = 0;            // TEL frames received since the device was added
+    TelemetryData last{};            // Most recent frame (valid when samples > 0)
+    LatencySummary deviceToHost;     // Of the current run
+};
+
+/**
+ * Several treadmills driven from one host
+ * Every controller's serial I/O runs on one shared IoThreadPool, so adding a
+ * device adds a strand, not threads. All devices publish to one telemetry bus,
+ * tagged with the device id; the manager subscribes to it to track each device
+ * and to record every sample losslessly into a TelemetryHistory, which keeps
+ * RAM within a budget by spilling older chunks to disk, and optionally into a
+ * crash-safe SessionJournal. One safety monitor watches them all.
+ */
+class DeviceManager
+{
+public:
+    static constexpr size_t RECORDER_QUEUE_CAPACITY = 65536;
+
+    using StatusCallback = std::function<void(size_t deviceId, const std::string &)>;
+
+    explicit DeviceManager(size_t ioThreads = IoThreadPool::defaultThreadCount());
+    ~DeviceManager();
+
+    DeviceManager(const DeviceManager &) = delete;
+    DeviceManager &operator=(const DeviceManager &) = delete;
+
+    // New, unconnected controller on the shared pool; ids are never reused
+    size_t addDevice();
+    // Stops and disconnects the device before dropping it
+    void removeDevice(size_t id);
+    std::shared_ptr<TreadmillController> getController(size_t id) const;
+    std::vector<size_t> getDeviceIds() const;
+    size_t getDeviceCount() const;
+    std::vector<DeviceStatus> getDeviceStatus() const;
+
+    // Run the same profile on every connected, idle device; returns how many started
+    size_t runAll(const std::vector<std::string> &speedCommands);
+    void stopAll();
+    // Operator acknowledgement of every latched safety stop; returns how many were cleared
+    size_t clearSafetyStops();
+
+    // Shared by every device; subscribe for telemetry from all of them (filter on deviceId)
+    TelemetryBus &getTelemetryBus() { return *m_telemetryBus; }
+    // Shared by every device; events carry the device id
+    SafetyMonitor &getSafetyMonitor() { return *m_safetyMonitor; }
+    // Applied to devices added afterwards; a controller's own status callback may override it
+    void setStatusCallback(StatusCallback callback) { m_statusCallback = std::move(callback); }
+
+    // Aggregated recording of every device's telemetry, in arrival order
+    void setRecording(bool enabled) { m_recording = enabled; }
+    bool isRecording() const { return m_recording; }
+    void clearRecording();
+    size_t getRecordedCount() const;
+    // RAM the recording may use before older samples are spilled to the session file
+    void setHistoryBudget(size_t bytes);
+    TelemetryHistoryStats getHistoryStats() const;
+    // Samples the recorder lost because its queue was full (it never holds up the I/O threads)
+    uint64_t getRecordingDropped() const;
+    // Journal the recording in `directory` from now on, starting a new journal whenever the
+    // recording is cleared; false if the journal could not be created
+    bool startJournal(const std::string &directory);
+    // Ends the session cleanly: the journal is deleted
+    void stopJournal();
+    JournalStats getJournalStats() const;
+    // The recording so far, to read (e.g. export) while recording goes on; locks only to take it
+    TelemetryHistorySnapshot snapshotRecording() const;
+    // TelemetryCsv layout; a Device column is added when more than one device was recorded,
+    // and one column per derived channel after the recorded ones. False if spilled samples
+    // could not be read back.
+    bool writeCsv(std::ostream &out) const;
+    // Channels added to exported recordings (null for none)
+    void setDerivedChannels(std::shared_ptr<const DerivedChannels> channels);
+    std::shared_ptr<const DerivedChannels> getDerivedChannels() const;
+    // Per-step analytics of each device's latest run (RunAnalytics layout, Device column likewise)
+    void writeAnalyticsCsv(std::ostream &out) const;
+
+    IoThreadPool &getIoPool() { return *m_ioPool; }
+    const IoThreadPool &getIoPool() const { return *m_ioPool; }
+
+private:
+    struct Device
+    {
+        std::shared_ptr<TreadmillController> controller;
+        uint64_t samples = 0;
+        TelemetryData last{};
+    };
+
+    void trackSample(const TelemetrySample &sample);
+    void recordSample(const TelemetryBus::Ptr &sample);
+
+    std::shared_ptr<IoThreadPool> m_ioPool;
+    std::shared_ptr<TelemetryBus> m_telemetryBus;
+    std::shared_ptr<SafetyMonitor> m_safetyMonitor;
+
+    mutable std::mutex m_devicesMutex;
+    std::map<size_t, Device> m_devices;
+    size_t m_nextId = 1;
+
+    StatusCallback m_statusCallback;
+
+    mutable std::mutex m_channelsMutex;
+    std::shared_ptr<const DerivedChannels> m_derivedChannels;
+
+    std::atomic<bool> m_recording{true};
+    mutable std::mutex m_recordMutex;
+    TelemetryHistory m_history;
+    std::string m_journalDirectory;
+    SessionJournal m_journal;
+
+    // Declared last: their threads use the members above
+    TelemetryBus::Subscription m_trackerSubscription;
+    TelemetryBus::Subscription m_recorderSubscription;
+};
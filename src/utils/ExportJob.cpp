@@ -0,0 +1,96 @@
+#include "ExportJob.h"
+#include "TelemetryCsv.h"
+#include <cstdio>
+#include <fstream>
+#include <vector>
+
+ExportJob::ExportJob(TelemetryHistorySnapshot recording, std::shared_ptr<const DerivedChannels> channels, std::string path)
+    : m_recording(std::move(recording)), m_channels(std::move(channels)), m_path(std::move(path)),
+      m_totalRows(m_recording.size())
+{
+}
+
+ExportJob::~ExportJob()
+{
+    cancel();
+    wait();
+}
+
+void ExportJob::start()
+{
+    m_started = std::chrono::steady_clock::now();
+    m_thread = std::thread(&ExportJob::run, this);
+}
+
+void ExportJob::wait()
+{
+    if (m_thread.joinable())
+    {
+        m_thread.join();
+    }
+}
+
+ExportProgress ExportJob::getProgress() const
+{
+    ExportProgress progress;
+    progress.rows = m_rows;
+    progress.totalRows = m_totalRows;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    progress.state = m_state;
+    progress.elapsedSec = (m_state == ExportState::Running)
+                              ? std::chrono::duration<double>(std::chrono::steady_clock::now() - m_started).count()
+                              : m_elapsedSec;
+    return progress;
+}
+
+std::string ExportJob::getError() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_error;
+}
+
+void ExportJob::run()
+{
+    // The writer hands over a whole chunk at a time; a large stream buffer keeps the
+    // header and any short chunk from going out in small pieces
+    std::vector<char> buffer(FILE_BUFFER_BYTES);
+    std::ofstream file;
+    file.rdbuf()->pubsetbuf(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+    file.open(m_path, std::ios::binary | std::ios::trunc);
+    if (!file.is_open())
+    {
+        finish(ExportState::Failed, "Could not create file: " + m_path);
+        return;
+    }
+
+    bool complete = TelemetryCsv::writeRecording(file, m_recording, m_channels.get(), [this](uint64_t rows)
+                                                 {
+        m_rows = rows;
+        return !m_cancelled; });
+    file.close();
+
+    // A cancel that lands after the last row leaves a finished export, which is kept
+    if (!complete && m_cancelled)
+    {
+        std::remove(m_path.c_str());
+        finish(ExportState::Cancelled);
+    }
+    else if (!complete || file.fail())
+    {
+        std::remove(m_path.c_str());
+        finish(ExportState::Failed, "Could not write " + m_path);
+    }
+    else
+    {
+        finish(ExportState::Completed);
+    }
+}
+
+void ExportJob::finish(ExportState state, const std::string &error)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_elapsedSec = std::chrono::duration<double>(std::chrono::steady_clock::now() - m_started).count();
+    m_error = error;
+    m_state = state;
+}
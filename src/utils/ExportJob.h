@@ -0,0 +1,79 @@
+#pragma once
+#include "DerivedChannels.h"
+#include "TelemetryHistory.h"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+enum class ExportState
+{
+    Running,
+    Completed,
+    Cancelled,
+    Failed
+};
+
+struct ExportProgress
+{
+    ExportState state = ExportState::Running;
+    uint64_t rows = 0;
+    uint64_t totalRows = 0;
+    double elapsedSec = 0.0;
+
+    double rowsPerSecond() const { return elapsedSec > 0.0 ? static_cast<double>(rows) / elapsedSec : 0.0; }
+};
+
+/**
+ * Writes a recording to a TelemetryCsv file on a thread of its own
+ * Works from a snapshot, so the UI and the recording carry on while it runs;
+ * poll getProgress() to follow it. Cancelling (or failing) removes the
+ * partly written file.
+ */
+class ExportJob
+{
+public:
+    static constexpr size_t FILE_BUFFER_BYTES = 1u << 20;
+
+    // channels may be null
+    ExportJob(TelemetryHistorySnapshot recording, std::shared_ptr<const DerivedChannels> channels, std::string path);
+    // Cancels and waits for the thread
+    ~ExportJob();
+
+    ExportJob(const ExportJob &) = delete;
+    ExportJob &operator=(const ExportJob &) = delete;
+
+    void start();
+    // Any thread; the job stops after the chunk it is writing
+    void cancel() { m_cancelled = true; }
+    // Blocks until the job has finished
+    void wait();
+
+    ExportProgress getProgress() const;
+    bool isFinished() const { return getProgress().state != ExportState::Running; }
+    const std::string &getPath() const { return m_path; }
+    // Why the job failed, once it has
+    std::string getError() const;
+
+private:
+    void run();
+    void finish(ExportState state, const std::string &error = "");
+
+    TelemetryHistorySnapshot m_recording;
+    std::shared_ptr<const DerivedChannels> m_channels;
+    std::string m_path;
+    uint64_t m_totalRows;
+    std::thread m_thread;
+
+    std::atomic<bool> m_cancelled{false};
+    std::atomic<uint64_t> m_rows{0};
+    std::chrono::steady_clock::time_point m_started;
+
+    mutable std::mutex m_mutex;
+    ExportState m_state = ExportState::Running;
+    double m_elapsedSec = 0.0; // Set when the job finishes
+    std::string m_error;
+};
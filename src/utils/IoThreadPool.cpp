@@ -0,0 +1,75 @@
+#include "IoThreadPool.h"
+#include "Trace.h"
+#include <algorithm>
+#include <iostream>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <time.h>
+#endif
+
+IoThreadPool::IoThreadPool(size_t threadCount)
+    : m_workGuard(asio::make_work_guard(m_context))
+{
+    threadCount = std::max<size_t>(1, threadCount);
+    m_threads.reserve(threadCount);
+    for (size_t i = 0; i < threadCount; ++i)
+    {
+        m_threads.emplace_back([this, i]()
+                               {
+            Trace::setThreadName("ASIO I/O " + std::to_string(i + 1));
+            // A throwing handler must not take the whole pool down with it
+            while (true)
+            {
+                try
+                {
+                    m_context.run();
+                    break;
+                }
+                catch (const std::exception &e)
+                {
+                    std::cerr << "Error in I/O pool thread: " << e.what() << std::endl;
+                }
+            } });
+    }
+}
+
+IoThreadPool::~IoThreadPool()
+{
+    m_workGuard.reset();
+    m_context.stop();
+    for (auto &thread : m_threads)
+    {
+        if (thread.joinable())
+        {
+            thread.join();
+        }
+    }
+}
+
+int64_t IoThreadPool::getCpuTimeUs() const
+{
+#ifdef __linux__
+    int64_t totalUs = 0;
+    for (const auto &thread : m_threads)
+    {
+        clockid_t clock;
+        timespec ts{};
+        if (pthread_getcpuclockid(const_cast<std::thread &>(thread).native_handle(), &clock) != 0 ||
+            clock_gettime(clock, &ts) != 0)
+        {
+            return -1;
+        }
+        totalUs += static_cast<int64_t>(ts.tv_sec) * 1000000 + ts.tv_nsec / 1000;
+    }
+    return totalUs;
+#else
+    return -1;
+#endif
+}
+
+size_t IoThreadPool::defaultThreadCount()
+{
+    size_t hardware = std::thread::hardware_concurrency();
+    return std::clamp<size_t>(hardware / 2, 1, 4);
+}
@@ -0,0 +1,35 @@
+#pragma once
+#include <asio.hpp>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+/**
+ * Fixed set of threads running one shared io_context
+ * Serial ports opened on it share these threads instead of each running its own.
+ * Handlers for one port are serialised by that port's strand, so the pool size
+ * bounds the I/O threads no matter how many devices are connected.
+ */
+class IoThreadPool
+{
+public:
+    explicit IoThreadPool(size_t threadCount = defaultThreadCount());
+    ~IoThreadPool();
+
+    IoThreadPool(const IoThreadPool &) = delete;
+    IoThreadPool &operator=(const IoThreadPool &) = delete;
+
+    asio::io_context &getContext() { return m_context; }
+    size_t getThreadCount() const { return m_threads.size(); }
+
+    // CPU time consumed by the pool threads so far, in microseconds (-1 where unsupported)
+    int64_t getCpuTimeUs() const;
+
+    // Half the hardware threads, at least 1 and at most 4: serial I/O is latency-bound, not CPU-bound
+    static size_t defaultThreadCount();
+
+private:
+    asio::io_context m_context;
+    asio::executor_work_guard<asio::io_context::executor_type> m_workGuard;
+    std::vector<std::thread> m_threads;
+};
@@ -0,0 +1,82 @@
+#include "LatencyHistogram.h"
+#include <algorithm>
+#include <cmath>
+
+uint32_t LatencyHistogram::bucketLowerBound(int index)
+{
+    if (index < static_cast<int>(LINEAR_LIMIT))
+    {
+        return static_cast<uint32_t>(index);
+    }
+
+    int shift = (index - LINEAR_LIMIT) / SUB_BUCKETS + 1;
+    uint32_t sub = (index - LINEAR_LIMIT) % SUB_BUCKETS + SUB_BUCKETS;
+    return sub << shift;
+}
+
+uint32_t LatencyHistogram::bucketUpperBound(int index)
+{
+    if (index + 1 >= BUCKET_COUNT)
+    {
+        return UINT32_MAX;
+    }
+    return bucketLowerBound(index + 1) - 1;
+}
+
+uint32_t LatencyHistogram::percentile(double fraction) const
+{
+    uint64_t total = count();
+    if (total == 0)
+    {
+        return 0;
+    }
+
+    // Rank of the requested sample (1-based), reported as the top of its bucket
+    uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(fraction * total)));
+    uint64_t seen = 0;
+    for (int i = 0; i < BUCKET_COUNT; ++i)
+    {
+        seen += m_buckets[i].load(std::memory_order_relaxed);
+        if (seen >= rank)
+        {
+            return std::min(bucketUpperBound(i), m_maxUs.load(std::memory_order_relaxed));
+        }
+    }
+    return m_maxUs.load(std::memory_order_relaxed);
+}
+
+LatencySummary LatencyHistogram::summarize() const
+{
+    LatencySummary summary;
+    summary.count = count();
+    if (summary.count == 0)
+    {
+        return summary;
+    }
+
+    summary.meanUs = static_cast<double>(m_sumUs.load(std::memory_order_relaxed)) / summary.count;
+    summary.maxUs = m_maxUs.load(std::memory_order_relaxed);
+    for (int i = 0; i < BUCKET_COUNT; ++i)
+    {
+        if (m_buckets[i].load(std::memory_order_relaxed))
+        {
+            summary.minUs = bucketLowerBound(i);
+            break;
+        }
+    }
+    summary.p50Us = percentile(0.50);
+    summary.p90Us = percentile(0.90);
+    summary.p99Us = percentile(0.99);
+    return summary;
+}
+
+void LatencyHistogram::reset()
+{
+    for (auto &bucket : m_buckets)
+    {
+        bucket.store(0, std::memory_order_relaxed);
+    }
+    m_count.store(0, std::memory_order_relaxed);
+    m_sumUs.store(0, std::memory_order_relaxed);
+    m_maxUs.store(0, std::memory_order_relaxed);
+}
@@ -0,0 +1,78 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+struct LatencySummary
+{
+    uint64_t count = 0;
+    double meanUs = 0.0;
+    uint32_t minUs = 0;
+    uint32_t p50Us = 0;
+    uint32_t p90Us = 0;
+    uint32_t p99Us = 0;
+    uint32_t maxUs = 0;
+};
+
+/**
+ * Lock-free latency histogram in microseconds (HDR-style log-linear buckets)
+ * Exact below 32us, then 16 buckets per power of two (~6% resolution) up to
+ * ~71 minutes. record() is a handful of relaxed atomic adds and safe from any thread.
+ */
+class LatencyHistogram
+{
+public:
+    static constexpr int LINEAR_BITS = 5;
+    static constexpr uint32_t LINEAR_LIMIT = 1u << LINEAR_BITS;       // 32 exact buckets
+    static constexpr uint32_t SUB_BUCKETS = LINEAR_LIMIT / 2;         // 16 per octave above that
+    static constexpr int BUCKET_COUNT = LINEAR_LIMIT + (32 - LINEAR_BITS) * SUB_BUCKETS;
+
+    void record(uint32_t valueUs)
+    {
+        m_buckets[bucketIndex(valueUs)].fetch_add(1, std::memory_order_relaxed);
+        m_count.fetch_add(1, std::memory_order_relaxed);
+        m_sumUs.fetch_add(valueUs, std::memory_order_relaxed);
+
+        uint32_t max = m_maxUs.load(std::memory_order_relaxed);
+        while (valueUs > max && !m_maxUs.compare_exchange_weak(max, valueUs, std::memory_order_relaxed))
+        {
+        }
+    }
+
+    LatencySummary summarize() const;
+    uint32_t percentile(double fraction) const;
+    uint64_t count() const { return m_count.load(std::memory_order_relaxed); }
+    void reset();
+
+    static int bucketIndex(uint32_t valueUs);
+    static uint32_t bucketUpperBound(int index);
+    static uint32_t bucketLowerBound(int index);
+
+private:
+    std::array<std::atomic<uint32_t>, BUCKET_COUNT> m_buckets{};
+    std::atomic<uint64_t> m_count{0};
+    std::atomic<uint64_t> m_sumUs{0};
+    std::atomic<uint32_t> m_maxUs{0};
+};
+
+inline int LatencyHistogram::bucketIndex(uint32_t valueUs)
+{
+    if (valueUs < LINEAR_LIMIT)
+    {
+        return static_cast<int>(valueUs);
+    }
+
+    // Position of the highest set bit (>= LINEAR_BITS here)
+    int msb = 0;
+    for (int step = 16; step > 0; step >>= 1)
+    {
+        if (valueUs >> (msb + step))
+        {
+            msb += step;
+        }
+    }
+
+    int shift = msb - LINEAR_BITS + 1;                           // >= 1
+    uint32_t sub = (valueUs >> shift) - SUB_BUCKETS;             // 0..SUB_BUCKETS-1
+    return static_cast<int>(LINEAR_LIMIT + (shift - 1) * SUB_BUCKETS + sub);
+}
@@ -0,0 +1,59 @@
+#include "LinkStats.h"
+
+const char *linkCommandName(LinkCommand command)
+{
+    switch (command)
+    {
+    case LinkCommand::Stop:
+        return "STOP_TM";
+    case LinkCommand::StartRead:
+        return "START_READ";
+    case LinkCommand::ProfileStep:
+        return "STEP";
+    case LinkCommand::EndRead:
+        return "END_READ";
+    case LinkCommand::Run:
+        return "RUN_TM";
+    case LinkCommand::Stats:
+        return "STATS";
+    case LinkCommand::ProfileQuery:
+        return "PROFILE?";
+    case LinkCommand::ProfileBinary:
+        return "PROFILE_BIN";
+    case LinkCommand::Count:
+        break;
+    }
+    return "?";
+}
+
+LinkStatsSnapshot LinkStats::snapshot() const
+{
+    LinkStatsSnapshot snapshot;
+    snapshot.bytesRx = m_bytesRx.load(std::memory_order_relaxed);
+    snapshot.bytesTx = m_bytesTx.load(std::memory_order_relaxed);
+    snapshot.linesRx = m_linesRx.load(std::memory_order_relaxed);
+    snapshot.linesTx = m_linesTx.load(std::memory_order_relaxed);
+    snapshot.timeouts = m_timeouts.load(std::memory_order_relaxed);
+    snapshot.parseErrors = m_parseErrors.load(std::memory_order_relaxed);
+    snapshot.purgedLines = m_purgedLines.load(std::memory_order_relaxed);
+    for (size_t i = 0; i < LINK_COMMAND_COUNT; ++i)
+    {
+        snapshot.roundTrip[i] = m_roundTrip[i].summarize();
+    }
+    return snapshot;
+}
+
+void LinkStats::reset()
+{
+    m_bytesRx.store(0, std::memory_order_relaxed);
+    m_bytesTx.store(0, std::memory_order_relaxed);
+    m_linesRx.store(0, std::memory_order_relaxed);
+    m_linesTx.store(0, std::memory_order_relaxed);
+    m_timeouts.store(0, std::memory_order_relaxed);
+    m_parseErrors.store(0, std::memory_order_relaxed);
+    m_purgedLines.store(0, std::memory_order_relaxed);
+    for (auto &histogram : m_roundTrip)
+    {
+        histogram.reset();
+    }
+}
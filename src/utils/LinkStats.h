@@ -0,0 +1,79 @@
+#pragma once
+#include "LatencyHistogram.h"
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// Request/reply exchanges whose round trip is timed
+enum class LinkCommand : uint8_t
+{
+    Stop,        // STOP_TM -> STOPPED
+    StartRead,   // START_READ -> READY
+    ProfileStep, // Profile line -> READY
+    EndRead,     // END_READ -> ACK
+    Run,         // RUN_TM -> RUNNING, STREAM -> STREAMING
+    Stats,       // STATS -> STATS,LOOP
+    ProfileQuery, // PROFILE? -> PROFILE,<steps>,<crc>
+    ProfileBinary, // PROFILE_BIN + packed steps -> ACK
+    Count
+};
+
+constexpr size_t LINK_COMMAND_COUNT = static_cast<size_t>(LinkCommand::Count);
+
+const char *linkCommandName(LinkCommand command);
+
+struct LinkStatsSnapshot
+{
+    uint64_t bytesRx = 0;
+    uint64_t bytesTx = 0;
+    uint64_t linesRx = 0;
+    uint64_t linesTx = 0;
+    uint64_t timeouts = 0;
+    uint64_t parseErrors = 0;
+    uint64_t purgedLines = 0;
+    std::array<LatencySummary, LINK_COMMAND_COUNT> roundTrip{};
+};
+
+/**
+ * Serial link counters and per-command round-trip latency
+ * Every update is a relaxed atomic add, so it can be called from the I/O
+ * thread and the caller's thread alike at no measurable cost.
+ */
+class LinkStats
+{
+public:
+    void recordTx(size_t bytes)
+    {
+        m_bytesTx.fetch_add(bytes, std::memory_order_relaxed);
+        m_linesTx.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void recordRx(size_t bytes)
+    {
+        m_bytesRx.fetch_add(bytes, std::memory_order_relaxed);
+        m_linesRx.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void recordTimeout() { m_timeouts.fetch_add(1, std::memory_order_relaxed); }
+    void recordParseError() { m_parseErrors.fetch_add(1, std::memory_order_relaxed); }
+    void recordPurged(size_t lines) { m_purgedLines.fetch_add(lines, std::memory_order_relaxed); }
+
+    void recordRoundTrip(LinkCommand command, uint32_t micros)
+    {
+        m_roundTrip[static_cast<size_t>(command)].record(micros);
+    }
+
+    LinkStatsSnapshot snapshot() const;
+    void reset();
+
+private:
+    std::atomic<uint64_t> m_bytesRx{0};
+    std::atomic<uint64_t> m_bytesTx{0};
+    std::atomic<uint64_t> m_linesRx{0};
+    std::atomic<uint64_t> m_linesTx{0};
+    std::atomic<uint64_t> m_timeouts{0};
+    std::atomic<uint64_t> m_parseErrors{0};
+    std::atomic<uint64_t> m_purgedLines{0};
+    std::array<LatencyHistogram, LINK_COMMAND_COUNT> m_roundTrip;
+};
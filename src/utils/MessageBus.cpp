@@ -0,0 +1,15 @@
+#include "MessageBus.h"
+
+const char *overflowPolicyName(OverflowPolicy policy)
+{
+    switch (policy)
+    {
+    case OverflowPolicy::DropOldest:
+        return "drop-oldest";
+    case OverflowPolicy::DropNewest:
+        return "drop-newest";
+    case OverflowPolicy::Block:
+        return "block";
+    }
+    return "unknown";
+}
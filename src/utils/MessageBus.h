@@ -0,0 +1,369 @@
+#pragma once
+#include "Trace.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// What a full subscriber queue does with the next message
+enum class OverflowPolicy : uint8_t
+{
+    DropOldest, // Keep the newest (displays: only the latest value matters)
+    DropNewest, // Keep what is queued, refuse the new message
+    Block       // Make the publisher wait up to blockTimeout, then drop it. Never for subscribers
+                // of a bus fed from the serial I/O thread: its wait stalls every port on the pool.
+};
+
+const char *overflowPolicyName(OverflowPolicy policy);
+
+struct SubscriberStats
+{
+    std::string name;
+    OverflowPolicy policy = OverflowPolicy::DropOldest;
+    size_t capacity = 0;
+    size_t queued = 0;
+    size_t highWater = 0;   // Deepest the queue has been
+    uint64_t delivered = 0;
+    uint64_t dropped = 0;
+};
+
+/**
+ * Fan-out publish/subscribe for one message type
+ * Every subscriber has its own bounded queue and overflow policy, so a slow
+ * consumer loses its own messages (or, with Block, briefly holds the publisher)
+ * without delaying the others. Messages are shared immutable blocks: publishing
+ * allocates once and each queue holds a reference, never a copy.
+ *
+ * A subscriber either gets its own delivery thread (subscribe with a handler)
+ * or drains its queue from a thread of its choosing (poll mode, e.g. the UI loop).
+ */
+template <typename Message>
+class MessageBus
+{
+public:
+    using Ptr = std::shared_ptr<const Message>;
+    using Handler = std::function<void(const Ptr &)>;
+    using Filter = std::function<bool(const Message &)>;
+
+    struct Options
+    {
+        size_t capacity = 256;
+        OverflowPolicy policy = OverflowPolicy::DropOldest;
+        std::chrono::milliseconds blockTimeout{50}; // Block only
+        Filter filter;                              // Null: every message
+    };
+
+private:
+    struct Subscriber
+    {
+        std::string name;
+        Options options;
+        Handler handler;
+
+        mutable std::mutex mutex;
+        std::condition_variable notEmpty;
+        std::condition_variable notFull;
+        std::deque<Ptr> queue;
+        bool closed = false;
+        size_t waitingPublishers = 0; // Block policy publishers waiting for room
+        size_t highWater = 0;
+        std::atomic<uint64_t> delivered{0};
+        std::atomic<uint64_t> dropped{0};
+        std::thread worker;
+
+        // Publisher side; returns false if the message was dropped
+        bool offer(const Ptr &message)
+        {
+            if (options.filter && !options.filter(*message))
+            {
+                return true;
+            }
+
+            std::unique_lock<std::mutex> lock(mutex);
+            if (closed)
+            {
+                return false;
+            }
+
+            if (queue.size() >= options.capacity)
+            {
+                switch (options.policy)
+                {
+                case OverflowPolicy::DropOldest:
+                    queue.pop_front();
+                    dropped++;
+                    break;
+                case OverflowPolicy::DropNewest:
+                    dropped++;
+                    return false;
+                case OverflowPolicy::Block:
+                {
+                    waitingPublishers++;
+                    bool room = notFull.wait_for(lock, options.blockTimeout, [this]()
+                                                 { return closed || queue.size() < options.capacity; });
+                    waitingPublishers--;
+                    if (!room || closed)
+                    {
+                        dropped++;
+                        return false;
+                    }
+                    break;
+                }
+                }
+            }
+
+            // The consumer takes the whole queue per wake-up, so only the first message needs to wake it
+            bool wasEmpty = queue.empty();
+            queue.push_back(message);
+            highWater = std::max(highWater, queue.size());
+            lock.unlock();
+            if (wasEmpty)
+            {
+                notEmpty.notify_one();
+            }
+            return true;
+        }
+
+        // Hands out everything queued (up to maxMessages) outside the lock
+        size_t drain(const Handler &deliver, size_t maxMessages)
+        {
+            std::deque<Ptr> batch;
+            bool publisherWaiting;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (maxMessages >= queue.size())
+                {
+                    batch.swap(queue);
+                }
+                else
+                {
+                    batch.assign(queue.begin(), queue.begin() + static_cast<std::ptrdiff_t>(maxMessages));
+                    queue.erase(queue.begin(), queue.begin() + static_cast<std::ptrdiff_t>(maxMessages));
+                }
+                publisherWaiting = waitingPublishers > 0;
+            }
+            if (publisherWaiting)
+            {
+                notFull.notify_all();
+            }
+
+            for (const Ptr &message : batch)
+            {
+                deliver(message);
+            }
+            delivered += batch.size();
+            return batch.size();
+        }
+
+        void run()
+        {
+            Trace::setThreadName("Bus: " + name);
+            while (true)
+            {
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    notEmpty.wait(lock, [this]()
+                                  { return closed || !queue.empty(); });
+                    if (queue.empty())
+                    {
+                        return; // Closed and fully delivered
+                    }
+                }
+                drain(handler, std::numeric_limits<size_t>::max());
+            }
+        }
+
+        void close()
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                closed = true;
+            }
+            notEmpty.notify_all();
+            notFull.notify_all();
+            if (worker.joinable() && worker.get_id() != std::this_thread::get_id())
+            {
+                worker.join();
+            }
+            else if (worker.joinable())
+            {
+                worker.detach(); // Unsubscribed from inside its own handler
+            }
+        }
+
+        SubscriberStats stats() const
+        {
+            SubscriberStats s;
+            s.name = name;
+            s.policy = options.policy;
+            s.capacity = options.capacity;
+            s.delivered = delivered;
+            s.dropped = dropped;
+            std::lock_guard<std::mutex> lock(mutex);
+            s.queued = queue.size();
+            s.highWater = highWater;
+            return s;
+        }
+    };
+
+    // Shared with subscriptions so they can detach safely even after the bus is gone
+    struct Registry
+    {
+        std::mutex mutex;
+        std::shared_ptr<const std::vector<std::shared_ptr<Subscriber>>> subscribers =
+            std::make_shared<const std::vector<std::shared_ptr<Subscriber>>>();
+
+        void remove(const std::shared_ptr<Subscriber> &subscriber)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            auto next = std::make_shared<std::vector<std::shared_ptr<Subscriber>>>(*subscribers);
+            next->erase(std::remove(next->begin(), next->end(), subscriber), next->end());
+            subscribers = std::move(next);
+        }
+    };
+
+public:
+    /**
+     * Subscriber handle; unsubscribes when destroyed
+     * Handler subscriptions deliver what is still queued before their thread ends.
+     */
+    class Subscription
+    {
+    public:
+        Subscription() = default;
+        ~Subscription() { reset(); }
+
+        Subscription(Subscription &&other) noexcept = default;
+        Subscription &operator=(Subscription &&other) noexcept
+        {
+            if (this != &other)
+            {
+                reset();
+                m_registry = std::move(other.m_registry);
+                m_subscriber = std::move(other.m_subscriber);
+            }
+            return *this;
+        }
+        Subscription(const Subscription &) = delete;
+        Subscription &operator=(const Subscription &) = delete;
+
+        explicit operator bool() const { return m_subscriber != nullptr; }
+
+        // Poll mode: deliver up to maxMessages queued messages on the calling thread
+        size_t drain(const Handler &handler, size_t maxMessages = std::numeric_limits<size_t>::max())
+        {
+            return m_subscriber ? m_subscriber->drain(handler, maxMessages) : 0;
+        }
+
+        SubscriberStats getStats() const { return m_subscriber ? m_subscriber->stats() : SubscriberStats{}; }
+
+        void reset()
+        {
+            if (!m_subscriber)
+            {
+                return;
+            }
+            if (auto registry = m_registry.lock())
+            {
+                registry->remove(m_subscriber);
+            }
+            m_subscriber->close();
+            m_subscriber.reset();
+        }
+
+    private:
+        friend class MessageBus;
+        Subscription(std::weak_ptr<Registry> registry, std::shared_ptr<Subscriber> subscriber)
+            : m_registry(std::move(registry)), m_subscriber(std::move(subscriber))
+        {
+        }
+
+        std::weak_ptr<Registry> m_registry;
+        std::shared_ptr<Subscriber> m_subscriber;
+    };
+
+    MessageBus() = default;
+    MessageBus(const MessageBus &) = delete;
+    MessageBus &operator=(const MessageBus &) = delete;
+
+    // With a handler, messages are delivered on a dedicated thread; without one, call drain()
+    Subscription subscribe(std::string name, Options options, Handler handler = nullptr)
+    {
+        auto subscriber = std::make_shared<Subscriber>();
+        subscriber->name = std::move(name);
+        subscriber->options = std::move(options);
+        subscriber->options.capacity = std::max<size_t>(1, subscriber->options.capacity);
+        subscriber->handler = std::move(handler);
+        if (subscriber->handler)
+        {
+            // The thread keeps its subscriber alive, even if it unsubscribes itself mid-delivery
+            subscriber->worker = std::thread([subscriber]()
+                                             { subscriber->run(); });
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(m_registry->mutex);
+            auto next = std::make_shared<std::vector<std::shared_ptr<Subscriber>>>(*m_registry->subscribers);
+            next->push_back(subscriber);
+            m_registry->subscribers = std::move(next);
+        }
+        return Subscription(m_registry, std::move(subscriber));
+    }
+
+    // Called from the producer thread; returns how many subscribers accepted the message
+    size_t publish(Ptr message)
+    {
+        std::shared_ptr<const std::vector<std::shared_ptr<Subscriber>>> subscribers;
+        {
+            std::lock_guard<std::mutex> lock(m_registry->mutex);
+            subscribers = m_registry->subscribers;
+        }
+
+        size_t accepted = 0;
+        for (const auto &subscriber : *subscribers)
+        {
+            accepted += subscriber->offer(message) ? 1 : 0;
+        }
+        m_published++;
+        return accepted;
+    }
+
+    size_t publish(Message message)
+    {
+        return publish(std::make_shared<const Message>(std::move(message)));
+    }
+
+    std::vector<SubscriberStats> getStats() const
+    {
+        std::shared_ptr<const std::vector<std::shared_ptr<Subscriber>>> subscribers;
+        {
+            std::lock_guard<std::mutex> lock(m_registry->mutex);
+            subscribers = m_registry->subscribers;
+        }
+
+        std::vector<SubscriberStats> stats;
+        stats.reserve(subscribers->size());
+        for (const auto &subscriber : *subscribers)
+        {
+            stats.push_back(subscriber->stats());
+        }
+        return stats;
+    }
+
+    uint64_t getPublishedCount() const { return m_published; }
+
+private:
+    std::shared_ptr<Registry> m_registry = std::make_shared<Registry>();
+    std::atomic<uint64_t> m_published{0};
+};
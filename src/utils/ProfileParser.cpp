@@ -0,0 +1,202 @@
+#include "ProfileParser.h"
+#include "Crc16.h"
+#include <algorithm>
+#include <iostream>
+#include <regex>
+#include <sstream>
+
+namespace
+{
+    // Mirrors parseMilli in the firmware: optional sign, at most three decimals
+    const char *parseMilli(const char *p, int32_t &out)
+    {
+        while (*p == ' ')
+        {
+            ++p;
+        }
+
+        bool negative = false;
+        if (*p == '-' || *p == '+')
+        {
+            negative = (*p == '-');
+            ++p;
+        }
+
+        bool hasDigits = false;
+        int32_t whole = 0;
+        while (*p >= '0' && *p <= '9')
+        {
+            if (whole < 2000000) // Same saturation as the firmware
+            {
+                whole = whole * 10 + (*p - '0');
+            }
+            hasDigits = true;
+            ++p;
+        }
+
+        int32_t frac = 0;
+        int fracDigits = 0;
+        if (*p == '.')
+        {
+            ++p;
+            while (*p >= '0' && *p <= '9')
+            {
+                if (fracDigits < 3)
+                {
+                    frac = frac * 10 + (*p - '0');
+                    fracDigits++;
+                }
+                hasDigits = true;
+                ++p;
+            }
+        }
+
+        if (!hasDigits)
+        {
+            return nullptr;
+        }
+
+        while (fracDigits < 3)
+        {
+            frac *= 10;
+            fracDigits++;
+        }
+
+        // Wraps like the AVR's 32-bit arithmetic rather than overflowing
+        int32_t value = static_cast<int32_t>(static_cast<uint32_t>(whole) * 1000u + static_cast<uint32_t>(frac));
+        out = negative ? -value : value;
+        return p;
+    }
+
+    const char *parseField(const char *p, char key, int32_t &out)
+    {
+        while (*p == ' ')
+        {
+            ++p;
+        }
+        if (p[0] != key || p[1] != ':')
+        {
+            return nullptr;
+        }
+        return parseMilli(p + 2, out);
+    }
+
+    void appendLittleEndian(std::vector<uint8_t> &bytes, uint32_t value)
+    {
+        for (int i = 0; i < 4; ++i)
+        {
+            bytes.push_back(static_cast<uint8_t>(value >> (8 * i)));
+        }
+    }
+}
+
+std::vector<std::string> ProfileParser::parseSpeedCommands(const std::string &text)
+{
+    std::vector<std::string> commands;
+    std::istringstream stream(text);
+    std::string line;
+
+    // Regex to validate the speed commands format (compiled once)
+    static const std::regex commandRegex(R"(L:\s*(-?\d+(?:\.\d+)?)\s+R:\s*(-?\d+(?:\.\d+)?)\s+T:\s*(-?\d+(?:\.\d+)?))");
+    std::smatch matches;
+
+    int lineNumber = 0;
+
+    while (std::getline(stream, line))
+    {
+        lineNumber++;
+
+        // Skip empty lines and lines with only whitespace
+        if (line.empty() || std::all_of(line.begin(), line.end(), ::isspace))
+        {
+            continue;
+        }
+
+        if (std::regex_search(line, matches, commandRegex))
+        {
+            try
+            {
+                // Validate the time value
+                double time = std::stod(matches[3].str());
+                if (time <= 0)
+                {
+                    std::cerr << "Warning: Line " << lineNumber << " has invalid time value (must be > 0): " << time << std::endl;
+                    continue;
+                }
+
+                commands.push_back(line);
+            }
+            catch (const std::exception &e)
+            {
+                std::cerr << "Error parsing line " << lineNumber << ": " << e.what() << std::endl;
+            }
+        }
+        else
+        {
+            std::cerr << "Warning: Line " << lineNumber << " doesn't match expected format, skipping: " << line << std::endl;
+        }
+    }
+
+    return commands;
+}
+
+bool ProfileParser::compileStep(const std::string &command, CompiledStep &step)
+{
+    // The firmware splits the keyword off at the first ' ', ',' or ':'
+    if (command.size() < 2 || command[0] != 'L' || (command[1] != ':' && command[1] != ' ' && command[1] != ','))
+    {
+        return false;
+    }
+
+    int32_t left = 0, right = 0, duration = 0;
+    const char *p = parseMilli(command.c_str() + 2, left);
+    if (p)
+        p = parseField(p, 'R', right);
+    if (p)
+        p = parseField(p, 'T', duration); // Seconds in thousandths == milliseconds
+
+    if (!p || duration <= 0)
+    {
+        return false;
+    }
+
+    step.leftMilli = left;
+    step.rightMilli = right;
+    step.durationMs = static_cast<uint32_t>(duration);
+    return true;
+}
+
+bool ProfileParser::compileSteps(const std::vector<std::string> &commands, std::vector<CompiledStep> &steps)
+{
+    steps.clear();
+    steps.reserve(commands.size());
+    for (const std::string &command : commands)
+    {
+        CompiledStep step;
+        if (!compileStep(command, step))
+        {
+            return false;
+        }
+        steps.push_back(step);
+    }
+    return true;
+}
+
+std::vector<uint8_t> ProfileParser::packSteps(const std::vector<CompiledStep> &steps)
+{
+    std::vector<uint8_t> bytes;
+    bytes.reserve(steps.size() * 12);
+    for (const CompiledStep &step : steps)
+    {
+        appendLittleEndian(bytes, static_cast<uint32_t>(step.leftMilli));
+        appendLittleEndian(bytes, static_cast<uint32_t>(step.rightMilli));
+        appendLittleEndian(bytes, step.durationMs);
+    }
+    return bytes;
+}
+
+uint16_t ProfileParser::checksum(const std::vector<CompiledStep> &steps)
+{
+    std::vector<uint8_t> bytes = packSteps(steps);
+    return Crc16::compute(bytes.data(), bytes.size());
+}
@@ -0,0 +1,37 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// One profile step as the firmware stores it (ProfileStep in the firmware)
+struct CompiledStep
+{
+    int32_t leftMilli = 0;  // Thousandths of an RPM
+    int32_t rightMilli = 0;
+    uint32_t durationMs = 0;
+};
+
+/**
+ * Static helper for speed profiles
+ * Validates profile text (one "L:{left} R:{right} T:{seconds}" step per line)
+ * and returns the lines that can be sent to the treadmill as-is
+ */
+class ProfileParser
+{
+public:
+    // Delete constructor to prevent instantiation
+    ProfileParser() = delete;
+
+    static std::vector<std::string> parseSpeedCommands(const std::string &text);
+
+    // Parse a step exactly as the firmware does (integer thousandths, extra
+    // decimals truncated). False if the firmware would reject the line.
+    static bool compileStep(const std::string &command, CompiledStep &step);
+    static bool compileSteps(const std::vector<std::string> &commands, std::vector<CompiledStep> &steps);
+
+    // 12 bytes per step, little-endian: the firmware's in-memory layout, used by PROFILE_BIN
+    static std::vector<uint8_t> packSteps(const std::vector<CompiledStep> &steps);
+
+    // CRC-16 over the packed steps, matching the firmware's PROFILE? reply
+    static uint16_t checksum(const std::vector<CompiledStep> &steps);
+};
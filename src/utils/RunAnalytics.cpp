@@ -0,0 +1,249 @@
+#include "RunAnalytics.h"
+#include "TreadmillController.h"
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+#include <string>
+
+namespace
+{
+    constexpr float TARGET_MATCH_RPM = 0.01f; // TEL reports targets to two decimals
+
+    void writeStats(std::ostream &out, const RunningStats &left, const RunningStats &right)
+    {
+        if (left.count() == 0)
+        {
+            out << ", , , , , , ";
+            return;
+        }
+        out << left.mean() << ", " << right.mean() << ", "
+            << left.stddev() << ", " << right.stddev() << ", "
+            << left.rms() << ", " << right.rms() << ", ";
+    }
+
+    void writeTime(std::ostream &out, double ms)
+    {
+        if (ms >= 0.0)
+        {
+            out << ms;
+        }
+    }
+}
+
+void RunningStats::add(double value)
+{
+    m_count++;
+    double delta = value - m_mean;
+    m_mean += delta / static_cast<double>(m_count);
+    m_m2 += delta * (value - m_mean);
+
+    if (m_count == 1)
+    {
+        m_min = m_max = value;
+    }
+    else
+    {
+        m_min = std::min(m_min, value);
+        m_max = std::max(m_max, value);
+    }
+}
+
+double RunningStats::stddev() const
+{
+    return std::sqrt(variance());
+}
+
+double RunningStats::rms() const
+{
+    // mean of squares = mean^2 + population variance
+    return m_count > 0 ? std::sqrt(m_mean * m_mean + m_m2 / static_cast<double>(m_count)) : 0.0;
+}
+
+void RunAnalytics::begin(const std::vector<CompiledStep> &plan)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_plan = plan;
+    m_state = RunAnalyticsSnapshot{};
+    m_state.planned = !plan.empty();
+    m_state.steps.reserve(plan.size());
+    m_lastActualLeft = 0.0f;
+    m_lastActualRight = 0.0f;
+}
+
+void RunAnalytics::addSample(const TelemetryData &data)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    // The frame that ends a profile reports zero targets while the belts coast down
+    if (m_state.planned && !data.profileActive)
+    {
+        return;
+    }
+
+    float errorLeft = data.actualRpm1 - data.targetRpm1;
+    float errorRight = data.actualRpm2 - data.targetRpm2;
+    float asymmetry = (data.actualRpm1 - data.actualRpm2) - (data.targetRpm1 - data.targetRpm2);
+    m_state.samples++;
+    m_state.errorLeft.add(errorLeft);
+    m_state.errorRight.add(errorRight);
+    m_state.asymmetry.add(asymmetry);
+
+    if (m_state.planned)
+    {
+        if (m_state.currentStep < 0)
+        {
+            startStep(0, data.timestamp);
+        }
+
+        // Follow the plan's durations; the targets changing over marks a boundary exactly
+        while (static_cast<size_t>(m_state.currentStep) + 1 < m_plan.size())
+        {
+            const StepAnalytics &step = m_state.steps.back();
+            size_t next = static_cast<size_t>(m_state.currentStep) + 1;
+            if (data.timestamp - step.startMs >= step.plannedMs)
+            {
+                startStep(next, step.startMs + step.plannedMs);
+            }
+            else if (matchesStep(next, data) && !matchesStep(next - 1, data))
+            {
+                startStep(next, data.timestamp);
+            }
+            else
+            {
+                break;
+            }
+        }
+
+        StepAnalytics &step = m_state.steps.back();
+        double elapsedMs = static_cast<double>(static_cast<int32_t>(data.timestamp - step.startMs));
+        step.left.error.add(errorLeft);
+        step.right.error.add(errorRight);
+        step.asymmetry.add(asymmetry);
+        updateBelt(step.left, data.actualRpm1, elapsedMs);
+        updateBelt(step.right, data.actualRpm2, elapsedMs);
+        step.lastMs = data.timestamp;
+    }
+
+    m_lastActualLeft = data.actualRpm1;
+    m_lastActualRight = data.actualRpm2;
+}
+
+RunAnalyticsSnapshot RunAnalytics::getSnapshot() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_state;
+}
+
+void RunAnalytics::startStep(size_t index, uint32_t startMs)
+{
+    const CompiledStep &planned = m_plan[index];
+    StepAnalytics step;
+    step.index = index;
+    step.plannedMs = planned.durationMs;
+    step.startMs = startMs;
+    step.lastMs = startMs;
+    startBelt(step.left, m_lastActualLeft, planned.leftMilli / 1000.0f);
+    startBelt(step.right, m_lastActualRight, planned.rightMilli / 1000.0f);
+    m_state.steps.push_back(step);
+    m_state.currentStep = static_cast<int>(index);
+}
+
+void RunAnalytics::startBelt(BeltStepResponse &belt, float startRpm, float targetRpm)
+{
+    belt = BeltStepResponse{};
+    belt.startRpm = startRpm;
+    belt.targetRpm = targetRpm;
+}
+
+void RunAnalytics::updateBelt(BeltStepResponse &belt, float actualRpm, double elapsedMs)
+{
+    float change = belt.targetRpm - belt.startRpm;
+    float band = std::max(SETTLE_FRACTION * std::fabs(change), SETTLE_MIN_RPM);
+
+    if (std::fabs(change) >= SETTLE_MIN_RPM)
+    {
+        float progress = (actualRpm - belt.startRpm) / change;
+        if (belt.tenPercentMs < 0.0 && progress >= 0.1f)
+        {
+            belt.tenPercentMs = elapsedMs;
+        }
+        if (belt.riseMs < 0.0 && belt.tenPercentMs >= 0.0 && progress >= 0.9f)
+        {
+            belt.riseMs = elapsedMs - belt.tenPercentMs;
+        }
+    }
+
+    // Settled from the first sample after the last one outside the band
+    if (std::fabs(actualRpm - belt.targetRpm) > band)
+    {
+        belt.settled = false;
+        belt.settleMs = -1.0;
+    }
+    else if (!belt.settled)
+    {
+        belt.settled = true;
+        belt.settleMs = elapsedMs;
+    }
+}
+
+bool RunAnalytics::matchesStep(size_t index, const TelemetryData &data) const
+{
+    const CompiledStep &step = m_plan[index];
+    return std::fabs(data.targetRpm1 - step.leftMilli / 1000.0f) < TARGET_MATCH_RPM &&
+           std::fabs(data.targetRpm2 - step.rightMilli / 1000.0f) < TARGET_MATCH_RPM;
+}
+
+void RunAnalytics::writeCsvHeader(std::ostream &out, bool deviceColumn)
+{
+    if (deviceColumn)
+    {
+        out << "Device,";
+    }
+    out << "Step,TargetL,TargetR,PlannedMs,StartMs,Samples,MeanErrL,MeanErrR,StdErrL,StdErrR,RmsErrL,RmsErrR,"
+           "RiseMsL,RiseMsR,SettleMsL,SettleMsR,AsymMean,AsymRms\n";
+}
+
+void RunAnalytics::writeCsvRows(std::ostream &out, const RunAnalyticsSnapshot &snapshot)
+{
+    for (const StepAnalytics &step : snapshot.steps)
+    {
+        out << step.index << ", " << step.left.targetRpm << ", " << step.right.targetRpm << ", "
+            << step.plannedMs << ", " << step.startMs << ", " << step.left.error.count() << ", ";
+        writeStats(out, step.left.error, step.right.error);
+        writeTime(out, step.left.riseMs);
+        out << ", ";
+        writeTime(out, step.right.riseMs);
+        out << ", ";
+        writeTime(out, step.left.settleMs);
+        out << ", ";
+        writeTime(out, step.right.settleMs);
+        out << ", " << step.asymmetry.mean() << ", " << step.asymmetry.rms() << "\n";
+    }
+
+    out << "all, , , , , " << snapshot.samples << ", ";
+    writeStats(out, snapshot.errorLeft, snapshot.errorRight);
+    out << ", , , , " << snapshot.asymmetry.mean() << ", " << snapshot.asymmetry.rms() << "\n";
+}
+
+std::string RunAnalytics::stepsPathFor(const std::string &recordingPath)
+{
+    std::string base = recordingPath;
+    if (base.size() >= 4 && base.compare(base.size() - 4, 4, ".csv") == 0)
+    {
+        base.resize(base.size() - 4);
+    }
+    return base + "_steps.csv";
+}
+
+void RunAnalytics::writeCsvRows(std::ostream &out, size_t deviceId, const RunAnalyticsSnapshot &snapshot)
+{
+    std::ostringstream rows;
+    writeCsvRows(rows, snapshot);
+
+    std::istringstream lines(rows.str());
+    std::string line;
+    while (std::getline(lines, line))
+    {
+        out << deviceId << ", " << line << "\n";
+    }
+}
@@ -0,0 +1,109 @@
+#pragma once
+#include "ProfileParser.h"
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+struct TelemetryData;
+
+/**
+ * Welford running mean/variance; RMS follows from the two without a separate sum
+ */
+class RunningStats
+{
+public:
+    void add(double value);
+
+    uint64_t count() const { return m_count; }
+    double mean() const { return m_mean; }
+    double variance() const { return m_count > 1 ? m_m2 / static_cast<double>(m_count - 1) : 0.0; }
+    double stddev() const;
+    double rms() const;
+    double min() const { return m_min; }
+    double max() const { return m_max; }
+
+private:
+    uint64_t m_count = 0;
+    double m_mean = 0.0;
+    double m_m2 = 0.0;
+    double m_min = 0.0;
+    double m_max = 0.0;
+};
+
+// Step response of one belt within one profile step (times in ms from the step's start, -1 = not reached)
+struct BeltStepResponse
+{
+    float startRpm = 0.0f;  // Actual speed when the step began
+    float targetRpm = 0.0f;
+    RunningStats error;     // actual - target
+    double riseMs = -1.0;   // 10% -> 90% of the change; -1 if the step is too small to rise
+    double settleMs = -1.0; // Entered the settle band for good (so far)
+
+    // Progress, kept so each sample is O(1)
+    double tenPercentMs = -1.0;
+    bool settled = false;
+};
+
+struct StepAnalytics
+{
+    size_t index = 0;
+    uint32_t plannedMs = 0;
+    uint32_t startMs = 0; // Device clock
+    uint32_t lastMs = 0;  // Device clock of the latest sample in the step
+    BeltStepResponse left;
+    BeltStepResponse right;
+    RunningStats asymmetry; // (actualL - actualR) - (targetL - targetR)
+};
+
+struct RunAnalyticsSnapshot
+{
+    bool planned = false;       // Steps are aligned to an uploaded profile
+    int currentStep = -1;       // Index into steps, -1 before the first sample
+    uint64_t samples = 0;
+    RunningStats errorLeft;     // Whole run
+    RunningStats errorRight;
+    RunningStats asymmetry;
+    std::vector<StepAnalytics> steps; // Only the steps reached so far
+};
+
+/**
+ * Incremental run analytics, fed one telemetry sample at a time
+ * Tracking error, rise and settle times and left/right asymmetry per profile
+ * step, in constant memory per step, so long sessions need no post-processing.
+ * Steps follow the profile's durations on the device clock and re-align
+ * whenever the reported targets switch to the next step's.
+ * A run without a profile (setpoint streaming) only keeps the whole-run figures.
+ */
+class RunAnalytics
+{
+public:
+    static constexpr float SETTLE_FRACTION = 0.02f; // Settle band: 2% of the step change...
+    static constexpr float SETTLE_MIN_RPM = 1.0f;   // ...but never narrower than this
+
+    // Start a new run; `plan` may be empty
+    void begin(const std::vector<CompiledStep> &plan);
+    void addSample(const TelemetryData &data);
+    RunAnalyticsSnapshot getSnapshot() const;
+
+    // One row per step plus a final whole-run row ("all"); blank cells are not available
+    static void writeCsvHeader(std::ostream &out, bool deviceColumn = false);
+    static void writeCsvRows(std::ostream &out, const RunAnalyticsSnapshot &snapshot);
+    static void writeCsvRows(std::ostream &out, size_t deviceId, const RunAnalyticsSnapshot &snapshot);
+    // Where the analytics of a recording are saved: run.csv -> run_steps.csv
+    static std::string stepsPathFor(const std::string &recordingPath);
+
+private:
+    void startStep(size_t index, uint32_t startMs);
+    static void startBelt(BeltStepResponse &belt, float startRpm, float targetRpm);
+    static void updateBelt(BeltStepResponse &belt, float actualRpm, double elapsedMs);
+    bool matchesStep(size_t index, const TelemetryData &data) const;
+
+    mutable std::mutex m_mutex;
+    std::vector<CompiledStep> m_plan;
+    RunAnalyticsSnapshot m_state;
+    float m_lastActualLeft = 0.0f;
+    float m_lastActualRight = 0.0f;
+};
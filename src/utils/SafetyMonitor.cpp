@@ -0,0 +1,366 @@
+#include "SafetyMonitor.h"
+#include "ClockSync.h"
+#include "TreadmillController.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <iostream>
+#include <sstream>
+
+namespace
+{
+    uint32_t clampMicros(int64_t micros)
+    {
+        return static_cast<uint32_t>(std::min<int64_t>(std::max<int64_t>(micros, 0), UINT32_MAX));
+    }
+
+    std::string trim(const std::string &text)
+    {
+        size_t begin = text.find_first_not_of(" \t\r");
+        if (begin == std::string::npos)
+        {
+            return "";
+        }
+        size_t end = text.find_last_not_of(" \t\r");
+        return text.substr(begin, end - begin + 1);
+    }
+
+    bool parseCondition(const std::string &name, SafetyCondition &condition)
+    {
+        for (SafetyCondition candidate : {SafetyCondition::DriverFault, SafetyCondition::EmergencyStop,
+                                          SafetyCondition::TrackingError, SafetyCondition::Asymmetry})
+        {
+            if (name == safetyConditionName(candidate))
+            {
+                condition = candidate;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool parseAction(const std::string &name, SafetyAction &action)
+    {
+        for (SafetyAction candidate : {SafetyAction::Stop, SafetyAction::Alarm, SafetyAction::Marker})
+        {
+            if (name == safetyActionName(candidate))
+            {
+                action = candidate;
+                return true;
+            }
+        }
+        return false;
+    }
+}
+
+const char *safetyConditionName(SafetyCondition condition)
+{
+    switch (condition)
+    {
+    case SafetyCondition::DriverFault:
+        return "driver_fault";
+    case SafetyCondition::EmergencyStop:
+        return "estop";
+    case SafetyCondition::TrackingError:
+        return "tracking";
+    case SafetyCondition::Asymmetry:
+        return "asymmetry";
+    }
+    return "unknown";
+}
+
+const char *safetyActionName(SafetyAction action)
+{
+    switch (action)
+    {
+    case SafetyAction::Stop:
+        return "stop";
+    case SafetyAction::Alarm:
+        return "alarm";
+    case SafetyAction::Marker:
+        return "marker";
+    }
+    return "unknown";
+}
+
+SafetyMonitor::SafetyMonitor()
+    : m_rules(defaultRules())
+{
+}
+
+std::vector<SafetyRule> SafetyMonitor::defaultRules()
+{
+    return {
+        {"Driver fault", SafetyCondition::DriverFault, SafetyAction::Stop, 0.0f, 0},
+        {"Emergency stop", SafetyCondition::EmergencyStop, SafetyAction::Stop, 0.0f, 0},
+        {"Speed tracking", SafetyCondition::TrackingError, SafetyAction::Alarm, 100.0f, 1000},
+        {"Belt asymmetry", SafetyCondition::Asymmetry, SafetyAction::Marker, 50.0f, 500},
+    };
+}
+
+std::vector<SafetyRule> SafetyMonitor::parseRules(const std::string &text)
+{
+    std::vector<SafetyRule> rules;
+    std::istringstream stream(text);
+    std::string line;
+    int lineNumber = 0;
+
+    while (std::getline(stream, line))
+    {
+        lineNumber++;
+        line = trim(line.substr(0, line.find('#')));
+        if (line.empty())
+        {
+            continue;
+        }
+
+        std::vector<std::string> fields;
+        std::istringstream fieldStream(line);
+        std::string field;
+        while (std::getline(fieldStream, field, ','))
+        {
+            fields.push_back(trim(field));
+        }
+
+        SafetyRule rule;
+        bool valid = (fields.size() >= 3 && fields.size() <= 5 && !fields[0].empty() &&
+                      parseCondition(fields[1], rule.condition) && parseAction(fields[2], rule.action));
+        try
+        {
+            if (valid && fields.size() >= 4)
+            {
+                rule.thresholdRpm = std::stof(fields[3]);
+            }
+            if (valid && fields.size() == 5)
+            {
+                rule.holdMs = static_cast<uint32_t>(std::stoul(fields[4]));
+            }
+        }
+        catch (const std::exception &)
+        {
+            valid = false;
+        }
+
+        if (!valid || rule.thresholdRpm < 0.0f)
+        {
+            std::cerr << "Warning: Safety rule on line " << lineNumber << " is invalid, skipping: " << line << std::endl;
+            continue;
+        }
+        rule.name = fields[0];
+        rules.push_back(rule);
+    }
+    return rules;
+}
+
+void SafetyMonitor::setRules(std::vector<SafetyRule> rules)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_rules = std::move(rules);
+    m_states.clear();
+}
+
+std::vector<SafetyRule> SafetyMonitor::getRules() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_rules;
+}
+
+void SafetyMonitor::setEventCallback(EventCallback callback)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_eventCallback = std::move(callback);
+}
+
+bool SafetyMonitor::check(const SafetyRule &rule, const TelemetrySample &sample, std::string *detail)
+{
+    const TelemetryData &data = sample.data;
+    char text[96];
+
+    switch (rule.condition)
+    {
+    case SafetyCondition::DriverFault:
+        if (data.driver1Healthy && data.driver2Healthy)
+        {
+            return false;
+        }
+        if (detail)
+        {
+            *detail = !data.driver1Healthy && !data.driver2Healthy ? "both drivers unhealthy"
+                      : !data.driver1Healthy                       ? "left driver unhealthy"
+                                                                   : "right driver unhealthy";
+        }
+        return true;
+
+    case SafetyCondition::EmergencyStop:
+        if (detail && data.emergencyStop)
+        {
+            *detail = "emergency stop reported";
+        }
+        return data.emergencyStop;
+
+    case SafetyCondition::TrackingError:
+    {
+        // Belts coasting down after a stop are not a tracking error
+        if (data.targetRpm1 == 0.0f && data.targetRpm2 == 0.0f)
+        {
+            return false;
+        }
+        float left = std::fabs(data.actualRpm1 - data.targetRpm1);
+        float right = std::fabs(data.actualRpm2 - data.targetRpm2);
+        if (std::max(left, right) <= rule.thresholdRpm)
+        {
+            return false;
+        }
+        if (detail)
+        {
+            std::snprintf(text, sizeof(text), "%s belt %.1f RPM off target", left >= right ? "left" : "right",
+                          std::max(left, right));
+            *detail = text;
+        }
+        return true;
+    }
+
+    case SafetyCondition::Asymmetry:
+    {
+        if (data.targetRpm1 == 0.0f && data.targetRpm2 == 0.0f)
+        {
+            return false;
+        }
+        float commanded = data.targetRpm1 - data.targetRpm2;
+        float actual = data.actualRpm1 - data.actualRpm2;
+        if (std::fabs(actual - commanded) <= rule.thresholdRpm)
+        {
+            return false;
+        }
+        if (detail)
+        {
+            std::snprintf(text, sizeof(text), "left-right %.1f RPM, commanded %.1f RPM", actual, commanded);
+            *detail = text;
+        }
+        return true;
+    }
+    }
+    return false;
+}
+
+std::vector<SafetyEvent> SafetyMonitor::evaluate(const TelemetrySample &sample)
+{
+    int64_t startUs = ClockSync::hostNowUs();
+    std::vector<SafetyEvent> events;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        std::vector<RuleState> &states = m_states[sample.deviceId];
+        states.resize(m_rules.size());
+
+        for (size_t i = 0; i < m_rules.size(); ++i)
+        {
+            const SafetyRule &rule = m_rules[i];
+            RuleState &state = states[i];
+
+            if (!check(rule, sample, nullptr))
+            {
+                state.active = false;
+                state.fired = false;
+                continue;
+            }
+            if (!state.active)
+            {
+                state.active = true;
+                state.sinceMs = sample.data.timestamp;
+            }
+            // Unsigned difference: correct across the device clock's 49-day wrap
+            if (state.fired || sample.data.timestamp - state.sinceMs < rule.holdMs)
+            {
+                continue;
+            }
+            state.fired = true;
+
+            SafetyEvent event;
+            event.deviceId = sample.deviceId;
+            event.rule = rule.name;
+            event.action = rule.action;
+            event.timestamp = sample.data.timestamp;
+            event.sampleArrivalUs = sample.data.hostArrivalUs;
+            check(rule, sample, &event.detail);
+            events.push_back(std::move(event));
+        }
+    }
+
+    m_samples.fetch_add(1, std::memory_order_relaxed);
+    m_evaluation.record(clampMicros(ClockSync::hostNowUs() - startUs));
+    return events;
+}
+
+void SafetyMonitor::complete(SafetyEvent &event)
+{
+    event.actionUs = ClockSync::hostNowUs();
+    uint32_t latencyUs = clampMicros(event.actionUs - event.sampleArrivalUs);
+    m_sampleToAction.record(latencyUs);
+    if (latencyUs > ACTION_BUDGET_US)
+    {
+        m_overBudget++;
+    }
+
+    switch (event.action)
+    {
+    case SafetyAction::Stop:
+        m_stops++;
+        break;
+    case SafetyAction::Alarm:
+        m_alarms++;
+        break;
+    case SafetyAction::Marker:
+        m_markers++;
+        break;
+    }
+
+    EventCallback callback;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_events.push_back(event);
+        if (m_events.size() > EVENT_LOG_SIZE)
+        {
+            m_events.pop_front();
+        }
+        callback = m_eventCallback;
+    }
+    if (callback)
+    {
+        callback(event);
+    }
+}
+
+SafetyStats SafetyMonitor::getStats() const
+{
+    SafetyStats stats;
+    stats.samples = m_samples;
+    stats.stops = m_stops;
+    stats.alarms = m_alarms;
+    stats.markers = m_markers;
+    stats.overBudget = m_overBudget;
+    stats.evaluation = m_evaluation.summarize();
+    stats.sampleToAction = m_sampleToAction.summarize();
+    return stats;
+}
+
+std::vector<SafetyEvent> SafetyMonitor::getEvents() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return std::vector<SafetyEvent>(m_events.begin(), m_events.end());
+}
+
+void SafetyMonitor::reset()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_states.clear();
+        m_events.clear();
+    }
+    m_samples = 0;
+    m_stops = 0;
+    m_alarms = 0;
+    m_markers = 0;
+    m_overBudget = 0;
+    m_evaluation.reset();
+    m_sampleToAction.reset();
+}
@@ -0,0 +1,130 @@
+#pragma once
+#include "LatencyHistogram.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+struct TelemetrySample;
+
+// What a safety rule watches for
+enum class SafetyCondition : uint8_t
+{
+    DriverFault,   // Either motor driver reports unhealthy
+    EmergencyStop, // The firmware reports its emergency stop
+    TrackingError, // |actual - target| on either belt above thresholdRpm
+    Asymmetry      // Left/right difference strays from the commanded one by more than thresholdRpm
+};
+
+// What happens when a rule fires
+enum class SafetyAction : uint8_t
+{
+    Stop,  // Priority STOP_TM from the I/O thread, ahead of everything else
+    Alarm, // Reported to the operator
+    Marker // Logged against the device timestamp only
+};
+
+const char *safetyConditionName(SafetyCondition condition);
+const char *safetyActionName(SafetyAction action);
+
+struct SafetyRule
+{
+    std::string name;
+    SafetyCondition condition = SafetyCondition::DriverFault;
+    SafetyAction action = SafetyAction::Alarm;
+    float thresholdRpm = 0.0f; // TrackingError / Asymmetry
+    uint32_t holdMs = 0;       // Condition must persist this long (device clock) before the rule fires
+};
+
+struct SafetyEvent
+{
+    size_t deviceId = 0;
+    std::string rule;
+    SafetyAction action = SafetyAction::Alarm;
+    uint32_t timestamp = 0;      // Device clock (ms) of the sample that fired the rule
+    int64_t sampleArrivalUs = 0; // When that sample reached the host
+    int64_t actionUs = 0;        // When the action had been carried out
+    std::string detail;
+};
+
+struct SafetyStats
+{
+    uint64_t samples = 0;
+    uint64_t stops = 0;
+    uint64_t alarms = 0;
+    uint64_t markers = 0;
+    uint64_t overBudget = 0;        // Actions slower than ACTION_BUDGET_US
+    LatencySummary evaluation;      // Rule evaluation per sample
+    LatencySummary sampleToAction;  // Sample arrival -> action carried out
+};
+
+/**
+ * Safety rules evaluated on every telemetry sample
+ * The controller calls evaluate() on the I/O thread as soon as a TEL frame is
+ * parsed, before the sample is published, and carries out Stop actions itself.
+ * Hold times use the device clock, so a recorded session replays exactly the
+ * same decisions. A rule fires once when its condition has held for holdMs and
+ * re-arms when the condition clears. One monitor can watch several devices.
+ */
+class SafetyMonitor
+{
+public:
+    // Sample arrival to action done; a stop must be on the wire within one telemetry period
+    static constexpr uint32_t ACTION_BUDGET_US = 1000;
+    static constexpr size_t EVENT_LOG_SIZE = 256;
+
+    using EventCallback = std::function<void(const SafetyEvent &)>;
+
+    SafetyMonitor();
+
+    // Driver fault and emergency stop stop the belts; tracking error alarms; asymmetry is marked
+    static std::vector<SafetyRule> defaultRules();
+    // One "name, condition, action[, thresholdRpm[, holdMs]]" rule per line; # starts a comment.
+    // Conditions: driver_fault, estop, tracking, asymmetry. Actions: stop, alarm, marker.
+    static std::vector<SafetyRule> parseRules(const std::string &text);
+
+    // Replaces the rules and forgets every device's rule state
+    void setRules(std::vector<SafetyRule> rules);
+    std::vector<SafetyRule> getRules() const;
+    // Called on the I/O thread for every completed event (keep it short)
+    void setEventCallback(EventCallback callback);
+
+    // The rules this sample fired (usually none); carry each out, then complete() it
+    std::vector<SafetyEvent> evaluate(const TelemetrySample &sample);
+    // Stamps the action time, records its latency, logs the event and notifies the callback
+    void complete(SafetyEvent &event);
+
+    SafetyStats getStats() const;
+    // The last EVENT_LOG_SIZE events, oldest first
+    std::vector<SafetyEvent> getEvents() const;
+    void reset();
+
+private:
+    struct RuleState
+    {
+        bool active = false; // Condition currently true
+        bool fired = false;  // Already fired since it became true
+        uint32_t sinceMs = 0;
+    };
+
+    static bool check(const SafetyRule &rule, const TelemetrySample &sample, std::string *detail);
+
+    mutable std::mutex m_mutex;
+    std::vector<SafetyRule> m_rules;
+    std::map<size_t, std::vector<RuleState>> m_states; // Per device, parallel to m_rules
+    std::deque<SafetyEvent> m_events;
+    EventCallback m_eventCallback;
+
+    std::atomic<uint64_t> m_samples{0};
+    std::atomic<uint64_t> m_stops{0};
+    std::atomic<uint64_t> m_alarms{0};
+    std::atomic<uint64_t> m_markers{0};
+    std::atomic<uint64_t> m_overBudget{0};
+    LatencyHistogram m_evaluation;
+    LatencyHistogram m_sampleToAction;
+};
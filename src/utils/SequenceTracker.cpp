@@ -0,0 +1,94 @@
+#include "SequenceTracker.h"
+#include <algorithm>
+
+SequenceTracker::Result SequenceTracker::track(uint16_t sequence)
+{
+    Result result;
+
+    if (!m_started)
+    {
+        m_started = true;
+        m_highest = sequence;
+        m_seen = 1;
+        m_span = 1;
+        m_received.fetch_add(1, std::memory_order_relaxed);
+        return result;
+    }
+
+    uint16_t ahead = static_cast<uint16_t>(sequence - m_highest);
+
+    // Forward (modulo 2^16): in order, or after a gap
+    if (ahead != 0 && ahead < 0x8000)
+    {
+        result.missing = static_cast<uint16_t>(ahead - 1);
+        result.verdict = (result.missing == 0) ? Verdict::InOrder : Verdict::Gap;
+        if (result.missing > 0)
+        {
+            m_lost.fetch_add(result.missing, std::memory_order_relaxed);
+            m_gaps.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        m_seen = (ahead < HISTORY) ? (m_seen << ahead) | 1 : 1;
+        m_span = static_cast<uint16_t>(std::min<uint32_t>(HISTORY, uint32_t{m_span} + ahead));
+        m_highest = sequence;
+        m_received.fetch_add(1, std::memory_order_relaxed);
+        return result;
+    }
+
+    // Backward (or equal): duplicate, late arrival, or the device started over
+    uint16_t behind = static_cast<uint16_t>(m_highest - sequence);
+    if (behind >= HISTORY)
+    {
+        m_resyncs.fetch_add(1, std::memory_order_relaxed);
+        m_started = false;
+        return track(sequence);
+    }
+
+    // Older than the first tracked frame: it was never counted as lost
+    bool tracked = behind < m_span;
+    uint64_t bit = uint64_t{1} << behind;
+    if (tracked && (m_seen & bit))
+    {
+        result.verdict = Verdict::Duplicate;
+        m_duplicates.fetch_add(1, std::memory_order_relaxed);
+        return result;
+    }
+
+    result.verdict = Verdict::Late;
+    m_reordered.fetch_add(1, std::memory_order_relaxed);
+    m_received.fetch_add(1, std::memory_order_relaxed);
+    if (tracked)
+    {
+        m_seen |= bit;
+        m_lost.fetch_sub(1, std::memory_order_relaxed);
+    }
+    return result;
+}
+
+SequenceStats SequenceTracker::getStats() const
+{
+    SequenceStats stats;
+    stats.received = m_received.load(std::memory_order_relaxed);
+    stats.lost = m_lost.load(std::memory_order_relaxed);
+    stats.gaps = m_gaps.load(std::memory_order_relaxed);
+    stats.duplicates = m_duplicates.load(std::memory_order_relaxed);
+    stats.reordered = m_reordered.load(std::memory_order_relaxed);
+    stats.corrupted = m_corrupted.load(std::memory_order_relaxed);
+    stats.resyncs = m_resyncs.load(std::memory_order_relaxed);
+    return stats;
+}
+
+void SequenceTracker::reset()
+{
+    m_started = false;
+    m_highest = 0;
+    m_seen = 0;
+    m_span = 0;
+    m_received.store(0, std::memory_order_relaxed);
+    m_lost.store(0, std::memory_order_relaxed);
+    m_gaps.store(0, std::memory_order_relaxed);
+    m_duplicates.store(0, std::memory_order_relaxed);
+    m_reordered.store(0, std::memory_order_relaxed);
+    m_corrupted.store(0, std::memory_order_relaxed);
+    m_resyncs.store(0, std::memory_order_relaxed);
+}
@@ -0,0 +1,60 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+
+struct SequenceStats
+{
+    uint64_t received = 0;   // Frames accepted (first, in order, after a gap, or late)
+    uint64_t lost = 0;       // Frames never seen (late arrivals are taken back out)
+    uint64_t gaps = 0;       // Separate loss events
+    uint64_t duplicates = 0; // Frames seen twice (dropped)
+    uint64_t reordered = 0;  // Frames that arrived after a later one
+    uint64_t corrupted = 0;  // Unparseable TEL lines
+    uint64_t resyncs = 0;    // Sequence jumped backwards too far, e.g. device restart
+};
+
+/**
+ * Gap, duplicate and reorder detection for the 16-bit TEL sequence counter
+ * track() is called from the I/O thread only; counters are atomics so
+ * getStats() can be read from any thread.
+ */
+class SequenceTracker
+{
+public:
+    enum class Verdict
+    {
+        First,     // No history yet (start of run or resync)
+        InOrder,   // Exactly the expected frame
+        Gap,       // Later than expected; `missing` frames were lost
+        Late,      // Earlier frame that had been counted lost
+        Duplicate  // Already seen; caller should drop it
+    };
+
+    struct Result
+    {
+        Verdict verdict = Verdict::First;
+        uint16_t missing = 0;
+    };
+
+    static constexpr uint16_t HISTORY = 64; // Frames remembered for duplicate/late detection
+
+    Result track(uint16_t sequence);
+    void recordCorrupted() { m_corrupted.fetch_add(1, std::memory_order_relaxed); }
+
+    SequenceStats getStats() const;
+    void reset();
+
+private:
+    bool m_started = false;
+    uint16_t m_highest = 0;
+    uint64_t m_seen = 0;  // Bit i set: (m_highest - i) has arrived
+    uint16_t m_span = 0;  // Positions tracked since the first frame, up to HISTORY
+
+    std::atomic<uint64_t> m_received{0};
+    std::atomic<uint64_t> m_lost{0};
+    std::atomic<uint64_t> m_gaps{0};
+    std::atomic<uint64_t> m_duplicates{0};
+    std::atomic<uint64_t> m_reordered{0};
+    std::atomic<uint64_t> m_corrupted{0};
+    std::atomic<uint64_t> m_resyncs{0};
+};
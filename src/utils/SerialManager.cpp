@@ -1,8 +1,27 @@
 #include "SerialManager.h"
+#include "Trace.h"
 #include <iostream>
 
+#ifndef _WIN32
+#include <termios.h>
+#endif
+
+#ifdef __linux__
+#include <filesystem>
+#include <fstream>
+#include <linux/serial.h>
+#include <sys/ioctl.h>
+#endif
+
 SerialManager::SerialManager()
-    : m_ioContext(std::make_unique<asio::io_context>()), m_baudRate(0), m_timeoutMs(DEFAULT_TIMEOUT_MS), m_isListening(false)
+    : m_ioContext(std::make_unique<asio::io_context>()), m_strand(asio::make_strand(*m_ioContext)),
+      m_baudRate(0), m_timeoutMs(DEFAULT_TIMEOUT_MS), m_isListening(false)
+{
+}
+
+SerialManager::SerialManager(std::shared_ptr<IoThreadPool> pool)
+    : m_pool(std::move(pool)), m_strand(asio::make_strand(m_pool->getContext())),
+      m_baudRate(0), m_timeoutMs(DEFAULT_TIMEOUT_MS), m_isListening(false)
 {
 }
 
@@ -12,7 +31,7 @@ SerialManager::~SerialManager()
     disconnect();
 }
 
-bool SerialManager::initialize(const std::string &portName, unsigned int baudRate, int timeoutMs)
+bool SerialManager::initialize(const std::string &portName, unsigned int baudRate, int timeoutMs, bool lowLatency)
 {
     try
     {
@@ -23,9 +42,10 @@ bool SerialManager::initialize(const std::string &portName, unsigned int baudRat
         m_portName = portName;
         m_baudRate = baudRate;
         m_timeoutMs = timeoutMs;
+        m_lowLatency = lowLatency;
 
         // Create new serial port
-        m_serialPort = std::make_unique<asio::serial_port>(*m_ioContext, portName);
+        m_serialPort = std::make_unique<asio::serial_port>(getIoContext(), portName);
 
         // Configure serial port settings
         m_serialPort->set_option(asio::serial_port_base::baud_rate(baudRate));
@@ -34,6 +54,11 @@ bool SerialManager::initialize(const std::string &portName, unsigned int baudRat
         m_serialPort->set_option(asio::serial_port_base::stop_bits(asio::serial_port_base::stop_bits::one));
         m_serialPort->set_option(asio::serial_port_base::flow_control(asio::serial_port_base::flow_control::none));
 
+        if (m_lowLatency)
+        {
+            applyLowLatency();
+        }
+
         // Verify connection
         if (m_serialPort->is_open())
         {
@@ -96,6 +121,18 @@ void SerialManager::startListening()
     }
 
     m_isListening = true;
+
+    if (m_pool)
+    {
+        // The pool's threads pick the reads up; nothing to start
+        {
+            std::lock_guard<std::mutex> lock(m_readStateMutex);
+            m_readPending = true;
+        }
+        startAsyncRead();
+        return;
+    }
+
     m_ioContext->restart();
 
     // Queue the first read
@@ -104,6 +141,7 @@ void SerialManager::startListening()
     // Start the worker thread
     m_listeningThread = std::thread([this]()
                                     {
+        Trace::setThreadName("ASIO I/O");
         try {
             m_ioContext->run();
         } catch (const std::exception& e) {
@@ -116,6 +154,44 @@ void SerialManager::stopListening()
     if (!m_isListening)
         return;
 
+    if (m_pool)
+    {
+        // From inside a handler the read chain ends by itself when that handler returns
+        if (m_strand.running_in_this_thread())
+        {
+            m_isListening = false;
+            if (m_serialPort)
+            {
+                m_serialPort->cancel();
+            }
+            return;
+        }
+
+        // The port is only touched on its strand, never concurrently with a read handler
+        {
+            std::lock_guard<std::mutex> lock(m_readStateMutex);
+            m_stopPending = true;
+        }
+        asio::post(m_strand, [this]()
+                   {
+            m_isListening = false;
+            if (m_serialPort)
+            {
+                m_serialPort->cancel();
+            }
+            std::lock_guard<std::mutex> lock(m_readStateMutex);
+            m_stopPending = false;
+            m_readStateCv.notify_all(); });
+
+        std::unique_lock<std::mutex> lock(m_readStateMutex);
+        if (!m_readStateCv.wait_for(lock, std::chrono::seconds(2), [this]()
+                                    { return !m_readPending && !m_stopPending; }))
+        {
+            std::cerr << "Timed out waiting for the listener on " << m_portName << " to stop" << std::endl;
+        }
+        return;
+    }
+
     // Check if we are calling stopListening from the listening thread itself
     if (std::this_thread::get_id() == m_listeningThread.get_id())
     {
@@ -152,26 +228,25 @@ void SerialManager::stopListening()
 void SerialManager::startAsyncRead()
 {
     if (!m_isListening || !isConnected())
+    {
+        finishListenerRead();
         return;
+    }
 
     asio::async_read_until(*m_serialPort, m_readBuffer, '\n',
-                           [this](const asio::error_code &ec, std::size_t bytes_transferred)
-                           {
+                           asio::bind_executor(m_strand, [this](const asio::error_code &ec, std::size_t bytes_transferred)
+                                               {
                                if (!m_isListening)
+                               {
+                                   finishListenerRead();
                                    return;
+                               }
 
                                if (!ec)
                                {
-                                   std::istream is(&m_readBuffer);
-                                   std::string line;
-                                   std::getline(is, line);
-
-                                   // Remove trailing \r, if it exists
-                                   if (!line.empty() && line.back() == '\r')
-                                   {
-                                       line.pop_back();
-                                   }
+                                   m_linkStats.recordRx(bytes_transferred);
 
+                                   std::string line = extractLine();
                                    if (m_telemetryCallback && !line.empty())
                                    {
                                        m_telemetryCallback(line);
@@ -180,11 +255,100 @@ void SerialManager::startAsyncRead()
                                    // Continue listening
                                    startAsyncRead();
                                }
-                               else if (ec != asio::error::operation_aborted)
+                               else
                                {
-                                   std::cerr << "Async read error: " << ec.message() << std::endl;
-                               }
-                           });
+                                   if (ec != asio::error::operation_aborted)
+                                   {
+                                       std::cerr << "Async read error: " << ec.message() << std::endl;
+                                   }
+                                   finishListenerRead();
+                               } }));
+}
+
+void SerialManager::finishListenerRead()
+{
+    // Last access to this object from the handler; stopListening may return right after
+    std::lock_guard<std::mutex> lock(m_readStateMutex);
+    m_readPending = false;
+    m_readStateCv.notify_all();
+}
+
+std::string SerialManager::extractLine()
+{
+    std::istream is(&m_readBuffer);
+    std::string line;
+    std::getline(is, line);
+
+    // Remove trailing \r, if it exists
+    if (!line.empty() && line.back() == '\r')
+    {
+        line.pop_back();
+    }
+    return line;
+}
+
+void SerialManager::applyLowLatency()
+{
+#ifdef __linux__
+    int fd = m_serialPort->native_handle();
+
+    // USB-serial drivers (ftdi_sio) drop their 16 ms latency timer to 1 ms with this flag.
+    // PTYs and some drivers do not support it, which is not an error.
+    serial_struct serial{};
+    if (::ioctl(fd, TIOCGSERIAL, &serial) == 0)
+    {
+        serial.flags |= ASYNC_LOW_LATENCY;
+        if (::ioctl(fd, TIOCSSERIAL, &serial) != 0)
+        {
+            std::cerr << "Low latency: ASYNC_LOW_LATENCY rejected by driver" << std::endl;
+        }
+    }
+
+    // Belt and braces for FTDI: the sysfs latency timer (needs write permission)
+    try
+    {
+        std::string device = std::filesystem::canonical(m_portName).filename().string();
+        std::filesystem::path timer = std::filesystem::path("/sys/class/tty") / device / "device" / "latency_timer";
+        if (std::filesystem::exists(timer))
+        {
+            std::ofstream(timer) << "1";
+        }
+    }
+    catch (const std::exception &)
+    {
+        // Not a USB adapter, or no permission
+    }
+
+    // Fully raw line discipline; a read returns as soon as one byte is available
+    termios tio{};
+    if (::tcgetattr(fd, &tio) == 0)
+    {
+        ::cfmakeraw(&tio);
+        tio.c_cflag |= CLOCAL | CREAD;
+        tio.c_cc[VMIN] = 1;
+        tio.c_cc[VTIME] = 0;
+        ::tcsetattr(fd, TCSANOW, &tio);
+    }
+
+    std::cout << "Low-latency serial mode enabled on " << m_portName << std::endl;
+#else
+    std::cerr << "Low-latency serial mode is only available on Linux" << std::endl;
+#endif
+}
+
+void SerialManager::flushInput()
+{
+    if (!isConnected())
+    {
+        return;
+    }
+
+    m_readBuffer.consume(m_readBuffer.size());
+#ifdef _WIN32
+    ::PurgeComm(m_serialPort->native_handle(), PURGE_RXCLEAR);
+#else
+    ::tcflush(m_serialPort->native_handle(), TCIFLUSH);
+#endif
 }
 
 bool SerialManager::reconnect()
@@ -196,7 +360,28 @@ bool SerialManager::reconnect()
     }
 
     std::cout << "Attempting to reconnect to " << m_portName << std::endl;
-    return initialize(m_portName, m_baudRate, m_timeoutMs);
+    return initialize(m_portName, m_baudRate, m_timeoutMs, m_lowLatency);
+}
+
+bool SerialManager::setBaudRate(unsigned int baudRate)
+{
+    if (!isConnected())
+    {
+        return false;
+    }
+
+    try
+    {
+        m_serialPort->set_option(asio::serial_port_base::baud_rate(baudRate));
+        m_baudRate = baudRate;
+        std::cout << "Serial baud rate changed to " << baudRate << std::endl;
+        return true;
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << "Failed to set baud rate " << baudRate << ": " << e.what() << std::endl;
+        return false;
+    }
 }
 
 void SerialManager::sendCommand(std::string_view cmd)
@@ -207,7 +392,24 @@ void SerialManager::sendCommand(std::string_view cmd)
     }
 
     std::string message = std::string(cmd) + "\n";
+    std::lock_guard<std::mutex> lock(m_writeMutex);
+    asio::write(*m_serialPort, asio::buffer(message));
+    m_linkStats.recordTx(message.size());
+}
+
+void SerialManager::sendCommand(std::string_view cmd, const std::vector<uint8_t> &payload)
+{
+    if (!isConnected())
+    {
+        throw std::runtime_error("Serial connection not available");
+    }
+
+    std::vector<uint8_t> message(cmd.begin(), cmd.end());
+    message.push_back('\n');
+    message.insert(message.end(), payload.begin(), payload.end());
+    std::lock_guard<std::mutex> lock(m_writeMutex);
     asio::write(*m_serialPort, asio::buffer(message));
+    m_linkStats.recordTx(message.size());
 }
 
 std::optional<std::string> SerialManager::readResponse()
@@ -223,9 +425,13 @@ std::optional<std::string> SerialManager::readResponse(int timeoutMs)
         return std::nullopt;
     }
 
+    if (m_pool)
+    {
+        return readResponsePooled(timeoutMs);
+    }
+
     try
     {
-        asio::streambuf buffer;
         std::optional<std::string> result;
         bool completed = false;
         asio::error_code readError;
@@ -235,7 +441,9 @@ std::optional<std::string> SerialManager::readResponse(int timeoutMs)
         timer.expires_after(std::chrono::milliseconds(timeoutMs));
 
         // Start async read
-        asio::async_read_until(*m_serialPort, buffer, '\n',
+        // Shares the listener's buffer: async_read_until completes at once
+        // when an earlier read already pulled in a whole line
+        asio::async_read_until(*m_serialPort, m_readBuffer, '\n',
                                [&](const asio::error_code &ec, std::size_t bytes_transferred)
                                {
                                    if (!completed)
@@ -246,15 +454,8 @@ std::optional<std::string> SerialManager::readResponse(int timeoutMs)
 
                                        if (!ec && bytes_transferred > 0)
                                        {
-                                           std::istream is(&buffer);
-                                           std::string line;
-                                           std::getline(is, line);
-                                           // Remove trailing \r, if it exists
-                                           if (!line.empty() && line.back() == '\r')
-                                           {
-                                               line.pop_back();
-                                           }
-                                           result = line;
+                                           m_linkStats.recordRx(bytes_transferred);
+                                           result = extractLine();
                                        }
                                    }
                                });
@@ -265,8 +466,9 @@ std::optional<std::string> SerialManager::readResponse(int timeoutMs)
                 if (!completed && !ec)
                 {
                     completed = true;
-                    // Only log timeout if its unusually long
+                    // Only log (and count) timeout if its unusually long; short reads are polls
                     if (timeoutMs > 100) {
+                        m_linkStats.recordTimeout();
                         std::cerr << "Timeout waiting for response (" << timeoutMs << "ms)" << std::endl;
                     }
                     m_serialPort->cancel();
@@ -295,6 +497,76 @@ std::optional<std::string> SerialManager::readResponse(int timeoutMs)
     }
 }
 
+std::optional<std::string> SerialManager::readResponsePooled(int timeoutMs)
+{
+    // Same read-or-timeout race as above, but the pool runs it: this thread only waits.
+    // Both handlers touch this frame, so the wait is for both of them, not just the first.
+    struct PendingRead
+    {
+        std::mutex mutex;
+        std::condition_variable cv;
+        int outstanding = 2;
+        bool completed = false;
+        asio::error_code error;
+        std::optional<std::string> result;
+    } pending;
+
+    asio::steady_timer timer(m_strand);
+    auto finish = [&pending]()
+    {
+        std::lock_guard<std::mutex> lock(pending.mutex);
+        if (--pending.outstanding == 0)
+        {
+            pending.cv.notify_all();
+        }
+    };
+
+    // Started on the strand so the read handler cannot cancel the timer before it is armed
+    asio::dispatch(m_strand, [&]()
+                   {
+        asio::async_read_until(*m_serialPort, m_readBuffer, '\n',
+                               asio::bind_executor(m_strand, [&](const asio::error_code &ec, std::size_t bytes_transferred)
+                                                   {
+            if (!pending.completed)
+            {
+                pending.completed = true;
+                pending.error = ec;
+                timer.cancel();
+
+                if (!ec && bytes_transferred > 0)
+                {
+                    m_linkStats.recordRx(bytes_transferred);
+                    pending.result = extractLine();
+                }
+            }
+            finish(); }));
+
+        timer.expires_after(std::chrono::milliseconds(timeoutMs));
+        timer.async_wait([&](const asio::error_code &ec)
+                         {
+            if (!pending.completed && !ec)
+            {
+                pending.completed = true;
+                if (timeoutMs > 100)
+                {
+                    m_linkStats.recordTimeout();
+                    std::cerr << "Timeout waiting for response (" << timeoutMs << "ms)" << std::endl;
+                }
+                m_serialPort->cancel();
+            }
+            finish(); }); });
+
+    std::unique_lock<std::mutex> lock(pending.mutex);
+    pending.cv.wait(lock, [&pending]()
+                    { return pending.outstanding == 0; });
+
+    if (pending.error && pending.error != asio::error::operation_aborted)
+    {
+        std::cerr << "Error reading response: " << pending.error.message() << std::endl;
+    }
+    return pending.error ? std::nullopt : pending.result;
+}
+
 void SerialManager::setTelemetryCallback(std::function<void(const std::string &)> callback)
 {
     m_telemetryCallback = callback;
@@ -6,11 +6,18 @@
 #include <functional>
 #include <thread>
 #include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <vector>
 #include <asio.hpp>
+#include "IoThreadPool.h"
+#include "LinkStats.h"
 
 /**
  * Low-level serial communication manager
  * Handles serial port connection, configuration, and basic I/O operations
+ * Runs either on a private io_context with its own listening thread, or on a
+ * shared IoThreadPool where this port's handlers are serialised by a strand
  */
 class SerialManager
 {
@@ -18,11 +25,14 @@ public:
     static constexpr int DEFAULT_TIMEOUT_MS = 5000;
 
 private:
+    std::shared_ptr<IoThreadPool> m_pool;          // Null: private io_context below
     std::unique_ptr<asio::io_context> m_ioContext;
+    asio::strand<asio::io_context::executor_type> m_strand;
     std::unique_ptr<asio::serial_port> m_serialPort;
     std::string m_portName;
     unsigned int m_baudRate;
     int m_timeoutMs;
+    bool m_lowLatency = false;
 
     std::function<void(const std::string &)> m_telemetryCallback;
 
@@ -31,35 +41,70 @@ private:
     std::atomic<bool> m_isListening{false};
     asio::streambuf m_readBuffer;
 
+    // Pooled mode has no thread to join: stopListening waits for the last read handler instead
+    std::mutex m_readStateMutex;
+    std::condition_variable m_readStateCv;
+    bool m_readPending = false;
+    bool m_stopPending = false; // stopListening's cancel is queued on the strand
+
+    LinkStats m_linkStats;
+
+    // Heartbeat, setpoint stream and UI may all write; lines must not interleave
+    std::mutex m_writeMutex;
+
     void startAsyncRead();
+    void finishListenerRead();
+    std::string extractLine();
+    std::optional<std::string> readResponsePooled(int timeoutMs);
+    void applyLowLatency();
 
 public:
     SerialManager();
+    // Share the pool's threads; no thread is started for this port
+    explicit SerialManager(std::shared_ptr<IoThreadPool> pool);
     ~SerialManager();
 
     // Connection management
-    bool initialize(const std::string &portName, unsigned int baudRate, int timeoutMs = DEFAULT_TIMEOUT_MS);
+    // lowLatency (Linux): ASYNC_LOW_LATENCY / 1 ms USB latency timer, raw termios, tcflush purging
+    bool initialize(const std::string &portName, unsigned int baudRate, int timeoutMs = DEFAULT_TIMEOUT_MS,
+                    bool lowLatency = false);
     bool isConnected() const;
     void disconnect();
     bool reconnect();
+    // Retune an open port, e.g. after the device acknowledged BAUD
+    bool setBaudRate(unsigned int baudRate);
 
-    // Basic I/O operations
+    // Basic I/O operations (sendCommand is safe to call from several threads)
     void sendCommand(std::string_view cmd);
+    // Command line followed directly by a binary payload, in one write
+    void sendCommand(std::string_view cmd, const std::vector<uint8_t> &payload);
     std::optional<std::string> readResponse();
+    // Lines that arrive together are kept for the next call rather than discarded
     std::optional<std::string> readResponse(int timeoutMs);
+    // Discard everything received but not yet read (kernel and listener buffers)
+    void flushInput();
 
     // Async Listening Mode
     void startListening();
     void stopListening();
+    bool isListening() const { return m_isListening; }
 
     // Configuration
     void setTelemetryCallback(std::function<void(const std::string &)> callback);
 
+    // Link counters and round-trip latency
+    LinkStats &getLinkStats() { return m_linkStats; }
+    const LinkStats &getLinkStats() const { return m_linkStats; }
+
     // Access to io_context for advanced async operations
-    asio::io_context &getIoContext() { return *m_ioContext; }
+    asio::io_context &getIoContext() { return m_pool ? m_pool->getContext() : *m_ioContext; }
+    // Timers bound to this strand never run concurrently with the port's read handlers
+    const asio::strand<asio::io_context::executor_type> &getStrand() const { return m_strand; }
+    bool isPooled() const { return m_pool != nullptr; }
 
     // Getters
     const std::string &getPortName() const { return m_portName; }
     unsigned int getBaudRate() const { return m_baudRate; }
     int getTimeoutMs() const { return m_timeoutMs; }
+    bool isLowLatency() const { return m_lowLatency; }
 };
\ No newline at end of file
@@ -0,0 +1,411 @@
+#include "SessionJournal.h"
+#include "ClockSync.h"
+#include "Crc16.h"
+#include "TelemetryCodec.h"
+#include "TelemetryCsv.h"
+#include "Trace.h"
+#include <algorithm>
+#include <ctime>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <system_error>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace
+{
+    // File: "TMJ1", u16 version, u16 header size, u64 creation time (unix seconds)
+    constexpr uint32_t FILE_MAGIC = 0x314A4D54;
+    constexpr uint16_t VERSION = 1;
+    constexpr size_t FILE_HEADER_BYTES = 16;
+
+    // Block: u32 magic, u32 sequence, u32 sample count, u32 payload bytes, u16 CRC of the
+    // first 16 header bytes and the payload, u16 reserved; then the TelemetryCodec payload
+    constexpr uint32_t BLOCK_MAGIC = 0x424A4D54; // "TMJB"
+    constexpr uint32_t END_MAGIC = 0x454A4D54;   // "TMJE", no payload
+    constexpr size_t BLOCK_HEADER_BYTES = 20;
+
+    void put16(uint8_t *out, uint16_t value)
+    {
+        out[0] = static_cast<uint8_t>(value);
+        out[1] = static_cast<uint8_t>(value >> 8);
+    }
+
+    void put32(uint8_t *out, uint32_t value)
+    {
+        for (int i = 0; i < 4; ++i)
+        {
+            out[i] = static_cast<uint8_t>(value >> (8 * i));
+        }
+    }
+
+    uint16_t get16(const uint8_t *in)
+    {
+        return static_cast<uint16_t>(in[0] | in[1] << 8);
+    }
+
+    uint32_t get32(const uint8_t *in)
+    {
+        uint32_t value = 0;
+        for (int i = 0; i < 4; ++i)
+        {
+            value |= static_cast<uint32_t>(in[i]) << (8 * i);
+        }
+        return value;
+    }
+
+    uint32_t clampMicros(int64_t micros)
+    {
+        return static_cast<uint32_t>(std::min<int64_t>(std::max<int64_t>(micros, 0), UINT32_MAX));
+    }
+
+    // Reads a block header; false at end of file or if it is not one
+    bool readBlockHeader(std::ifstream &in, uint8_t header[BLOCK_HEADER_BYTES])
+    {
+        in.read(reinterpret_cast<char *>(header), BLOCK_HEADER_BYTES);
+        if (in.gcount() != static_cast<std::streamsize>(BLOCK_HEADER_BYTES))
+        {
+            return false;
+        }
+        uint32_t magic = get32(header);
+        return magic == BLOCK_MAGIC || magic == END_MAGIC;
+    }
+}
+
+SessionJournal::~SessionJournal()
+{
+    close();
+}
+
+bool SessionJournal::open(const std::string &path)
+{
+    close();
+
+    std::error_code error;
+    std::filesystem::path parent = std::filesystem::path(path).parent_path();
+    if (!parent.empty())
+    {
+        std::filesystem::create_directories(parent, error);
+    }
+
+    m_file = std::fopen(path.c_str(), "wb");
+    if (!m_file)
+    {
+        std::cerr << "Warning: Could not create session journal " << path << std::endl;
+        return false;
+    }
+    m_path = path;
+
+    uint8_t header[FILE_HEADER_BYTES] = {};
+    put32(header, FILE_MAGIC);
+    put16(header + 4, VERSION);
+    put16(header + 6, static_cast<uint16_t>(FILE_HEADER_BYTES));
+    uint64_t created = static_cast<uint64_t>(std::time(nullptr));
+    put32(header + 8, static_cast<uint32_t>(created));
+    put32(header + 12, static_cast<uint32_t>(created >> 32));
+
+    m_sequence = 0;
+    m_offset = 0;
+    m_syncedOffset = 0;
+    m_failed = false;
+    m_samples = 0;
+    m_blocks = 0;
+    m_dropped = 0;
+    m_payloadBytes = 0;
+    m_deviceBytes = 0;
+    m_syncLatency.reset();
+    m_durableLatency.reset();
+    if (std::fwrite(header, 1, sizeof(header), m_file) != sizeof(header) || !sync())
+    {
+        std::cerr << "Warning: Could not write session journal " << path << std::endl;
+        std::fclose(m_file);
+        m_file = nullptr;
+        return false;
+    }
+    m_offset = m_syncedOffset = sizeof(header);
+    m_fileBytes = sizeof(header);
+
+    m_stopping = false;
+    m_writer = std::thread([this]()
+                           { writerLoop(); });
+    return true;
+}
+
+void SessionJournal::append(const TelemetrySample &sample)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_pending.size() >= MAX_PENDING)
+    {
+        m_dropped++;
+        return;
+    }
+    m_pending.push_back(sample);
+}
+
+void SessionJournal::close(bool keepFile)
+{
+    if (!m_file)
+    {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_cv.notify_one();
+    if (m_writer.joinable())
+    {
+        m_writer.join(); // Writes out what is still pending
+    }
+
+    bool complete = !m_failed && writeBlock(END_MAGIC, {}) && sync();
+    std::fclose(m_file);
+    m_file = nullptr;
+
+    if (!keepFile && complete)
+    {
+        std::error_code ignored;
+        std::filesystem::remove(m_path, ignored);
+    }
+}
+
+JournalStats SessionJournal::getStats() const
+{
+    JournalStats stats;
+    stats.samples = m_samples;
+    stats.blocks = m_blocks;
+    stats.dropped = m_dropped;
+    stats.payloadBytes = m_payloadBytes;
+    stats.fileBytes = m_fileBytes;
+    stats.deviceBytes = m_deviceBytes;
+    stats.sync = m_syncLatency.summarize();
+    stats.durable = m_durableLatency.summarize();
+    return stats;
+}
+
+void SessionJournal::writerLoop()
+{
+    Trace::setThreadName("Journal");
+    std::vector<TelemetrySample> batch;
+
+    while (true)
+    {
+        bool stopping;
+        batch.clear();
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_cv.wait_for(lock, SYNC_INTERVAL, [this]()
+                          { return m_stopping; });
+            // The emptied batch keeps its capacity for the next interval
+            std::swap(batch, m_pending);
+            stopping = m_stopping;
+        }
+
+        if (!batch.empty() && !m_failed)
+        {
+            TRACE_SCOPE("journalBlock");
+            if (writeBlock(BLOCK_MAGIC, batch) && sync())
+            {
+                m_samples += batch.size();
+                int64_t oldestUs = batch.front().data.hostArrivalUs;
+                if (oldestUs > 0)
+                {
+                    m_durableLatency.record(clampMicros(ClockSync::hostNowUs() - oldestUs));
+                }
+            }
+            else
+            {
+                std::cerr << "Error: Session journal " << m_path << " could not be written; journaling stopped" << std::endl;
+                m_failed = true;
+            }
+        }
+        if (m_failed)
+        {
+            m_dropped += batch.size();
+        }
+
+        if (stopping)
+        {
+            return;
+        }
+    }
+}
+
+bool SessionJournal::writeBlock(uint32_t magic, const std::vector<TelemetrySample> &samples)
+{
+    m_buffer.assign(BLOCK_HEADER_BYTES, 0);
+    if (!samples.empty())
+    {
+        TelemetryCodec::encode(samples.data(), samples.size(), m_buffer);
+    }
+    size_t payloadBytes = m_buffer.size() - BLOCK_HEADER_BYTES;
+
+    put32(m_buffer.data(), magic);
+    put32(m_buffer.data() + 4, m_sequence);
+    put32(m_buffer.data() + 8, static_cast<uint32_t>(samples.size()));
+    put32(m_buffer.data() + 12, static_cast<uint32_t>(payloadBytes));
+    uint16_t crc = Crc16::compute(m_buffer.data(), 16);
+    crc = Crc16::compute(m_buffer.data() + BLOCK_HEADER_BYTES, payloadBytes, crc);
+    put16(m_buffer.data() + 16, crc);
+
+    if (std::fwrite(m_buffer.data(), 1, m_buffer.size(), m_file) != m_buffer.size())
+    {
+        return false;
+    }
+    m_sequence++;
+    m_offset += m_buffer.size();
+    m_blocks++;
+    m_payloadBytes += payloadBytes;
+    m_fileBytes += m_buffer.size();
+    return true;
+}
+
+bool SessionJournal::sync()
+{
+    int64_t startUs = ClockSync::hostNowUs();
+    if (std::fflush(m_file) != 0)
+    {
+        return false;
+    }
+#ifdef _WIN32
+    bool synced = ::_commit(::_fileno(m_file)) == 0;
+#else
+    bool synced = ::fsync(::fileno(m_file)) == 0;
+#endif
+    m_syncLatency.record(clampMicros(ClockSync::hostNowUs() - startUs));
+
+    // The device rewrites every page the new bytes touch, including the partly filled last one
+    uint64_t firstPage = m_syncedOffset / PAGE_BYTES;
+    uint64_t endPage = (m_offset + PAGE_BYTES - 1) / PAGE_BYTES;
+    if (m_offset > m_syncedOffset)
+    {
+        m_deviceBytes += (endPage - firstPage) * PAGE_BYTES;
+    }
+    m_syncedOffset = m_offset;
+    return synced;
+}
+
+std::string SessionJournal::makePath(const std::string &directory)
+{
+    std::time_t now = std::time(nullptr);
+    char stamp[32];
+    std::strftime(stamp, sizeof(stamp), "%Y%m%d_%H%M%S", std::localtime(&now));
+
+    std::filesystem::path base = std::filesystem::path(directory) / ("session_" + std::string(stamp));
+    std::filesystem::path path = base.string() + EXTENSION;
+    for (int i = 2; std::filesystem::exists(path); ++i)
+    {
+        path = base.string() + "_" + std::to_string(i) + EXTENSION;
+    }
+    return path.string();
+}
+
+std::vector<std::string> SessionJournal::findIncomplete(const std::string &directory)
+{
+    std::vector<std::string> journals;
+    std::error_code error;
+    for (const auto &entry : std::filesystem::directory_iterator(directory, error))
+    {
+        if (!entry.is_regular_file() || entry.path().extension() != EXTENSION)
+        {
+            continue;
+        }
+
+        // Complete journals end with an end block
+        std::ifstream in(entry.path(), std::ios::binary);
+        uint8_t header[BLOCK_HEADER_BYTES];
+        bool complete = entry.file_size(error) >= FILE_HEADER_BYTES + BLOCK_HEADER_BYTES && !error &&
+                        in.seekg(-static_cast<std::streamoff>(BLOCK_HEADER_BYTES), std::ios::end) &&
+                        readBlockHeader(in, header) && get32(header) == END_MAGIC;
+        if (!complete)
+        {
+            journals.push_back(entry.path().string());
+        }
+    }
+    std::sort(journals.begin(), journals.end());
+    return journals;
+}
+
+bool SessionJournal::recover(const std::string &path, TelemetryHistory &history, JournalRecovery &result)
+{
+    result = JournalRecovery{};
+    std::ifstream in(path, std::ios::binary);
+    uint8_t fileHeader[FILE_HEADER_BYTES];
+    if (!in.read(reinterpret_cast<char *>(fileHeader), sizeof(fileHeader)) || get32(fileHeader) != FILE_MAGIC ||
+        get16(fileHeader + 4) != VERSION)
+    {
+        return false;
+    }
+    result.validBytes = get16(fileHeader + 6);
+    in.seekg(static_cast<std::streamoff>(result.validBytes));
+
+    std::vector<uint8_t> payload;
+    std::vector<TelemetrySample> samples;
+    uint8_t header[BLOCK_HEADER_BYTES];
+    while (readBlockHeader(in, header))
+    {
+        uint32_t sequence = get32(header + 4);
+        uint32_t count = get32(header + 8);
+        uint32_t payloadBytes = get32(header + 12);
+        if (sequence != result.blocks)
+        {
+            break; // Stale bytes from an earlier file, not this session's next block
+        }
+
+        payload.resize(payloadBytes);
+        if (!in.read(reinterpret_cast<char *>(payload.data()), payloadBytes))
+        {
+            break; // Torn write
+        }
+        uint16_t crc = Crc16::compute(header, 16);
+        crc = Crc16::compute(payload.data(), payload.size(), crc);
+        if (crc != get16(header + 16) || !TelemetryCodec::decode(payload.data(), payload.size(), count, samples))
+        {
+            break;
+        }
+
+        result.blocks++;
+        result.validBytes += BLOCK_HEADER_BYTES + payloadBytes;
+        if (get32(header) == END_MAGIC)
+        {
+            result.cleanEnd = true;
+            break;
+        }
+        for (const TelemetrySample &sample : samples)
+        {
+            history.append(sample);
+        }
+        result.samples += samples.size();
+    }
+
+    std::error_code error;
+    uint64_t size = std::filesystem::file_size(path, error);
+    result.discardedBytes = (!error && size > result.validBytes) ? size - result.validBytes : 0;
+    return true;
+}
+
+bool SessionJournal::recoverToCsv(const std::string &journalPath, const std::string &csvPath, JournalRecovery &result)
+{
+    TelemetryHistory history;
+    if (!recover(journalPath, history, result))
+    {
+        std::cerr << journalPath << " is not a session journal" << std::endl;
+        return false;
+    }
+
+    std::ofstream file(csvPath);
+    if (!file.is_open())
+    {
+        std::cerr << "Could not create file: " << csvPath << std::endl;
+        return false;
+    }
+    bool complete = TelemetryCsv::writeRecording(file, history.snapshot(), nullptr);
+    file.close();
+    return complete && !file.fail();
+}
@@ -0,0 +1,115 @@
+#pragma once
+#include "LatencyHistogram.h"
+#include "TelemetryHistory.h"
+#include "TreadmillController.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct JournalStats
+{
+    uint64_t samples = 0;      // On disk and synced
+    uint64_t blocks = 0;
+    uint64_t dropped = 0;      // Refused because the writer fell too far behind
+    uint64_t payloadBytes = 0; // Encoded samples
+    uint64_t fileBytes = 0;    // Payload plus file and block headers
+    uint64_t deviceBytes = 0;  // Estimate: every sync rewrites the whole pages it touches
+    LatencySummary sync;       // fsync duration
+    LatencySummary durable;    // Oldest sample of a block: host arrival -> synced
+
+    double writeAmplification() const
+    {
+        return payloadBytes > 0 ? static_cast<double>(deviceBytes) / static_cast<double>(payloadBytes) : 0.0;
+    }
+};
+
+struct JournalRecovery
+{
+    uint64_t samples = 0;
+    uint64_t blocks = 0;
+    bool cleanEnd = false;       // The session was closed normally
+    uint64_t validBytes = 0;     // Up to the last intact block
+    uint64_t discardedBytes = 0; // Torn or corrupt tail
+};
+
+/**
+ * Append-only, crash-safe journal of a telemetry recording
+ * append() only queues the sample; a writer thread turns everything queued
+ * into one CRC-checked block (TelemetryCodec payload), appends it and fsyncs,
+ * at most SYNC_INTERVAL apart. A crash or power cut therefore loses at most
+ * the last interval plus one sync. A clean close() writes an end block and
+ * deletes the file, so any journal left behind is an interrupted session;
+ * recover() reads it back up to the last intact block.
+ */
+class SessionJournal
+{
+public:
+    static constexpr std::chrono::milliseconds SYNC_INTERVAL{250};
+    static constexpr size_t MAX_PENDING = 1u << 20; // Samples queued for the writer
+    static constexpr size_t PAGE_BYTES = 4096;      // For the write amplification estimate
+    static constexpr const char *EXTENSION = ".tmj";
+
+    SessionJournal() = default;
+    // Closes cleanly (and deletes the file) if still open
+    ~SessionJournal();
+
+    SessionJournal(const SessionJournal &) = delete;
+    SessionJournal &operator=(const SessionJournal &) = delete;
+
+    // Creates the file (and its directory) and starts the writer
+    bool open(const std::string &path);
+    // Any thread; never waits for the disk
+    void append(const TelemetrySample &sample);
+    // Writes what is still queued and the end block; keepFile leaves the completed journal in place
+    void close(bool keepFile = false);
+
+    bool isOpen() const { return m_file != nullptr; }
+    const std::string &getPath() const { return m_path; }
+    JournalStats getStats() const;
+
+    // New, unused journal path in `directory`: session_YYYYMMDD_HHMMSS.tmj
+    static std::string makePath(const std::string &directory);
+    // Journals in `directory` without an end block
+    static std::vector<std::string> findIncomplete(const std::string &directory);
+    // Every intact block, in order; false if the file is missing or not a journal
+    static bool recover(const std::string &path, TelemetryHistory &history, JournalRecovery &result);
+    // recover() straight into a TelemetryCsv recording
+    static bool recoverToCsv(const std::string &journalPath, const std::string &csvPath, JournalRecovery &result);
+
+private:
+    void writerLoop();
+    bool writeBlock(uint32_t magic, const std::vector<TelemetrySample> &samples);
+    bool sync();
+
+    std::string m_path;
+    std::FILE *m_file = nullptr;
+    std::thread m_writer;
+
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    std::vector<TelemetrySample> m_pending;
+    bool m_stopping = false;
+
+    // Writer thread only
+    uint32_t m_sequence = 0;
+    uint64_t m_offset = 0;
+    uint64_t m_syncedOffset = 0;
+    bool m_failed = false;
+    std::vector<uint8_t> m_buffer;
+
+    std::atomic<uint64_t> m_samples{0};
+    std::atomic<uint64_t> m_blocks{0};
+    std::atomic<uint64_t> m_dropped{0};
+    std::atomic<uint64_t> m_payloadBytes{0};
+    std::atomic<uint64_t> m_fileBytes{0};
+    std::atomic<uint64_t> m_deviceBytes{0};
+    LatencyHistogram m_syncLatency;
+    LatencyHistogram m_durableLatency;
+};
@@ -0,0 +1,268 @@
+#include "TelemetryCodec.h"
+#include <cmath>
+#include <cstring>
+#include <map>
+
+namespace
+{
+    constexpr float CENTI_LIMIT = 1e7f; // Beyond this hundredths no longer fit a float exactly
+
+    // Previous sample of one device; every field is coded against it
+    struct Predictor
+    {
+        uint32_t timestamp = 0;
+        int64_t rpm[4] = {0, 0, 0, 0}; // Hundredths
+        uint16_t droppedFrames = 0;
+        int64_t hostArrivalUs = 0;
+        int64_t sequence = 0;
+        int64_t setpointSeq = 0;
+    };
+
+    uint64_t zigzag(int64_t value)
+    {
+        return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+    }
+
+    int64_t unzigzag(uint64_t value)
+    {
+        return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+    }
+
+    // Wrap-safe difference, for fields that may run over their range
+    int64_t delta(int64_t value, int64_t previous)
+    {
+        return static_cast<int64_t>(static_cast<uint64_t>(value) - static_cast<uint64_t>(previous));
+    }
+
+    int64_t advance(int64_t previous, int64_t difference)
+    {
+        return static_cast<int64_t>(static_cast<uint64_t>(previous) + static_cast<uint64_t>(difference));
+    }
+
+    float fromCenti(int64_t centi)
+    {
+        return static_cast<float>(centi) / 100.0f;
+    }
+
+    // True if `value` is exactly what fromCenti() makes of some whole number of hundredths
+    bool toCenti(float value, int64_t &centi)
+    {
+        if (!(std::fabs(value) < CENTI_LIMIT))
+        {
+            return false; // Also NaN
+        }
+        centi = std::llround(static_cast<double>(value) * 100.0);
+        float back = fromCenti(centi);
+        return std::memcmp(&back, &value, sizeof(float)) == 0; // Rejects -0.0f
+    }
+
+    class Writer
+    {
+    public:
+        explicit Writer(std::vector<uint8_t> &out) : m_out(out) {}
+
+        void varint(uint64_t value)
+        {
+            while (value >= 0x80)
+            {
+                m_out.push_back(static_cast<uint8_t>(value | 0x80));
+                value >>= 7;
+            }
+            m_out.push_back(static_cast<uint8_t>(value));
+        }
+
+        void signedVarint(int64_t value) { varint(zigzag(value)); }
+
+        void byte(uint8_t value) { m_out.push_back(value); }
+
+        void rpm(float value, int64_t &previous)
+        {
+            int64_t centi;
+            if (toCenti(value, centi))
+            {
+                varint(zigzag(centi - previous) << 1);
+                previous = centi;
+                return;
+            }
+            uint32_t bits;
+            std::memcpy(&bits, &value, sizeof(bits));
+            varint(1); // Raw float follows
+            for (int shift = 0; shift < 32; shift += 8)
+            {
+                m_out.push_back(static_cast<uint8_t>(bits >> shift));
+            }
+        }
+
+    private:
+        std::vector<uint8_t> &m_out;
+    };
+
+    class Reader
+    {
+    public:
+        Reader(const uint8_t *data, size_t size) : m_data(data), m_end(data + size) {}
+
+        bool varint(uint64_t &value)
+        {
+            value = 0;
+            for (int shift = 0; shift < 64; shift += 7)
+            {
+                if (m_data == m_end)
+                {
+                    return false;
+                }
+                uint8_t byte = *m_data++;
+                value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+                if ((byte & 0x80) == 0)
+                {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        bool signedVarint(int64_t &value)
+        {
+            uint64_t raw;
+            if (!varint(raw))
+            {
+                return false;
+            }
+            value = unzigzag(raw);
+            return true;
+        }
+
+        bool byte(uint8_t &value)
+        {
+            if (m_data == m_end)
+            {
+                return false;
+            }
+            value = *m_data++;
+            return true;
+        }
+
+        bool rpm(float &value, int64_t &previous)
+        {
+            uint64_t tag;
+            if (!varint(tag))
+            {
+                return false;
+            }
+            if ((tag & 1) == 0)
+            {
+                previous += unzigzag(tag >> 1);
+                value = fromCenti(previous);
+                return true;
+            }
+            if (m_end - m_data < 4)
+            {
+                return false;
+            }
+            uint32_t bits = 0;
+            for (int shift = 0; shift < 32; shift += 8)
+            {
+                bits |= static_cast<uint32_t>(*m_data++) << shift;
+            }
+            std::memcpy(&value, &bits, sizeof(value));
+            return true;
+        }
+
+        bool atEnd() const { return m_data == m_end; }
+
+    private:
+        const uint8_t *m_data;
+        const uint8_t *m_end;
+    };
+}
+
+void TelemetryCodec::encode(const TelemetrySample *samples, size_t count, std::vector<uint8_t> &out)
+{
+    std::map<size_t, Predictor> predictors;
+    Writer writer(out);
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        const TelemetrySample &sample = samples[i];
+        const TelemetryData &data = sample.data;
+        Predictor &previous = predictors[sample.deviceId];
+
+        writer.varint(sample.deviceId);
+        writer.byte(static_cast<uint8_t>((data.driver1Healthy ? 0x01 : 0) | (data.driver2Healthy ? 0x02 : 0) |
+                                         (data.emergencyStop ? 0x04 : 0) | (data.profileActive ? 0x08 : 0) |
+                                         (static_cast<uint8_t>(data.speedQuality1) & 0x03) << 4 |
+                                         (static_cast<uint8_t>(data.speedQuality2) & 0x03) << 6));
+
+        writer.signedVarint(static_cast<int32_t>(data.timestamp - previous.timestamp));
+        writer.rpm(data.targetRpm1, previous.rpm[0]);
+        writer.rpm(data.actualRpm1, previous.rpm[1]);
+        writer.rpm(data.targetRpm2, previous.rpm[2]);
+        writer.rpm(data.actualRpm2, previous.rpm[3]);
+        writer.signedVarint(static_cast<int16_t>(data.droppedFrames - previous.droppedFrames));
+        writer.signedVarint(delta(data.hostArrivalUs, previous.hostArrivalUs));
+        writer.signedVarint(delta(data.sequence, previous.sequence));
+        writer.varint(data.gapBefore);
+        writer.signedVarint(delta(data.setpointSeq, previous.setpointSeq));
+
+        previous.timestamp = data.timestamp;
+        previous.droppedFrames = data.droppedFrames;
+        previous.hostArrivalUs = data.hostArrivalUs;
+        previous.sequence = data.sequence;
+        previous.setpointSeq = data.setpointSeq;
+    }
+}
+
+bool TelemetryCodec::decode(const uint8_t *data, size_t size, size_t count, std::vector<TelemetrySample> &out)
+{
+    std::map<size_t, Predictor> predictors;
+    Reader reader(data, size);
+    out.clear();
+    out.reserve(count);
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        TelemetrySample sample;
+        TelemetryData &fields = sample.data;
+        uint64_t deviceId, gapBefore;
+        uint8_t flags;
+        int64_t timestamp, dropped, hostArrivalUs, sequence, setpointSeq;
+
+        if (!reader.varint(deviceId) || !reader.byte(flags))
+        {
+            return false;
+        }
+        sample.deviceId = static_cast<size_t>(deviceId);
+        Predictor &previous = predictors[sample.deviceId];
+
+        if (!reader.signedVarint(timestamp) ||
+            !reader.rpm(fields.targetRpm1, previous.rpm[0]) || !reader.rpm(fields.actualRpm1, previous.rpm[1]) ||
+            !reader.rpm(fields.targetRpm2, previous.rpm[2]) || !reader.rpm(fields.actualRpm2, previous.rpm[3]) ||
+            !reader.signedVarint(dropped) || !reader.signedVarint(hostArrivalUs) || !reader.signedVarint(sequence) ||
+            !reader.varint(gapBefore) || !reader.signedVarint(setpointSeq))
+        {
+            return false;
+        }
+
+        fields.driver1Healthy = (flags & 0x01) != 0;
+        fields.driver2Healthy = (flags & 0x02) != 0;
+        fields.emergencyStop = (flags & 0x04) != 0;
+        fields.profileActive = (flags & 0x08) != 0;
+        fields.speedQuality1 = static_cast<SpeedEstimateQuality>((flags >> 4) & 0x03);
+        fields.speedQuality2 = static_cast<SpeedEstimateQuality>((flags >> 6) & 0x03);
+
+        previous.timestamp += static_cast<uint32_t>(timestamp);
+        previous.droppedFrames = static_cast<uint16_t>(previous.droppedFrames + dropped);
+        previous.hostArrivalUs = advance(previous.hostArrivalUs, hostArrivalUs);
+        previous.sequence = advance(previous.sequence, sequence);
+        previous.setpointSeq = advance(previous.setpointSeq, setpointSeq);
+
+        fields.timestamp = previous.timestamp;
+        fields.droppedFrames = previous.droppedFrames;
+        fields.hostArrivalUs = previous.hostArrivalUs;
+        fields.sequence = static_cast<int32_t>(previous.sequence);
+        fields.gapBefore = static_cast<uint16_t>(gapBefore);
+        fields.setpointSeq = static_cast<int32_t>(previous.setpointSeq);
+        out.push_back(sample);
+    }
+    return reader.atEnd();
+}
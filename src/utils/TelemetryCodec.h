@@ -0,0 +1,25 @@
+#pragma once
+#include "TreadmillController.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * Lossless compact encoding of a run of telemetry samples, for spilling history to disk
+ * Each field is stored as a zigzag varint delta from the same device's previous
+ * sample. RPM values are carried as hundredths (TEL reports two decimals) when
+ * that reproduces the float exactly, and as raw bits otherwise, so decoding
+ * always returns the samples bit for bit. Typical frames take 14-18 bytes.
+ */
+class TelemetryCodec
+{
+public:
+    // Delete constructor to prevent instantiation
+    TelemetryCodec() = delete;
+
+    // Appends the encoding of samples[0..count) to out
+    static void encode(const TelemetrySample *samples, size_t count, std::vector<uint8_t> &out);
+    // Decodes exactly `count` samples from data[0..size) into out (replacing its contents);
+    // false if the data is truncated or malformed
+    static bool decode(const uint8_t *data, size_t size, size_t count, std::vector<TelemetrySample> &out);
+};
@@ -0,0 +1,259 @@
+#include "TelemetryCsv.h"
+#include <charconv>
+#include <cstdlib>
+#include <map>
+#include <vector>
+
+namespace
+{
+    constexpr const char *HEADER = "Timestamp,TargetL,ActualL,TargetR,ActualR,Driver1Health,Driver2Health,EStop,Seq,Gap";
+    constexpr size_t COLUMNS = 10;
+
+    // Upper bounds on the formatted text, with separators
+    constexpr size_t DEVICE_BYTES = 24; // "<deviceId>, "
+    constexpr size_t ROW_BYTES = 160;   // The recorded columns
+    constexpr size_t EXTRA_BYTES = 32;  // ", <derived value>"
+
+    // Numbers come out exactly as `ostream <<` prints them (6 significant digits for
+    // floating point), without the stream's per-value locale and state overhead
+    template <typename T>
+    char *formatInteger(char *p, char *end, T value)
+    {
+        return std::to_chars(p, end, value).ptr;
+    }
+
+    template <typename T>
+    char *formatReal(char *p, char *end, T value)
+    {
+        return std::to_chars(p, end, value, std::chars_format::general, 6).ptr;
+    }
+
+    char *separator(char *p)
+    {
+        *p++ = ',';
+        *p++ = ' ';
+        return p;
+    }
+
+    char *formatDevice(char *p, char *end, size_t deviceId)
+    {
+        return separator(formatInteger(p, end, deviceId));
+    }
+
+    // Every recorded column, without the line break
+    char *formatFields(char *p, char *end, const TelemetryData &data)
+    {
+        p = separator(formatInteger(p, end, data.timestamp));
+        p = separator(formatReal(p, end, data.targetRpm1));
+        p = separator(formatReal(p, end, data.actualRpm1));
+        p = separator(formatReal(p, end, data.targetRpm2));
+        p = separator(formatReal(p, end, data.actualRpm2));
+        *p++ = data.driver1Healthy ? '1' : '0';
+        p = separator(p);
+        *p++ = data.driver2Healthy ? '1' : '0';
+        p = separator(p);
+        *p++ = data.emergencyStop ? '1' : '0';
+        p = separator(p);
+
+        // Seq is blank for firmware without frame counters; Gap marks frames lost before this row
+        if (data.sequence >= 0)
+        {
+            p = formatInteger(p, end, data.sequence);
+        }
+        p = separator(p);
+        return formatInteger(p, end, data.gapBefore);
+    }
+
+    char *formatExtra(char *p, char *end, double value)
+    {
+        return formatReal(separator(p), end, value);
+    }
+}
+
+void TelemetryCsv::writeHeader(std::ostream &out, bool deviceColumn, const std::vector<std::string> &extraColumns)
+{
+    if (deviceColumn)
+    {
+        out << "Device,";
+    }
+    out << HEADER;
+    for (const std::string &column : extraColumns)
+    {
+        out << "," << column;
+    }
+    out << "\n";
+}
+
+void TelemetryCsv::writeRow(std::ostream &out, const TelemetryData &data, const double *extra, size_t extraCount)
+{
+    char row[ROW_BYTES];
+    char *end = formatFields(row, row + sizeof(row), data);
+    out.write(row, end - row);
+    for (size_t i = 0; i < extraCount; ++i)
+    {
+        char cell[EXTRA_BYTES];
+        end = formatExtra(cell, cell + sizeof(cell), extra[i]);
+        out.write(cell, end - cell);
+    }
+    out.put('\n');
+}
+
+void TelemetryCsv::writeRow(std::ostream &out, size_t deviceId, const TelemetryData &data, const double *extra, size_t extraCount)
+{
+    char prefix[DEVICE_BYTES];
+    char *end = formatDevice(prefix, prefix + sizeof(prefix), deviceId);
+    out.write(prefix, end - prefix);
+    writeRow(out, data, extra, extraCount);
+}
+
+bool TelemetryCsv::writeRecording(std::ostream &out, const TelemetryHistorySnapshot &recording,
+                                  const DerivedChannels *channels, const std::function<bool(uint64_t rows)> &progress)
+{
+    bool multiDevice = recording.getDeviceIds().size() > 1;
+    size_t channelCount = channels ? channels->size() : 0;
+    writeHeader(out, multiDevice, channels ? channels->getNames() : std::vector<std::string>{});
+
+    // d() and prev() must only ever see one device's samples, so each device keeps its own state
+    // across chunks and a chunk is evaluated in one batch per device
+    std::map<size_t, DerivedChannels::State> states;
+    std::map<size_t, std::vector<size_t>> rowsByDevice;
+    std::vector<TelemetryData> batch;
+    std::vector<std::vector<double>> columns;
+    std::vector<double> derived;
+
+    // A whole chunk is formatted into one buffer and handed to the stream in a single write
+    size_t rowBytes = DEVICE_BYTES + ROW_BYTES + channelCount * EXTRA_BYTES;
+    std::vector<char> text;
+    uint64_t rows = 0;
+
+    auto writeChunk = [&](const TelemetrySample *samples, size_t count)
+    {
+        if (channelCount > 0)
+        {
+            for (auto &device : rowsByDevice)
+            {
+                device.second.clear();
+            }
+            for (size_t row = 0; row < count; ++row)
+            {
+                rowsByDevice[samples[row].deviceId].push_back(row);
+            }
+
+            derived.resize(count * channelCount);
+            for (const auto &device : rowsByDevice)
+            {
+                if (device.second.empty())
+                {
+                    continue;
+                }
+                batch.clear();
+                for (size_t row : device.second)
+                {
+                    batch.push_back(samples[row].data);
+                }
+                auto state = states.find(device.first);
+                if (state == states.end())
+                {
+                    state = states.emplace(device.first, channels->makeState()).first;
+                }
+                channels->evaluateBatch(batch.data(), batch.size(), state->second, columns);
+                for (size_t i = 0; i < device.second.size(); ++i)
+                {
+                    for (size_t channel = 0; channel < channelCount; ++channel)
+                    {
+                        derived[device.second[i] * channelCount + channel] = columns[channel][i];
+                    }
+                }
+            }
+        }
+
+        text.resize(count * rowBytes);
+        char *p = text.data();
+        for (size_t row = 0; row < count; ++row)
+        {
+            const TelemetrySample &sample = samples[row];
+            char *end = p + rowBytes;
+            if (multiDevice)
+            {
+                p = formatDevice(p, end, sample.deviceId);
+            }
+            p = formatFields(p, end, sample.data);
+            for (size_t channel = 0; channel < channelCount; ++channel)
+            {
+                p = formatExtra(p, end, derived[row * channelCount + channel]);
+            }
+            *p++ = '\n';
+        }
+        out.write(text.data(), p - text.data());
+
+        rows += count;
+        return static_cast<bool>(out) && (!progress || progress(rows));
+    };
+    return recording.forEachChunk(writeChunk) && static_cast<bool>(out);
+}
+
+bool TelemetryCsv::parseHeader(const std::string &line, bool &deviceColumn)
+{
+    std::string header = line.substr(0, line.find_last_not_of("\r\n") + 1);
+    deviceColumn = (header.rfind("Device,", 0) == 0);
+    size_t start = deviceColumn ? 7 : 0;
+    size_t length = std::char_traits<char>::length(HEADER);
+    return header.compare(start, length, HEADER) == 0 &&
+           (header.size() == start + length || header[start + length] == ',');
+}
+
+bool TelemetryCsv::parseRow(const std::string &line, bool deviceColumn, TelemetrySample &sample)
+{
+    // Numbers only; Seq may be blank
+    std::vector<double> fields;
+    std::vector<bool> blank;
+    const char *p = line.c_str();
+    while (true)
+    {
+        char *end = nullptr;
+        double value = std::strtod(p, &end);
+        bool empty = (end == p);
+        while (*end == ' ' || *end == '\r' || *end == '\n')
+        {
+            ++end;
+        }
+        if (*end != ',' && *end != '\0')
+        {
+            return false;
+        }
+        fields.push_back(empty ? 0.0 : value);
+        blank.push_back(empty);
+        if (*end == '\0')
+        {
+            break;
+        }
+        p = end + 1;
+    }
+
+    size_t first = deviceColumn ? 1 : 0;
+    if (fields.size() < COLUMNS + first)
+    {
+        return false;
+    }
+    for (size_t i = 0; i < fields.size(); ++i)
+    {
+        if (blank[i] && i != first + 8) // Only Seq may be missing
+        {
+            return false;
+        }
+    }
+
+    sample.deviceId = deviceColumn ? static_cast<size_t>(fields[0]) : 0;
+    TelemetryData &data = sample.data;
+    data.timestamp = static_cast<uint32_t>(fields[first]);
+    data.targetRpm1 = static_cast<float>(fields[first + 1]);
+    data.actualRpm1 = static_cast<float>(fields[first + 2]);
+    data.targetRpm2 = static_cast<float>(fields[first + 3]);
+    data.actualRpm2 = static_cast<float>(fields[first + 4]);
+    data.driver1Healthy = fields[first + 5] != 0.0;
+    data.driver2Healthy = fields[first + 6] != 0.0;
+    data.emergencyStop = fields[first + 7] != 0.0;
+    data.sequence = blank[first + 8] ? -1 : static_cast<int32_t>(fields[first + 8]);
+    data.gapBefore = static_cast<uint16_t>(fields[first + 9]);
+    return true;
+}
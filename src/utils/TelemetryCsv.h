@@ -0,0 +1,44 @@
+#pragma once
+#include "DerivedChannels.h"
+#include "TelemetryHistory.h"
+#include "TreadmillController.h"
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <ostream>
+#include <string>
+#include <vector>
+
+/**
+ * CSV layout for recorded telemetry
+ * Shared by the GUI export and the headless CLI so recordings are comparable
+ */
+class TelemetryCsv
+{
+public:
+    // Delete constructor to prevent instantiation
+    TelemetryCsv() = delete;
+
+    // deviceColumn: leading Device column for recordings of several treadmills;
+    // extraColumns: derived channels (see DerivedChannels), after the recorded ones
+    static void writeHeader(std::ostream &out, bool deviceColumn = false,
+                            const std::vector<std::string> &extraColumns = {});
+    static void writeRow(std::ostream &out, const TelemetryData &data, const double *extra = nullptr, size_t extraCount = 0);
+    static void writeRow(std::ostream &out, size_t deviceId, const TelemetryData &data,
+                         const double *extra = nullptr, size_t extraCount = 0);
+
+    // A whole recording in arrival order, read chunk by chunk: Device column only if it spans
+    // several devices, plus one column per derived channel, computed in batches per device
+    // (channels may be null). Each chunk goes out in one write, after which progress (if set)
+    // gets the rows written so far and may return false to stop. False if stopped, if part of
+    // the recording could not be read back or if the stream failed.
+    static bool writeRecording(std::ostream &out, const TelemetryHistorySnapshot &recording,
+                               const DerivedChannels *channels,
+                               const std::function<bool(uint64_t rows)> &progress = nullptr);
+
+    // Reading a recording back (e.g. to replay it); the header tells whether rows have a Device column.
+    // Columns after the recorded ones are ignored.
+    static bool parseHeader(const std::string &line, bool &deviceColumn);
+    // Fills the recorded fields only; false if the row is malformed
+    static bool parseRow(const std::string &line, bool deviceColumn, TelemetrySample &sample);
+};
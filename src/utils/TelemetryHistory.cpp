@@ -0,0 +1,356 @@
+#include "TelemetryHistory.h"
+#include "Crc16.h"
+#include "TelemetryCodec.h"
+#include "Trace.h"
+#include <chrono>
+#include <filesystem>
+#include <iostream>
+#include <system_error>
+
+TelemetryHistory::TelemetryHistory(size_t budgetBytes, std::string spillPath)
+    : m_budgetBytes(budgetBytes), m_requestedSpillPath(std::move(spillPath))
+{
+}
+
+TelemetryHistory::~TelemetryHistory()
+{
+    stopWriter();
+    removeSpillFiles();
+}
+
+void TelemetryHistory::append(const TelemetrySample &sample)
+{
+    if (m_chunks.empty() || m_chunks.back().count == CHUNK_SAMPLES)
+    {
+        m_chunks.emplace_back();
+        m_chunks.back().samples = std::make_shared<std::vector<TelemetrySample>>();
+        m_chunks.back().samples->reserve(CHUNK_SAMPLES);
+        m_memoryBytes += chunkBytes(m_chunks.back());
+        enforceBudget();
+    }
+
+    Chunk &chunk = m_chunks.back();
+    chunk.samples->push_back(sample);
+    chunk.count++;
+    m_samples++;
+    m_deviceIds.insert(sample.deviceId);
+}
+
+void TelemetryHistory::clear()
+{
+    stopWriter(); // Chunks still queued are dropped along with the rest
+
+    m_chunks.clear();
+    m_firstInMemory = 0;
+    m_nextToQueue = 0;
+    m_memoryBytes = 0;
+    m_queuedBytes = 0;
+    m_samples = 0;
+    m_spilledSamples = 0;
+    m_deviceIds.clear();
+
+    // A new file on the next spill; snapshots still reading the old one keep their handle
+    removeSpillFiles();
+    m_spillPath = m_requestedSpillPath;
+    m_spillEnd = 0;
+    m_spillFailed = false;
+}
+
+void TelemetryHistory::flush()
+{
+    {
+        std::unique_lock<std::mutex> lock(m_writerMutex);
+        m_writerCv.wait(lock, [this]()
+                        { return (m_spillQueue.empty() && !m_writerBusy) || m_spillFailed; });
+    }
+    releaseSpilled();
+}
+
+void TelemetryHistory::setBudget(size_t budgetBytes)
+{
+    m_budgetBytes = budgetBytes;
+    enforceBudget();
+}
+
+TelemetryHistoryStats TelemetryHistory::getStats() const
+{
+    TelemetryHistoryStats stats;
+    stats.samples = m_samples;
+    stats.chunksSpilled = m_firstInMemory;
+    stats.spilledSamples = m_spilledSamples;
+    // Written by now but not yet freed by append()
+    for (size_t i = m_firstInMemory; i < m_nextToQueue && isSpilled(m_chunks[i]); ++i)
+    {
+        stats.chunksSpilled++;
+        stats.spilledSamples += m_chunks[i].count;
+    }
+    stats.chunksInMemory = m_chunks.size() - m_firstInMemory;
+    stats.memoryBytes = m_memoryBytes;
+    stats.spilledBytes = m_spillEnd;
+    stats.budgetBytes = m_budgetBytes;
+    return stats;
+}
+
+TelemetryHistorySnapshot TelemetryHistory::snapshot() const
+{
+    TelemetryHistorySnapshot snapshot;
+    snapshot.m_samples = m_samples;
+    snapshot.m_deviceIds = m_deviceIds;
+    snapshot.m_chunks.reserve(m_chunks.size());
+
+    bool anySpilled = false;
+    for (size_t i = 0; i < m_chunks.size(); ++i)
+    {
+        const Chunk &chunk = m_chunks[i];
+        TelemetryHistorySnapshot::Chunk shared;
+        shared.count = chunk.count;
+        if (isSpilled(chunk))
+        {
+            shared.fileOffset = chunk.spill->fileOffset;
+            shared.fileBytes = chunk.spill->fileBytes;
+            shared.crc = chunk.spill->crc;
+            anySpilled = true;
+        }
+        else
+        {
+            // The open chunk keeps growing, so the snapshot gets its own copy of it
+            bool open = (i + 1 == m_chunks.size());
+            shared.samples = open ? std::make_shared<const std::vector<TelemetrySample>>(*chunk.samples) : chunk.samples;
+        }
+        snapshot.m_chunks.push_back(std::move(shared));
+    }
+
+    if (anySpilled)
+    {
+        snapshot.m_spillPath = m_spillPath;
+        snapshot.m_spillFile = std::make_unique<std::ifstream>(m_spillPath, std::ios::binary);
+    }
+    return snapshot;
+}
+
+size_t TelemetryHistory::chunkBytes(const Chunk &chunk)
+{
+    return chunk.samples ? chunk.samples->capacity() * sizeof(TelemetrySample) : 0;
+}
+
+bool TelemetryHistory::isSpilled(const Chunk &chunk)
+{
+    return chunk.spill && chunk.spill->written.load(std::memory_order_acquire);
+}
+
+void TelemetryHistory::enforceBudget()
+{
+    releaseSpilled();
+
+    // The open chunk (the last one) always stays in memory
+    while (m_memoryBytes - m_queuedBytes > m_budgetBytes && !m_spillFailed && m_nextToQueue + 1 < m_chunks.size())
+    {
+        Chunk &chunk = m_chunks[m_nextToQueue];
+        queueSpill(chunk);
+        m_queuedBytes += chunkBytes(chunk);
+        m_nextToQueue++;
+    }
+}
+
+void TelemetryHistory::releaseSpilled()
+{
+    while (m_firstInMemory < m_nextToQueue && isSpilled(m_chunks[m_firstInMemory]))
+    {
+        Chunk &chunk = m_chunks[m_firstInMemory];
+        size_t bytes = chunkBytes(chunk);
+        m_memoryBytes -= bytes;
+        m_queuedBytes -= bytes;
+        m_spilledSamples += chunk.count;
+        chunk.samples.reset(); // Freed once no snapshot shares it
+        m_firstInMemory++;
+    }
+}
+
+void TelemetryHistory::queueSpill(Chunk &chunk)
+{
+    if (m_spillPath.empty())
+    {
+        auto stamp = std::chrono::steady_clock::now().time_since_epoch().count();
+        std::error_code error;
+        std::filesystem::path directory = std::filesystem::temp_directory_path(error);
+        m_spillPath = (directory / ("treadmill_history_" + std::to_string(stamp) + ".bin")).string();
+    }
+
+    chunk.spill = std::make_shared<SpillRecord>();
+    {
+        std::unique_lock<std::mutex> lock(m_writerMutex);
+        if (!m_writer.joinable())
+        {
+            m_writer = std::thread([this]()
+                                   { writerLoop(); });
+        }
+        // Back-pressure: the recording may only run MAX_QUEUED_CHUNKS ahead of the disk
+        m_writerCv.wait(lock, [this]()
+                        { return m_spillQueue.size() < MAX_QUEUED_CHUNKS || m_spillFailed; });
+        m_spillQueue.push_back(SpillJob{chunk.samples, chunk.spill});
+    }
+    m_writerCv.notify_all();
+}
+
+void TelemetryHistory::stopWriter()
+{
+    if (!m_writer.joinable())
+    {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_writerMutex);
+        m_spillQueue.clear();
+        m_writerStopping = true;
+    }
+    m_writerCv.notify_all();
+    m_writer.join();
+    m_writerStopping = false;
+}
+
+void TelemetryHistory::removeSpillFiles()
+{
+    if (m_spillFile.is_open())
+    {
+        m_spillFile.close();
+        m_staleSpillFiles.push_back(m_spillPath);
+    }
+
+    // Windows refuses while a snapshot still has the file open; those are retried on the next clear
+    std::vector<std::string> remaining;
+    for (const std::string &path : m_staleSpillFiles)
+    {
+        std::error_code error;
+        std::filesystem::remove(path, error);
+        if (error)
+        {
+            std::cerr << "Warning: Could not remove " << path << " (" << error.message() << "); will retry" << std::endl;
+            remaining.push_back(path);
+        }
+    }
+    m_staleSpillFiles.swap(remaining);
+}
+
+void TelemetryHistory::writerLoop()
+{
+    Trace::setThreadName("History");
+    while (true)
+    {
+        SpillJob job;
+        {
+            std::unique_lock<std::mutex> lock(m_writerMutex);
+            m_writerCv.wait(lock, [this]()
+                            { return m_writerStopping || !m_spillQueue.empty(); });
+            if (m_spillQueue.empty())
+            {
+                return; // Stopping; stopWriter() dropped whatever was queued
+            }
+            job = std::move(m_spillQueue.front());
+            m_spillQueue.pop_front();
+            m_writerBusy = true;
+        }
+        m_writerCv.notify_all(); // Room for an append waiting on a full queue
+
+        bool failed = !m_spillFailed && !writeChunk(job);
+        {
+            std::lock_guard<std::mutex> lock(m_writerMutex);
+            m_writerBusy = false;
+            if (failed)
+            {
+                m_spillFailed = true;
+            }
+        }
+        m_writerCv.notify_all();
+    }
+}
+
+bool TelemetryHistory::writeChunk(const SpillJob &job)
+{
+    TRACE_SCOPE("historySpill");
+    if (!openSpillFile())
+    {
+        return false;
+    }
+
+    m_encodeBuffer.clear();
+    TelemetryCodec::encode(job.samples->data(), job.samples->size(), m_encodeBuffer);
+
+    // Flushed, so snapshots reading through their own handle see the whole chunk
+    m_spillFile.write(reinterpret_cast<const char *>(m_encodeBuffer.data()),
+                      static_cast<std::streamsize>(m_encodeBuffer.size()));
+    m_spillFile.flush();
+    if (!m_spillFile)
+    {
+        std::cerr << "Warning: Could not write " << m_spillPath << "; keeping telemetry history in memory" << std::endl;
+        return false;
+    }
+
+    SpillRecord &record = *job.record;
+    record.fileOffset = m_spillEnd;
+    record.fileBytes = static_cast<uint32_t>(m_encodeBuffer.size());
+    record.crc = Crc16::compute(m_encodeBuffer.data(), m_encodeBuffer.size());
+    m_spillEnd += m_encodeBuffer.size();
+    record.written.store(true, std::memory_order_release);
+    return true;
+}
+
+bool TelemetryHistory::openSpillFile()
+{
+    if (m_spillFile.is_open())
+    {
+        return true;
+    }
+
+    m_spillFile.open(m_spillPath, std::ios::binary | std::ios::trunc);
+    if (!m_spillFile.is_open())
+    {
+        std::cerr << "Warning: Could not create " << m_spillPath << "; keeping telemetry history in memory" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool TelemetryHistorySnapshot::forEachChunk(const std::function<bool(const TelemetrySample *samples, size_t count)> &visit) const
+{
+    std::vector<TelemetrySample> decoded;
+    for (const Chunk &chunk : m_chunks)
+    {
+        if (chunk.samples)
+        {
+            if (!visit(chunk.samples->data(), chunk.count))
+            {
+                return false;
+            }
+            continue;
+        }
+        if (!readChunk(chunk, decoded))
+        {
+            std::cerr << "Error: Telemetry history chunk at " << chunk.fileOffset << " in " << m_spillPath
+                      << " could not be read back" << std::endl;
+            return false;
+        }
+        if (!visit(decoded.data(), decoded.size()))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool TelemetryHistorySnapshot::readChunk(const Chunk &chunk, std::vector<TelemetrySample> &samples) const
+{
+    if (!m_spillFile || !m_spillFile->is_open())
+    {
+        return false;
+    }
+
+    std::vector<uint8_t> bytes(chunk.fileBytes);
+    m_spillFile->clear();
+    m_spillFile->seekg(static_cast<std::streamoff>(chunk.fileOffset));
+    m_spillFile->read(reinterpret_cast<char *>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+    if (!*m_spillFile || Crc16::compute(bytes.data(), bytes.size()) != chunk.crc)
+    {
+        return false;
+    }
+    return TelemetryCodec::decode(bytes.data(), bytes.size(), chunk.count, samples);
+}
@@ -0,0 +1,180 @@
+#pragma once
+#include "TreadmillController.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct TelemetryHistoryStats
+{
+    uint64_t samples = 0;
+    size_t chunksInMemory = 0;
+    size_t chunksSpilled = 0;
+    size_t memoryBytes = 0;   // Samples held in RAM
+    uint64_t spilledBytes = 0; // Compressed, in the session file
+    uint64_t spilledSamples = 0;
+    size_t budgetBytes = 0;
+};
+
+/**
+ * Frozen view of a TelemetryHistory, for reading it (e.g. exporting) while recording goes on
+ * Shares the history's sealed chunks and reads spilled ones through its own handle on the
+ * session file, so taking one is cheap and the history is never locked while it is read.
+ * Move-only: one reader at a time.
+ */
+class TelemetryHistorySnapshot
+{
+public:
+    TelemetryHistorySnapshot() = default;
+    TelemetryHistorySnapshot(TelemetryHistorySnapshot &&) = default;
+    TelemetryHistorySnapshot &operator=(TelemetryHistorySnapshot &&) = default;
+    TelemetryHistorySnapshot(const TelemetryHistorySnapshot &) = delete;
+    TelemetryHistorySnapshot &operator=(const TelemetryHistorySnapshot &) = delete;
+
+    size_t size() const { return static_cast<size_t>(m_samples); }
+    const std::set<size_t> &getDeviceIds() const { return m_deviceIds; }
+
+    // Calls visit with each chunk in recording order until it returns false;
+    // false if stopped that way or a spilled chunk could not be read back
+    bool forEachChunk(const std::function<bool(const TelemetrySample *samples, size_t count)> &visit) const;
+
+private:
+    friend class TelemetryHistory;
+
+    struct Chunk
+    {
+        std::shared_ptr<const std::vector<TelemetrySample>> samples; // Null if spilled
+        size_t count = 0;
+        uint64_t fileOffset = 0;
+        uint32_t fileBytes = 0;
+        uint16_t crc = 0;
+    };
+
+    bool readChunk(const Chunk &chunk, std::vector<TelemetrySample> &samples) const;
+
+    std::vector<Chunk> m_chunks;
+    std::string m_spillPath;
+    std::unique_ptr<std::ifstream> m_spillFile; // Opened up front: stays readable if the history clears the file
+    uint64_t m_samples = 0;
+    std::set<size_t> m_deviceIds;
+};
+
+/**
+ * Telemetry recording with a RAM budget
+ * Samples are kept in fixed-size chunks. Once the chunks in memory exceed the
+ * budget, the oldest are handed to a writer thread that compresses them
+ * (TelemetryCodec) and appends them to a session file, so RAM keeps only the
+ * most recent window however long the session runs; a chunk is freed once the
+ * next append sees it on disk. append() itself never touches the file; it only
+ * waits if MAX_QUEUED_CHUNKS are still queued. snapshot() reads the whole
+ * recording in order, from the file and from RAM alike. If the session file
+ * cannot be written, chunks simply stay in memory.
+ *
+ * Not synchronized; the owner serializes access.
+ */
+class TelemetryHistory
+{
+public:
+    static constexpr size_t CHUNK_SAMPLES = 4096;
+    static constexpr size_t DEFAULT_BUDGET_BYTES = 64u * 1024 * 1024;
+    static constexpr size_t MAX_QUEUED_CHUNKS = 16; // Sealed chunks waiting for the writer
+
+    // spillPath: session file, created on first use; empty picks one in the temp directory
+    explicit TelemetryHistory(size_t budgetBytes = DEFAULT_BUDGET_BYTES, std::string spillPath = "");
+    // Deletes the session file
+    ~TelemetryHistory();
+
+    TelemetryHistory(const TelemetryHistory &) = delete;
+    TelemetryHistory &operator=(const TelemetryHistory &) = delete;
+
+    void append(const TelemetrySample &sample);
+    // Drops every sample and truncates the session file
+    void clear();
+    // Waits until every chunk handed to the writer is on disk (and freed)
+    void flush();
+
+    // Spills straight away if the new budget is already exceeded
+    void setBudget(size_t budgetBytes);
+    size_t getBudget() const { return m_budgetBytes; }
+
+    size_t size() const { return static_cast<size_t>(m_samples); }
+    bool empty() const { return m_samples == 0; }
+    // Every device that has samples in the recording
+    const std::set<size_t> &getDeviceIds() const { return m_deviceIds; }
+    TelemetryHistoryStats getStats() const;
+
+    // Everything recorded so far; cheap, the samples in memory are shared rather than copied
+    TelemetryHistorySnapshot snapshot() const;
+
+private:
+    // Where the writer put a chunk; filled in before `written` is set
+    struct SpillRecord
+    {
+        std::atomic<bool> written{false};
+        uint64_t fileOffset = 0;
+        uint32_t fileBytes = 0;
+        uint16_t crc = 0; // Of the compressed bytes
+    };
+
+    struct Chunk
+    {
+        // Only the last chunk is ever appended to; snapshots share the others. Null once spilled.
+        std::shared_ptr<std::vector<TelemetrySample>> samples;
+        size_t count = 0;
+        std::shared_ptr<SpillRecord> spill; // Set when queued for the writer
+    };
+
+    struct SpillJob
+    {
+        std::shared_ptr<const std::vector<TelemetrySample>> samples;
+        std::shared_ptr<SpillRecord> record;
+    };
+
+    static size_t chunkBytes(const Chunk &chunk);
+    static bool isSpilled(const Chunk &chunk);
+    void enforceBudget();
+    void releaseSpilled();
+    void queueSpill(Chunk &chunk);
+    void stopWriter();
+    void removeSpillFiles();
+    void writerLoop();
+    bool writeChunk(const SpillJob &job);
+    bool openSpillFile();
+
+    size_t m_budgetBytes;
+    std::string m_requestedSpillPath;
+    std::string m_spillPath; // Fresh for every file when none was requested
+    std::vector<std::string> m_staleSpillFiles; // Could not be removed yet (e.g. still open elsewhere on Windows)
+
+    std::deque<Chunk> m_chunks; // Spilled chunks first, then the ones in memory; the last one is open
+    size_t m_firstInMemory = 0; // Chunks before this one are spilled and freed
+    size_t m_nextToQueue = 0;   // Chunks from m_firstInMemory up to this one are queued for the writer
+    size_t m_memoryBytes = 0;
+    size_t m_queuedBytes = 0;   // Part of m_memoryBytes that is on its way to disk
+    uint64_t m_samples = 0;
+    uint64_t m_spilledSamples = 0;
+    std::set<size_t> m_deviceIds;
+
+    // Writer thread, started by the first spill
+    std::thread m_writer;
+    std::mutex m_writerMutex;
+    std::condition_variable m_writerCv;
+    std::deque<SpillJob> m_spillQueue;
+    bool m_writerStopping = false;
+    bool m_writerBusy = false; // Writing a chunk taken off the queue
+    std::atomic<bool> m_spillFailed{false}; // Gave up on the file; everything stays in memory
+    std::atomic<uint64_t> m_spillEnd{0};
+
+    // Writer thread only (the owner touches them only while no writer runs)
+    std::ofstream m_spillFile;
+    std::vector<uint8_t> m_encodeBuffer;
+};
@@ -0,0 +1,243 @@
+#include "Trace.h"
+#include "ClockSync.h"
+#include <algorithm>
+#include <array>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+std::atomic<bool> Trace::s_enabled{false};
+
+namespace
+{
+    struct TraceEvent
+    {
+        const char *name;
+        int64_t startUs;
+        int64_t durationUs;
+    };
+
+    // Stored field by field so a reader racing the writer sees torn spans, not
+    // undefined behaviour; it then discards them using `claimed` (see recordSpan)
+    struct EventSlot
+    {
+        std::atomic<const char *> name{nullptr};
+        std::atomic<int64_t> startUs{0};
+        std::atomic<int64_t> durationUs{0};
+    };
+
+    // Single writer (the owning thread). Indices only ever grow, also across
+    // reuse by another thread, so a reader holding an old copy stays consistent.
+    struct ThreadRing
+    {
+        uint32_t threadId = 0;  // Guarded by the registry mutex
+        std::string threadName; // Guarded by the registry mutex
+        std::array<EventSlot, Trace::RING_CAPACITY> events{};
+        std::atomic<uint64_t> claimed{0};   // Index + 1 of the span being written
+        std::atomic<uint64_t> written{0};   // Spans fully written
+        std::atomic<uint64_t> clearedAt{0}; // Spans before this index were cleared
+    };
+
+    // Every ring ever handed out stays listed, so an exited thread's spans still
+    // export until its ring is reused; rings are only allocated when nothing is free
+    struct Registry
+    {
+        std::mutex mutex;
+        std::vector<std::shared_ptr<ThreadRing>> rings;
+        std::vector<std::shared_ptr<ThreadRing>> freeRings;
+        uint32_t nextThreadId = 1;
+    };
+
+    Registry &registry()
+    {
+        static Registry instance;
+        return instance;
+    }
+
+    // Per-thread state; a thread that never records a span never gets a ring
+    struct ThreadSlot
+    {
+        std::string name;
+        std::shared_ptr<ThreadRing> ring;
+
+        ~ThreadSlot()
+        {
+            if (ring)
+            {
+                Registry &reg = registry();
+                std::lock_guard<std::mutex> lock(reg.mutex);
+                reg.freeRings.push_back(std::move(ring));
+            }
+        }
+    };
+
+    ThreadSlot &threadSlot()
+    {
+        thread_local ThreadSlot slot;
+        return slot;
+    }
+
+    ThreadRing &acquireRing(ThreadSlot &slot)
+    {
+        Registry &reg = registry();
+        std::lock_guard<std::mutex> lock(reg.mutex);
+        if (reg.freeRings.empty())
+        {
+            reg.rings.push_back(std::make_shared<ThreadRing>());
+            slot.ring = reg.rings.back();
+        }
+        else
+        {
+            slot.ring = std::move(reg.freeRings.back());
+            reg.freeRings.pop_back();
+            // The previous owner's spans are dropped; the new owner is a new trace thread
+            slot.ring->clearedAt.store(slot.ring->written.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        }
+        slot.ring->threadId = reg.nextThreadId++;
+        slot.ring->threadName = slot.name.empty() ? "Thread " + std::to_string(slot.ring->threadId) : slot.name;
+        return *slot.ring;
+    }
+
+    void writeJsonString(std::ostream &out, const std::string &text)
+    {
+        out << '"';
+        for (char c : text)
+        {
+            if (c == '"' || c == '\\')
+                out << '\\' << c;
+            else if (static_cast<unsigned char>(c) >= 0x20)
+                out << c;
+        }
+        out << '"';
+    }
+}
+
+int64_t TraceScope::nowUs()
+{
+    return ClockSync::hostNowUs();
+}
+
+void Trace::setThreadName(const std::string &name)
+{
+    ThreadSlot &slot = threadSlot();
+    slot.name = name;
+    if (slot.ring)
+    {
+        std::lock_guard<std::mutex> lock(registry().mutex);
+        slot.ring->threadName = name;
+    }
+}
+
+void Trace::recordSpan(const char *name, int64_t startUs, int64_t endUs)
+{
+    ThreadSlot &slot = threadSlot();
+    ThreadRing &ring = slot.ring ? *slot.ring : acquireRing(slot);
+
+    // Claim the slot before touching it: a reader that sees any of the new
+    // fields also sees the claim (fence to fence) and drops that index
+    uint64_t index = ring.written.load(std::memory_order_relaxed);
+    ring.claimed.store(index + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    EventSlot &event = ring.events[index % RING_CAPACITY];
+    event.name.store(name, std::memory_order_relaxed);
+    event.startUs.store(startUs, std::memory_order_relaxed);
+    event.durationUs.store(endUs - startUs, std::memory_order_relaxed);
+    ring.written.store(index + 1, std::memory_order_release);
+}
+
+void Trace::writeChromeJson(std::ostream &out)
+{
+    // Snapshot the ring list; the rings themselves are read without the lock
+    std::vector<std::shared_ptr<ThreadRing>> rings;
+    std::vector<uint32_t> threadIds;
+    std::vector<std::string> names;
+    {
+        Registry &reg = registry();
+        std::lock_guard<std::mutex> lock(reg.mutex);
+        rings = reg.rings;
+        for (const auto &ring : rings)
+        {
+            threadIds.push_back(ring->threadId);
+            names.push_back(ring->threadName);
+        }
+    }
+
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    bool first = true;
+
+    for (size_t r = 0; r < rings.size(); ++r)
+    {
+        const ThreadRing &ring = *rings[r];
+
+        uint64_t end = ring.written.load(std::memory_order_acquire);
+        uint64_t begin = (end > RING_CAPACITY) ? end - RING_CAPACITY : 0;
+        begin = std::max(begin, std::min(end, ring.clearedAt.load(std::memory_order_relaxed)));
+
+        std::vector<TraceEvent> copy;
+        copy.reserve(static_cast<size_t>(end - begin));
+        for (uint64_t i = begin; i < end; ++i)
+        {
+            const EventSlot &event = ring.events[i % RING_CAPACITY];
+            copy.push_back(TraceEvent{event.name.load(std::memory_order_relaxed),
+                                      event.startUs.load(std::memory_order_relaxed),
+                                      event.durationUs.load(std::memory_order_relaxed)});
+        }
+
+        // Drop whatever the writer claimed, and so may have overwritten, during the copy
+        std::atomic_thread_fence(std::memory_order_acquire);
+        uint64_t after = ring.claimed.load(std::memory_order_relaxed);
+        uint64_t safeBegin = (after > RING_CAPACITY) ? after - RING_CAPACITY : 0;
+        size_t skip = (safeBegin > begin) ? static_cast<size_t>(std::min(safeBegin - begin, end - begin)) : 0;
+
+        out << (first ? "\n" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << threadIds[r]
+            << ",\"args\":{\"name\":";
+        writeJsonString(out, names[r]);
+        out << "}}";
+        first = false;
+
+        for (size_t i = skip; i < copy.size(); ++i)
+        {
+            const TraceEvent &event = copy[i];
+            out << ",\n{\"name\":";
+            writeJsonString(out, event.name ? event.name : "?");
+            out << ",\"cat\":\"treadmill\",\"ph\":\"X\",\"ts\":" << event.startUs << ",\"dur\":" << event.durationUs
+                << ",\"pid\":1,\"tid\":" << threadIds[r] << "}";
+        }
+    }
+
+    out << "\n]}\n";
+}
+
+bool Trace::dumpToFile(const std::string &filepath)
+{
+    try
+    {
+        std::ofstream file(filepath);
+        if (!file.is_open())
+        {
+            std::cerr << "Could not create trace file: " << filepath << std::endl;
+            return false;
+        }
+        writeChromeJson(file);
+        return file.good();
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << "Error writing trace: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+void Trace::clear()
+{
+    Registry &reg = registry();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+    for (const auto &ring : reg.rings)
+    {
+        // Move the floor rather than the write index so tracing threads are never disturbed
+        ring->clearedAt.store(ring->written.load(std::memory_order_acquire), std::memory_order_relaxed);
+    }
+}
@@ -0,0 +1,70 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+/**
+ * Lightweight scoped tracing, exported as Chrome/Perfetto trace-event JSON
+ * Each thread records complete spans into its own fixed ring (oldest spans
+ * are overwritten), taken on its first span and handed to a later thread once
+ * it exits. When tracing is off a TRACE_SCOPE costs one relaxed load.
+ * Span names must be string literals (or otherwise outlive the dump).
+ */
+class Trace
+{
+public:
+    static constexpr size_t RING_CAPACITY = 8192; // Spans kept per thread
+
+    // Delete constructor to prevent instantiation
+    Trace() = delete;
+
+    static void setEnabled(bool enabled) { s_enabled.store(enabled, std::memory_order_relaxed); }
+    static bool isEnabled() { return s_enabled.load(std::memory_order_relaxed); }
+
+    // Label the calling thread in the exported trace
+    static void setThreadName(const std::string &name);
+
+    static void recordSpan(const char *name, int64_t startUs, int64_t endUs);
+
+    // Safe to call while other threads are still tracing
+    static void writeChromeJson(std::ostream &out);
+    static bool dumpToFile(const std::string &filepath);
+    static void clear();
+
+private:
+    static std::atomic<bool> s_enabled;
+};
+
+/**
+ * RAII span; use through TRACE_SCOPE
+ */
+class TraceScope
+{
+public:
+    explicit TraceScope(const char *name)
+        : m_name(Trace::isEnabled() ? name : nullptr), m_startUs(m_name ? nowUs() : 0)
+    {
+    }
+
+    ~TraceScope()
+    {
+        if (m_name)
+        {
+            Trace::recordSpan(m_name, m_startUs, nowUs());
+        }
+    }
+
+    TraceScope(const TraceScope &) = delete;
+    TraceScope &operator=(const TraceScope &) = delete;
+
+private:
+    static int64_t nowUs();
+
+    const char *m_name;
+    int64_t m_startUs;
+};
+
+#define TRACE_CONCAT_INNER(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+#define TRACE_SCOPE(name) TraceScope TRACE_CONCAT(traceScope_, __LINE__)(name)
@@ -1,18 +1,86 @@
 #include "TreadmillController.h"
+#include "Crc16.h"
+#include "Trace.h"
+#include <algorithm>
 #include <iostream>
+#include <iomanip>
 #include <chrono>
+#include <cstdint>
+#include <cstdio>
 #include <sstream>
+#include <thread>
 #include <vector>
 
+namespace
+{
+    // TICK, CTL, RX and TEL lines, as bits in m_pendingStatsTasks
+    constexpr uint8_t ALL_STATS_TASKS = 0x0F;
+
+    uint32_t clampMicros(int64_t micros)
+    {
+        return static_cast<uint32_t>(std::min<int64_t>(std::max<int64_t>(micros, 0), UINT32_MAX));
+    }
+
+    // B,<seq>,<payload>,<crc16 of "<seq>,<payload>">
+    bool parseBurstLine(const std::string &line, uint32_t &seq)
+    {
+        size_t crcComma = line.rfind(',');
+        if (line.rfind("B,", 0) != 0 || crcComma == std::string::npos || crcComma < 3)
+        {
+            return false;
+        }
+
+        std::string_view body(line.data() + 2, crcComma - 2);
+        uint16_t crc = 0;
+        if (!Crc16::fromHex(std::string_view(line).substr(crcComma + 1), crc) || Crc16::compute(body) != crc)
+        {
+            return false;
+        }
+
+        size_t seqEnd = body.find(',');
+        if (seqEnd == std::string_view::npos || seqEnd == 0 || seqEnd > 5)
+        {
+            return false;
+        }
+
+        uint32_t value = 0;
+        for (char c : body.substr(0, seqEnd))
+        {
+            if (c < '0' || c > '9')
+            {
+                return false;
+            }
+            value = value * 10 + (c - '0');
+        }
+        seq = value;
+        return true;
+    }
+}
+
 // Protocol constants
 const std::string TreadmillController::Protocol::START_READ = "START_READ";
 const std::string TreadmillController::Protocol::END_READ = "END_READ";
 const std::string TreadmillController::Protocol::RUN = "RUN_TM ";
+const std::string TreadmillController::Protocol::STREAM = "STREAM";
 const std::string TreadmillController::Protocol::STOP = "STOP_TM";
 const std::string TreadmillController::Protocol::HEARTBEAT = "HEARTBEAT";
+const std::string TreadmillController::Protocol::STATS = "STATS";
+const std::string TreadmillController::Protocol::STATS_RESET = "STATS,RESET";
+const std::string TreadmillController::Protocol::PING = "PING,";
+const std::string TreadmillController::Protocol::PONG = "PONG,";
+const std::string TreadmillController::Protocol::BAUD = "BAUD,";
+const std::string TreadmillController::Protocol::BAUD_OK = "BAUD_OK,";
+const std::string TreadmillController::Protocol::BAUD_COMMIT = "BAUD_COMMIT";
+const std::string TreadmillController::Protocol::BAUD_COMMITTED = "BAUD_COMMITTED,";
+const std::string TreadmillController::Protocol::BURST = "BURST,";
+const std::string TreadmillController::Protocol::BURST_END = "BURST_END";
+const std::string TreadmillController::Protocol::PROFILE_QUERY = "PROFILE?";
+const std::string TreadmillController::Protocol::PROFILE = "PROFILE,";
+const std::string TreadmillController::Protocol::PROFILE_BIN = "PROFILE_BIN,";
 const std::string TreadmillController::Protocol::READY = "READY";
 const std::string TreadmillController::Protocol::ACK = "ACK";
 const std::string TreadmillController::Protocol::RUNNING = "RUNNING";
+const std::string TreadmillController::Protocol::STREAMING = "STREAMING";
 const std::string TreadmillController::Protocol::STOPPED = "STOPPED";
 const std::string TreadmillController::Protocol::ERR = "ERR";
 
@@ -21,19 +89,25 @@ TreadmillController::TreadmillController()
 {
 }
 
+TreadmillController::TreadmillController(std::shared_ptr<IoThreadPool> ioPool)
+    : m_serialComm(std::make_unique<SerialManager>(std::move(ioPool)))
+{
+}
+
 TreadmillController::~TreadmillController()
 {
+    joinStreamThread();
     stopHeartbeat();
     disconnect();
 }
 
-bool TreadmillController::initialize(const std::string &portName, unsigned int baudRate)
+bool TreadmillController::initialize(const std::string &portName, unsigned int baudRate, bool lowLatency)
 {
-    bool success = m_serialComm->initialize(portName, baudRate);
+    bool success = m_serialComm->initialize(portName, baudRate, SerialManager::DEFAULT_TIMEOUT_MS, lowLatency);
     if (success)
     {
-        // Create heartbeat timer using serial communication's io_context
-        m_heartbeatTimer = std::make_unique<asio::steady_timer>(m_serialComm->getIoContext());
+        // Heartbeats share the port's strand, so on a shared pool they never overlap its reads
+        m_heartbeatTimer = std::make_unique<asio::steady_timer>(m_serialComm->getStrand());
     }
     return success;
 }
@@ -54,16 +128,60 @@ bool TreadmillController::runTreadmill(const std::vector<std::string> &speedComm
         return false;
     }
 
+    if (isSafetyStopped())
+    {
+        logError("Safety stop latched (" + getSafetyStopReason() + "); clear it before starting a run");
+        updateStatus("ERROR: Safety stop latched - clear it first");
+        return false;
+    }
+
+    std::unique_lock<std::mutex> idleLock(m_idleOperationMutex, std::try_to_lock);
+    if (!idleLock.owns_lock())
+    {
+        logError("Another operation is using the connection; run not started");
+        return false;
+    }
+
     // 1: SENDING COMMANDS
     try
     {
         // a. Communicate with motor controller via protocol
         if (!initiateProtocol())
             return false;
-        if (!uploadCommands(speedCommands))
-            return false;
-        if (!finalizeUpload())
-            return false;
+
+        // b. Upload, unless the device already holds this exact profile.
+        // Lines the firmware would reject cannot be hashed; those always upload.
+        std::vector<CompiledStep> steps;
+        std::optional<StoredProfile> expected;
+        if (ProfileParser::compileSteps(speedCommands, steps))
+        {
+            expected = StoredProfile{steps.size(), ProfileParser::checksum(steps)};
+        }
+
+        std::optional<StoredProfile> stored = queryStoredProfile();
+        if (expected && stored && stored->steps == expected->steps && stored->crc == expected->crc)
+        {
+            std::cout << "Device already holds this profile; skipping upload" << std::endl;
+            updateStatus("Profile unchanged (" + std::to_string(expected->steps) + " steps) - upload skipped");
+        }
+        else if (!(m_binaryUpload && expected && stored && expected->steps <= stored->capacity &&
+                   uploadBinary(steps, *expected)))
+        {
+            // Text upload: older firmware, or a binary transfer that was refused
+            if (!beginUpload())
+                return false;
+            if (!uploadCommands(speedCommands))
+                return false;
+            if (!finalizeUpload())
+                return false;
+            // Firmware without PROFILE? cannot be checked
+            if (expected && stored && !verifyUpload(*expected))
+                return false;
+        }
+
+        // Aligned to the steps that are about to run; lines that do not compile leave it unplanned
+        m_runAnalytics.begin(expected ? steps : std::vector<CompiledStep>{});
+
         if (!startExecution())
             return false;
 
@@ -88,6 +206,7 @@ bool TreadmillController::runTreadmill(const std::vector<std::string> &speedComm
 
 bool TreadmillController::stopTreadmill()
 {
+    TRACE_SCOPE("stopTreadmill");
     if (!isConnected())
     {
         logError("Treadmill not connected: Cannot send stop command.");
@@ -133,6 +252,7 @@ bool TreadmillController::stopTreadmill()
 
 void TreadmillController::disconnect()
 {
+    joinStreamThread();
     stopHeartbeat();
     m_serialComm->disconnect();
 }
@@ -153,171 +273,663 @@ void TreadmillController::setStatusCallback(std::function<void(const std::string
     m_statusCallback = callback;
 }
 
-void TreadmillController::setTelemetryCallback(std::function<void(const TelemetryData &)> callback)
+void TreadmillController::setTelemetryBus(std::shared_ptr<TelemetryBus> bus, size_t deviceId)
 {
-    m_telemetryCallback = callback;
+    m_telemetryBus = std::move(bus);
+    m_deviceId = deviceId;
 }
 
-void TreadmillController::handleRawTelemetry(const std::string &rawData)
+void TreadmillController::setControlStatsCallback(std::function<void(const ControlLoopStats &)> callback)
 {
-    // Expected format: TEL,timestamp,target1,actual1,target2,actual2,health1,health2,estop,profileActive
-    if (rawData.rfind("TEL,", 0) != 0)
+    m_controlStatsCallback = callback;
+}
+
+LinkStatsSnapshot TreadmillController::getLinkStats() const
+{
+    return m_serialComm->getLinkStats().snapshot();
+}
+
+void TreadmillController::resetLinkStats()
+{
+    m_serialComm->getLinkStats().reset();
+}
+
+TelemetryLatencySnapshot TreadmillController::getTelemetryLatency() const
+{
+    TelemetryLatencySnapshot snapshot;
+    snapshot.clock = m_clockSync.getState();
+    snapshot.deviceToHost = m_deviceToHostLatency.summarize();
+    snapshot.hostToScreen = m_hostToScreenLatency.summarize();
+    return snapshot;
+}
+
+void TreadmillController::recordPresentation(int64_t hostArrivalUs)
+{
+    if (hostArrivalUs > 0)
+    {
+        m_hostToScreenLatency.record(clampMicros(ClockSync::hostNowUs() - hostArrivalUs));
+    }
+}
+
+LatencySummary TreadmillController::probeRoundTrip(int samples)
+{
+    LatencyHistogram histogram;
+    std::unique_lock<std::mutex> idleLock(m_idleOperationMutex, std::try_to_lock);
+    if (!idleLock.owns_lock() || !isConnected() || m_serialComm->isListening())
     {
-        return; // Not a telemetry message
+        logError("Round-trip probe needs an idle connection");
+        return histogram.summarize();
     }
 
     try
     {
-        std::vector<std::string> parts;
-        std::stringstream ss(rawData);
-        std::string item;
-
-        while (std::getline(ss, item, ','))
+        purgeBuffer();
+        for (int i = 0; i < samples; ++i)
         {
-            parts.push_back(item);
-        }
+            std::string ping = Protocol::PING + std::to_string(m_pingSeq.fetch_add(1));
+            int64_t sentUs = ClockSync::hostNowUs();
+            m_serialComm->sendCommand(ping);
 
-        if (parts.size() < 10)
-        {
-            std::cerr << "Invalid telemetry format: " << rawData << std::endl;
-            return;
+            auto response = m_serialComm->readResponse(200);
+            if (response && (response->rfind(Protocol::PONG, 0) == 0 || *response == ping))
+            {
+                histogram.record(clampMicros(ClockSync::hostNowUs() - sentUs));
+            }
         }
+    }
+    catch (const std::exception &e)
+    {
+        logError("Error during round-trip probe: " + std::string(e.what()));
+    }
+    return histogram.summarize();
+}
 
-        TelemetryData data;
-        data.timestamp = std::stoul(parts[1]);
-        data.targetRpm1 = std::stof(parts[2]);
-        data.actualRpm1 = std::stof(parts[3]);
-        data.targetRpm2 = std::stof(parts[4]);
-        data.actualRpm2 = std::stof(parts[5]);
-        data.driver1Healthy = (parts[6] == "1");
-        data.driver2Healthy = (parts[7] == "1");
-        data.emergencyStop = (parts[8] == "1");
-        data.profileActive = (parts[9] == "1");
+bool TreadmillController::requestControlLoopStats()
+{
+    if (!isConnected())
+    {
+        return false;
+    }
 
-        // Check for completion
-        if (!data.profileActive)
+    try
+    {
+        sendStatsRequest();
+        if (m_serialComm->isListening())
         {
-            // Only trigger completion logic if we were previously running
-            bool expected = true;
-            if (m_isRunActive.compare_exchange_strong(expected, false))
-            {
-                // Run finished!
-                stopHeartbeat();
-                updateStatus("Run completed successfully.");
-                // Notify UI via status callback
-                if (m_statusCallback)
-                {
-                    m_statusCallback("FINISHED");
-                }
-            }
+            return true; // Reply is handled by handleRawTelemetry
         }
 
-        if (m_telemetryCallback)
+        // Idle: 4 task lines followed by the terminating LOOP line
+        for (int i = 0; i < 8; ++i)
         {
-            m_telemetryCallback(data);
+            auto line = m_serialComm->readResponse(200);
+            if (!line)
+            {
+                return false;
+            }
+            if (handleStatsLine(*line))
+            {
+                return true;
+            }
         }
     }
     catch (const std::exception &e)
     {
-        std::cerr << "Error parsing telemetry: " << e.what() << std::endl;
+        logError("Error requesting control loop stats: " + std::string(e.what()));
     }
+    return false;
 }
 
-// Protocol phases
-bool TreadmillController::initiateProtocol()
+ControlLoopStats TreadmillController::getControlLoopStats() const
 {
-    updateStatus("Initiating communication with treadmill...");
-    std::cout << "Starting treadmill protocol..." << std::endl;
+    std::lock_guard<std::mutex> lock(m_loopStatsMutex);
+    return m_loopStats;
+}
 
-    // 1. Force IDLE state and clear buffer
-    if (!synchronizeWithDevice())
+bool TreadmillController::handleStatsLine(const std::string &line)
+{
+    // STATS,<task>,<lastUs>,<maxUs>,<h0>,...,<h7>  or  STATS,LOOP,<ticks>,<overruns>,<skipped>
+    if (line.rfind("STATS,", 0) != 0)
     {
-        logError("Failed to synchronize with treadmill (no STOPPED response)");
-        updateStatus("ERROR: Treadmill synchronization failed");
         return false;
     }
 
-    // 2. Start the actual protocol
-    m_serialComm->sendCommand(Protocol::START_READ);
-    auto response = m_serialComm->readResponse();
+    try
+    {
+        std::vector<std::string> parts;
+        std::stringstream ss(line);
+        std::string item;
+        while (std::getline(ss, item, ','))
+        {
+            parts.push_back(item);
+        }
+
+        if (parts.size() < 2)
+        {
+            return false;
+        }
 
-    if (!response || *response != Protocol::READY)
+        const std::string &task = parts[1];
+        if (task == "LOOP")
+        {
+            if (parts.size() < 5)
+            {
+                return false;
+            }
+
+            // A report that lost a task line would mix zeros with real values; drop it
+            bool complete = m_pendingStatsTasks == ALL_STATS_TASKS;
+            m_pendingStatsTasks = 0;
+            if (!complete)
+            {
+                m_pendingLoopStats = ControlLoopStats();
+                return true;
+            }
+
+            m_pendingLoopStats.ticks = std::stoul(parts[2]);
+            m_pendingLoopStats.overruns = std::stoul(parts[3]);
+            m_pendingLoopStats.skippedTicks = std::stoul(parts[4]);
+            m_pendingLoopStats.valid = true;
+
+            int64_t requestedUs = m_statsRequestedUs.exchange(0);
+            if (requestedUs != 0)
+            {
+                m_serialComm->getLinkStats().recordRoundTrip(LinkCommand::Stats, clampMicros(ClockSync::hostNowUs() - requestedUs));
+            }
+
+            ControlLoopStats completed = m_pendingLoopStats;
+            m_pendingLoopStats = ControlLoopStats();
+            {
+                std::lock_guard<std::mutex> lock(m_loopStatsMutex);
+                m_loopStats = completed;
+            }
+
+            if (m_controlStatsCallback)
+            {
+                m_controlStatsCallback(completed);
+            }
+            return true;
+        }
+
+        if (parts.size() < 4 + TaskTimingStats::BUCKET_COUNT)
+        {
+            return false;
+        }
+
+        TaskTimingStats *target = nullptr;
+        uint8_t taskBit = 0;
+        if (task == "TICK")
+        {
+            target = &m_pendingLoopStats.tick;
+            taskBit = 1;
+        }
+        else if (task == "CTL")
+        {
+            target = &m_pendingLoopStats.control;
+            taskBit = 2;
+        }
+        else if (task == "RX")
+        {
+            target = &m_pendingLoopStats.serial;
+            taskBit = 4;
+        }
+        else if (task == "TEL")
+        {
+            target = &m_pendingLoopStats.telemetry;
+            taskBit = 8;
+        }
+
+        if (target)
+        {
+            m_pendingStatsTasks |= taskBit;
+            target->lastUs = static_cast<uint16_t>(std::stoul(parts[2]));
+            target->maxUs = static_cast<uint16_t>(std::stoul(parts[3]));
+            for (int b = 0; b < TaskTimingStats::BUCKET_COUNT; ++b)
+            {
+                target->histogram[b] = static_cast<uint16_t>(std::stoul(parts[4 + b]));
+            }
+        }
+    }
+    catch (const std::exception &e)
     {
-        logError("Failed to receive READY response", response);
-        updateStatus("ERROR: Treadmill not ready");
-        return false;
+        m_serialComm->getLinkStats().recordParseError();
+        std::cerr << "Error parsing stats: " << e.what() << std::endl;
     }
-
-    std::cout << "Received READY from treadmill" << std::endl;
-    updateStatus("Treadmill ready - sending commands...");
-    return true;
+    return false;
 }
 
-bool TreadmillController::uploadCommands(const std::vector<std::string> &commands)
+bool TreadmillController::parseTelemetryLine(const std::string &line, TelemetryData &data)
 {
-    std::cout << "Sending " << commands.size() << " speed commands..." << std::endl;
+    // Expected format: TEL,timestamp,target1,actual1,target2,actual2,health1,health2,estop,profileActive
+    //                  [,dropped,quality1,quality2[,seq[,setpointSeq]]]
+    if (line.rfind("TEL,", 0) != 0)
+    {
+        return false; // Not a telemetry message
+    }
 
-    for (size_t i = 0; i < commands.size(); ++i)
+    try
     {
-        m_serialComm->sendCommand(commands[i]);
-        std::cout << "Sent command " << (i + 1) << "/" << commands.size()
-                  << ": " << commands[i] << std::endl;
-        updateStatus("Command " + std::to_string(i + 1) + "/" + std::to_string(commands.size()) + " sent");
+        std::vector<std::string> parts;
+        std::stringstream ss(line);
+        std::string item;
 
-        auto response = m_serialComm->readResponse();
-        if (!response || *response != Protocol::READY)
+        while (std::getline(ss, item, ','))
         {
-            logError("Failed to receive READY for command " + std::to_string(i + 1), response);
-            updateStatus("ERROR: Command " + std::to_string(i + 1) + " failed");
+            parts.push_back(item);
+        }
+
+        if (parts.size() < 10)
+        {
+            std::cerr << "Invalid telemetry format: " << line << std::endl;
             return false;
         }
-        std::cout << "  -> READY received" << std::endl;
+
+        data.timestamp = std::stoul(parts[1]);
+        data.targetRpm1 = std::stof(parts[2]);
+        data.actualRpm1 = std::stof(parts[3]);
+        data.targetRpm2 = std::stof(parts[4]);
+        data.actualRpm2 = std::stof(parts[5]);
+        data.driver1Healthy = (parts[6] == "1");
+        data.driver2Healthy = (parts[7] == "1");
+        data.emergencyStop = (parts[8] == "1");
+        data.profileActive = (parts[9] == "1");
+        // Older firmware does not report TX drops
+        data.droppedFrames = (parts.size() > 10) ? static_cast<uint16_t>(std::stoul(parts[10])) : 0;
+        data.speedQuality1 = (parts.size() > 12) ? static_cast<SpeedEstimateQuality>(std::stoul(parts[11]) & 0x3)
+                                                 : SpeedEstimateQuality::Count;
+        data.speedQuality2 = (parts.size() > 12) ? static_cast<SpeedEstimateQuality>(std::stoul(parts[12]) & 0x3)
+                                                 : SpeedEstimateQuality::Count;
+        data.sequence = (parts.size() > 13) ? static_cast<int32_t>(std::stoul(parts[13]) & 0xFFFF) : -1;
+        data.setpointSeq = (parts.size() > 14) ? static_cast<int32_t>(std::stoul(parts[14]) & 0xFFFF) : -1;
+        data.gapBefore = 0;
+        return true;
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << "Error parsing telemetry: " << e.what() << std::endl;
+        return false;
     }
-    return true;
 }
 
-bool TreadmillController::finalizeUpload()
+bool TreadmillController::handlePongLine(const std::string &line, int64_t arrivalUs)
 {
-    std::cout << "Finalizing command transmission..." << std::endl;
-    m_serialComm->sendCommand(Protocol::END_READ);
-
-    auto response = m_serialComm->readResponse();
-    if (!response || *response != Protocol::ACK)
+    // PONG,<seq>,<millis>
+    if (line.rfind(Protocol::PONG, 0) != 0)
     {
-        logError("Failed to receive ACK for END_READ", response);
         return false;
     }
 
-    std::cout << "END_READ acknowledged" << std::endl;
-    return true;
-}
-
-bool TreadmillController::startExecution()
-{
-    std::cout << "Starting treadmill execution..." << std::endl;
-    updateStatus("All commands sent - starting treadmill...");
+    try
+    {
+        size_t comma = line.find(',', Protocol::PONG.size());
+        if (comma == std::string::npos)
+        {
+            m_serialComm->getLinkStats().recordParseError();
+            return true;
+        }
 
-    m_serialComm->sendCommand(Protocol::RUN);
-    auto response = m_serialComm->readResponse();
+        uint32_t seq = static_cast<uint32_t>(std::stoul(line.substr(Protocol::PONG.size(), comma - Protocol::PONG.size())));
+        uint32_t deviceMs = static_cast<uint32_t>(std::stoul(line.substr(comma + 1)));
 
-    if (!response || *response != Protocol::RUNNING)
+        // Each slot is claimed once, so duplicate or stale replies are ignored
+        int64_t sentUs = m_pingSentUs[seq % PING_SLOTS].exchange(0);
+        if (sentUs != 0)
+        {
+            m_clockSync.addExchange(sentUs, arrivalUs, deviceMs);
+        }
+    }
+    catch (const std::exception &)
     {
-        logError("Failed to receive ACK for RUN command", response);
-        updateStatus("ERROR: Failed to start treadmill");
-        return false;
+        m_serialComm->getLinkStats().recordParseError();
     }
-
-    std::cout << "Treadmill is now running!" << std::endl;
-    updateStatus("✓ Treadmill running successfully");
     return true;
 }
 
-// Heartbeat management
-void TreadmillController::startHeartbeat()
+void TreadmillController::handleRawTelemetry(const std::string &rawData)
 {
-    if (!isConnected())
+    TRACE_SCOPE("handleRawTelemetry");
+    int64_t arrivalUs = ClockSync::hostNowUs();
+
+    if (handleStatsLine(rawData) || handlePongLine(rawData, arrivalUs) || handleStreamErrorLine(rawData))
     {
-        std::cerr << "Cannot start heartbeat: treadmill not connected" << std::endl;
+        return;
+    }
+
+    TelemetryData data;
+    if (!parseTelemetryLine(rawData, data))
+    {
+        if (rawData.rfind("TEL,", 0) == 0)
+        {
+            m_serialComm->getLinkStats().recordParseError();
+            m_sequenceTracker.recordCorrupted();
+        }
+        return;
+    }
+
+    if (data.sequence >= 0)
+    {
+        SequenceTracker::Result result = m_sequenceTracker.track(static_cast<uint16_t>(data.sequence));
+        if (result.verdict == SequenceTracker::Verdict::Duplicate)
+        {
+            return; // Never record the same frame twice
+        }
+        data.gapBefore = result.missing;
+    }
+
+    data.hostArrivalUs = arrivalUs;
+    TelemetrySample sample{m_deviceId, data};
+
+    // Safety first: the rules see the frame before any bookkeeping or subscriber does
+    if (m_safetyMonitor)
+    {
+        for (SafetyEvent &event : m_safetyMonitor->evaluate(sample))
+        {
+            if (event.action == SafetyAction::Stop)
+            {
+                priorityStop(event.rule + " (" + event.detail + ")");
+            }
+            m_safetyMonitor->complete(event);
+            if (event.action == SafetyAction::Stop)
+            {
+                updateStatus("SAFETY STOP: " + event.rule + " (" + event.detail + ")");
+            }
+        }
+    }
+
+    m_runAnalytics.addSample(data);
+
+    if (m_clockSync.isSynchronized())
+    {
+        m_deviceToHostLatency.record(clampMicros(arrivalUs - m_clockSync.toHostUs(data.timestamp)));
+    }
+
+    // First frame to report a streamed setpoint as applied; each slot is claimed once
+    if (m_streamActive && data.setpointSeq >= 0)
+    {
+        int64_t sentUs = m_setpointSentUs[data.setpointSeq % SETPOINT_SLOTS].exchange(0);
+        if (sentUs != 0)
+        {
+            m_setpointLatency.record(clampMicros(arrivalUs - sentUs));
+        }
+    }
+
+    // Check for completion
+    if (!data.profileActive)
+    {
+        // Only trigger completion logic if we were previously running
+        bool expected = true;
+        if (m_isRunActive.compare_exchange_strong(expected, false))
+        {
+            // Run finished!
+            stopHeartbeat();
+            updateStatus("Run completed successfully.");
+            // Notify UI via status callback
+            if (m_statusCallback)
+            {
+                m_statusCallback("FINISHED");
+            }
+        }
+    }
+
+    m_telemetryBus->publish(std::move(sample));
+}
+
+void TreadmillController::priorityStop(const std::string &reason)
+{
+    TRACE_SCOPE("priorityStop");
+    {
+        // The stream thread sends under the same lock, so once STOP_TM is out no
+        // SPD from this stream follows it, not even the final SPD,0,0
+        std::lock_guard<std::mutex> lock(m_safetyStopMutex);
+        if (!m_safetyStopped)
+        {
+            m_safetyStopReason = reason; // The first rule to fire is the cause
+        }
+        m_safetyStopped = true;
+        m_streamActive = false;
+        try
+        {
+            m_serialComm->sendCommand(Protocol::STOP);
+        }
+        catch (const std::exception &e)
+        {
+            logError("Safety stop could not be sent: " + std::string(e.what()));
+        }
+    }
+
+    // The STOPPED reply is ignored by the listener; stopTreadmill() later confirms IDLE as usual
+    m_isRunActive = false;
+    stopHeartbeat();
+}
+
+bool TreadmillController::isSafetyStopped() const
+{
+    std::lock_guard<std::mutex> lock(m_safetyStopMutex);
+    return m_safetyStopped;
+}
+
+std::string TreadmillController::getSafetyStopReason() const
+{
+    std::lock_guard<std::mutex> lock(m_safetyStopMutex);
+    return m_safetyStopReason;
+}
+
+bool TreadmillController::clearSafetyStop()
+{
+    std::string reason;
+    {
+        std::lock_guard<std::mutex> lock(m_safetyStopMutex);
+        if (!m_safetyStopped)
+        {
+            return false;
+        }
+        m_safetyStopped = false;
+        reason.swap(m_safetyStopReason);
+    }
+    std::cout << "Safety stop cleared by operator: " << reason << std::endl;
+    updateStatus("Safety stop cleared");
+    return true;
+}
+
+// Protocol phases
+bool TreadmillController::initiateProtocol()
+{
+    TRACE_SCOPE("initiateProtocol");
+    updateStatus("Initiating communication with treadmill...");
+    std::cout << "Starting treadmill protocol..." << std::endl;
+
+    // 1. Force IDLE state and clear buffer
+    if (!synchronizeWithDevice())
+    {
+        logError("Failed to synchronize with treadmill (no STOPPED response)");
+        updateStatus("ERROR: Treadmill synchronization failed");
+        return false;
+    }
+
+    // 2. Map device time onto host time before anything is timestamped
+    synchronizeClock(4);
+    return true;
+}
+
+std::optional<TreadmillController::StoredProfile> TreadmillController::queryStoredProfile()
+{
+    // PROFILE,<steps>,<crc hex>[,<capacity>]; older firmware ignores the query
+    auto response = transact(Protocol::PROFILE_QUERY, LinkCommand::ProfileQuery, 250);
+    if (!response || response->rfind(Protocol::PROFILE, 0) != 0)
+    {
+        return std::nullopt;
+    }
+
+    std::string_view reply(*response);
+    size_t comma = reply.find(',', Protocol::PROFILE.size());
+    StoredProfile stored;
+    try
+    {
+        if (comma == std::string::npos ||
+            !Crc16::fromHex(reply.substr(comma + 1, 4), stored.crc))
+        {
+            throw std::invalid_argument("bad PROFILE reply");
+        }
+        stored.steps = std::stoul(response->substr(Protocol::PROFILE.size(), comma - Protocol::PROFILE.size()));
+        if (comma + 5 < reply.size() && reply[comma + 5] == ',')
+        {
+            stored.capacity = std::stoul(response->substr(comma + 6));
+        }
+    }
+    catch (const std::exception &)
+    {
+        m_serialComm->getLinkStats().recordParseError();
+        return std::nullopt;
+    }
+    return stored;
+}
+
+bool TreadmillController::uploadBinary(const std::vector<CompiledStep> &steps, const StoredProfile &expected)
+{
+    TRACE_SCOPE("uploadBinary");
+
+    // PROFILE_BIN,<steps>,<crc> then the packed steps; the firmware checks the
+    // CRC over what it stored and answers once
+    char crc[5] = {};
+    Crc16::toHex(expected.crc, crc);
+    std::string header = Protocol::PROFILE_BIN + std::to_string(steps.size()) + "," + crc;
+    std::vector<uint8_t> payload = ProfileParser::packSteps(steps);
+
+    // Wire time for the payload at 10 bits per byte, plus the usual reply margin
+    unsigned int baudRate = std::max(m_serialComm->getBaudRate(), 1u);
+    int timeoutMs = 500 + static_cast<int>(payload.size() * 10000ULL / baudRate);
+
+    int64_t sentUs = ClockSync::hostNowUs();
+    m_serialComm->sendCommand(header, payload);
+    auto response = m_serialComm->readResponse(timeoutMs);
+    if (!response || *response != Protocol::ACK)
+    {
+        logError("Binary profile upload refused, falling back to text upload", response);
+        purgeBuffer();
+        return false;
+    }
+
+    m_serialComm->getLinkStats().recordRoundTrip(LinkCommand::ProfileBinary, clampMicros(ClockSync::hostNowUs() - sentUs));
+    std::cout << "Uploaded " << steps.size() << " steps in one binary transfer (" << payload.size() << " bytes)" << std::endl;
+    updateStatus("Profile uploaded (" + std::to_string(steps.size()) + " steps, CRC verified)");
+    return true;
+}
+
+bool TreadmillController::beginUpload()
+{
+    TRACE_SCOPE("beginUpload");
+    auto response = transact(Protocol::START_READ, LinkCommand::StartRead);
+
+    if (!response || *response != Protocol::READY)
+    {
+        logError("Failed to receive READY response", response);
+        updateStatus("ERROR: Treadmill not ready");
+        return false;
+    }
+
+    std::cout << "Received READY from treadmill" << std::endl;
+    updateStatus("Treadmill ready - sending commands...");
+    return true;
+}
+
+bool TreadmillController::uploadCommands(const std::vector<std::string> &commands)
+{
+    TRACE_SCOPE("uploadCommands");
+    std::cout << "Sending " << commands.size() << " speed commands..." << std::endl;
+
+    for (size_t i = 0; i < commands.size(); ++i)
+    {
+        auto response = transact(commands[i], LinkCommand::ProfileStep);
+        std::cout << "Sent command " << (i + 1) << "/" << commands.size()
+                  << ": " << commands[i] << std::endl;
+        updateStatus("Command " + std::to_string(i + 1) + "/" + std::to_string(commands.size()) + " sent");
+
+        if (!response || *response != Protocol::READY)
+        {
+            logError("Failed to receive READY for command " + std::to_string(i + 1), response);
+            updateStatus("ERROR: Command " + std::to_string(i + 1) + " failed");
+            return false;
+        }
+        std::cout << "  -> READY received" << std::endl;
+    }
+    return true;
+}
+
+bool TreadmillController::finalizeUpload()
+{
+    TRACE_SCOPE("finalizeUpload");
+    std::cout << "Finalizing command transmission..." << std::endl;
+    auto response = transact(Protocol::END_READ, LinkCommand::EndRead);
+    if (!response || *response != Protocol::ACK)
+    {
+        logError("Failed to receive ACK for END_READ", response);
+        return false;
+    }
+
+    std::cout << "END_READ acknowledged" << std::endl;
+    return true;
+}
+
+bool TreadmillController::verifyUpload(const StoredProfile &expected)
+{
+    TRACE_SCOPE("verifyUpload");
+    auto describe = [](const StoredProfile &profile)
+    {
+        char crc[5] = {};
+        Crc16::toHex(profile.crc, crc);
+        return std::to_string(profile.steps) + " steps, CRC " + crc;
+    };
+
+    std::optional<StoredProfile> stored = queryStoredProfile();
+    if (!stored || stored->steps != expected.steps || stored->crc != expected.crc)
+    {
+        logError("Device profile does not match the upload (expected " + describe(expected) + ")",
+                 stored ? std::optional<std::string>(describe(*stored)) : std::nullopt);
+        updateStatus("ERROR: Profile verification failed");
+        return false;
+    }
+
+    std::cout << "Device profile verified (" << expected.steps << " steps)" << std::endl;
+    return true;
+}
+
+bool TreadmillController::startExecution()
+{
+    TRACE_SCOPE("startExecution");
+    std::cout << "Starting treadmill execution..." << std::endl;
+    updateStatus("All commands sent - starting treadmill...");
+
+    // Start each run with fresh firmware timing stats (no reply) and fresh latency figures
+    m_serialComm->sendCommand(Protocol::STATS_RESET);
+    m_deviceToHostLatency.reset();
+    m_hostToScreenLatency.reset();
+    m_sequenceTracker.reset();
+
+    auto response = transact(Protocol::RUN, LinkCommand::Run);
+
+    if (!response || *response != Protocol::RUNNING)
+    {
+        logError("Failed to receive ACK for RUN command", response);
+        updateStatus("ERROR: Failed to start treadmill");
+        return false;
+    }
+
+    std::cout << "Treadmill is now running!" << std::endl;
+    updateStatus("✓ Treadmill running successfully");
+    return true;
+}
+
+// Heartbeat management
+void TreadmillController::startHeartbeat()
+{
+    if (!isConnected())
+    {
+        std::cerr << "Cannot start heartbeat: treadmill not connected" << std::endl;
+        return;
+    }
+    if (isSafetyStopped())
+    {
+        std::cerr << "Cannot start heartbeat: safety stop latched" << std::endl;
         return;
     }
 
@@ -349,11 +961,18 @@ void TreadmillController::scheduleHeartbeat()
     m_heartbeatTimer->expires_after(std::chrono::milliseconds(HEARTBEAT_INTERVAL_MS));
     m_heartbeatTimer->async_wait([this](const asio::error_code &ec)
                                  {
-        if (!ec && m_heartbeatActive && isConnected())
+        // A heartbeat would keep the firmware's run watchdog fed after a safety stop
+        if (!ec && m_heartbeatActive && isConnected() && !isSafetyStopped())
         {
+            TRACE_SCOPE("heartbeat");
             try
             {
                 m_serialComm->sendCommand(Protocol::HEARTBEAT);
+                sendPing();
+                if (m_controlStatsCallback)
+                {
+                    sendStatsRequest();
+                }
                 scheduleHeartbeat(); // Schedule next heartbeat
             }
             catch (const std::exception& e)
@@ -367,6 +986,554 @@ void TreadmillController::scheduleHeartbeat()
     // m_serialComm->getIoContext().poll(); // REMOVED: Background thread is already running the io_context
 }
 
+std::optional<std::string> TreadmillController::transact(const std::string &command, LinkCommand type, int timeoutMs)
+{
+    int64_t sentUs = ClockSync::hostNowUs();
+    m_serialComm->sendCommand(command);
+
+    auto response = m_serialComm->readResponse(timeoutMs);
+    if (response)
+    {
+        m_serialComm->getLinkStats().recordRoundTrip(type, clampMicros(ClockSync::hostNowUs() - sentUs));
+    }
+    return response;
+}
+
+void TreadmillController::sendStatsRequest()
+{
+    // Latest request wins; a lost reply simply goes unmeasured
+    m_statsRequestedUs = ClockSync::hostNowUs();
+    m_serialComm->sendCommand(Protocol::STATS);
+}
+
+void TreadmillController::sendPing()
+{
+    uint32_t seq = m_pingSeq.fetch_add(1);
+    m_pingSentUs[seq % PING_SLOTS] = ClockSync::hostNowUs();
+    m_serialComm->sendCommand(Protocol::PING + std::to_string(seq));
+}
+
+void TreadmillController::synchronizeClock(int exchanges)
+{
+    TRACE_SCOPE("synchronizeClock");
+    // Idle only: replies are read here rather than by the listener.
+    // Firmware without PING just leaves the clock unsynchronized.
+    for (int i = 0; i < exchanges; ++i)
+    {
+        sendPing();
+        auto response = m_serialComm->readResponse(50);
+        if (!response)
+        {
+            std::cerr << "Clock sync: no PONG from device" << std::endl;
+            return;
+        }
+        handlePongLine(*response, ClockSync::hostNowUs());
+    }
+
+    ClockSyncState state = m_clockSync.getState();
+    std::cout << "Clock sync: min RTT " << state.minRttUs << " us over " << state.exchanges << " exchanges" << std::endl;
+}
+
+BaudNegotiationResult TreadmillController::negotiateBaudRate()
+{
+    TRACE_SCOPE("negotiateBaudRate");
+    BaudNegotiationResult result;
+    // Held to the end, so no run or stream can start while the rate changes underneath it
+    std::unique_lock<std::mutex> idleLock(m_idleOperationMutex, std::try_to_lock);
+    if (!idleLock.owns_lock() || !isConnected() || m_serialComm->isListening())
+    {
+        logError("Baud negotiation needs an idle connection");
+        return result;
+    }
+
+    unsigned int startRate = m_serialComm->getBaudRate();
+    unsigned int goodRate = startRate;
+    updateStatus("Testing serial link from " + std::to_string(startRate) + " baud...");
+
+    try
+    {
+        purgeBuffer();
+        LinkTestResult baseline = runLinkTest(startRate);
+        baseline.switched = true;
+        result.attempts.push_back(baseline);
+        updateStatus(describeLinkTest(baseline));
+
+        if (baseline.passed)
+        {
+            // Step up until a rate fails
+            for (unsigned int rate : BAUD_RATES)
+            {
+                if (rate <= startRate)
+                    continue;
+
+                LinkTestResult attempt = tryBaudRate(rate, goodRate);
+                result.attempts.push_back(attempt);
+                updateStatus(describeLinkTest(attempt));
+                if (!attempt.passed)
+                    break;
+                goodRate = rate;
+            }
+        }
+        else
+        {
+            // Step down until a rate passes
+            for (auto it = BAUD_RATES.rbegin(); it != BAUD_RATES.rend(); ++it)
+            {
+                if (*it >= startRate)
+                    continue;
+
+                LinkTestResult attempt = tryBaudRate(*it, goodRate);
+                result.attempts.push_back(attempt);
+                updateStatus(describeLinkTest(attempt));
+                if (attempt.passed)
+                {
+                    goodRate = *it;
+                    break;
+                }
+            }
+        }
+
+        // Whatever happened above, the device must answer at the rate we settled on
+        result.baudRate = awaitPong(100) ? m_serialComm->getBaudRate() : 0;
+    }
+    catch (const std::exception &e)
+    {
+        logError("Error during baud negotiation: " + std::string(e.what()));
+    }
+
+    if (result.baudRate != 0)
+    {
+        updateStatus("Serial link running at " + std::to_string(result.baudRate) + " baud");
+    }
+    else
+    {
+        updateStatus("ERROR: Lost contact with the device during baud negotiation");
+    }
+    return result;
+}
+
+std::string TreadmillController::describeLinkTest(const LinkTestResult &result)
+{
+    std::ostringstream out;
+    out << result.baudRate << " baud: ";
+    if (!result.switched)
+    {
+        out << "not accepted by device - fail";
+        return out.str();
+    }
+
+    out << std::fixed << std::setprecision(1) << result.goodputBytesPerSec / 1000.0 << " kB/s, "
+        << std::setprecision(2) << result.errorRate * 100.0 << "% errors";
+    if (result.linesCorrupt > 0)
+    {
+        out << " (" << result.linesCorrupt << " corrupt lines)";
+    }
+    out << (result.passed ? " - pass" : " - fail");
+    return out.str();
+}
+
+LinkTestResult TreadmillController::runLinkTest(unsigned int baudRate)
+{
+    TRACE_SCOPE("runLinkTest");
+    LinkTestResult result;
+    result.baudRate = baudRate;
+    result.linesExpected = LINK_TEST_LINES;
+
+    // Device -> host: a CRC-checked burst, as fast as the firmware can stream it
+    std::vector<bool> seen(LINK_TEST_LINES, false);
+    uint64_t goodBytes = 0;
+    int64_t startUs = ClockSync::hostNowUs();
+    int64_t endUs = startUs;
+    m_serialComm->sendCommand(Protocol::BURST + std::to_string(LINK_TEST_LINES));
+
+    // A 100 ms silence means the rest of the burst is not coming
+    while (auto line = m_serialComm->readResponse(100))
+    {
+        endUs = ClockSync::hostNowUs();
+        if (line->rfind(Protocol::BURST_END, 0) == 0)
+        {
+            break;
+        }
+
+        uint32_t seq = 0;
+        if (parseBurstLine(*line, seq) && seq < LINK_TEST_LINES && !seen[seq])
+        {
+            seen[seq] = true;
+            result.linesGood++;
+            goodBytes += line->size() + 2; // CR LF
+        }
+        else
+        {
+            result.linesCorrupt++;
+        }
+    }
+
+    if (endUs > startUs)
+    {
+        result.goodputBytesPerSec = goodBytes * 1e6 / static_cast<double>(endUs - startUs);
+    }
+
+    // Host -> device: every PING must come back with its own sequence number
+    for (int i = 0; i < LINK_TEST_PINGS; ++i)
+    {
+        result.pingsSent++;
+        if (!awaitPong(100))
+        {
+            result.pingsFailed++;
+        }
+    }
+
+    uint32_t failures = (result.linesExpected - result.linesGood) + result.pingsFailed;
+    result.errorRate = static_cast<double>(failures) / (result.linesExpected + result.pingsSent);
+    result.passed = (failures == 0 && result.linesCorrupt == 0);
+    return result;
+}
+
+LinkTestResult TreadmillController::tryBaudRate(unsigned int baudRate, unsigned int fallbackRate)
+{
+    LinkTestResult result;
+    result.baudRate = baudRate;
+
+    // BAUD_OK comes back at the old rate, after which both ends switch
+    std::string rate = std::to_string(baudRate);
+    m_serialComm->sendCommand(Protocol::BAUD + rate);
+    auto reply = m_serialComm->readResponse(250);
+    if (!reply || *reply != Protocol::BAUD_OK + rate)
+    {
+        logError("Device did not accept " + rate + " baud", reply);
+        if (!reply)
+        {
+            // The acknowledgement may have been lost after the device switched
+            recoverBaudRate(fallbackRate, baudRate);
+        }
+        return result;
+    }
+
+    m_serialComm->setBaudRate(baudRate);
+    std::this_thread::sleep_for(std::chrono::milliseconds(BAUD_SETTLE_MS));
+    m_serialComm->flushInput(); // Bytes caught mid-switch are garbage
+
+    result = runLinkTest(baudRate);
+    result.switched = true;
+    if (result.passed)
+    {
+        m_serialComm->sendCommand(Protocol::BAUD_COMMIT);
+        auto ack = m_serialComm->readResponse(250);
+        if (ack && *ack == Protocol::BAUD_COMMITTED + rate)
+        {
+            return result;
+        }
+        logError(rate + " baud was not committed", ack);
+        result.passed = false;
+    }
+
+    recoverBaudRate(fallbackRate, baudRate);
+    return result;
+}
+
+bool TreadmillController::recoverBaudRate(unsigned int fallbackRate, unsigned int attemptedRate)
+{
+    TRACE_SCOPE("recoverBaudRate");
+
+    // Without BAUD_COMMIT the device reverts on its own; wait that out
+    m_serialComm->setBaudRate(fallbackRate);
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(BAUD_COMMIT_TIMEOUT_MS + 1000);
+    while (std::chrono::steady_clock::now() < deadline)
+    {
+        if (awaitPong(100))
+        {
+            purgeBuffer();
+            return true;
+        }
+    }
+
+    // Only a lost BAUD_COMMITTED leaves the device at the attempted rate: move it back explicitly
+    m_serialComm->setBaudRate(attemptedRate);
+    m_serialComm->flushInput();
+    if (awaitPong(100))
+    {
+        m_serialComm->sendCommand(Protocol::BAUD + std::to_string(fallbackRate));
+        m_serialComm->readResponse(250);
+        m_serialComm->setBaudRate(fallbackRate);
+        std::this_thread::sleep_for(std::chrono::milliseconds(BAUD_SETTLE_MS));
+        m_serialComm->flushInput();
+        m_serialComm->sendCommand(Protocol::BAUD_COMMIT);
+        m_serialComm->readResponse(250);
+        if (awaitPong(100))
+        {
+            return true;
+        }
+    }
+
+    logError("Lost contact with device after trying " + std::to_string(attemptedRate) + " baud");
+    return false;
+}
+
+bool TreadmillController::awaitPong(int timeoutMs)
+{
+    std::string seq = std::to_string(m_pingSeq.fetch_add(1));
+    std::string expected = Protocol::PONG + seq + ",";
+    m_serialComm->sendCommand(Protocol::PING + seq);
+
+    // Skip unrelated lines (INFO, stale replies) until ours arrives
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+    while (true)
+    {
+        auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+        if (remaining.count() <= 0)
+        {
+            return false;
+        }
+
+        auto line = m_serialComm->readResponse(static_cast<int>(remaining.count()));
+        if (!line)
+        {
+            return false;
+        }
+        if (line->rfind(expected, 0) == 0)
+        {
+            return true;
+        }
+    }
+}
+
+bool TreadmillController::startSetpointStream(double rateHz, SetpointSource source)
+{
+    TRACE_SCOPE("startSetpointStream");
+    std::unique_lock<std::mutex> idleLock(m_idleOperationMutex, std::try_to_lock);
+    if (!idleLock.owns_lock() || !isConnected() || m_serialComm->isListening() || m_streamActive)
+    {
+        logError("Setpoint streaming needs an idle connection");
+        return false;
+    }
+    if (!source || rateHz < MIN_STREAM_RATE_HZ || rateHz > MAX_STREAM_RATE_HZ)
+    {
+        logError("Setpoint stream rate must be between " + std::to_string(static_cast<int>(MIN_STREAM_RATE_HZ)) +
+                 " and " + std::to_string(static_cast<int>(MAX_STREAM_RATE_HZ)) + " Hz");
+        return false;
+    }
+    if (isSafetyStopped())
+    {
+        logError("Safety stop latched (" + getSafetyStopReason() + "); clear it before streaming");
+        updateStatus("ERROR: Safety stop latched - clear it first");
+        return false;
+    }
+
+    try
+    {
+        joinStreamThread(); // A stream whose source ended is still joinable
+
+        if (!synchronizeWithDevice())
+        {
+            logError("Failed to synchronize with treadmill (no STOPPED response)");
+            updateStatus("ERROR: Treadmill synchronization failed");
+            return false;
+        }
+        synchronizeClock(4);
+
+        // STOP_TM above leaves the firmware refusing to drive on SPD until STREAM starts a new run
+        auto response = transact(Protocol::STREAM, LinkCommand::Run);
+        if (!response || *response != Protocol::STREAMING)
+        {
+            logError("Treadmill did not accept STREAM (firmware without setpoint streaming?)");
+            updateStatus("ERROR: Setpoint stream refused");
+            return false;
+        }
+        m_deviceToHostLatency.reset();
+        m_hostToScreenLatency.reset();
+        m_sequenceTracker.reset();
+        m_streamLateness.reset();
+        m_setpointLatency.reset();
+        m_runAnalytics.begin({});
+        m_streamSent = 0;
+        m_streamMissed = 0;
+        for (auto &slot : m_setpointSentUs)
+        {
+            slot = 0;
+        }
+        m_streamRateHz = rateHz;
+        m_streamStartUs = ClockSync::hostNowUs();
+        m_streamEndUs = 0;
+        {
+            std::lock_guard<std::mutex> lock(m_streamErrorMutex);
+            m_streamError.clear();
+        }
+
+        m_serialComm->setTelemetryCallback([this](const std::string &data)
+                                           { handleRawTelemetry(data); });
+        m_serialComm->startListening();
+
+        m_streamActive = true;
+        m_streamThread = std::thread(&TreadmillController::streamSetpoints, this, rateHz, std::move(source));
+        updateStatus("Streaming setpoints at " + std::to_string(static_cast<int>(rateHz)) + " Hz");
+        return true;
+    }
+    catch (const std::exception &e)
+    {
+        m_streamActive = false;
+        logError("Error starting setpoint stream: " + std::string(e.what()));
+        return false;
+    }
+}
+
+void TreadmillController::stopSetpointStream()
+{
+    if (joinStreamThread() && isConnected())
+    {
+        stopTreadmill(); // Stops the listener and confirms IDLE with STOP_TM
+    }
+}
+
+SetpointStreamStats TreadmillController::getSetpointStreamStats() const
+{
+    SetpointStreamStats stats;
+    stats.active = m_streamActive;
+    stats.rateHz = m_streamRateHz;
+    stats.sent = m_streamSent;
+    stats.missedDeadlines = m_streamMissed;
+    stats.lateness = m_streamLateness.summarize();
+    stats.setpointToTelemetry = m_setpointLatency.summarize();
+    {
+        std::lock_guard<std::mutex> lock(m_streamErrorMutex);
+        stats.error = m_streamError;
+    }
+
+    int64_t startUs = m_streamStartUs;
+    int64_t endUs = m_streamEndUs;
+    if (endUs == 0)
+    {
+        endUs = ClockSync::hostNowUs();
+    }
+    if (startUs != 0 && endUs > startUs)
+    {
+        stats.achievedRateHz = stats.sent * 1e6 / static_cast<double>(endUs - startUs);
+    }
+    return stats;
+}
+
+void TreadmillController::streamSetpoints(double rateHz, SetpointSource source)
+{
+    using Clock = std::chrono::steady_clock;
+    Trace::setThreadName("Setpoints");
+
+    const auto period = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / rateHz));
+    const uint64_t pingEvery = std::max<uint64_t>(1, static_cast<uint64_t>(rateHz / 2)); // Clock sync at ~2 Hz
+    const auto start = Clock::now();
+    auto deadline = start;
+    uint64_t tick = 0;
+
+    try
+    {
+        while (m_streamActive)
+        {
+            // Sleep most of the way, then yield-spin: sleep_until alone overshoots
+            // by a scheduler quantum, which would be most of a 5 ms period
+            std::this_thread::sleep_until(deadline - SETPOINT_SPIN_WINDOW);
+            while (Clock::now() < deadline)
+            {
+                std::this_thread::yield();
+            }
+
+            auto now = Clock::now();
+            if (now - deadline >= period)
+            {
+                // A whole period behind: skip the missed ticks instead of bursting them out
+                auto missed = (now - deadline) / period;
+                m_streamMissed += static_cast<uint64_t>(missed);
+                deadline += missed * period;
+                tick += static_cast<uint64_t>(missed);
+            }
+            m_streamLateness.record(clampMicros(std::chrono::duration_cast<std::chrono::microseconds>(now - deadline).count()));
+
+            float left = 0.0f, right = 0.0f;
+            double t = std::chrono::duration<double>(deadline - start).count();
+            if (!source(t, left, right))
+            {
+                break;
+            }
+
+            TRACE_SCOPE("setpoint");
+            uint32_t seq = m_setpointSeq.fetch_add(1) & 0xFFFF; // The firmware echoes 16 bits
+            char command[64];
+            std::snprintf(command, sizeof(command), "SPD,%.3f,%.3f,%u", left, right, seq);
+            {
+                // A safety stop may have landed since the loop condition was checked
+                std::lock_guard<std::mutex> lock(m_safetyStopMutex);
+                if (m_safetyStopped)
+                {
+                    break;
+                }
+                m_setpointSentUs[seq % SETPOINT_SLOTS] = ClockSync::hostNowUs();
+                m_serialComm->sendCommand(command);
+            }
+            m_streamSent++;
+
+            if (++tick % pingEvery == 0)
+            {
+                sendPing();
+            }
+            deadline += period;
+        }
+
+        // Source ended or stop requested: leave the belts at rest. After a safety
+        // stop the firmware is already stopped and nothing more may be sent.
+        std::lock_guard<std::mutex> lock(m_safetyStopMutex);
+        if (!m_safetyStopped)
+        {
+            m_serialComm->sendCommand("SPD,0,0");
+        }
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << "Setpoint stream stopped: " << e.what() << std::endl;
+    }
+
+    m_streamEndUs = ClockSync::hostNowUs();
+    m_streamActive = false;
+    updateStatus("Setpoint stream ended after " + std::to_string(m_streamSent.load()) + " setpoints");
+}
+
+// I/O thread: the firmware reports ERR,SETPOINT_TIMEOUT when its watchdog stops the belts
+// and ERR,STOP_LATCHED for every SPD after that; either way the stream is over
+bool TreadmillController::handleStreamErrorLine(const std::string &line)
+{
+    if (!m_streamActive || (line.rfind("ERR,SETPOINT_TIMEOUT", 0) != 0 && line.rfind("ERR,STOP_LATCHED", 0) != 0))
+    {
+        return false;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_streamErrorMutex);
+        if (!m_streamError.empty())
+        {
+            return true; // Already ending
+        }
+        m_streamError = line.substr(Protocol::ERR.size() + 1);
+    }
+    m_streamActive = false;
+    updateStatus("ERROR: Treadmill stopped the setpoint stream (" + line.substr(Protocol::ERR.size() + 1) + ")");
+    return true;
+}
+
+bool TreadmillController::joinStreamThread()
+{
+    m_streamActive = false;
+    if (!m_streamThread.joinable())
+    {
+        return false;
+    }
+
+    if (m_streamThread.get_id() == std::this_thread::get_id())
+    {
+        m_streamThread.detach(); // Stopped from inside the source callback
+    }
+    else
+    {
+        m_streamThread.join();
+    }
+    return true;
+}
+
 // Utility methods
 void TreadmillController::updateStatus(const std::string &message)
 {
@@ -393,6 +1560,15 @@ void TreadmillController::logError(const std::string &message, const std::option
 
 void TreadmillController::purgeBuffer()
 {
+    TRACE_SCOPE("purgeBuffer");
+
+    // One syscall instead of draining line by line with short timeouts
+    if (m_serialComm->isLowLatency())
+    {
+        m_serialComm->flushInput();
+        return;
+    }
+
     int purgeCount = 0;
     while (purgeCount < 100)
     {
@@ -403,16 +1579,19 @@ void TreadmillController::purgeBuffer()
     }
     if (purgeCount > 0)
     {
+        m_serialComm->getLinkStats().recordPurged(purgeCount);
         std::cout << "Purged " << purgeCount << " lines of buffered data." << std::endl;
     }
 }
 
 bool TreadmillController::synchronizeWithDevice()
 {
+    TRACE_SCOPE("synchronizeWithDevice");
     const int maxRetries = 3;
 
     for (int attempt = 1; attempt <= maxRetries; ++attempt)
     {
+        int64_t sentUs = ClockSync::hostNowUs();
         m_serialComm->sendCommand(Protocol::STOP);
 
         // Wait up to 1 second for STOPPED response
@@ -425,6 +1604,7 @@ bool TreadmillController::synchronizeWithDevice()
 
             if (resp && *resp == Protocol::STOPPED)
             {
+                m_serialComm->getLinkStats().recordRoundTrip(LinkCommand::Stop, clampMicros(ClockSync::hostNowUs() - sentUs));
                 std::cout << "Synchronized with treadmill (STOPPED received)" << std::endl;
                 return true;
             }
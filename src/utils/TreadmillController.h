@@ -1,10 +1,28 @@
 #pragma once
 #include "SerialManager.h"
+#include "ClockSync.h"
+#include "MessageBus.h"
+#include "SequenceTracker.h"
+#include "ProfileParser.h"
+#include "RunAnalytics.h"
+#include "SafetyMonitor.h"
 #include <vector>
 #include <memory>
 #include <functional>
 #include <cstdint>
 #include <atomic>
+#include <array>
+#include <mutex>
+#include <thread>
+
+// How the firmware derived actualRpm (see measureRpm in the firmware)
+enum class SpeedEstimateQuality : uint8_t
+{
+    Stale = 0,   // No recent encoder activity
+    Period = 1,  // Edge timing only (low speed)
+    Blended = 2, // Mix of edge timing and counts
+    Count = 3    // Encoder counts only (high speed, or timing pins not wired)
+};
 
 struct TelemetryData
 {
@@ -17,6 +35,92 @@ struct TelemetryData
     bool driver2Healthy;
     bool emergencyStop;
     bool profileActive;
+    uint16_t droppedFrames; // Firmware-side TX drops so far (wraps at 65535)
+    SpeedEstimateQuality speedQuality1;
+    SpeedEstimateQuality speedQuality2;
+    int64_t hostArrivalUs = 0; // ClockSync::hostNowUs() when the line reached the host
+    int32_t sequence = -1;     // Firmware frame counter (16-bit); -1 if not reported
+    uint16_t gapBefore = 0;    // Frames lost immediately before this one
+    int32_t setpointSeq = -1;  // Last SPD sequence number applied by the firmware; -1 if not reported
+};
+
+// One published telemetry frame; immutable once on the bus
+struct TelemetrySample
+{
+    size_t deviceId = 0; // DeviceManager id, 0 for a stand-alone controller
+    TelemetryData data{};
+};
+
+using TelemetryBus = MessageBus<TelemetrySample>;
+
+/**
+ * Firmware control-loop timing, as reported by the STATS query.
+ * Histogram buckets are powers of two: <64us, <128us, ... <4096us, >=4096us.
+ */
+struct TaskTimingStats
+{
+    static constexpr int BUCKET_COUNT = 8;
+
+    uint16_t lastUs = 0;
+    uint16_t maxUs = 0;
+    std::array<uint16_t, BUCKET_COUNT> histogram{};
+};
+
+// End-to-end telemetry latency (see ClockSync)
+struct TelemetryLatencySnapshot
+{
+    ClockSyncState clock;
+    LatencySummary deviceToHost;  // Firmware timestamp -> line parsed on the host
+    LatencySummary hostToScreen;  // Line parsed -> frame presented
+};
+
+struct ControlLoopStats
+{
+    uint32_t ticks = 0;
+    uint32_t overruns = 0;
+    uint32_t skippedTicks = 0;
+    TaskTimingStats tick;      // handleProfile + runControl
+    TaskTimingStats control;   // runControl
+    TaskTimingStats serial;    // pollSerial
+    TaskTimingStats telemetry; // publishTelemetry
+    bool valid = false;
+};
+
+// Streaming setpoint mode (see startSetpointStream)
+struct SetpointStreamStats
+{
+    bool active = false;
+    double rateHz = 0.0;                // Requested
+    double achievedRateHz = 0.0;        // Setpoints actually sent per second
+    uint64_t sent = 0;
+    uint64_t missedDeadlines = 0;       // Ticks skipped after falling a whole period behind
+    LatencySummary lateness;            // Send time minus scheduled deadline
+    LatencySummary setpointToTelemetry; // SPD written -> first TEL frame that reports it applied
+    std::string error;                  // Set when the firmware ended the stream (watchdog or stop latch)
+};
+
+// Produces the setpoint for time t (seconds since the stream started); return false to end it
+using SetpointSource = std::function<bool(double t, float &leftRpm, float &rightRpm)>;
+
+// One CRC-checked throughput test at a single baud rate (see negotiateBaudRate)
+struct LinkTestResult
+{
+    unsigned int baudRate = 0;
+    bool switched = false;            // Device acknowledged the rate (always true for the starting rate)
+    bool passed = false;
+    uint32_t linesExpected = 0;
+    uint32_t linesGood = 0;
+    uint32_t linesCorrupt = 0;        // Failed the CRC or could not be parsed
+    uint32_t pingsSent = 0;           // Host -> device direction
+    uint32_t pingsFailed = 0;
+    double goodputBytesPerSec = 0.0;  // Verified burst bytes per second, device -> host
+    double errorRate = 0.0;           // Missing/corrupt lines and failed pings over all attempted
+};
+
+struct BaudNegotiationResult
+{
+    unsigned int baudRate = 0; // Rate the link was left at (0 = connection lost)
+    std::vector<LinkTestResult> attempts;
 };
 
 /**
@@ -27,16 +131,81 @@ class TreadmillController
 {
 public:
     static constexpr int HEARTBEAT_INTERVAL_MS = 500;
+    // Rates the firmware accepts for BAUD, slowest first
+    static constexpr std::array<unsigned int, 5> BAUD_RATES = {115200, 250000, 500000, 1000000, 2000000};
 
 private:
     std::unique_ptr<SerialManager> m_serialComm;
     std::function<void(const std::string &)> m_statusCallback;
-    std::function<void(const TelemetryData &)> m_telemetryCallback;
+    std::function<void(const ControlLoopStats &)> m_controlStatsCallback;
+
+    // Every parsed TEL frame is published here, tagged with m_deviceId
+    std::shared_ptr<TelemetryBus> m_telemetryBus = std::make_shared<TelemetryBus>();
+    std::atomic<size_t> m_deviceId{0};
+
+    // Evaluated on the I/O thread for every frame, before it is published
+    std::shared_ptr<SafetyMonitor> m_safetyMonitor = std::make_shared<SafetyMonitor>();
+
+    // Firmware timing stats (assembled from several STATS lines)
+    ControlLoopStats m_pendingLoopStats;
+    uint8_t m_pendingStatsTasks = 0; // Bit per task line received since the last STATS,LOOP
+    ControlLoopStats m_loopStats;
+    mutable std::mutex m_loopStatsMutex;
 
     // Heartbeat management
     std::unique_ptr<asio::steady_timer> m_heartbeatTimer;
     std::atomic<bool> m_heartbeatActive{false};
     std::atomic<bool> m_isRunActive{false};
+    bool m_binaryUpload = true;
+
+    // When the outstanding STATS request was sent (steady clock, us; 0 = none)
+    std::atomic<int64_t> m_statsRequestedUs{0};
+
+    // Device clock mapping and end-to-end latency
+    static constexpr uint32_t PING_SLOTS = 16;
+    ClockSync m_clockSync;
+    std::atomic<uint32_t> m_pingSeq{0};
+    std::array<std::atomic<int64_t>, PING_SLOTS> m_pingSentUs{};
+    LatencyHistogram m_deviceToHostLatency;
+    LatencyHistogram m_hostToScreenLatency;
+
+    // Try-locked for the whole of each idle-only exchange (run or stream start-up, probe,
+    // baud negotiation), so none can start while another is talking on the port
+    std::mutex m_idleOperationMutex;
+
+    // Setpoint streaming; the firmware stops the belts SETPOINT_TIMEOUT_MS (250) after the last SPD
+    static constexpr uint32_t SETPOINT_SLOTS = 256;
+    static constexpr auto SETPOINT_SPIN_WINDOW = std::chrono::microseconds(500);
+    std::thread m_streamThread;
+    std::atomic<bool> m_streamActive{false};
+    // Held across each SPD send and by priorityStop(), so no SPD can follow its STOP_TM
+    mutable std::mutex m_safetyStopMutex;
+    // Latched by priorityStop() until clearSafetyStop(); guarded by m_safetyStopMutex
+    bool m_safetyStopped = false;
+    std::string m_safetyStopReason;
+    std::atomic<double> m_streamRateHz{0.0};
+    std::atomic<int64_t> m_streamStartUs{0};
+    std::atomic<int64_t> m_streamEndUs{0};
+    std::atomic<uint64_t> m_streamSent{0};
+    std::atomic<uint64_t> m_streamMissed{0};
+    std::atomic<uint32_t> m_setpointSeq{0};
+    std::array<std::atomic<int64_t>, SETPOINT_SLOTS> m_setpointSentUs{};
+    LatencyHistogram m_streamLateness;
+    LatencyHistogram m_setpointLatency;
+    mutable std::mutex m_streamErrorMutex;
+    std::string m_streamError; // Firmware's reason for ending the stream; guarded by m_streamErrorMutex
+
+    // Baud negotiation; the commit timeout mirrors BAUD_COMMIT_TIMEOUT_MS in the firmware
+    static constexpr uint32_t LINK_TEST_LINES = 200;
+    static constexpr int LINK_TEST_PINGS = 16;
+    static constexpr int BAUD_SETTLE_MS = 20;
+    static constexpr int BAUD_COMMIT_TIMEOUT_MS = 3000;
+
+    // TEL frame loss / duplicate detection (reset per run)
+    SequenceTracker m_sequenceTracker;
+
+    // Step response and tracking error of the current run, fed from the I/O thread
+    RunAnalytics m_runAnalytics;
 
     // Protocol constants
     struct Protocol
@@ -46,19 +215,36 @@ private:
         static const std::string RUN;
         static const std::string STOP;
         static const std::string HEARTBEAT;
+        static const std::string STATS;
+        static const std::string STATS_RESET;
+        static const std::string PING;
+        static const std::string PONG;
+        static const std::string BAUD;
+        static const std::string BAUD_OK;
+        static const std::string BAUD_COMMIT;
+        static const std::string BAUD_COMMITTED;
+        static const std::string BURST;
+        static const std::string BURST_END;
+        static const std::string PROFILE_QUERY;
+        static const std::string PROFILE;
+        static const std::string PROFILE_BIN;
         static const std::string READY;
         static const std::string ACK;
         static const std::string RUNNING;
+        static const std::string STREAM;
+        static const std::string STREAMING;
         static const std::string STOPPED;
         static const std::string ERR;
     };
 
 public:
     TreadmillController();
+    // Run the serial I/O on a shared pool (see DeviceManager) instead of a private thread
+    explicit TreadmillController(std::shared_ptr<IoThreadPool> ioPool);
     ~TreadmillController();
 
     // High-level interface
-    bool initialize(const std::string &portName, unsigned int baudRate = 500000);
+    bool initialize(const std::string &portName, unsigned int baudRate = 500000, bool lowLatency = false);
     bool runTreadmill(const std::vector<std::string> &speedCommands);
     bool stopTreadmill();
     void disconnect();
@@ -67,19 +253,101 @@ public:
     // Status
     bool isConnected() const;
     bool isHeartbeatActive() const { return m_heartbeatActive; }
+    bool isRunActive() const { return m_isRunActive; }
+
+    // A safety rule stopped the belts. Runs, streams and heartbeats are refused
+    // until the operator clears it; stopTreadmill() does not.
+    bool isSafetyStopped() const;
+    std::string getSafetyStopReason() const;
+    // False if there was nothing to clear
+    bool clearSafetyStop();
+
+    // Firmware control-loop timing
+    // While a run is active the reply is picked up by the listener; otherwise it is read here.
+    bool requestControlLoopStats();
+    ControlLoopStats getControlLoopStats() const;
+
+    // Serial link counters and per-command round-trip latency
+    LinkStatsSnapshot getLinkStats() const;
+    void resetLinkStats();
+
+    // Device clock mapping and end-to-end telemetry latency.
+    // Call recordPresentation once a sample has been drawn to the screen.
+    const ClockSync &getClockSync() const { return m_clockSync; }
+    TelemetryLatencySnapshot getTelemetryLatency() const;
+    void recordPresentation(int64_t hostArrivalUs);
+
+    // Idle only: time `samples` PING round trips (a TX/RX loopback echo also counts)
+    LatencySummary probeRoundTrip(int samples);
+
+    // Idle only: step the link up from the current rate to the fastest one that
+    // passes a CRC-checked burst, or down until one passes. Failed rates fall back.
+    BaudNegotiationResult negotiateBaudRate();
+    // One-line report, e.g. "1000000 baud: 96.4 kB/s, 0.00% errors - pass"
+    static std::string describeLinkTest(const LinkTestResult &result);
+
+    // Send profiles as one PROFILE_BIN transfer when the firmware supports it (default);
+    // false keeps the line-by-line text upload
+    void setBinaryUpload(bool enabled) { m_binaryUpload = enabled; }
+
+    // Idle only: drive the belts live with SPD setpoints at rateHz (MIN_STREAM_RATE_HZ to
+    // MAX_STREAM_RATE_HZ) from `source`, on a dedicated deadline-scheduled thread, until it
+    // returns false or stopSetpointStream() is called. Telemetry is published on the
+    // telemetry bus; no heartbeat runs, since every SPD refreshes the firmware's setpoint
+    // watchdog. If that watchdog fires anyway (a host stall over 250 ms) the firmware
+    // stops and latches, and the stream ends with SetpointStreamStats::error set.
+    static constexpr double MIN_STREAM_RATE_HZ = 10.0; // Several SPDs per 250 ms watchdog window
+    static constexpr double MAX_STREAM_RATE_HZ = 500.0;
+    bool startSetpointStream(double rateHz, SetpointSource source);
+    // Ends the stream (if still running), zeroes the belts and returns the device to IDLE
+    void stopSetpointStream();
+    bool isStreaming() const { return m_streamActive; }
+    SetpointStreamStats getSetpointStreamStats() const;
+
+    // Telemetry frame loss for the current run
+    SequenceStats getSequenceStats() const { return m_sequenceTracker.getStats(); }
+
+    // Tracking error, rise/settle times and asymmetry of the current (or last) run, per profile step
+    RunAnalyticsSnapshot getRunAnalytics() const { return m_runAnalytics.getSnapshot(); }
+
+    // Telemetry consumers subscribe here (see MessageBus); each has its own queue
+    const std::shared_ptr<TelemetryBus> &getTelemetryBus() const { return m_telemetryBus; }
+    // Publish to a bus shared with other devices instead (before connecting)
+    void setTelemetryBus(std::shared_ptr<TelemetryBus> bus, size_t deviceId);
+
+    // Safety rules checked against every frame (default rules unless replaced); Stop rules
+    // are carried out here with priorityStop. Set before connecting; null disables the checks.
+    const std::shared_ptr<SafetyMonitor> &getSafetyMonitor() const { return m_safetyMonitor; }
+    void setSafetyMonitor(std::shared_ptr<SafetyMonitor> monitor) { m_safetyMonitor = std::move(monitor); }
 
     // Callbacks
     void setStatusCallback(std::function<void(const std::string &)> callback);
-    void setTelemetryCallback(std::function<void(const TelemetryData &)> callback);
+    // When set, STATS is polled alongside every heartbeat during a run
+    void setControlStatsCallback(std::function<void(const ControlLoopStats &)> callback);
+
+    // Parse one TEL line; false if it is not telemetry or is malformed
+    static bool parseTelemetryLine(const std::string &line, TelemetryData &data);
 
     // Direct serial communication access (for advanced use)
     SerialManager *getSerialComm() const { return m_serialComm.get(); }
 
 private:
+    // What PROFILE? reports the device is holding from its last upload
+    struct StoredProfile
+    {
+        size_t steps = 0;
+        uint16_t crc = 0;
+        size_t capacity = 0; // Largest PROFILE_BIN upload; 0 = firmware without PROFILE_BIN
+    };
+
     // Protocol phases
     bool initiateProtocol();
+    std::optional<StoredProfile> queryStoredProfile();
+    bool uploadBinary(const std::vector<CompiledStep> &steps, const StoredProfile &expected);
+    bool beginUpload();
     bool uploadCommands(const std::vector<std::string> &commands);
     bool finalizeUpload();
+    bool verifyUpload(const StoredProfile &expected);
     bool startExecution();
 
     // Heartbeat management
@@ -87,10 +355,32 @@ private:
     void stopHeartbeat();
     void scheduleHeartbeat();
 
+    // Send a command and wait for its one-line reply, timing the round trip
+    std::optional<std::string> transact(const std::string &command, LinkCommand type,
+                                        int timeoutMs = SerialManager::DEFAULT_TIMEOUT_MS);
+    void sendStatsRequest();
+    void sendPing();
+    bool handlePongLine(const std::string &line, int64_t arrivalUs);
+    void synchronizeClock(int exchanges);
+
+    // Baud negotiation steps
+    LinkTestResult runLinkTest(unsigned int baudRate);
+    LinkTestResult tryBaudRate(unsigned int baudRate, unsigned int fallbackRate);
+    bool recoverBaudRate(unsigned int fallbackRate, unsigned int attemptedRate);
+    bool awaitPong(int timeoutMs);
+
+    // Setpoint stream thread
+    void streamSetpoints(double rateHz, SetpointSource source);
+    bool joinStreamThread(); // False if there was no stream to end
+    bool handleStreamErrorLine(const std::string &line);
+
     // Utility methods
     void updateStatus(const std::string &message);
     void logError(const std::string &message, const std::optional<std::string> &response = std::nullopt);
     void handleRawTelemetry(const std::string &rawData);
+    // I/O thread: STOP_TM straight onto the wire, then wind down the run without waiting for replies
+    void priorityStop(const std::string &reason);
+    bool handleStatsLine(const std::string &line);
     void purgeBuffer();
     bool synchronizeWithDevice();
 };
\ No newline at end of file
@@ -9,6 +9,7 @@ constexpr uint16_t CONTROL_INTERVAL_US = 5000;
 constexpr float CONTROL_PERIOD_S = CONTROL_INTERVAL_US / 1000000.0f;
 constexpr uint32_t TELEMETRY_INTERVAL_MS = 100;
 constexpr uint32_t WATCHDOG_TIMEOUT_MS = 2000; // Stop motors if no heartbeat for 2 seconds
+constexpr uint32_t SETPOINT_TIMEOUT_MS = 250;  // Stop motors if a SPD stream goes quiet
 constexpr float RPM_SCALE = 0.6f;
 
 constexpr int32_t ENCODER_CPR = 200;
@@ -29,6 +30,21 @@ constexpr MotorPins MOTOR_PINS[2] = {
 
 constexpr uint8_t ENCODER_PIN_A[2] = {22, 26};
 constexpr uint8_t ENCODER_PIN_B[2] = {24, 28};
+
+// Edge-timing speed estimation needs a wiring change, so it is off unless the
+// build defines ENCODER_EDGE_TIMING 1. Pins 22-28 are not interrupt capable
+// on the Mega, so channel A of each encoder must ALSO be jumpered to an
+// external interrupt pin (keep the existing connection to 22/26):
+//   M1 encoder A: pin 22 + pin 2  (INT4)
+//   M2 encoder A: pin 26 + pin 19 (INT2). Pin 19 is Serial1 RX, which must
+//   then stay unused; nothing else may be connected to it.
+// Without the jumpers, leave it at 0: speed comes from counts only, as before.
+#ifndef ENCODER_EDGE_TIMING
+#define ENCODER_EDGE_TIMING 0
+#endif
+#if ENCODER_EDGE_TIMING
+constexpr uint8_t ENCODER_TIMING_PIN[2] = {2, 19};
+#endif
 constexpr uint8_t NFault_PIN = 10;
 
 enum class CommandMode
@@ -37,22 +53,51 @@ enum class CommandMode
   DIFFERENTIAL
 };
 
+constexpr uint16_t CALIBRATION_MAGIC = 0xA5A6;
+constexpr uint16_t CALIBRATION_MAGIC_V1 = 0xA5A5; // Gains only, no encoderDirection
+
 struct CalibrationData
 {
-  uint16_t magic = 0xA5A5; // Magic number to detect valid data
+  uint16_t magic = CALIBRATION_MAGIC; // Magic number to detect valid data
   float kp[2];
   float ki[2];
   float kd[2];
   float feedForward[2];
+  // Sign that turns encoder counts into forward belt motion, set with
+  // CFG,ENC1/ENC2 once checked on the machine. 0 = not calibrated: only the
+  // count magnitude is trusted and the direction comes from the drive.
+  int8_t encoderDirection[2];
 };
 
+// ------------------------ Fixed point ------------------------
+// Q16.16: 16 integer bits, 16 fractional bits. Products are taken in 64 bits.
+typedef int32_t q16_t;
+constexpr uint8_t Q16_SHIFT = 16;
+constexpr q16_t Q16_ONE = 1L << Q16_SHIFT;
+
+constexpr q16_t floatToQ16(float value)
+{
+  return static_cast<q16_t>(value * Q16_ONE + (value >= 0.0f ? 0.5f : -0.5f));
+}
+
+inline q16_t q16Mul(q16_t a, q16_t b)
+{
+  return static_cast<q16_t>((static_cast<int64_t>(a) * b) >> Q16_SHIFT);
+}
+
+inline q16_t q16Clamp(q16_t value, q16_t limit)
+{
+  return value > limit ? limit : (value < -limit ? -limit : value);
+}
+
 struct MotorState
 {
   float targetRpm = 0.0f;
-  float actualRpm = 0.0f;
-  float integral = 0.0f;
-  float lastError = 0.0f;
-  float controlEffort = 0.0f;
+  q16_t actualRpm = 0; // Filtered measured speed, RPM
+  q16_t integral = 0;  // Integrated error, RPM*s
+  q16_t lastError = 0; // RPM
+  int16_t duty = 0;    // Last applied PWM duty, -PWM_MAX..PWM_MAX
+  uint8_t speedQuality = 0; // SpeedQuality of actualRpm
   bool enabled = true;
 };
 
@@ -72,7 +117,7 @@ unsigned long lastHeartbeatMs = 0;
 constexpr uint8_t MAX_PROFILE_STEPS = 64;
 struct ProfileStep
 {
-  float rpm[2];
+  int32_t rpmMilli[2]; // Thousandths of an RPM, as parsed from the command
   uint32_t durationMs;
 };
 ProfileStep profileQueue[MAX_PROFILE_STEPS];
@@ -81,6 +126,304 @@ uint8_t profileTail = 0;
 bool profileActive = false;
 unsigned long profileStepMs = 0;
 
+// Host-streamed setpoints (SPD). While a stream holds the belts moving, every
+// update doubles as a heartbeat; TEL echoes the last applied sequence number.
+bool setpointStreaming = false;
+unsigned long lastSetpointMs = 0;
+uint16_t setpointSeq = 0;
+// Set whenever the drivers are disabled for safety; only RUN_TM or STREAM may
+// re-enable them, so a late SPD cannot undo a STOP_TM or a watchdog trip.
+bool stopLatched = true;
+
+// The last uploaded profile stays in profileQueue[0..storedProfileSteps) after
+// a run, so the host can compare PROFILE? against its own CRC and skip an
+// identical upload. Anything else that fills the queue invalidates it.
+uint8_t storedProfileSteps = 0;
+uint16_t storedProfileCrc = 0;
+bool storedProfileValid = false;
+
+// ------------------------ Serial TX ------------------------
+// All output is staged in a software ring and handed to the UART only as fast
+// as Serial.availableForWrite() allows, so a host that stops reading can never
+// block loop() inside Serial.print once the 64 byte hardware buffer is full.
+// Lines are always enqueued whole, so they never interleave.
+//
+// Telemetry, STATS and burst lines may only fill the ring up to
+// TX_REPLY_RESERVE bytes short of full, and are dropped beyond that. The
+// reserve belongs to protocol replies, which are never dropped and never wait:
+// pollSerial() only takes commands while the reserve can hold their replies.
+constexpr uint16_t TX_QUEUE_SIZE = 256; // Must be a power of two
+constexpr uint16_t TX_QUEUE_MASK = TX_QUEUE_SIZE - 1;
+constexpr uint8_t MAX_REPLY_BYTES = 40;                  // Longest reply line, CRLF included
+constexpr uint8_t TX_REPLY_RESERVE = 3 * MAX_REPLY_BYTES; // A command's reply plus two from loop()
+uint8_t txQueue[TX_QUEUE_SIZE];
+uint16_t txHead = 0;
+uint16_t txTail = 0;
+uint16_t telemetryDropped = 0; // Frames discarded because the ring was full
+uint16_t telemetrySeq = 0;     // Every generated frame, sent or dropped; gaps show loss
+
+inline uint16_t txPending()
+{
+  return (txTail - txHead) & TX_QUEUE_MASK;
+}
+
+inline uint16_t txFree()
+{
+  return TX_QUEUE_MASK - txPending();
+}
+
+void txWrite(const char *data, uint8_t len)
+{
+  for (uint8_t i = 0; i < len; ++i)
+  {
+    txQueue[txTail] = data[i];
+    txTail = (txTail + 1) & TX_QUEUE_MASK;
+  }
+}
+
+// Droppable output: false if the line would eat into the reply reserve
+bool txEnqueue(const char *data, uint8_t len)
+{
+  if (txFree() < static_cast<uint16_t>(len) + TX_REPLY_RESERVE)
+  {
+    return false;
+  }
+  txWrite(data, len);
+  return true;
+}
+
+// Protocol reply: may use the reserve. pollSerial() keeps enough of it free
+// that this always fits; a reply that still does not is dropped, not waited for.
+bool txEnqueueReply(const char *data, uint8_t len)
+{
+  if (txFree() < len)
+  {
+    return false;
+  }
+  txWrite(data, len);
+  return true;
+}
+
+void serviceTx()
+{
+  int room = Serial.availableForWrite();
+  while (room > 0 && txHead != txTail)
+  {
+    // Write the contiguous run up to the end of the ring (or the tail)
+    uint16_t run = (txTail > txHead) ? txTail - txHead : TX_QUEUE_SIZE - txHead;
+    if (run > static_cast<uint16_t>(room))
+    {
+      run = room;
+    }
+    Serial.write(txQueue + txHead, run);
+    txHead = (txHead + run) & TX_QUEUE_MASK;
+    room -= run;
+  }
+}
+
+// Waits for the ring and the UART to drain. Only switchBaud() uses it: the
+// last bytes must leave at the old rate, and that rare wait is bounded by the
+// ring size.
+void flushTxQueue()
+{
+  while (txHead != txTail)
+  {
+    serviceTx();
+  }
+  Serial.flush();
+}
+
+void replyLine(const __FlashStringHelper *msg)
+{
+  char line[MAX_REPLY_BYTES];
+  PGM_P text = reinterpret_cast<PGM_P>(msg);
+  uint8_t len = min(strlen_P(text), static_cast<size_t>(MAX_REPLY_BYTES - 2));
+  memcpy_P(line, text, len);
+  line[len++] = '\r';
+  line[len++] = '\n';
+  txEnqueueReply(line, len);
+}
+
+char *formatUInt(char *p, uint32_t value)
+{
+  char digits[10];
+  uint8_t n = 0;
+  do
+  {
+    digits[n++] = '0' + (value % 10);
+    value /= 10;
+  } while (value != 0);
+
+  while (n > 0)
+  {
+    *p++ = digits[--n];
+  }
+  return p;
+}
+
+char *formatHundredths(char *p, int32_t hundredths)
+{
+  if (hundredths < 0)
+  {
+    *p++ = '-';
+    hundredths = -hundredths;
+  }
+
+  p = formatUInt(p, hundredths / 100);
+  uint8_t frac = hundredths % 100;
+  *p++ = '.';
+  *p++ = '0' + frac / 10;
+  *p++ = '0' + frac % 10;
+  return p;
+}
+
+// Two decimal places, same output as Serial.print(value, 2)
+char *formatFixed2(char *p, float value)
+{
+  return formatHundredths(p, static_cast<int32_t>(value * 100.0f + (value >= 0.0f ? 0.5f : -0.5f)));
+}
+
+char *formatQ16(char *p, q16_t value)
+{
+  int64_t scaled = static_cast<int64_t>(value) * 100;
+  scaled += (scaled >= 0) ? (Q16_ONE / 2) : -(Q16_ONE / 2);
+  return formatHundredths(p, static_cast<int32_t>(scaled / Q16_ONE));
+}
+
+// ------------------------ Timing ------------------------
+// Execution time of the periodic tasks, reported to the host on STATS.
+// Histogram buckets are powers of two: <64us, <128us, ... <4096us, >=4096us.
+constexpr uint8_t TIMING_BUCKETS = 8;
+constexpr uint8_t TIMING_FIRST_BUCKET_SHIFT = 6;
+
+struct TaskTiming
+{
+  uint16_t lastUs = 0;
+  uint16_t maxUs = 0;
+  uint16_t histogram[TIMING_BUCKETS] = {};
+};
+
+enum TimedTask : uint8_t
+{
+  TASK_TICK,      // Whole control tick (handleProfile + runControl)
+  TASK_CONTROL,   // runControl
+  TASK_SERIAL,    // pollSerial
+  TASK_TELEMETRY, // publishTelemetry
+  TASK_COUNT
+};
+
+const char *const TASK_NAMES[TASK_COUNT] = {"TICK", "CTL", "RX", "TEL"};
+
+TaskTiming taskTiming[TASK_COUNT];
+uint32_t controlTicks = 0;
+uint32_t controlOverruns = 0; // Ticks that started a full interval or more late
+uint32_t controlSkipped = 0;  // Intervals dropped instead of being run back to back
+
+void recordTiming(TimedTask task, unsigned long elapsedUs)
+{
+  TaskTiming &t = taskTiming[task];
+  uint16_t us = elapsedUs > 0xFFFF ? 0xFFFF : static_cast<uint16_t>(elapsedUs);
+  t.lastUs = us;
+  if (us > t.maxUs)
+  {
+    t.maxUs = us;
+  }
+
+  uint8_t bucket = 0;
+  uint16_t scaled = us >> TIMING_FIRST_BUCKET_SHIFT;
+  while (scaled != 0 && bucket < TIMING_BUCKETS - 1)
+  {
+    scaled >>= 1;
+    bucket++;
+  }
+
+  if (t.histogram[bucket] != 0xFFFF)
+  {
+    t.histogram[bucket]++;
+  }
+}
+
+void resetTimingStats()
+{
+  for (uint8_t i = 0; i < TASK_COUNT; ++i)
+  {
+    taskTiming[i] = TaskTiming();
+  }
+  controlTicks = 0;
+  controlOverruns = 0;
+  controlSkipped = 0;
+}
+
+// One line per task, then a STATS,LOOP line that terminates the report:
+//   STATS,<task>,<lastUs>,<maxUs>,<h0>,...,<h7>
+//   STATS,LOOP,<ticks>,<overruns>,<skipped>
+// The whole report is bigger than the TX ring leaves for droppable output,
+// so serviceStats() sends it a line at a time as room appears; each line
+// carries the values current when it is sent.
+constexpr uint8_t STATS_IDLE = 0xFF;
+uint8_t statsNextLine = STATS_IDLE; // Task index of the next line, TASK_COUNT for LOOP
+
+uint8_t formatStatsLine(uint8_t index, char *line)
+{
+  char *p = line;
+  if (index < TASK_COUNT)
+  {
+    memcpy(p, "STATS,", 6);
+    p += 6;
+    for (const char *name = TASK_NAMES[index]; *name; ++name)
+    {
+      *p++ = *name;
+    }
+    *p++ = ',';
+    p = formatUInt(p, taskTiming[index].lastUs);
+    *p++ = ',';
+    p = formatUInt(p, taskTiming[index].maxUs);
+    for (uint8_t b = 0; b < TIMING_BUCKETS; ++b)
+    {
+      *p++ = ',';
+      p = formatUInt(p, taskTiming[index].histogram[b]);
+    }
+  }
+  else
+  {
+    memcpy(p, "STATS,LOOP,", 11);
+    p += 11;
+    p = formatUInt(p, controlTicks);
+    *p++ = ',';
+    p = formatUInt(p, controlOverruns);
+    *p++ = ',';
+    p = formatUInt(p, controlSkipped);
+  }
+  *p++ = '\r';
+  *p++ = '\n';
+  return p - line;
+}
+
+// A request while a report is still being sent is answered by that report
+void requestTimingStats()
+{
+  if (statsNextLine == STATS_IDLE)
+  {
+    statsNextLine = 0;
+  }
+}
+
+void serviceStats()
+{
+  if (statsNextLine == STATS_IDLE)
+  {
+    return;
+  }
+
+  char line[72]; // Longest line: ten 5-digit fields after the task name
+  if (txFree() < sizeof(line) + TX_REPLY_RESERVE)
+  {
+    return; // Not formatted until it is sure to fit
+  }
+  txEnqueue(line, formatStatsLine(statsNextLine, line));
+  statsNextLine = (statsNextLine < TASK_COUNT) ? statsNextLine + 1 : STATS_IDLE;
+}
+
 // ------------------------ Utility ------------------------
 inline void setMotorEnable(uint8_t idx, bool enable)
 {
@@ -88,19 +431,18 @@ inline void setMotorEnable(uint8_t idx, bool enable)
   motors[idx].enabled = enable;
 }
 
-inline void applyMotorPwm(uint8_t idx, float effort)
+inline void applyMotorDuty(uint8_t idx, int16_t duty)
 {
-  effort = constrain(effort, -1.0f, 1.0f);
+  duty = constrain(duty, -PWM_MAX, PWM_MAX);
 
-  bool dir = effort >= 0.0f;
+  bool dir = duty >= 0;
   if (idx == 1)
   {
-    dir = !dir;
+    dir = !dir; // Motor 2 is mounted mirrored
   }
 
-  uint8_t duty = static_cast<uint8_t>(fabsf(effort) * PWM_MAX);
   digitalWrite(MOTOR_PINS[idx].dir, dir ? HIGH : LOW);
-  analogWrite(MOTOR_PINS[idx].pwm, duty);
+  analogWrite(MOTOR_PINS[idx].pwm, duty >= 0 ? duty : -duty);
 }
 
 int32_t readAndZeroEncoder(uint8_t idx)
@@ -113,22 +455,183 @@ int32_t readAndZeroEncoder(uint8_t idx)
   return count;
 }
 
-float countsToRpm(int32_t counts, uint8_t idx)
+// ------------------------ Speed estimation ------------------------
+// Two estimators per belt, blended by speed:
+//  - count based: quadrature counts per 5 ms tick, 36 RPM per count, so it
+//    quantises badly at walking speed and needs filtering;
+//  - edge timing (M/T): rising edges of channel A since the previous tick
+//    divided by the time between the last edges, captured in the ISR. Exact
+//    at low speed and needs no filter.
+// Built without ENCODER_EDGE_TIMING, or with the timing pins not wired, no
+// edges arrive and the estimator falls back to counts only.
+enum SpeedQuality : uint8_t
+{
+  SPEED_STALE = 0,   // No recent edges or counts; belt stopped or sensor lost
+  SPEED_PERIOD = 1,  // Edge timing only
+  SPEED_BLENDED = 2, // Mix of both
+  SPEED_COUNT = 3    // Count based only
+};
+
+constexpr q16_t RPM_PER_COUNT = floatToQ16(60.0f * RPM_SCALE / (ENCODER_CPR * CONTROL_PERIOD_S));
+constexpr q16_t RPM_FILTER_GAIN = floatToQ16(0.3f);
+
+constexpr uint8_t EDGES_PER_REV = ENCODER_CPR / 4;
+// RPM x microseconds for one edge, in Q8 so that dividing by a span in us stays in 32 bits
+constexpr uint32_t RPM_US_PER_EDGE_Q8 = static_cast<uint32_t>(60.0e6f * RPM_SCALE / EDGES_PER_REV * 256.0f);
+constexpr uint16_t MAX_EDGES_PER_TICK = 16;
+constexpr uint32_t EDGE_STALE_US = 250000; // No edge for 250 ms: below ~3 RPM, treat as stopped
+constexpr int32_t BLEND_LOW_COUNTS = 2;    // At or below: edge timing only
+constexpr int32_t BLEND_HIGH_COUNTS = 10;  // At or above: counts only (360 RPM)
+
+volatile uint32_t isrEdgeUs[2] = {0, 0};
+volatile uint16_t isrEdgeCount[2] = {0, 0};
+
+void onEncoderEdge0()
+{
+  isrEdgeUs[0] = micros();
+  isrEdgeCount[0]++;
+}
+
+void onEncoderEdge1()
+{
+  isrEdgeUs[1] = micros();
+  isrEdgeCount[1]++;
+}
+
+struct SpeedEstimator
+{
+  uint32_t lastEdgeUs = 0;
+  uint16_t lastEdgeCount = 0;
+  bool primed = false;     // At least one edge seen, so lastEdgeUs is meaningful
+  int8_t direction = 1;    // Edge timing has no direction; taken from the counts
+  q16_t periodRpm = 0;     // Unsigned edge timing estimate
+  bool periodValid = false;
+  q16_t countRpm = 0;      // Filtered count based estimate
+};
+
+SpeedEstimator estimators[2];
+
+q16_t measureRpm(uint8_t idx, uint8_t &quality)
 {
-  if (counts == 0)
-    return 0.0f;
+  SpeedEstimator &est = estimators[idx];
+
+  // The count sign depends on how each encoder is mounted and wired (encoder
+  // 2 normally counts backwards because its motor is mirrored), so it comes
+  // from calibration rather than from the belt index
+  int32_t counts = readAndZeroEncoder(idx);
+  int8_t sign = calib.encoderDirection[idx];
+  if (sign == 0)
+  {
+    // The belt only reverses through standstill, so the direction follows
+    // the drive once no counts arrive and is held while it is moving
+    if (counts == 0 && motors[idx].duty != 0)
+    {
+      est.direction = motors[idx].duty > 0 ? 1 : -1;
+    }
+    counts = (counts >= 0 ? counts : -counts) * est.direction;
+  }
+  else if (sign < 0)
+  {
+    counts = -counts;
+  }
+  if (counts != 0)
+  {
+    est.direction = counts > 0 ? 1 : -1;
+  }
+  est.countRpm += q16Mul(counts * RPM_PER_COUNT - est.countRpm, RPM_FILTER_GAIN);
+
+  noInterrupts();
+  uint32_t edgeUs = isrEdgeUs[idx];
+  uint16_t edgeCount = isrEdgeCount[idx];
+  interrupts();
+
+  uint16_t newEdges = edgeCount - est.lastEdgeCount;
+  if (newEdges > 0)
+  {
+    uint32_t span = edgeUs - est.lastEdgeUs;
+    if (est.primed && span > 0)
+    {
+      if (newEdges > MAX_EDGES_PER_TICK)
+      {
+        newEdges = MAX_EDGES_PER_TICK;
+      }
+      est.periodRpm = static_cast<q16_t>((RPM_US_PER_EDGE_Q8 * newEdges / span) << 8);
+      est.periodValid = true;
+    }
+    est.primed = true;
+    est.lastEdgeUs = edgeUs;
+    est.lastEdgeCount = edgeCount;
+  }
+  else if (est.periodValid)
+  {
+    // No edge this tick: the belt is at most as fast as one edge in the time
+    // since the last one, so decay towards that bound until it goes stale
+    uint32_t sinceEdge = micros() - est.lastEdgeUs;
+    if (sinceEdge >= EDGE_STALE_US)
+    {
+      est.periodValid = false;
+      est.periodRpm = 0;
+    }
+    else
+    {
+      q16_t bound = static_cast<q16_t>((RPM_US_PER_EDGE_Q8 / sinceEdge) << 8);
+      if (bound < est.periodRpm)
+      {
+        est.periodRpm = bound;
+      }
+    }
+  }
+
+  if (!est.periodValid)
+  {
+    quality = (counts != 0) ? SPEED_COUNT : SPEED_STALE;
+    return est.countRpm;
+  }
+
+  q16_t periodRpm = est.direction > 0 ? est.periodRpm : -est.periodRpm;
+  int32_t magnitude = counts >= 0 ? counts : -counts;
+  if (magnitude <= BLEND_LOW_COUNTS)
+  {
+    quality = SPEED_PERIOD;
+    return periodRpm;
+  }
+  if (magnitude >= BLEND_HIGH_COUNTS)
+  {
+    quality = SPEED_COUNT;
+    return est.countRpm;
+  }
+
+  q16_t weight = (magnitude - BLEND_LOW_COUNTS) * (Q16_ONE / (BLEND_HIGH_COUNTS - BLEND_LOW_COUNTS));
+  quality = SPEED_BLENDED;
+  return periodRpm + q16Mul(est.countRpm - periodRpm, weight);
+}
 
-  float revs = static_cast<float>(counts) / ENCODER_CPR;
-  float rpm = (revs / CONTROL_PERIOD_S) * 60.0f;
+// ------------------------ Control gains ------------------------
+// Per-motor gains in fixed point, pre-multiplied by the effort->duty scale
+// (PWM_MAX / MAX_RPM) and the loop period so the control tick only needs
+// integer multiplies. Rebuilt whenever CalibrationData changes.
+struct ControlGains
+{
+  q16_t kp;      // duty per RPM of error
+  q16_t ki;      // duty per RPM*s of integrated error
+  q16_t kdPerDt; // duty per RPM of error change over one tick
+  int32_t ffQ24; // duty per RPM of target, Q24 because the gain is tiny
+};
 
-  rpm *= RPM_SCALE;
-  rpm = fabsf(rpm);
+ControlGains gains[2];
 
-  static float lastRpm[2] = {0.0f, 0.0f};
-  float filteredRpm = lastRpm[idx] * 0.7f + rpm * 0.3f;
-  lastRpm[idx] = filteredRpm;
+constexpr float DUTY_PER_RPM = PWM_MAX / MAX_RPM;
+constexpr q16_t CONTROL_PERIOD_Q16 = floatToQ16(CONTROL_PERIOD_S);
 
-  return filteredRpm;
+void updateControlGains()
+{
+  for (uint8_t i = 0; i < 2; ++i)
+  {
+    gains[i].kp = floatToQ16(calib.kp[i] * DUTY_PER_RPM);
+    gains[i].ki = floatToQ16(calib.ki[i] * DUTY_PER_RPM);
+    gains[i].kdPerDt = floatToQ16(calib.kd[i] / CONTROL_PERIOD_S * DUTY_PER_RPM);
+    gains[i].ffQ24 = static_cast<int32_t>(calib.feedForward[i] * DUTY_PER_RPM * 16777216.0f + 0.5f);
+  }
 }
 
 // ------------------------ EEPROM ------------------------
@@ -137,10 +640,17 @@ void loadCalibration()
   CalibrationData tmp;
 
   EEPROM.get(0, tmp);
-  if (tmp.magic != 0xA5A5)
+  if (tmp.magic == CALIBRATION_MAGIC_V1)
   {
-
-    tmp.magic = 0xA5A5;
+    // Keep the tuned gains; the encoder directions start uncalibrated
+    tmp.magic = CALIBRATION_MAGIC;
+    tmp.encoderDirection[0] = 0;
+    tmp.encoderDirection[1] = 0;
+    EEPROM.put(0, tmp);
+  }
+  else if (tmp.magic != CALIBRATION_MAGIC)
+  {
+    tmp.magic = CALIBRATION_MAGIC;
     tmp.kp[0] = 0.15f;
     tmp.kp[1] = 0.15f;
     tmp.ki[0] = 0.30f;
@@ -149,117 +659,114 @@ void loadCalibration()
     tmp.kd[1] = 0.0005f;
     tmp.feedForward[0] = 0.00040f;
     tmp.feedForward[1] = 0.00040f;
+    tmp.encoderDirection[0] = 0;
+    tmp.encoderDirection[1] = 0;
 
     EEPROM.put(0, tmp);
   }
 
   calib = tmp;
+  updateControlGains();
 }
 
 void saveCalibration()
 {
   EEPROM.put(0, calib);
+  updateControlGains();
 }
 
 // ------------------------ Safety ------------------------
 void disableAllMotors()
 {
+  stopLatched = true;
   for (uint8_t i = 0; i < 2; ++i)
   {
-    applyMotorPwm(i, 0.0f);
+    applyMotorDuty(i, 0);
     setMotorEnable(i, false);
   }
 }
 
 // ------------------------ Control ------------------------
+constexpr q16_t INTEGRAL_RESET_ERROR = floatToQ16(50.0f); // Large steps restart the integrator
+constexpr q16_t INTEGRAL_LIMIT = floatToQ16(MAX_RPM);     // RPM*s
+constexpr q16_t MAX_RPM_Q16 = floatToQ16(MAX_RPM);
+constexpr q16_t STARTUP_SPEED = floatToQ16(1.0f);
+constexpr int16_t STARTUP_BOOST_DUTY = static_cast<int16_t>(0.30f * PWM_MAX);
+constexpr int32_t DUTY_LIMIT = static_cast<int32_t>(PWM_MAX) << Q16_SHIFT;
+
+// PID + feed-forward per motor. Each tick costs one float->Q16 conversion of
+// the target and six 32x32->64 multiplies per motor, well under a
+// millisecond on the Mega against the 5 ms CONTROL_INTERVAL_US; the CTL
+// entry of the STATS report shows the measured figure.
 void runControl()
 {
   for (uint8_t i = 0; i < 2; ++i)
   {
-    // *****************************************************************
-    // TEMPORARY BYPASS: DIRECT PWM CONTROL
-    // *****************************************************************
+    MotorState &motor = motors[i];
+    const ControlGains &g = gains[i];
 
-    float target = motors[i].targetRpm;
+    motor.actualRpm = measureRpm(i, motor.speedQuality);
 
-    // Determine direction
-    bool dir = (target >= 0);
-    if (i == 1)
-      dir = !dir; // Preserve hardware inversion for Motor 2
+    q16_t target = q16Clamp(floatToQ16(motor.targetRpm), MAX_RPM_Q16);
+    q16_t error = target - motor.actualRpm;
 
-    // Map target directly to PWM (0-255)
-    int pwm = (int)fabs(target);
-    pwm = constrain(pwm, 0, 255);
-
-    // Apply to pins
-    digitalWrite(MOTOR_PINS[i].dir, dir ? HIGH : LOW);
-    digitalWrite(MOTOR_PINS[i].sleep, HIGH); // Ensure driver is enabled
-    analogWrite(MOTOR_PINS[i].pwm, pwm);
-
-    // Fake telemetry
-    motors[i].actualRpm = target;
-  }
-
-  /* ORIGINAL CONTROL LOGIC (DISABLED)
-  for (uint8_t i = 0; i < 2; ++i)
-  {
-    int32_t delta = readAndZeroEncoder(i);
-    motors[i].actualRpm = countsToRpm(delta, i);
-
-    float error = motors[i].targetRpm - motors[i].actualRpm;
-
-    if (abs(error) > 50.0f)
+    if (error > INTEGRAL_RESET_ERROR || error < -INTEGRAL_RESET_ERROR)
     {
-      motors[i].integral = 0.0f;
+      motor.integral = 0;
     }
 
-    motors[i].integral += error * CONTROL_PERIOD_S;
-    motors[i].integral = constrain(motors[i].integral, -MAX_RPM, MAX_RPM);
-    float derivative = (error - motors[i].lastError) / CONTROL_PERIOD_S;
-    motors[i].lastError = error;
+    q16_t derivative = error - motor.lastError;
+    motor.lastError = error;
 
-    float pid = calib.kp[i] * error + calib.ki[i] * motors[i].integral + calib.kd[i] * derivative;
-    float ff = calib.feedForward[i] * motors[i].targetRpm;
+    int32_t ff = static_cast<int32_t>((static_cast<int64_t>(g.ffQ24) * target) >> 24);
+    int32_t pdff = q16Mul(g.kp, error) + q16Mul(g.kdPerDt, derivative) + ff;
 
-    float rawEffort = (pid + ff) / MAX_RPM;
-
-    if (motors[i].targetRpm != 0.0f && abs(motors[i].actualRpm) < 1.0f)
+    // Anti-windup by conditional integration: the integrator only advances
+    // while the output is unsaturated or the error pulls it back into range.
+    q16_t integral = q16Clamp(motor.integral + q16Mul(error, CONTROL_PERIOD_Q16), INTEGRAL_LIMIT);
+    int32_t effort = pdff + q16Mul(g.ki, integral);
+    if ((effort > DUTY_LIMIT && error > 0) || (effort < -DUTY_LIMIT && error < 0))
     {
-      const float STARTUP_BOOST = 0.30f;
-      if (motors[i].targetRpm > 0)
-      {
-        rawEffort = max(rawEffort, STARTUP_BOOST);
-      }
-      else
-      {
-        rawEffort = min(rawEffort, -STARTUP_BOOST);
-      }
+      effort = pdff + q16Mul(g.ki, motor.integral);
     }
-
-    motors[i].controlEffort = constrain(rawEffort, -1.0f, 1.0f);
-
-    if (!motors[i].enabled)
+    else
     {
-      applyMotorPwm(i, 0.0f);
+      motor.integral = integral;
     }
-    else
+
+    // Truncate towards zero like the float law; a plain shift would floor
+    // negative efforts and drive reverse one duty step harder than forward
+    effort = q16Clamp(effort, DUTY_LIMIT);
+    int16_t duty = static_cast<int16_t>(effort >= 0 ? effort >> Q16_SHIFT : -(-effort >> Q16_SHIFT));
+
+    // Overcome static friction from standstill
+    if (target != 0 && motor.actualRpm > -STARTUP_SPEED && motor.actualRpm < STARTUP_SPEED)
     {
-      applyMotorPwm(i, motors[i].controlEffort);
+      duty = (target > 0) ? max(duty, STARTUP_BOOST_DUTY) : min(duty, static_cast<int16_t>(-STARTUP_BOOST_DUTY));
     }
+
+    // The driver's SLEEP pin is left alone here: setMotorEnable() owns it, so
+    // a STOP or watchdog disable is not undone by the next tick
+    motor.duty = motor.enabled ? duty : 0;
+    applyMotorDuty(i, motor.duty);
   }
-  */
 }
 
 // ------------------------ Profile ------------------------
-void enqueueProfileStep(float rpm0, float rpm1, uint32_t duration)
+inline float milliToRpm(int32_t milli)
+{
+  return constrain(milli * 0.001f, -MAX_RPM, MAX_RPM);
+}
+
+void enqueueProfileStep(int32_t rpm0Milli, int32_t rpm1Milli, uint32_t duration)
 {
   uint8_t next = (profileTail + 1) % MAX_PROFILE_STEPS;
   if (next == profileHead)
   {
-    Serial.println(F("ERR,PROFILE_FULL"));
+    replyLine(F("ERR,PROFILE_FULL"));
     return;
   }
-  profileQueue[profileTail] = {{rpm0, rpm1}, duration};
+  profileQueue[profileTail] = {{rpm0Milli, rpm1Milli}, duration};
   profileTail = next;
 }
 
@@ -268,8 +775,8 @@ void handleProfile()
   if (!profileActive && profileHead != profileTail)
   {
     auto &step = profileQueue[profileHead];
-    motors[0].targetRpm = constrain(step.rpm[0], -MAX_RPM, MAX_RPM);
-    motors[1].targetRpm = constrain(step.rpm[1], -MAX_RPM, MAX_RPM);
+    motors[0].targetRpm = milliToRpm(step.rpmMilli[0]);
+    motors[1].targetRpm = milliToRpm(step.rpmMilli[1]);
     profileActive = true;
     profileStepMs = millis();
   }
@@ -284,8 +791,8 @@ void handleProfile()
       if (profileHead != profileTail)
       {
         auto &nextStep = profileQueue[profileHead];
-        motors[0].targetRpm = constrain(nextStep.rpm[0], -MAX_RPM, MAX_RPM);
-        motors[1].targetRpm = constrain(nextStep.rpm[1], -MAX_RPM, MAX_RPM);
+        motors[0].targetRpm = milliToRpm(nextStep.rpmMilli[0]);
+        motors[1].targetRpm = milliToRpm(nextStep.rpmMilli[1]);
         profileActive = true;
         profileStepMs = millis();
       }
@@ -328,235 +835,809 @@ SystemState systemState = SystemState::IDLE;
 const uint8_t MAX_CMD_LEN = 64;
 char serialBuf[MAX_CMD_LEN];
 uint8_t serialPos = 0;
+bool serialOverflow = false;
+
+// Upper bound on bytes taken from the UART per pollSerial() call, so a burst
+// of input cannot push the next control tick out
+constexpr uint8_t MAX_RX_BYTES_PER_POLL = 64;
+
+// Parses an optionally signed decimal ("-12.345") into thousandths using
+// integer arithmetic only; atof costs hundreds of microseconds on the AVR.
+// Digits past the third decimal place are ignored. Returns the position
+// after the number, or nullptr if there were no digits.
+const char *parseMilli(const char *p, int32_t &out)
+{
+  while (*p == ' ')
+  {
+    ++p;
+  }
+
+  bool negative = false;
+  if (*p == '-' || *p == '+')
+  {
+    negative = (*p == '-');
+    ++p;
+  }
+
+  bool hasDigits = false;
+  int32_t whole = 0;
+  while (*p >= '0' && *p <= '9')
+  {
+    if (whole < 2000000L) // Saturate well before int32 overflow
+    {
+      whole = whole * 10 + (*p - '0');
+    }
+    hasDigits = true;
+    ++p;
+  }
+
+  int32_t frac = 0;
+  uint8_t fracDigits = 0;
+  if (*p == '.')
+  {
+    ++p;
+    while (*p >= '0' && *p <= '9')
+    {
+      if (fracDigits < 3)
+      {
+        frac = frac * 10 + (*p - '0');
+        fracDigits++;
+      }
+      hasDigits = true;
+      ++p;
+    }
+  }
+
+  if (!hasDigits)
+  {
+    return nullptr;
+  }
+
+  while (fracDigits < 3)
+  {
+    frac *= 10;
+    fracDigits++;
+  }
+
+  int32_t value = whole * 1000L + frac;
+  out = negative ? -value : value;
+  return p;
+}
 
-void parseProfileCommand(char *cmd)
+// Expects "<key>" followed by a decimal, e.g. parseField(p, 'L', value) for "L:1.5"
+const char *parseField(const char *p, char key, int32_t &out)
 {
-  // Format: L:1.5 R:2.0 T:3.0
-  float lSpeed = 0, rSpeed = 0, duration = 0;
+  while (*p == ' ')
+  {
+    ++p;
+  }
+  if (p[0] != key || p[1] != ':')
+  {
+    return nullptr;
+  }
+  return parseMilli(p + 2, out);
+}
 
-  char *pL = strstr(cmd, "L:");
-  char *pR = strstr(cmd, "R:");
-  char *pT = strstr(cmd, "T:");
+void parseProfileCommand(const char *args)
+{
+  // Format: L:1.5 R:2.0 T:3.0 (args starts after the "L:" keyword)
+  int32_t lMilli = 0, rMilli = 0, durationMs = 0;
+
+  const char *p = parseMilli(args, lMilli);
+  if (p)
+    p = parseField(p, 'R', rMilli);
+  if (p)
+    p = parseField(p, 'T', durationMs); // Seconds in thousandths == milliseconds
 
-  if (pL && pR && pT)
+  if (p && durationMs > 0)
   {
-    lSpeed = atof(pL + 2);
-    rSpeed = atof(pR + 2);
-    duration = atof(pT + 2);
-    enqueueProfileStep(lSpeed, rSpeed, (uint32_t)(duration * 1000));
-    Serial.println(F("READY"));
+    enqueueProfileStep(lMilli, rMilli, static_cast<uint32_t>(durationMs));
+    replyLine(F("READY"));
   }
   else
   {
-    Serial.println(F("ERR,PARSE_FMT"));
+    replyLine(F("ERR,PARSE_FMT"));
   }
 }
 
-void handleCommand(char *cmd)
+// ------------------------ Link negotiation ------------------------
+// BAUD,<rate> moves the link to another rate. The new rate is provisional
+// until BAUD_COMMIT arrives over it; otherwise the board falls back to the
+// last committed rate, so a rate the cable cannot carry never strands it.
+// BURST,<n> streams n CRC-checked lines for the host to measure goodput.
+constexpr uint32_t DEFAULT_BAUD = 500000;
+constexpr uint32_t SUPPORTED_BAUD[] = {115200, 250000, 500000, 1000000, 2000000}; // Exact or <3.5% error at 16 MHz
+constexpr uint32_t BAUD_COMMIT_TIMEOUT_MS = 3000;
+constexpr uint16_t MAX_BURST_LINES = 1000;
+constexpr uint8_t BURST_LINES_PER_PASS = 4;
+
+uint32_t serialBaud = DEFAULT_BAUD;
+uint32_t fallbackBaud = 0; // Committed rate while a switch is provisional, 0 otherwise
+unsigned long baudSwitchMs = 0;
+uint16_t burstRemaining = 0;
+uint16_t burstSeq = 0;
+
+// CRC-16/CCITT-FALSE, bitwise: no 512 byte table in RAM for a few hundred bytes of input
+uint16_t crc16(const char *data, uint16_t len, uint16_t crc = 0xFFFF)
 {
-  // ALWAYS check for STOP first
-  if (strcmp(cmd, "STOP_TM") == 0)
+  for (uint16_t i = 0; i < len; ++i)
   {
-    disableAllMotors();
-    motors[0].targetRpm = 0;
-    motors[1].targetRpm = 0;
-    profileActive = false;
-    profileHead = 0;
-    profileTail = 0;
-    systemState = SystemState::IDLE;
-    Serial.println(F("STOPPED"));
-    return;
+    crc ^= static_cast<uint16_t>(static_cast<uint8_t>(data[i])) << 8;
+    for (uint8_t bit = 0; bit < 8; ++bit)
+    {
+      crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+    }
+  }
+  return crc;
+}
+
+char *formatHex4(char *p, uint16_t value)
+{
+  static const char HEX_DIGITS[] = "0123456789ABCDEF";
+  for (int8_t shift = 12; shift >= 0; shift -= 4)
+  {
+    *p++ = HEX_DIGITS[(value >> shift) & 0xF];
   }
+  return p;
+}
+
+// Exactly four hex digits; returns the position after them, or nullptr
+const char *parseHex4(const char *p, uint16_t &out)
+{
+  uint16_t value = 0;
+  for (uint8_t i = 0; i < 4; ++i, ++p)
+  {
+    uint8_t digit;
+    if (*p >= '0' && *p <= '9')
+      digit = *p - '0';
+    else if (*p >= 'A' && *p <= 'F')
+      digit = *p - 'A' + 10;
+    else if (*p >= 'a' && *p <= 'f')
+      digit = *p - 'a' + 10;
+    else
+      return nullptr;
+    value = (value << 4) | digit;
+  }
+  out = value;
+  return p;
+}
 
-  switch (systemState)
+// Unsigned decimal; returns the position after it, or nullptr if there were no digits
+const char *parseUInt(const char *p, uint32_t &out)
+{
+  const char *start = p;
+  uint32_t value = 0;
+  while (*p >= '0' && *p <= '9')
   {
-  case SystemState::RUNNING:
-    // Ignore everything else during run to prevent jitter
-    if (strncmp(cmd, "SPD", 3) == 0 || strncmp(cmd, "START", 5) == 0)
+    if (value < 100000000UL) // Saturate well before uint32 overflow
     {
-      Serial.println(F("ERR,BUSY_RUNNING"));
+      value = value * 10 + (*p - '0');
     }
-    break;
+    ++p;
+  }
+  if (p == start)
+  {
+    return nullptr;
+  }
+  out = value;
+  return p;
+}
+
+void switchBaud(uint32_t rate)
+{
+  flushTxQueue(); // Let the last byte leave at the old rate
+  Serial.begin(rate);
+  serialBaud = rate;
+  serialPos = 0; // Anything half received belongs to the old rate
+  serialOverflow = false;
+}
+
+// Numeric protocol reply such as BAUD_OK,1000000
+void replyRate(const char *prefix, uint8_t prefixLen, uint32_t rate)
+{
+  char line[32];
+  memcpy(line, prefix, prefixLen);
+  char *p = formatUInt(line + prefixLen, rate);
+  *p++ = '\r';
+  *p++ = '\n';
+  txEnqueueReply(line, p - line);
+}
+
+// Line: B,<seq>,<32 hex payload>,<crc of "<seq>,<payload>">
+void serviceBurst()
+{
+  if (statsNextLine != STATS_IDLE)
+  {
+    return; // A STATS report goes first; the burst would otherwise keep the ring full
+  }
 
-  case SystemState::IDLE:
-    if (strcmp(cmd, "START_READ") == 0)
+  for (uint8_t n = 0; n < BURST_LINES_PER_PASS && burstRemaining > 0; ++n)
+  {
+    char line[56];
+    char *p = line;
+    *p++ = 'B';
+    *p++ = ',';
+    char *body = p;
+    p = formatUInt(p, burstSeq);
+    *p++ = ',';
+
+    uint16_t x = burstSeq ^ 0xACE1;
+    for (uint8_t i = 0; i < 8; ++i)
     {
-      profileHead = 0;
-      profileTail = 0;
-      profileActive = false;
-      systemState = SystemState::UPLOADING;
-      Serial.println(F("READY"));
+      // xorshift16: a varied bit pattern, cheap to generate
+      x ^= x << 7;
+      x ^= x >> 9;
+      x ^= x << 8;
+      p = formatHex4(p, x);
     }
-    else if (strncmp(cmd, "RUN_TM", 6) == 0)
+
+    uint16_t crc = crc16(body, p - body);
+    *p++ = ',';
+    p = formatHex4(p, crc);
+    *p++ = '\r';
+    *p++ = '\n';
+
+    if (!txEnqueue(line, p - line))
     {
-      if (profileHead != profileTail)
-      {
-        systemState = SystemState::RUNNING;
-        profileActive = false;
-        setMotorEnable(0, true);
-        setMotorEnable(1, true);
-        Serial.println(F("RUNNING"));
-      }
-      else
-      {
-        Serial.println(F("ERR,NO_PROFILE"));
-      }
+      return; // Ring full: the UART paces the burst
     }
-    else if (strncmp(cmd, "SPD", 3) == 0)
+    burstSeq++;
+    if (--burstRemaining == 0)
     {
-      // SPD,100,100
-      char *p1 = strchr(cmd, ',');
-      if (p1)
-      {
-        char *p2 = strchr(p1 + 1, ',');
-        if (p2)
-        {
-          float a = atof(p1 + 1);
-          float b = atof(p2 + 1);
-          setTargetsFromCommand(a, b);
-          setMotorEnable(0, true);
-          setMotorEnable(1, true);
-          profileHead = profileTail; // Clear profile
-          profileActive = false;
-        }
-      }
+      replyRate("BURST_END,", 10, burstSeq);
     }
-    else if (strncmp(cmd, "SEQ", 3) == 0)
+  }
+}
+
+void serviceLink()
+{
+  if (fallbackBaud != 0 && millis() - baudSwitchMs > BAUD_COMMIT_TIMEOUT_MS)
+  {
+    burstRemaining = 0;
+    switchBaud(fallbackBaud);
+    fallbackBaud = 0;
+    replyLine(F("INFO,BAUD_REVERTED"));
+  }
+  serviceBurst();
+}
+
+// ------------------------ Binary profile upload ------------------------
+// PROFILE_BIN,<steps>,<crc16> is followed by steps * sizeof(ProfileStep) raw
+// bytes, little-endian like the AVR itself, which pollSerial() writes straight
+// into profileQueue. The whole transfer is acknowledged once.
+constexpr uint16_t BINARY_IDLE_TIMEOUT_MS = 250;
+uint16_t binaryRemaining = 0; // Payload bytes still expected; line parsing is off while > 0
+uint16_t binaryPos = 0;
+uint16_t binaryCrc = 0;
+uint8_t binarySteps = 0;
+bool binaryDiscard = false; // Oversized upload: swallow the payload, then refuse it
+unsigned long binaryLastByteMs = 0;
+
+void finishBinaryProfile()
+{
+  systemState = SystemState::IDLE;
+  if (binaryDiscard)
+  {
+    replyLine(F("ERR,PROFILE_FULL"));
+    return;
+  }
+
+  uint16_t crc = crc16(reinterpret_cast<const char *>(profileQueue), binaryPos);
+  if (crc != binaryCrc)
+  {
+    replyLine(F("ERR,PROFILE_CRC"));
+    return;
+  }
+
+  storedProfileSteps = binarySteps;
+  storedProfileCrc = crc;
+  storedProfileValid = true;
+  profileHead = 0;
+  profileTail = binarySteps;
+  replyLine(F("ACK"));
+}
+
+void abortStalledBinaryProfile()
+{
+  if (binaryRemaining > 0 && millis() - binaryLastByteMs > BINARY_IDLE_TIMEOUT_MS)
+  {
+    binaryRemaining = 0;
+    systemState = SystemState::IDLE;
+    replyLine(F("ERR,PROFILE_TIMEOUT"));
+  }
+}
+
+// ---- Command handlers ----
+// Each receives the text after the command keyword and its separator.
+
+void cmdStop(char *)
+{
+  setpointStreaming = false;
+  disableAllMotors();
+  motors[0].targetRpm = 0;
+  motors[1].targetRpm = 0;
+  profileActive = false;
+  profileHead = 0;
+  profileTail = 0;
+  systemState = SystemState::IDLE;
+  replyLine(F("STOPPED"));
+}
+
+void cmdStats(char *args)
+{
+  if (strcmp(args, "RESET") == 0)
+  {
+    resetTimingStats();
+  }
+  else
+  {
+    requestTimingStats();
+  }
+}
+
+void cmdStartRead(char *)
+{
+  storedProfileValid = false;
+  profileHead = 0;
+  profileTail = 0;
+  profileActive = false;
+  systemState = SystemState::UPLOADING;
+  replyLine(F("READY"));
+}
+
+void cmdRun(char *)
+{
+  setpointStreaming = false; // The run's heartbeat watchdog takes over
+  if (storedProfileValid)
+  {
+    // Every run of the stored profile starts from its first step
+    profileHead = 0;
+    profileTail = storedProfileSteps;
+  }
+
+  if (profileHead != profileTail)
+  {
+    systemState = SystemState::RUNNING;
+    profileActive = false;
+    lastHeartbeatMs = millis(); // Watchdog counts from the start of the run
+    stopLatched = false;
+    setMotorEnable(0, true);
+    setMotorEnable(1, true);
+    replyLine(F("RUNNING"));
+  }
+  else
+  {
+    replyLine(F("ERR,NO_PROFILE"));
+  }
+}
+
+void cmdSpeed(char *args)
+{
+  // SPD,100,100 or SPD,100,100,<seq>
+  int32_t a = 0, b = 0;
+  const char *p = parseMilli(args, a);
+  if (p && *p == ',')
+    p = parseMilli(p + 1, b);
+  else
+    p = nullptr;
+  if (p)
+  {
+    uint32_t seq = 0;
+    if (*p == ',' && parseUInt(p + 1, seq))
     {
-      // SEQ,1000,10.0,10.0
-      char *p1 = strchr(cmd, ',');
-      if (p1)
-      {
-        char *p2 = strchr(p1 + 1, ',');
-        if (p2)
-        {
-          char *p3 = strchr(p2 + 1, ',');
-          if (p3)
-          {
-            uint32_t d = atol(p1 + 1);
-            float a = atof(p2 + 1);
-            float b = atof(p3 + 1);
-            enqueueProfileStep(a, b, d);
-          }
-        }
-      }
+      setpointSeq = seq;
     }
-    else if (strncmp(cmd, "MODE", 4) == 0)
+    bool moving = (a != 0 || b != 0);
+    lastSetpointMs = millis();
+    profileHead = profileTail; // Clear profile
+    profileActive = false;
+    if (stopLatched)
     {
-      // MODE,DIFF or MODE,IND
-      if (strstr(cmd, "DIFF"))
-        controlMode = CommandMode::DIFFERENTIAL;
-      else
-        controlMode = CommandMode::INDEPENDENT;
+      // Stopped until the host opens a new stream; the drivers stay asleep
+      setpointStreaming = false;
+      motors[0].targetRpm = 0;
+      motors[1].targetRpm = 0;
+      if (moving)
+        replyLine(F("ERR,STOP_LATCHED"));
+      return;
     }
-    else if (strcmp(cmd, "HEARTBEAT") == 0)
+    setpointStreaming = moving;
+    setTargetsFromCommand(a * 0.001f, b * 0.001f);
+    if (moving)
     {
-      lastHeartbeatMs = millis();
-      // No response needed for heartbeat
+      setMotorEnable(0, true);
+      setMotorEnable(1, true);
     }
-    else if (strncmp(cmd, "CFG", 3) == 0)
+  }
+}
+
+void cmdStream(char *)
+{
+  // Opens a setpoint stream: the only way besides RUN_TM to clear the stop latch
+  setpointStreaming = false;
+  lastSetpointMs = millis();
+  stopLatched = false;
+  replyLine(F("STREAMING"));
+}
+
+void cmdSequence(char *args)
+{
+  // SEQ,1000,10.0,10.0
+  int32_t durationMilli = 0, a = 0, b = 0;
+  const char *p = parseMilli(args, durationMilli);
+  if (p && *p == ',')
+    p = parseMilli(p + 1, a);
+  else
+    p = nullptr;
+  if (p && *p == ',' && parseMilli(p + 1, b) && durationMilli > 0)
+  {
+    storedProfileValid = false;
+    enqueueProfileStep(a, b, static_cast<uint32_t>(durationMilli / 1000));
+  }
+}
+
+void cmdMode(char *args)
+{
+  // MODE,DIFF or MODE,IND
+  if (strstr(args, "DIFF"))
+    controlMode = CommandMode::DIFFERENTIAL;
+  else
+    controlMode = CommandMode::INDEPENDENT;
+}
+
+void cmdHeartbeat(char *)
+{
+  lastHeartbeatMs = millis();
+  // No response needed for heartbeat
+}
+
+void cmdPing(char *args)
+{
+  // PING,<seq> -> PONG,<seq>,<millis>; the host maps millis() onto its own clock
+  char line[32];
+  char *p = line;
+  memcpy(p, "PONG,", 5);
+  p += 5;
+  for (uint8_t n = 0; n < 10 && *args >= '0' && *args <= '9'; ++n)
+  {
+    *p++ = *args++;
+  }
+  *p++ = ',';
+  p = formatUInt(p, millis());
+  *p++ = '\r';
+  *p++ = '\n';
+  txEnqueueReply(line, p - line);
+}
+
+void cmdConfig(char *args)
+{
+  // CFG,KP1,0.15 or CFG,ENC2,-1 (rare, so plain atof is fine here)
+  char *pVal = strchr(args, ',');
+  if (pVal)
+  {
+    *pVal = 0; // Terminate key string
+    char *key = args;
+    float val = atof(pVal + 1);
+
+    if (strcmp(key, "KP1") == 0)
+      calib.kp[0] = val;
+    else if (strcmp(key, "KP2") == 0)
+      calib.kp[1] = val;
+    else if (strcmp(key, "KI1") == 0)
+      calib.ki[0] = val;
+    else if (strcmp(key, "KI2") == 0)
+      calib.ki[1] = val;
+    else if (strcmp(key, "KD1") == 0)
+      calib.kd[0] = val;
+    else if (strcmp(key, "KD2") == 0)
+      calib.kd[1] = val;
+    else if (strcmp(key, "FF1") == 0)
+      calib.feedForward[0] = val;
+    else if (strcmp(key, "FF2") == 0)
+      calib.feedForward[1] = val;
+    else if (strcmp(key, "ENC1") == 0)
+      calib.encoderDirection[0] = val > 0.0f ? 1 : (val < 0.0f ? -1 : 0);
+    else if (strcmp(key, "ENC2") == 0)
+      calib.encoderDirection[1] = val > 0.0f ? 1 : (val < 0.0f ? -1 : 0);
+    saveCalibration();
+  }
+}
+
+void cmdProfileStep(char *args)
+{
+  parseProfileCommand(args);
+}
+
+void cmdEndRead(char *)
+{
+  // START_READ emptied the queue, so the upload sits at index 0 onwards
+  storedProfileSteps = profileTail;
+  storedProfileCrc = crc16(reinterpret_cast<const char *>(profileQueue), storedProfileSteps * sizeof(ProfileStep));
+  storedProfileValid = true;
+  systemState = SystemState::IDLE;
+  replyLine(F("ACK"));
+}
+
+void cmdProfileBinary(char *args)
+{
+  uint32_t steps = 0;
+  uint16_t crc = 0;
+  const char *p = parseUInt(args, steps);
+  if (!p || *p != ',' || !parseHex4(p + 1, crc) || steps == 0 || steps > 0xFFFF / sizeof(ProfileStep))
+  {
+    replyLine(F("ERR,PARSE_FMT")); // Payload length unknown: its bytes are parsed as (garbage) lines
+    return;
+  }
+
+  // The ring holds MAX_PROFILE_STEPS - 1 steps
+  binaryDiscard = steps >= MAX_PROFILE_STEPS;
+  if (!binaryDiscard)
+  {
+    storedProfileValid = false;
+    profileHead = 0;
+    profileTail = 0;
+    profileActive = false;
+  }
+  binarySteps = steps;
+  binaryCrc = crc;
+  binaryPos = 0;
+  binaryRemaining = steps * sizeof(ProfileStep);
+  binaryLastByteMs = millis();
+  systemState = SystemState::UPLOADING;
+}
+
+void cmdProfileQuery(char *)
+{
+  // PROFILE? -> PROFILE,<steps>,<crc16 of the packed steps>,<PROFILE_BIN capacity>;
+  // 0 steps if none is stored
+  uint8_t steps = storedProfileValid ? storedProfileSteps : 0;
+  char line[28];
+  memcpy(line, "PROFILE,", 8);
+  char *p = formatUInt(line + 8, steps);
+  *p++ = ',';
+  p = formatHex4(p, steps ? storedProfileCrc : 0);
+  *p++ = ',';
+  p = formatUInt(p, MAX_PROFILE_STEPS - 1);
+  *p++ = '\r';
+  *p++ = '\n';
+  txEnqueueReply(line, p - line);
+}
+
+void cmdBaud(char *args)
+{
+  // BAUD,<rate> -> BAUD_OK,<rate> at the current rate, then switch
+  uint32_t rate = 0;
+  bool supported = false;
+  if (parseUInt(args, rate))
+  {
+    for (uint32_t candidate : SUPPORTED_BAUD)
     {
-      // CFG,KP1,0.15
-      char *pKey = strchr(cmd, ',');
-      if (pKey)
-      {
-        char *pVal = strchr(pKey + 1, ',');
-        if (pVal)
-        {
-          *pVal = 0; // Terminate key string
-          char *key = pKey + 1;
-          float val = atof(pVal + 1);
-
-          if (strcmp(key, "KP1") == 0)
-            calib.kp[0] = val;
-          else if (strcmp(key, "KP2") == 0)
-            calib.kp[1] = val;
-          else if (strcmp(key, "KI1") == 0)
-            calib.ki[0] = val;
-          else if (strcmp(key, "KI2") == 0)
-            calib.ki[1] = val;
-          else if (strcmp(key, "KD1") == 0)
-            calib.kd[0] = val;
-          else if (strcmp(key, "KD2") == 0)
-            calib.kd[1] = val;
-          else if (strcmp(key, "FF1") == 0)
-            calib.feedForward[0] = val;
-          else if (strcmp(key, "FF2") == 0)
-            calib.feedForward[1] = val;
-          saveCalibration();
-        }
-      }
+      supported |= (candidate == rate);
     }
-    break;
+  }
+  if (!supported)
+  {
+    replyLine(F("ERR,BAUD_UNSUPPORTED"));
+    return;
+  }
+
+  replyRate("BAUD_OK,", 8, rate);
+  if (fallbackBaud == 0)
+  {
+    fallbackBaud = serialBaud; // A chain of provisional switches falls back to the last committed rate
+  }
+  baudSwitchMs = millis();
+  burstRemaining = 0;
+  switchBaud(rate);
+}
+
+void cmdBaudCommit(char *)
+{
+  fallbackBaud = 0;
+  replyRate("BAUD_COMMITTED,", 15, serialBaud);
+}
+
+void cmdBurst(char *args)
+{
+  // BURST,<lines>; serviceBurst() streams them between control ticks
+  uint32_t lines = 0;
+  if (!parseUInt(args, lines) || lines == 0 || lines > MAX_BURST_LINES)
+  {
+    replyLine(F("ERR,BURST_RANGE"));
+    return;
+  }
+  burstSeq = 0;
+  burstRemaining = lines;
+}
+
+// ---- Dispatch table ----
+constexpr uint8_t IN_IDLE = 1 << static_cast<uint8_t>(SystemState::IDLE);
+constexpr uint8_t IN_UPLOADING = 1 << static_cast<uint8_t>(SystemState::UPLOADING);
+constexpr uint8_t IN_RUNNING = 1 << static_cast<uint8_t>(SystemState::RUNNING);
+constexpr uint8_t IN_ANY = IN_IDLE | IN_UPLOADING | IN_RUNNING;
+constexpr uint8_t BUSY_WHEN_RUNNING = 0x80; // Reply ERR,BUSY_RUNNING instead of ignoring
+
+struct CommandEntry
+{
+  const char *keyword; // Text before the first ',', ' ' or ':'
+  uint8_t flags;       // IN_* states the command is accepted in
+  void (*handler)(char *args);
+};
+
+// STOP_TM comes first: it is accepted in every state and must always win
+const CommandEntry COMMANDS[] = {
+    {"STOP_TM", IN_ANY, cmdStop},
+    {"HEARTBEAT", IN_IDLE | IN_RUNNING, cmdHeartbeat},
+    {"PING", IN_ANY, cmdPing},
+    {"L", IN_UPLOADING, cmdProfileStep},
+    {"STATS", IN_ANY, cmdStats},
+    {"START_READ", IN_IDLE | BUSY_WHEN_RUNNING, cmdStartRead},
+    {"END_READ", IN_UPLOADING, cmdEndRead},
+    {"PROFILE?", IN_IDLE | BUSY_WHEN_RUNNING, cmdProfileQuery},
+    {"PROFILE_BIN", IN_IDLE | BUSY_WHEN_RUNNING, cmdProfileBinary},
+    {"RUN_TM", IN_IDLE, cmdRun},
+    {"SPD", IN_IDLE | BUSY_WHEN_RUNNING, cmdSpeed},
+    {"STREAM", IN_IDLE | BUSY_WHEN_RUNNING, cmdStream},
+    {"SEQ", IN_IDLE, cmdSequence},
+    {"MODE", IN_IDLE, cmdMode},
+    {"CFG", IN_IDLE, cmdConfig},
+    {"BAUD", IN_IDLE | BUSY_WHEN_RUNNING, cmdBaud},
+    {"BAUD_COMMIT", IN_IDLE, cmdBaudCommit},
+    {"BURST", IN_IDLE | BUSY_WHEN_RUNNING, cmdBurst},
+};
+
+void handleCommand(char *cmd)
+{
+  // Split off the keyword in place
+  char *args = cmd;
+  while (*args && *args != ',' && *args != ' ' && *args != ':')
+  {
+    ++args;
+  }
+  if (*args)
+  {
+    *args++ = '\0';
+  }
 
-  case SystemState::UPLOADING:
-    if (strncmp(cmd, "L:", 2) == 0)
+  const uint8_t stateBit = 1 << static_cast<uint8_t>(systemState);
+  for (const CommandEntry &entry : COMMANDS)
+  {
+    // First-character check rejects most entries without calling strcmp
+    if (entry.keyword[0] != cmd[0] || strcmp(entry.keyword, cmd) != 0)
     {
-      parseProfileCommand(cmd);
+      continue;
     }
-    else if (strcmp(cmd, "END_READ") == 0)
+
+    if (entry.flags & stateBit)
     {
-      systemState = SystemState::IDLE;
-      Serial.println(F("ACK"));
+      entry.handler(args);
+      return;
     }
-    else
+
+    if (systemState == SystemState::RUNNING && (entry.flags & BUSY_WHEN_RUNNING))
     {
-      Serial.println(F("ERR,EXPECTED_PROFILE_DATA"));
+      replyLine(F("ERR,BUSY_RUNNING"));
+      return;
     }
     break;
   }
+
+  // Unknown, or not valid in this state. Everything else is ignored while
+  // running to prevent jitter, and ignored in IDLE as before.
+  if (systemState == SystemState::UPLOADING)
+  {
+    replyLine(F("ERR,EXPECTED_PROFILE_DATA"));
+  }
 }
 
 void pollSerial()
 {
-  while (Serial.available())
+  // Drain what has already arrived, bounded per call. Serial.available() is
+  // read once rather than per character.
+  abortStalledBinaryProfile();
+
+  int pending = Serial.available();
+  if (pending > MAX_RX_BYTES_PER_POLL)
   {
-    char c = Serial.read();
+    pending = MAX_RX_BYTES_PER_POLL;
+  }
+
+  while (pending-- > 0)
+  {
+    // Leave further input in the UART until the TX ring can take the reply
+    // to the next command and still hold two from the rest of loop()
+    if (txFree() < TX_REPLY_RESERVE)
+    {
+      break;
+    }
+
+    int c = Serial.read();
+    if (c < 0)
+    {
+      break; // BAUD restarted the UART mid-drain
+    }
+    if (binaryRemaining > 0)
+    {
+      // PROFILE_BIN payload: no line framing, '\n' is just data here
+      if (!binaryDiscard)
+      {
+        reinterpret_cast<uint8_t *>(profileQueue)[binaryPos] = c;
+      }
+      binaryPos++;
+      binaryLastByteMs = millis();
+      if (--binaryRemaining == 0)
+      {
+        finishBinaryProfile();
+      }
+      continue;
+    }
     if (c == '\n' || c == '\r')
     {
-      if (serialPos > 0)
+      if (serialPos > 0 && !serialOverflow)
       {
         serialBuf[serialPos] = '\0';
         handleCommand(serialBuf);
-        serialPos = 0;
       }
+      serialPos = 0;
+      serialOverflow = false;
+    }
+    else if (serialPos < MAX_CMD_LEN - 1)
+    {
+      serialBuf[serialPos++] = c;
     }
     else
     {
-      if (serialPos < MAX_CMD_LEN - 1)
-      {
-        serialBuf[serialPos++] = c;
-      }
-      else
-      {
-        // Buffer overflow protection: discard characters until newline
-        // This prevents a long garbage string from being interpreted as a valid command prefix
-        // or corrupting the next command.
-      }
+      // Buffer overflow protection: discard the whole line at the next newline
+      // so a long garbage string is never interpreted as a valid command prefix
+      serialOverflow = true;
     }
   }
 }
 
 void publishTelemetry()
 {
-  Serial.print(F("TEL,"));
-  Serial.print(millis());
-  Serial.print(',');
-  Serial.print(motors[0].targetRpm, 2);
-  Serial.print(',');
-  Serial.print(motors[0].actualRpm, 2);
-  Serial.print(',');
-  Serial.print(motors[1].targetRpm, 2);
-  Serial.print(',');
-  Serial.print(motors[1].actualRpm, 2);
-  Serial.print(',');
-  Serial.print(driverHealthy[0]);
-  Serial.print(',');
-  Serial.print(driverHealthy[1]);
-  Serial.print(',');
-  Serial.print(false);
-  Serial.print(',');
-  Serial.println(profileActive);
+  // Format: TEL,timestamp,target1,actual1,target2,actual2,health1,health2,estop,profileActive,dropped,quality1,quality2,seq,setpointSeq
+  char frame[96];
+  char *p = frame;
+
+  memcpy(p, "TEL,", 4);
+  p += 4;
+  p = formatUInt(p, millis());
+  *p++ = ',';
+  p = formatFixed2(p, motors[0].targetRpm);
+  *p++ = ',';
+  p = formatQ16(p, motors[0].actualRpm);
+  *p++ = ',';
+  p = formatFixed2(p, motors[1].targetRpm);
+  *p++ = ',';
+  p = formatQ16(p, motors[1].actualRpm);
+  *p++ = ',';
+  *p++ = driverHealthy[0] ? '1' : '0';
+  *p++ = ',';
+  *p++ = driverHealthy[1] ? '1' : '0';
+  *p++ = ',';
+  *p++ = '0';
+  *p++ = ',';
+  *p++ = profileActive ? '1' : '0';
+  *p++ = ',';
+  p = formatUInt(p, telemetryDropped);
+  *p++ = ',';
+  *p++ = '0' + motors[0].speedQuality;
+  *p++ = ',';
+  *p++ = '0' + motors[1].speedQuality;
+  *p++ = ',';
+  p = formatUInt(p, telemetrySeq++);
+  *p++ = ',';
+  p = formatUInt(p, setpointSeq);
+  *p++ = '\r';
+  *p++ = '\n';
+
+  // Never wait for the UART: if the host is not draining, drop the frame and
+  // let the counter in the next delivered frame report the loss.
+  if (!txEnqueue(frame, p - frame))
+  {
+    telemetryDropped++;
+  }
 }
 
 // ------------------------ Setup & Loop ------------------------
@@ -573,11 +1654,20 @@ void configurePins()
     analogWrite(MOTOR_PINS[i].pwm, 0); // Critical: clear floating state
     setMotorEnable(i, true);
   }
+
+#if ENCODER_EDGE_TIMING
+  for (uint8_t i = 0; i < 2; ++i)
+  {
+    pinMode(ENCODER_TIMING_PIN[i], INPUT_PULLUP);
+  }
+  attachInterrupt(digitalPinToInterrupt(ENCODER_TIMING_PIN[0]), onEncoderEdge0, RISING);
+  attachInterrupt(digitalPinToInterrupt(ENCODER_TIMING_PIN[1]), onEncoderEdge1, RISING);
+#endif
 }
 
 void setup()
 {
-  Serial.begin(500000);
+  Serial.begin(DEFAULT_BAUD);
   loadCalibration();
   configurePins();
 
@@ -588,20 +1678,41 @@ void setup()
   lastControlMicros = micros();
   lastTelemetryMs = millis();
   lastHeartbeatMs = millis(); // Initialize watchdog
-  Serial.println(F("INFO,ARDUINO_MEGA_TREADMILL_READY"));
+  replyLine(F("INFO,ARDUINO_MEGA_TREADMILL_READY"));
 }
 
 void loop()
 {
   unsigned long now = micros();
-  if (now - lastControlMicros >= CONTROL_INTERVAL_US)
+  unsigned long sinceTick = now - lastControlMicros;
+  if (sinceTick >= CONTROL_INTERVAL_US)
   {
+    if (sinceTick >= 2UL * CONTROL_INTERVAL_US)
+    {
+      // Overrun: skip the missed intervals instead of running them back to
+      // back, which would otherwise keep the loop permanently in debt.
+      uint32_t missed = sinceTick / CONTROL_INTERVAL_US - 1;
+      controlOverruns++;
+      controlSkipped += missed;
+      lastControlMicros += missed * CONTROL_INTERVAL_US;
+    }
     lastControlMicros += CONTROL_INTERVAL_US;
+    controlTicks++;
+
     handleProfile();
+    unsigned long controlStart = micros();
     runControl();
+    unsigned long controlEnd = micros();
+    recordTiming(TASK_CONTROL, controlEnd - controlStart);
+    recordTiming(TASK_TICK, controlEnd - now);
   }
 
+  unsigned long serialStart = micros();
   pollSerial();
+  recordTiming(TASK_SERIAL, micros() - serialStart);
+  serviceStats();
+  serviceLink();
+  serviceTx();
 
   // Watchdog: Stop motors if no heartbeat received
   if (systemState == SystemState::RUNNING &&
@@ -612,7 +1723,17 @@ void loop()
     motors[1].targetRpm = 0;
     profileActive = false;
     systemState = SystemState::IDLE;
-    Serial.println(F("ERR,WATCHDOG_TIMEOUT"));
+    replyLine(F("ERR,WATCHDOG_TIMEOUT"));
+  }
+
+  // Same for a setpoint stream whose host stopped sending
+  if (setpointStreaming && millis() - lastSetpointMs > SETPOINT_TIMEOUT_MS)
+  {
+    setpointStreaming = false;
+    disableAllMotors();
+    motors[0].targetRpm = 0;
+    motors[1].targetRpm = 0;
+    replyLine(F("ERR,SETPOINT_TIMEOUT"));
   }
 
   now = millis();
@@ -625,7 +1746,9 @@ void loop()
                      (abs(motors[0].targetRpm) > 0.1f || abs(motors[1].targetRpm) > 0.1f);
     if (systemState != SystemState::UPLOADING && isRunning)
     {
+      unsigned long telemetryStart = micros();
       publishTelemetry();
+      recordTiming(TASK_TELEMETRY, micros() - telemetryStart);
     }
   }
-}
\ No newline at end of file
+}